@@ -115,6 +115,59 @@ START_TEST (test_int32_set_pass_001)
 }
 END_TEST
 
+/* target:
+ *	bool
+ *	pgm_atomic_compare_and_exchange_pointer (
+ *		void* volatile*		atomic,
+ *		void*			oldval,
+ *		void*			newval
+ *	)
+ */
+
+START_TEST (test_pointer_cas_pass_001)
+{
+	int a, b;
+	void* volatile atomic = &a;
+	fail_unless (TRUE == pgm_atomic_compare_and_exchange_pointer (&atomic, &a, &b), "cas failed");
+	fail_unless (&b == atomic, "cas failed");
+	fail_unless (FALSE == pgm_atomic_compare_and_exchange_pointer (&atomic, &a, NULL), "cas failed");
+	fail_unless (&b == atomic, "cas failed");
+}
+END_TEST
+
+START_TEST (test_int64_cas_pass_001)
+{
+	volatile uint64_t atomic = UINT64_C(0xffffffff00000001);
+	fail_unless (TRUE == pgm_atomic_compare_and_exchange64 (&atomic, UINT64_C(0xffffffff00000001), UINT64_C(0x100000000)), "cas failed");
+	fail_unless (UINT64_C(0x100000000) == atomic, "cas failed");
+	fail_unless (FALSE == pgm_atomic_compare_and_exchange64 (&atomic, UINT64_C(0xffffffff00000001), 0), "cas failed");
+	fail_unless (UINT64_C(0x100000000) == atomic, "cas failed");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_atomic_add64 (
+ *		volatile uint64_t*	atomic,
+ *		const uint64_t		val
+ *	)
+ *
+ *	uint64_t
+ *	pgm_atomic_read64 (
+ *		const volatile uint64_t* atomic
+ *	)
+ */
+
+START_TEST (test_int64_add_pass_001)
+{
+	volatile uint64_t atomic = UINT64_C(0xffffffff);
+	pgm_atomic_add64 (&atomic, 1);
+	fail_unless (UINT64_C(0x100000000) == pgm_atomic_read64 (&atomic), "add failed");
+	pgm_atomic_add64 (&atomic, (uint64_t)-2);
+	fail_unless (UINT64_C(0xfffffffe) == pgm_atomic_read64 (&atomic), "add failed");
+}
+END_TEST
+
 
 static
 Suite*
@@ -132,6 +185,7 @@ make_test_suite (void)
 	suite_add_tcase (s, tc_add);
 	tcase_add_test (tc_add, test_int32_add_pass_001);
 	tcase_add_test (tc_add, test_int32_add_pass_002);
+	tcase_add_test (tc_add, test_int64_add_pass_001);
 
 	TCase* tc_get = tcase_create ("get");
 	suite_add_tcase (s, tc_get);
@@ -141,6 +195,11 @@ make_test_suite (void)
 	suite_add_tcase (s, tc_set);
 	tcase_add_test (tc_set, test_int32_set_pass_001);
 
+	TCase* tc_cas = tcase_create ("compare-and-exchange");
+	suite_add_tcase (s, tc_cas);
+	tcase_add_test (tc_cas, test_pointer_cas_pass_001);
+	tcase_add_test (tc_cas, test_int64_cas_pass_001);
+
 	return s;
 }
 
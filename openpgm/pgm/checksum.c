@@ -1111,7 +1111,7 @@ do_csumcpy_sse2 (
 
 		sum = _mm_add_epi32 (sum, lo);
 		sum = _mm_add_epi32 (sum, hi);
-		_mm_store_si128((__m128i*)dstbuf, tmp);
+		_mm_storeu_si128((__m128i*)dstbuf, tmp);
 		srcbuf = &srcbuf[ 16 ];
 		dstbuf = &dstbuf[ 16 ];
 	}
@@ -1409,7 +1409,7 @@ do_csumcpy_avx2 (
 
 		sum = _mm256_add_epi32 (sum, lo);
 		sum = _mm256_add_epi32 (sum, hi);
-		_mm256_store_si256((__m256i*)dstbuf, tmp);
+		_mm256_storeu_si256((__m256i*)dstbuf, tmp);
 		srcbuf = &srcbuf[ 32 ];
 		dstbuf = &dstbuf[ 32 ];
 	}
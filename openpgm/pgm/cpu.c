@@ -37,10 +37,17 @@
 static
 void
 __cpuidex (int cpu_info[4], int function_id, int subfunction_id) {
+// preserve the full %rbx on x86-64, a 32-bit exchange clears the upper half.
   __asm__ volatile (
+#if defined(__x86_64__)
+    "mov %%rbx, %%rdi\n"
+    "cpuid\n"
+    "xchg %%rdi, %%rbx\n"
+#else
     "mov %%ebx, %%edi\n"
     "cpuid\n"
     "xchg %%edi, %%ebx\n"
+#endif
     : "=a"(cpu_info[0]), "=D"(cpu_info[1]), "=c"(cpu_info[2]), "=d"(cpu_info[3])
     : "a"(function_id), "c"(subfunction_id)
   );
@@ -93,6 +100,46 @@ pgm_cpuid (pgm_cpu_t* cpu)
 			(cpu_info[2] & 0x08000000) != 0 /* OSXSAVE */ &&
 			(_xgetbv(0) & 6) == 6 /* XSAVE enabled by kernel */;
 	cpu->has_avx2 = cpu->has_avx && (cpu_info7[1] & 0x00000020) != 0;
+	cpu->has_avx512bw = cpu->has_avx &&
+			(cpu_info7[1] & 0x00010000) != 0 /* AVX512F */ &&
+			(cpu_info7[1] & 0x40000000) != 0 &&
+			(_xgetbv(0) & 0xe6) == 0xe6 /* opmask & ZMM state enabled by kernel */;
+	cpu->has_gfni =  (cpu_info7[2] & 0x00000100) != 0;
+}
+
+/* invariant TSC frequency as enumerated by the processor or hypervisor,
+ * returns 0 when neither reports it.
+ *
+ * leaf 0x15 gives the TSC to core crystal ratio, exact when the crystal
+ * frequency is also reported.  leaf 0x16 is only the nominal base frequency
+ * and is not used.
+ */
+
+PGM_GNUC_INTERNAL
+uint32_t
+pgm_cpuid_tsc_khz (void)
+{
+	int cpu_info[4] = {0};
+	__cpuidex (cpu_info, 0x0, 0x0);
+	const int num_ids = cpu_info[0];
+	if (num_ids >= 0x15) {
+		__cpuidex (cpu_info, 0x15, 0x0);
+		const uint32_t denominator = (uint32_t)cpu_info[0];
+		const uint32_t numerator   = (uint32_t)cpu_info[1];
+		const uint32_t crystal_hz  = (uint32_t)cpu_info[2];
+		if (0 != denominator && 0 != numerator && 0 != crystal_hz)
+			return (uint32_t)(((uint64_t)crystal_hz * numerator / denominator) / 1000);
+	}
+/* hypervisor timing leaf, EAX is the guest TSC frequency in kHz */
+	__cpuidex (cpu_info, 0x1, 0x0);
+	if (cpu_info[2] & 0x80000000) {
+		__cpuidex (cpu_info, 0x40000000, 0x0);
+		if ((uint32_t)cpu_info[0] >= 0x40000010) {
+			__cpuidex (cpu_info, 0x40000010, 0x0);
+			return (uint32_t)cpu_info[0];
+		}
+	}
+	return 0;
 }
 #else
 PGM_GNUC_INTERNAL
@@ -101,6 +148,13 @@ pgm_cpuid (pgm_cpu_t* cpu)
 {
 	memset(cpu, 0, sizeof(pgm_cpu_t));
 }
+
+PGM_GNUC_INTERNAL
+uint32_t
+pgm_cpuid_tsc_khz (void)
+{
+	return 0;
+}
 #endif
 
 /* eof */
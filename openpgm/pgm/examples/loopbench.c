@@ -0,0 +1,595 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Loopback transport benchmark.  One source and a set of receivers in a
+ * single process exchange messages over the in-process transport with
+ * simulated loss, duplication, reordering and delay, measuring throughput,
+ * repair latency and processor time per message.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#	include <time.h>
+#	include <unistd.h>
+#	include <getopt.h>
+#	include <sys/time.h>
+#	include <sys/resource.h>
+#else
+#	include "getopt.h"
+#endif
+#ifdef __APPLE__
+#	include <pgm/in.h>
+#endif
+#include <pgm/pgm.h>
+
+
+/* globals */
+
+#define MAX_RECEIVERS		64
+
+static int		port = 0;
+static const char*	network = ";239.192.0.1";
+static int		udp_encap_port = 7500;
+
+static int		max_tpdu = 1500;
+static int		max_rte = 0;			/* unregulated */
+static int		txw_sqns = 1000;
+static int		rxw_sqns = 1000;
+static int		nak_bo_ivl = 50;		/* milliseconds */
+
+static bool		use_fec = FALSE;
+static bool		use_proactive_parity = FALSE;
+static bool		use_ondemand_parity = FALSE;
+static int		rs_k = 8;
+static int		rs_n = 255;
+static int		rs_h = 1;
+
+static unsigned		message_count = 100000;
+static unsigned		message_size = 1000;
+static unsigned		receiver_count = 1;
+static unsigned		linger_secs = 5;		/* give up without progress */
+static struct pgm_loopbackinfo_t impairment;
+
+static pgm_sock_t*	source = NULL;
+static pgm_sock_t*	receivers[ MAX_RECEIVERS ];
+
+#ifndef _MSC_VER
+static void usage (const char*) __attribute__((__noreturn__));
+#else
+static void usage (const char*);
+#endif
+static pgm_sock_t* create_sock (bool, unsigned);
+static bool drain (pgm_sock_t*, char*, size_t, uint64_t*, unsigned*);
+static long time_remain (pgm_sock_t*);
+static uint64_t now_usecs (void);
+static uint64_t cpu_usecs (void);
+
+
+static void
+usage (
+	const char*	bin
+	)
+{
+	fprintf (stderr, "Usage: %s [options]\n", bin);
+	fprintf (stderr, "  -n, --network NETWORK    : Multicast group or unicast IP address\n");
+	fprintf (stderr, "  -s, --service PORT       : IP port\n");
+	fprintf (stderr, "  -p, --port PORT          : UDP encapsulation port\n");
+	fprintf (stderr, "  -c, --count COUNT        : Messages to send (100000)\n");
+	fprintf (stderr, "  -z, --size BYTES         : Message size (1000)\n");
+	fprintf (stderr, "  -R, --receivers COUNT    : Receiving sockets (1)\n");
+	fprintf (stderr, "  -r, --speed-limit RATE   : Regulate to RATE bytes per second\n");
+	fprintf (stderr, "  -w, --txw SQNS           : Transmit window size in sequence numbers (1000)\n");
+	fprintf (stderr, "  -W, --rxw SQNS           : Receive window size in sequence numbers (1000)\n");
+	fprintf (stderr, "  -b, --nak-backoff MSECS  : NAK back-off interval (50)\n");
+	fprintf (stderr, "  -f, --enable-fec TYPE    : Enable FEC: proactive, ondemand, or both\n");
+	fprintf (stderr, "  -N N                     : Reed-Solomon block size (255)\n");
+	fprintf (stderr, "  -K K                     : Reed-Solomon group size (8)\n");
+	fprintf (stderr, "  -P H                     : Proactive parity packets per group (1)\n");
+	fprintf (stderr, "  -L, --loss PPM           : Packet loss in parts per million\n");
+	fprintf (stderr, "  -D, --duplicate PPM      : Packet duplication in parts per million\n");
+	fprintf (stderr, "  -O, --reorder PPM        : Packet reordering in parts per million\n");
+	fprintf (stderr, "  -d, --delay USECS        : Delivery delay\n");
+	fprintf (stderr, "  -Z, --ring PACKETS       : Receive ring size\n");
+	fprintf (stderr, "  -S, --seed SEED          : Impairment random seed, 0 for random\n");
+	fprintf (stderr, "  -t, --linger SECS        : Give up after SECS without progress (5)\n");
+	exit (EXIT_SUCCESS);
+}
+
+int
+main (
+	int	argc,
+	char   *argv[]
+	)
+{
+	pgm_error_t* pgm_err = NULL;
+	int retval = EXIT_FAILURE;
+
+	setlocale (LC_ALL, "");
+
+	if (!pgm_init (&pgm_err)) {
+		fprintf (stderr, "Unable to start PGM engine: %s\n", pgm_err->message);
+		pgm_error_free (pgm_err);
+		return EXIT_FAILURE;
+	}
+
+/* parse program arguments */
+#ifdef _WIN32
+	const char* binary_name = strrchr (argv[0], '\\');
+#else
+	const char* binary_name = strrchr (argv[0], '/');
+#endif
+	if (NULL == binary_name)	binary_name = argv[0];
+	else				binary_name++;
+
+	static struct option long_options[] = {
+		{ "network",        required_argument, NULL, 'n' },
+		{ "service",        required_argument, NULL, 's' },
+		{ "port",           required_argument, NULL, 'p' },
+		{ "count",          required_argument, NULL, 'c' },
+		{ "size",           required_argument, NULL, 'z' },
+		{ "receivers",      required_argument, NULL, 'R' },
+		{ "speed-limit",    required_argument, NULL, 'r' },
+		{ "txw",            required_argument, NULL, 'w' },
+		{ "rxw",            required_argument, NULL, 'W' },
+		{ "nak-backoff",    required_argument, NULL, 'b' },
+		{ "enable-fec",     required_argument, NULL, 'f' },
+		{ "loss",           required_argument, NULL, 'L' },
+		{ "duplicate",      required_argument, NULL, 'D' },
+		{ "reorder",        required_argument, NULL, 'O' },
+		{ "delay",          required_argument, NULL, 'd' },
+		{ "ring",           required_argument, NULL, 'Z' },
+		{ "seed",           required_argument, NULL, 'S' },
+		{ "linger",         required_argument, NULL, 't' },
+		{ "help",           no_argument,       NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "n:s:p:c:z:R:r:w:W:b:f:N:K:P:L:D:O:d:Z:S:t:h", long_options, NULL)) != -1)
+	{
+		switch (c) {
+		case 'n':	network = optarg; break;
+		case 's':	port = atoi (optarg); break;
+		case 'p':	udp_encap_port = atoi (optarg); break;
+		case 'c':	message_count = (unsigned)atoi (optarg); break;
+		case 'z':	message_size = (unsigned)atoi (optarg); break;
+		case 'R':	receiver_count = (unsigned)atoi (optarg); break;
+		case 'r':	max_rte = atoi (optarg); break;
+		case 'w':	txw_sqns = atoi (optarg); break;
+		case 'W':	rxw_sqns = atoi (optarg); break;
+		case 'b':	nak_bo_ivl = atoi (optarg); break;
+		case 'f':
+			use_fec = TRUE;
+			use_proactive_parity = (0 != strcmp (optarg, "ondemand"));
+			use_ondemand_parity = (0 != strcmp (optarg, "proactive"));
+			break;
+		case 'N':	rs_n = atoi (optarg); break;
+		case 'K':	rs_k = atoi (optarg); break;
+		case 'P':	rs_h = atoi (optarg); break;
+		case 'L':	impairment.loss_rate = (uint32_t)atoi (optarg); break;
+		case 'D':	impairment.duplicate_rate = (uint32_t)atoi (optarg); break;
+		case 'O':	impairment.reorder_rate = (uint32_t)atoi (optarg); break;
+		case 'd':	impairment.delay = (uint32_t)atoi (optarg); break;
+		case 'Z':	impairment.ring_size = (uint32_t)atoi (optarg); break;
+		case 'S':	impairment.seed = (uint32_t)atoi (optarg); break;
+		case 't':	linger_secs = (unsigned)atoi (optarg); break;
+
+		case 'h':
+		case '?':
+			usage (binary_name);
+		}
+	}
+
+	if (use_fec && ( !rs_n || !rs_k )) {
+		fprintf (stderr, "Invalid Reed-Solomon parameters RS(%d,%d).\n", rs_n, rs_k);
+		usage (binary_name);
+	}
+	if (0 == message_count || 0 == message_size) {
+		fprintf (stderr, "Invalid message count or size.\n");
+		usage (binary_name);
+	}
+	if (0 == receiver_count || receiver_count > MAX_RECEIVERS) {
+		fprintf (stderr, "Receiver count must be between 1 and %d.\n", MAX_RECEIVERS);
+		usage (binary_name);
+	}
+
+/* receivers first so that no data precedes them */
+	for (unsigned i = 0; i < receiver_count; i++)
+		if (NULL == (receivers[i] = create_sock (FALSE, i)))
+			goto cleanup;
+	if (NULL == (source = create_sock (TRUE, 0)))
+		goto cleanup;
+
+	printf ("Sending %u messages of %u bytes to %u receivers, loss %u ppm, duplicate %u ppm, reorder %u ppm, delay %u us.\n",
+		message_count, message_size, receiver_count,
+		impairment.loss_rate, impairment.duplicate_rate, impairment.reorder_rate, impairment.delay);
+	fflush (stdout);
+
+	char* buffer = malloc (message_size);
+	memset (buffer, 'x', message_size);
+	const uint64_t expected = (uint64_t)message_count * receiver_count;
+	uint64_t received = 0;
+	unsigned resets = 0, sent = 0;
+	const uint64_t start = now_usecs();
+	const uint64_t cpu_start = cpu_usecs();
+	uint64_t last_progress = start;
+
+/* one message per round, then every socket is serviced until it would block.
+ * a round without progress sleeps until the earliest timer or delayed packet.
+ */
+	while (received < expected)
+	{
+		bool is_active = FALSE;
+		if (sent < message_count) {
+			const int status = pgm_send (source, buffer, message_size, NULL);
+			if (PGM_IO_STATUS_NORMAL == status) {
+				sent++;
+				is_active = TRUE;
+			} else if (PGM_IO_STATUS_ERROR == status) {
+				fprintf (stderr, "pgm_send() failed.\n");
+				break;
+			}
+		}
+		drain (source, buffer, message_size, NULL, NULL);
+		for (unsigned i = 0; i < receiver_count; i++)
+			if (drain (receivers[i], buffer, message_size, &received, &resets))
+				is_active = TRUE;
+		if (is_active) {
+			last_progress = now_usecs();
+			continue;
+		}
+		if (sent == message_count &&
+		    now_usecs() - last_progress > (uint64_t)linger_secs * 1000000)
+		{
+			fprintf (stderr, "No progress for %u seconds, giving up.\n", linger_secs);
+			break;
+		}
+		long wait = time_remain (source);
+		for (unsigned i = 0; i < receiver_count; i++) {
+			const long remain = time_remain (receivers[i]);
+			if (remain < wait) wait = remain;
+		}
+		if (wait > 100 * 1000)
+			wait = 100 * 1000;
+		if (wait > 0) {
+#ifndef _WIN32
+			usleep ((useconds_t)wait);
+#else
+			Sleep ((DWORD)((wait + 999) / 1000));
+#endif
+		}
+	}
+
+/* exclude the idle linger from throughput */
+	const uint64_t elapsed = (received < expected ? last_progress : now_usecs()) - start;
+	const uint64_t cpu = cpu_usecs() - cpu_start;
+	free (buffer);
+
+/* report */
+	struct pgm_hdr_snapshot_t total, snapshot;
+	memset (&total, 0, sizeof(total));
+	for (unsigned i = 0; i < receiver_count; i++) {
+		if (!pgm_hdr_snapshot (receivers[i], NULL, PGM_HDR_REPAIR_TIME, PGM_HDR_CUMULATIVE, &snapshot))
+			continue;
+		total.hs_count += snapshot.hs_count;
+		total.hs_sum   += snapshot.hs_sum;
+		for (unsigned j = 0; j < PGM_HDR_BUCKETS; j++)
+			total.hs_counts[j] += snapshot.hs_counts[j];
+	}
+	struct pgm_repairinfo_t repairinfo;
+	socklen_t optlen = sizeof(repairinfo);
+	memset (&repairinfo, 0, sizeof(repairinfo));
+	pgm_getsockopt (source, IPPROTO_PGM, PGM_REPAIR_INFO, &repairinfo, &optlen);
+
+	const double secs = (double)elapsed / 1000000.0;
+	printf ("Received %llu of %llu messages in %.3f seconds, %u data loss resets.\n",
+		(unsigned long long)received, (unsigned long long)expected, secs, resets);
+	printf ("Throughput %.0f messages/s, %.2f MB/s per receiver.\n",
+		secs > 0.0 ? (double)received / receiver_count / secs : 0.0,
+		secs > 0.0 ? (double)received * message_size / receiver_count / secs / (1024.0 * 1024.0) : 0.0);
+	printf ("Repairs %llu, RDATA sent %u, latency mean %.0f us, p50 %llu us, p99 %llu us, max %llu us.\n",
+		(unsigned long long)total.hs_count,
+		repairinfo.repairs,
+		total.hs_count ? (double)total.hs_sum / (double)total.hs_count : 0.0,
+		(unsigned long long)pgm_hdr_percentile (&total, 50.0),
+		(unsigned long long)pgm_hdr_percentile (&total, 99.0),
+		(unsigned long long)pgm_hdr_percentile (&total, 100.0));
+	printf ("CPU %.3f us per message sent, %.3f seconds total.\n",
+		sent ? (double)cpu / sent : 0.0,
+		(double)cpu / 1000000.0);
+	retval = (received == expected) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+cleanup:
+	if (source) {
+		pgm_close (source, FALSE);
+		source = NULL;
+	}
+	for (unsigned i = 0; i < receiver_count; i++) {
+		if (receivers[i]) {
+			pgm_close (receivers[i], FALSE);
+			receivers[i] = NULL;
+		}
+	}
+	pgm_shutdown();
+	return retval;
+}
+
+/* read until the socket would block, returns TRUE if any message was
+ * delivered or lost.
+ */
+
+static
+bool
+drain (
+	pgm_sock_t*	sock,
+	char*		buf,
+	size_t		buflen,
+	uint64_t*	received,		/* NULL for the source */
+	unsigned*	resets
+	)
+{
+	bool is_active = FALSE;
+
+	for (;;) {
+		pgm_error_t* pgm_err = NULL;
+		size_t len;
+		const int status = pgm_recv (sock, buf, buflen, 0, &len, &pgm_err);
+		switch (status) {
+		case PGM_IO_STATUS_NORMAL:
+			if (received) (*received)++;
+			is_active = TRUE;
+			break;
+		case PGM_IO_STATUS_RESET:
+			if (resets) (*resets)++;
+			pgm_error_free (pgm_err);
+			is_active = TRUE;
+			break;
+		case PGM_IO_STATUS_TIMER_PENDING:
+		case PGM_IO_STATUS_RATE_LIMITED:
+		case PGM_IO_STATUS_WOULD_BLOCK:
+			return is_active;
+		default:
+			if (pgm_err) {
+				fprintf (stderr, "%s\n", pgm_err->message);
+				pgm_error_free (pgm_err);
+			}
+			return is_active;
+		}
+	}
+}
+
+/* microseconds until the socket has work, covering timers, rate regulation
+ * and delayed packets.
+ */
+
+static
+long
+time_remain (
+	pgm_sock_t*	sock
+	)
+{
+	struct timeval tv;
+	socklen_t optlen = sizeof(tv);
+	long remain;
+	if (!pgm_getsockopt (sock, IPPROTO_PGM, PGM_TIME_REMAIN, &tv, &optlen))
+		return 0;
+	remain = tv.tv_sec * 1000000L + tv.tv_usec;
+	if (0 != max_rte && pgm_getsockopt (sock, IPPROTO_PGM, PGM_RATE_REMAIN, &tv, &optlen)) {
+		const long rate_remain = tv.tv_sec * 1000000L + tv.tv_usec;
+		if (rate_remain > 0 && rate_remain < remain)
+			remain = rate_remain;
+	}
+	return remain;
+}
+
+static
+uint64_t
+now_usecs (void)
+{
+#ifndef _WIN32
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency (&frequency);
+	QueryPerformanceCounter (&counter);
+	return (uint64_t)(counter.QuadPart / (frequency.QuadPart / 1000000));
+#endif
+}
+
+/* user and system processor time of the process */
+
+static
+uint64_t
+cpu_usecs (void)
+{
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+	       usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#else
+	FILETIME creation, exit, kernel, user;
+	ULARGE_INTEGER k, u;
+	GetProcessTimes (GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) / 10;
+#endif
+}
+
+static
+pgm_sock_t*
+create_sock (
+	bool		is_source,
+	unsigned	index
+	)
+{
+	struct pgm_addrinfo_t* res = NULL;
+	pgm_error_t* pgm_err = NULL;
+	pgm_sock_t* sock = NULL;
+	sa_family_t sa_family = AF_UNSPEC;
+
+/* parse network parameter into PGM socket address structure */
+	if (!pgm_getaddrinfo (network, NULL, &res, &pgm_err)) {
+		fprintf (stderr, "Parsing network parameter: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+
+	sa_family = res->ai_send_addrs[0].gsr_group.ss_family;
+
+	if (!pgm_socket (&sock, sa_family, SOCK_SEQPACKET, IPPROTO_UDP, &pgm_err)) {
+		fprintf (stderr, "Creating PGM/UDP socket: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_UDP_ENCAP_UCAST_PORT, &udp_encap_port, sizeof(udp_encap_port));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_UDP_ENCAP_MCAST_PORT, &udp_encap_port, sizeof(udp_encap_port));
+
+/* in-process transport, impairments apply to data delivered to receivers */
+	struct pgm_loopbackinfo_t loopbackinfo;
+	memset (&loopbackinfo, 0, sizeof(loopbackinfo));
+	loopbackinfo.ring_size = impairment.ring_size;
+	if (!is_source) {
+		loopbackinfo = impairment;
+		if (impairment.seed)
+			loopbackinfo.seed = impairment.seed + index;
+	}
+	if (!pgm_setsockopt (sock, IPPROTO_PGM, PGM_LOOPBACK, &loopbackinfo, sizeof(loopbackinfo))) {
+		fprintf (stderr, "Invalid loopback transport parameters.\n");
+		goto err_abort;
+	}
+
+	const int no_router_assist = 0;
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_IP_ROUTER_ALERT, &no_router_assist, sizeof(no_router_assist));
+
+/* set PGM parameters, the source also receives NAKs */
+	const int passive = 0,
+		  peer_expiry = pgm_secs (300),
+		  spmr_expiry = pgm_msecs (250),
+		  nak_bo = pgm_msecs (nak_bo_ivl),
+		  nak_rpt_ivl = pgm_msecs (200),
+		  nak_rdata_ivl = pgm_msecs (200),
+		  nak_data_retries = 50,
+		  nak_ncf_retries = 50;
+
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_MTU, &max_tpdu, sizeof(max_tpdu));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_PASSIVE, &passive, sizeof(passive));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_RXW_SQNS, &rxw_sqns, sizeof(rxw_sqns));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_PEER_EXPIRY, &peer_expiry, sizeof(peer_expiry));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_SPMR_EXPIRY, &spmr_expiry, sizeof(spmr_expiry));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_BO_IVL, &nak_bo, sizeof(nak_bo));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_RPT_IVL, &nak_rpt_ivl, sizeof(nak_rpt_ivl));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_RDATA_IVL, &nak_rdata_ivl, sizeof(nak_rdata_ivl));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_DATA_RETRIES, &nak_data_retries, sizeof(nak_data_retries));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_NCF_RETRIES, &nak_ncf_retries, sizeof(nak_ncf_retries));
+	if (is_source) {
+		const int ambient_spm = pgm_secs (30),
+			  heartbeat_spm[] = { pgm_msecs (100),
+					      pgm_msecs (100),
+					      pgm_msecs (100),
+					      pgm_msecs (100),
+					      pgm_msecs (1300),
+					      pgm_secs  (7),
+					      pgm_secs  (16),
+					      pgm_secs  (25),
+					      pgm_secs  (30) };
+
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_TXW_SQNS, &txw_sqns, sizeof(txw_sqns));
+		if (max_rte)
+			pgm_setsockopt (sock, IPPROTO_PGM, PGM_TXW_MAX_RTE, &max_rte, sizeof(max_rte));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_AMBIENT_SPM, &ambient_spm, sizeof(ambient_spm));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_HEARTBEAT_SPM, &heartbeat_spm, sizeof(heartbeat_spm));
+	} else {
+		const int recv_only = 1;
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_RECV_ONLY, &recv_only, sizeof(recv_only));
+	}
+	if (use_fec) {
+		struct pgm_fecinfo_t fecinfo;
+		fecinfo.block_size		= rs_n;
+		fecinfo.proactive_packets	= use_proactive_parity ? rs_h : 0;
+		fecinfo.group_size		= rs_k;
+		fecinfo.ondemand_parity_enabled	= use_ondemand_parity;
+		fecinfo.var_pktlen_enabled	= TRUE;
+		if (!pgm_setsockopt (sock, IPPROTO_PGM, PGM_USE_FEC, &fecinfo, sizeof(fecinfo))) {
+			fprintf (stderr, "Invalid FEC parameters RS(%d,%d) with %d proactive packets.\n", rs_n, rs_k, rs_h);
+			goto err_abort;
+		}
+	}
+
+/* create global session identifier */
+	struct pgm_sockaddr_t addr;
+	memset (&addr, 0, sizeof(addr));
+	addr.sa_port = port ? port : DEFAULT_DATA_DESTINATION_PORT;
+	addr.sa_addr.sport = is_source ? DEFAULT_DATA_SOURCE_PORT : 0;
+	if (!pgm_gsi_create_from_hostname (&addr.sa_addr.gsi, &pgm_err)) {
+		fprintf (stderr, "Creating GSI: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+
+/* assign socket to specified address */
+	struct pgm_interface_req_t if_req;
+	memset (&if_req, 0, sizeof(if_req));
+	if_req.ir_interface = res->ai_recv_addrs[0].gsr_interface;
+	memcpy (&if_req.ir_address, &res->ai_send_addrs[0].gsr_addr, sizeof(struct sockaddr_storage));
+	if (!pgm_bind3 (sock,
+			&addr, sizeof(addr),
+			&if_req, sizeof(if_req),	/* tx interface */
+			&if_req, sizeof(if_req),	/* rx interface */
+			&pgm_err))
+	{
+		fprintf (stderr, "Binding PGM socket: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+
+/* join IP multicast groups */
+	for (unsigned i = 0; i < res->ai_recv_addrs_len; i++)
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_JOIN_GROUP, &res->ai_recv_addrs[i], sizeof(struct pgm_group_source_req));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_SEND_GROUP, &res->ai_send_addrs[0], sizeof(struct pgm_group_source_req));
+	pgm_freeaddrinfo (res);
+	res = NULL;
+
+	const int nonblocking = 1;
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_NOBLOCK, &nonblocking, sizeof(nonblocking));
+
+	if (!pgm_connect (sock, &pgm_err)) {
+		fprintf (stderr, "Connecting PGM socket: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+	return sock;
+
+err_abort:
+	if (NULL != sock) {
+		pgm_close (sock, FALSE);
+		sock = NULL;
+	}
+	if (NULL != res) {
+		pgm_freeaddrinfo (res);
+		res = NULL;
+	}
+	if (NULL != pgm_err) {
+		pgm_error_free (pgm_err);
+		pgm_err = NULL;
+	}
+	return NULL;
+}
+
+/* eof */
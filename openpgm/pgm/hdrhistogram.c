@@ -0,0 +1,251 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Per-socket and per-peer log-linear histograms.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <string.h>
+#include <impl/framework.h>
+
+
+//#define HDRHISTOGRAM_DEBUG
+
+#ifndef HDRHISTOGRAM_DEBUG
+#	define PGM_DISABLE_ASSERT
+#endif
+
+#if defined( __GNUC__ ) || defined( __SUNPRO_C )
+#	define PGM_HDR_TLS	__thread
+#elif defined( _MSC_VER )
+#	define PGM_HDR_TLS	__declspec(thread)
+#endif
+
+/* threads are numbered on their first recording, the number selects the
+ * shard of every histogram the thread writes to.
+ */
+static volatile uint32_t hdr_thread_count = 0;
+#ifdef PGM_HDR_TLS
+static PGM_HDR_TLS uint32_t hdr_thread_id = 0;		/* 1-based, 0 unassigned */
+#endif
+
+static inline
+unsigned
+_pgm_hdr_thread_id (void)
+{
+#ifdef PGM_HDR_TLS
+	if (PGM_UNLIKELY(0 == hdr_thread_id))
+		hdr_thread_id = pgm_atomic_exchange_and_add32 (&hdr_thread_count, 1) + 1;
+	return hdr_thread_id - 1;
+#else
+	return 0;
+#endif
+}
+
+/* shard count is rounded up to a power of two, 1 <= shards <= PGM_HDR_MAX_SHARDS
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_hdr_init (
+	pgm_hdr_t* const	hdr,
+	const unsigned		shards
+	)
+{
+	unsigned n = 1;
+
+/* pre-conditions */
+	pgm_assert (NULL != hdr);
+	pgm_assert_cmpuint (shards, >, 0);
+
+	while (n < shards && n < PGM_HDR_MAX_SHARDS)
+		n <<= 1;
+	hdr->shards	= pgm_new0 (struct pgm_hdr_shard_t, n);
+	hdr->shard_mask	= n - 1;
+	hdr->marks	= NULL;
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_hdr_destroy (
+	pgm_hdr_t* const	hdr
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != hdr);
+
+	if (hdr->marks) {
+		pgm_free (hdr->marks);
+		hdr->marks = NULL;
+	}
+	pgm_free (hdr->shards);
+	hdr->shards = NULL;
+}
+
+/* add one sample, safe against concurrent recording and reading.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_hdr_record (
+	pgm_hdr_t* const	hdr,
+	const uint64_t		value
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != hdr);
+	pgm_assert (NULL != hdr->shards);
+
+	struct pgm_hdr_shard_t* shard = &hdr->shards[ _pgm_hdr_thread_id() & hdr->shard_mask ];
+	pgm_atomic_add64 (&shard->counts[ pgm_hdr_bucket (value) ], 1);
+	pgm_atomic_add64 (&shard->sum, value);
+}
+
+/* total over all shards, the sample count is taken from the buckets so that
+ * a snapshot racing a writer is never inconsistent with itself.
+ */
+
+static
+void
+_pgm_hdr_total (
+	const pgm_hdr_t*           const restrict hdr,
+	struct pgm_hdr_snapshot_t* const restrict total
+	)
+{
+	memset (total, 0, sizeof(struct pgm_hdr_snapshot_t));
+	for (unsigned i = 0; i <= hdr->shard_mask; i++) {
+		const struct pgm_hdr_shard_t* shard = &hdr->shards[ i ];
+		for (unsigned j = 0; j < PGM_HDR_BUCKETS; j++) {
+			const uint64_t count = pgm_atomic_read64 (&shard->counts[ j ]);
+			total->hs_counts[ j ] += count;
+			total->hs_count       += count;
+		}
+		total->hs_sum += pgm_atomic_read64 (&shard->sum);
+	}
+}
+
+static
+void
+_pgm_hdr_subtract (
+	struct pgm_hdr_snapshot_t*       const restrict snapshot,
+	const struct pgm_hdr_snapshot_t* const restrict base
+	)
+{
+	for (unsigned j = 0; j < PGM_HDR_BUCKETS; j++)
+		snapshot->hs_counts[ j ] -= base->hs_counts[ j ];
+	snapshot->hs_count -= base->hs_count;
+	snapshot->hs_sum   -= base->hs_sum;
+}
+
+/* copy the samples since the last reset, or for PGM_HDR_DELTA since the
+ * previous delta read.  readers must be serialised by the caller.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_hdr_read (
+	pgm_hdr_t*                 const restrict hdr,
+	const int				  mode,
+	struct pgm_hdr_snapshot_t* const restrict snapshot
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != hdr);
+	pgm_assert (PGM_HDR_CUMULATIVE == mode || PGM_HDR_DELTA == mode);
+	pgm_assert (NULL != snapshot);
+
+	_pgm_hdr_total (hdr, snapshot);
+	if (PGM_HDR_DELTA == mode) {
+		if (NULL == hdr->marks)
+			hdr->marks = pgm_new0 (struct pgm_hdr_snapshot_t, 2);
+		struct pgm_hdr_snapshot_t* mark = &hdr->marks[ 1 ];
+		const struct pgm_hdr_snapshot_t previous = *mark;
+		*mark = *snapshot;
+		_pgm_hdr_subtract (snapshot, &previous);
+	}
+	else if (NULL != hdr->marks)
+		_pgm_hdr_subtract (snapshot, &hdr->marks[ 0 ]);
+}
+
+/* restart cumulative and delta reads from the current totals.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_hdr_clear (
+	pgm_hdr_t* const	hdr
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != hdr);
+
+	if (NULL == hdr->marks)
+		hdr->marks = pgm_new0 (struct pgm_hdr_snapshot_t, 2);
+	_pgm_hdr_total (hdr, &hdr->marks[ 0 ]);
+	hdr->marks[ 1 ] = hdr->marks[ 0 ];
+}
+
+/* lowest value counted in a bucket, PGM_HDR_BUCKETS returns one past the
+ * highest value so that the upper bound of bucket i is lowest (i + 1) - 1.
+ */
+
+uint64_t
+pgm_hdr_bucket_lowest (
+	const unsigned		bucket
+	)
+{
+	if (bucket >= PGM_HDR_BUCKETS)
+		return (uint64_t)1 << PGM_HDR_VALUE_BITS;
+	if (bucket < (1U << PGM_HDR_SUB_BITS))
+		return bucket;
+	const unsigned msb = (bucket >> PGM_HDR_SUB_BITS) + PGM_HDR_SUB_BITS - 1;
+	const uint64_t sub = bucket & ((1U << PGM_HDR_SUB_BITS) - 1);
+	return ((1U << PGM_HDR_SUB_BITS) + sub) << (msb - PGM_HDR_SUB_BITS);
+}
+
+/* highest value of the bucket holding the given percentile, 0 <= percentile <= 100,
+ * returns 0 for an empty snapshot.
+ */
+
+uint64_t
+pgm_hdr_percentile (
+	const struct pgm_hdr_snapshot_t* const	snapshot,
+	const double				percentile
+	)
+{
+	pgm_return_val_if_fail (NULL != snapshot, 0);
+	pgm_return_val_if_fail (percentile >= 0.0 && percentile <= 100.0, 0);
+
+	if (0 == snapshot->hs_count)
+		return 0;
+
+	uint64_t target = (uint64_t)((percentile / 100.0) * (double)snapshot->hs_count + 0.5);
+	if (0 == target)
+		target = 1;
+	uint64_t seen = 0;
+	for (unsigned j = 0; j < PGM_HDR_BUCKETS; j++) {
+		seen += snapshot->hs_counts[ j ];
+		if (seen >= target)
+			return pgm_hdr_bucket_lowest (j + 1) - 1;
+	}
+	return pgm_hdr_bucket_lowest (PGM_HDR_BUCKETS) - 1;
+}
+
+/* eof */
@@ -0,0 +1,284 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for log-linear histograms.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+
+/* mock state */
+
+#define TEST_THREADS		4
+#define TEST_THREAD_SAMPLES	100000
+
+
+#define HDRHISTOGRAM_DEBUG
+#include "hdrhistogram.c"
+
+
+/* target:
+ *	unsigned
+ *	pgm_hdr_bucket (
+ *		uint64_t	value
+ *	)
+ *
+ *	uint64_t
+ *	pgm_hdr_bucket_lowest (
+ *		const unsigned	bucket
+ *	)
+ */
+
+/* every value lies within the bounds of its bucket */
+START_TEST (test_bucket_pass_001)
+{
+	unsigned last = 0;
+	for (uint64_t value = 0; value < 100000; value++) {
+		const unsigned bucket = pgm_hdr_bucket (value);
+		fail_unless (bucket < PGM_HDR_BUCKETS, "bucket out of range");
+		fail_unless (bucket >= last, "bucket not monotonic");
+		fail_unless (pgm_hdr_bucket_lowest (bucket) <= value, "below bucket");
+		fail_unless (pgm_hdr_bucket_lowest (bucket + 1) > value, "above bucket");
+		last = bucket;
+	}
+	for (unsigned shift = 3; shift < PGM_HDR_VALUE_BITS; shift++) {
+		const uint64_t value = (uint64_t)1 << shift;
+		fail_unless (pgm_hdr_bucket_lowest (pgm_hdr_bucket (value)) == value, "power of two not a bucket boundary");
+		fail_unless (pgm_hdr_bucket (value - 1) + 1 == pgm_hdr_bucket (value), "gap at power of two");
+	}
+}
+END_TEST
+
+/* exact below 2^SUB_BITS, saturates above 2^32 - 1 */
+START_TEST (test_bucket_pass_002)
+{
+	for (unsigned value = 0; value < (1U << PGM_HDR_SUB_BITS); value++)
+		fail_unless (value == pgm_hdr_bucket (value), "small value not exact");
+	fail_unless (PGM_HDR_BUCKETS - 1 == pgm_hdr_bucket (UINT32_MAX), "max value not in last bucket");
+	fail_unless (PGM_HDR_BUCKETS - 1 == pgm_hdr_bucket (UINT64_MAX), "value did not saturate");
+	fail_unless (((uint64_t)1 << PGM_HDR_VALUE_BITS) == pgm_hdr_bucket_lowest (PGM_HDR_BUCKETS), "end bound");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_hdr_record (
+ *		pgm_hdr_t* const	hdr,
+ *		const uint64_t		value
+ *	)
+ *
+ *	void
+ *	pgm_hdr_read (
+ *		pgm_hdr_t* const		hdr,
+ *		const int			mode,
+ *		struct pgm_hdr_snapshot_t* const snapshot
+ *	)
+ */
+
+START_TEST (test_record_pass_001)
+{
+	pgm_hdr_t hdr;
+	struct pgm_hdr_snapshot_t snapshot;
+	pgm_hdr_init (&hdr, 1);
+	fail_unless (0 == hdr.shard_mask, "shard count");
+	pgm_hdr_record (&hdr, 1);
+	pgm_hdr_record (&hdr, 100);
+	pgm_hdr_record (&hdr, 100);
+	pgm_hdr_read (&hdr, PGM_HDR_CUMULATIVE, &snapshot);
+	fail_unless (3 == snapshot.hs_count, "count");
+	fail_unless (201 == snapshot.hs_sum, "sum");
+	fail_unless (1 == snapshot.hs_counts[ pgm_hdr_bucket (1) ], "bucket 1");
+	fail_unless (2 == snapshot.hs_counts[ pgm_hdr_bucket (100) ], "bucket 100");
+	pgm_hdr_destroy (&hdr);
+}
+END_TEST
+
+/* concurrent writers on sharded storage lose no samples */
+static
+gpointer
+record_thread (
+	gpointer	data
+	)
+{
+	pgm_hdr_t* hdr = data;
+	for (unsigned i = 0; i < TEST_THREAD_SAMPLES; i++)
+		pgm_hdr_record (hdr, i);
+	return NULL;
+}
+
+START_TEST (test_record_pass_002)
+{
+	GThread* threads[ TEST_THREADS ];
+	pgm_hdr_t hdr;
+	struct pgm_hdr_snapshot_t snapshot;
+	pgm_hdr_init (&hdr, TEST_THREADS * 2);
+	fail_unless (PGM_HDR_MAX_SHARDS - 1 == hdr.shard_mask, "shard count");
+	for (unsigned i = 0; i < TEST_THREADS; i++) {
+		threads[ i ] = g_thread_create (record_thread, &hdr, TRUE, NULL);
+		fail_if (NULL == threads[ i ], "g_thread_create failed");
+	}
+	for (unsigned i = 0; i < TEST_THREADS; i++)
+		g_thread_join (threads[ i ]);
+	pgm_hdr_read (&hdr, PGM_HDR_CUMULATIVE, &snapshot);
+	fail_unless ((uint64_t)TEST_THREADS * TEST_THREAD_SAMPLES == snapshot.hs_count, "samples lost");
+	fail_unless ((uint64_t)TEST_THREADS * TEST_THREAD_SAMPLES * (TEST_THREAD_SAMPLES - 1) / 2 == snapshot.hs_sum, "sum lost");
+	pgm_hdr_destroy (&hdr);
+}
+END_TEST
+
+/* delta reads return only the samples since the previous delta read */
+START_TEST (test_read_pass_001)
+{
+	pgm_hdr_t hdr;
+	struct pgm_hdr_snapshot_t snapshot;
+	pgm_hdr_init (&hdr, 1);
+	for (unsigned i = 0; i < 3; i++)
+		pgm_hdr_record (&hdr, 10);
+	pgm_hdr_read (&hdr, PGM_HDR_DELTA, &snapshot);
+	fail_unless (3 == snapshot.hs_count, "first delta");
+	pgm_hdr_record (&hdr, 1000);
+	pgm_hdr_record (&hdr, 1000);
+	pgm_hdr_read (&hdr, PGM_HDR_DELTA, &snapshot);
+	fail_unless (2 == snapshot.hs_count, "second delta");
+	fail_unless (2000 == snapshot.hs_sum, "second delta sum");
+	fail_unless (0 == snapshot.hs_counts[ pgm_hdr_bucket (10) ], "second delta bucket");
+	pgm_hdr_read (&hdr, PGM_HDR_DELTA, &snapshot);
+	fail_unless (0 == snapshot.hs_count, "empty delta");
+	pgm_hdr_read (&hdr, PGM_HDR_CUMULATIVE, &snapshot);
+	fail_unless (5 == snapshot.hs_count, "cumulative");
+	pgm_hdr_destroy (&hdr);
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_hdr_clear (
+ *		pgm_hdr_t* const	hdr
+ *	)
+ */
+
+START_TEST (test_clear_pass_001)
+{
+	pgm_hdr_t hdr;
+	struct pgm_hdr_snapshot_t snapshot;
+	pgm_hdr_init (&hdr, 2);
+	pgm_hdr_record (&hdr, 5);
+	pgm_hdr_record (&hdr, 6);
+	pgm_hdr_clear (&hdr);
+	pgm_hdr_read (&hdr, PGM_HDR_CUMULATIVE, &snapshot);
+	fail_unless (0 == snapshot.hs_count, "cleared count");
+	fail_unless (0 == snapshot.hs_sum, "cleared sum");
+	pgm_hdr_record (&hdr, 7);
+	pgm_hdr_read (&hdr, PGM_HDR_CUMULATIVE, &snapshot);
+	fail_unless (1 == snapshot.hs_count, "count after clear");
+	pgm_hdr_read (&hdr, PGM_HDR_DELTA, &snapshot);
+	fail_unless (1 == snapshot.hs_count, "delta after clear");
+	fail_unless (1 == snapshot.hs_counts[ 7 ], "bucket after clear");
+	pgm_hdr_destroy (&hdr);
+}
+END_TEST
+
+/* target:
+ *	uint64_t
+ *	pgm_hdr_percentile (
+ *		const struct pgm_hdr_snapshot_t* const	snapshot,
+ *		const double				percentile
+ *	)
+ */
+
+START_TEST (test_percentile_pass_001)
+{
+	pgm_hdr_t hdr;
+	struct pgm_hdr_snapshot_t snapshot;
+	pgm_hdr_init (&hdr, 1);
+	pgm_hdr_read (&hdr, PGM_HDR_CUMULATIVE, &snapshot);
+	fail_unless (0 == pgm_hdr_percentile (&snapshot, 50.0), "empty");
+	for (unsigned i = 1; i <= 1000; i++)
+		pgm_hdr_record (&hdr, i);
+	pgm_hdr_read (&hdr, PGM_HDR_CUMULATIVE, &snapshot);
+	const uint64_t p50 = pgm_hdr_percentile (&snapshot, 50.0);
+	const uint64_t p99 = pgm_hdr_percentile (&snapshot, 99.0);
+	g_message ("p50 %" PRIu64 " p99 %" PRIu64, p50, p99);
+	fail_unless (p50 >= 500 && p50 < 500 + 500 / 8, "p50 outside bucket error");
+	fail_unless (p99 >= 990 && p99 < 990 + 990 / 8, "p99 outside bucket error");
+	fail_unless (pgm_hdr_percentile (&snapshot, 100.0) >= 1000, "p100");
+	fail_unless (1 == pgm_hdr_percentile (&snapshot, 0.0), "p0");
+	pgm_hdr_destroy (&hdr);
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_bucket = tcase_create ("bucket");
+	suite_add_tcase (s, tc_bucket);
+	tcase_add_test (tc_bucket, test_bucket_pass_001);
+	tcase_add_test (tc_bucket, test_bucket_pass_002);
+
+	TCase* tc_record = tcase_create ("record");
+	suite_add_tcase (s, tc_record);
+	tcase_add_test (tc_record, test_record_pass_001);
+	tcase_add_test (tc_record, test_record_pass_002);
+
+	TCase* tc_read = tcase_create ("read");
+	suite_add_tcase (s, tc_read);
+	tcase_add_test (tc_read, test_read_pass_001);
+
+	TCase* tc_clear = tcase_create ("clear");
+	suite_add_tcase (s, tc_clear);
+	tcase_add_test (tc_clear, test_clear_pass_001);
+
+	TCase* tc_percentile = tcase_create ("percentile");
+	suite_add_tcase (s, tc_percentile);
+	tcase_add_test (tc_percentile, test_percentile_pass_001);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	if (!g_thread_supported ()) g_thread_init (NULL);
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
@@ -1126,7 +1126,7 @@ http_tsi_response (
 
 /* check receivers */
 		pgm_rwlock_reader_lock (&list_sock->peers_lock);
-		pgm_peer_t* receiver = pgm_hashtable_lookup (list_sock->peers_hashtable, tsi);
+		pgm_peer_t* receiver = pgm_tsimap_lookup (list_sock->peers_map, tsi);
 		if (receiver) {
 			const int retval = http_receiver_response (connection, list_sock, receiver);
 			pgm_rwlock_reader_unlock (&list_sock->peers_lock);
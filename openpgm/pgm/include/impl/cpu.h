@@ -45,9 +45,12 @@ struct pgm_cpu_t {
 	bool		has_sse42;
 	bool		has_avx;
 	bool		has_avx2;
+	bool		has_avx512bw;
+	bool		has_gfni;
 };
 
 PGM_GNUC_INTERNAL void pgm_cpuid (pgm_cpu_t*);
+PGM_GNUC_INTERNAL uint32_t pgm_cpuid_tsc_khz (void);
 
 PGM_END_DECLS
 
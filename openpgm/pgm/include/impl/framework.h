@@ -55,6 +55,7 @@
 #include <impl/getnodeaddr.h>
 #include <impl/getprotobyname.h>
 #include <impl/hashtable.h>
+#include <impl/hdrhistogram.h>
 #include <impl/histogram.h>
 #include <impl/indextoaddr.h>
 #include <impl/indextoname.h>
@@ -72,6 +73,7 @@
 #include <impl/rate_control.h>
 #include <impl/reed_solomon.h>
 #include <impl/security.h>
+#include <impl/skbuff.h>
 #include <impl/slist.h>
 #include <impl/sn.h>
 #include <impl/sockaddr.h>
@@ -79,6 +81,7 @@
 #include <impl/thread.h>
 #include <impl/time.h>
 #include <impl/tsi.h>
+#include <impl/tsimap.h>
 #include <impl/wsastrerror.h>
 
 #undef __PGM_IMPL_FRAMEWORK_H_INSIDE__
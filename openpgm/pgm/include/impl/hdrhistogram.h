@@ -0,0 +1,92 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Per-socket and per-peer log-linear histograms.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if !defined (__PGM_IMPL_FRAMEWORK_H_INSIDE__) && !defined (PGM_COMPILATION)
+#	error "Only <framework.h> can be included directly."
+#endif
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_HDRHISTOGRAM_H__
+#define __PGM_IMPL_HDRHISTOGRAM_H__
+
+typedef struct pgm_hdr_t pgm_hdr_t;
+
+#include <pgm/types.h>
+#include <pgm/hdrhistogram.h>
+
+PGM_BEGIN_DECLS
+
+/* upper bound on writer shards of one histogram */
+#define PGM_HDR_MAX_SHARDS	4
+
+/* each recording thread adds to its own shard with atomic increments, a
+ * snapshot sums the shards.  reset and delta snapshots subtract saved
+ * totals rather than clearing counters under concurrent writers.
+ */
+struct pgm_hdr_shard_t {
+	volatile uint64_t	sum;
+	volatile uint64_t	counts[ PGM_HDR_BUCKETS ];
+};
+
+struct pgm_hdr_t {
+	struct pgm_hdr_shard_t* restrict	shards;
+	unsigned				shard_mask;	/* shards - 1, shards a power of two */
+	struct pgm_hdr_snapshot_t* restrict	marks;		/* [0] reset, [1] last delta, lazily allocated */
+};
+
+PGM_GNUC_INTERNAL void pgm_hdr_init (pgm_hdr_t*const, const unsigned);
+PGM_GNUC_INTERNAL void pgm_hdr_destroy (pgm_hdr_t*const);
+PGM_GNUC_INTERNAL void pgm_hdr_record (pgm_hdr_t*const, const uint64_t);
+PGM_GNUC_INTERNAL void pgm_hdr_read (pgm_hdr_t*const restrict, const int, struct pgm_hdr_snapshot_t*const restrict);
+PGM_GNUC_INTERNAL void pgm_hdr_clear (pgm_hdr_t*const);
+
+/* bucket of a value, for v >= 2^SUB_BITS with most significant bit e the
+ * bucket is (e - SUB_BITS + 1) * 2^SUB_BITS plus the SUB_BITS below e.
+ */
+
+static inline
+unsigned
+pgm_hdr_bucket (
+	uint64_t	value
+	)
+{
+	if (value > UINT32_MAX)
+		value = UINT32_MAX;
+	if (value < (1U << PGM_HDR_SUB_BITS))
+		return (unsigned)value;
+#if defined( __GNUC__ )
+	const unsigned msb = 31 - __builtin_clz ((uint32_t)value);
+#else
+	unsigned msb = PGM_HDR_SUB_BITS;
+	while (value >> (msb + 1))
+		msb++;
+#endif
+	return ((msb - PGM_HDR_SUB_BITS + 1) << PGM_HDR_SUB_BITS) +
+	       (unsigned)((value >> (msb - PGM_HDR_SUB_BITS)) & ((1U << PGM_HDR_SUB_BITS) - 1));
+}
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_HDRHISTOGRAM_H__ */
+
+/* eof */
@@ -0,0 +1,50 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * In-process transport with simulated loss, reordering, delay and
+ * duplication.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_LOOPBACK_H__
+#define __PGM_IMPL_LOOPBACK_H__
+
+typedef struct pgm_loopback_t pgm_loopback_t;
+
+#include <impl/framework.h>
+
+PGM_BEGIN_DECLS
+
+/* default ring capacity in packets */
+#define PGM_LOOPBACK_RING_SIZE		1024
+
+PGM_GNUC_INTERNAL pgm_loopback_t* pgm_loopback_create (const struct pgm_loopbackinfo_t*const, const uint16_t) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_loopback_destroy (pgm_loopback_t*const);
+PGM_GNUC_INTERNAL ssize_t pgm_loopback_sendto (pgm_sock_t*const restrict, const void*restrict, const size_t, const struct sockaddr*restrict, const socklen_t);
+PGM_GNUC_INTERNAL ssize_t pgm_loopback_recvfrom (pgm_loopback_t*const restrict, void*restrict, const size_t, struct sockaddr*restrict, const socklen_t, struct sockaddr*restrict, const socklen_t);
+PGM_GNUC_INTERNAL bool pgm_loopback_next_due (pgm_loopback_t*const restrict, pgm_time_t*const restrict);
+PGM_GNUC_INTERNAL bool pgm_loopback_is_ready (pgm_loopback_t*const, const pgm_time_t);
+PGM_GNUC_INTERNAL SOCKET pgm_loopback_get_socket (pgm_loopback_t*const);
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_LOOPBACK_H__ */
+
+/* eof */
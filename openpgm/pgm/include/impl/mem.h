@@ -29,8 +29,19 @@
 
 PGM_BEGIN_DECLS
 
+/* zero filled storage for window buffers, optionally on hugepages and
+ * preferring one NUMA node.
+ */
+struct pgm_mem_arena_t {
+	char*		base;
+	size_t		len;
+	unsigned	is_mapped:1;
+};
+
 PGM_GNUC_INTERNAL void pgm_mem_init (void);
 PGM_GNUC_INTERNAL void pgm_mem_shutdown (void);
+PGM_GNUC_INTERNAL void pgm_mem_arena_init (struct pgm_mem_arena_t*const, const size_t, const int, const bool);
+PGM_GNUC_INTERNAL void pgm_mem_arena_destroy (struct pgm_mem_arena_t*const);
 
 PGM_END_DECLS
 
@@ -32,7 +32,11 @@
 
 PGM_BEGIN_DECLS
 
+/* upper bound on datagrams sent by one sendmmsg() call, also the UDP GSO segment limit */
+#define PGM_MAX_SEND_BATCH	64
+
 PGM_GNUC_INTERNAL ssize_t pgm_sendto_hops (pgm_sock_t*restrict, bool, pgm_rate_t*restrict, bool, int, const void*restrict, size_t, const struct sockaddr*restrict, socklen_t);
+PGM_GNUC_INTERNAL int pgm_sendto_batch (pgm_sock_t*restrict, bool, pgm_rate_t*restrict, bool, const struct pgm_iovec*restrict, unsigned, const struct sockaddr*restrict, socklen_t);
 PGM_GNUC_INTERNAL int pgm_set_nonblocking (SOCKET fd[2]);
 
 static inline
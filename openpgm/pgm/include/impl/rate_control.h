@@ -42,15 +42,17 @@ struct pgm_rate_t {
 	ssize_t		rate_per_msec;
 	size_t		iphdr_len;
 
-	ssize_t		rate_limit;		/* signed for math */
-	pgm_time_t	last_rate_check;
-	pgm_spinlock_t	spinlock;
+	int64_t		bucket_size;		/* signed for math */
+	pgm_time_t	epoch;			/* origin of the byte clock */
+	volatile uint64_t tat;			/* byte clock when the bucket drains, signed */
 };
 
 PGM_GNUC_INTERNAL void pgm_rate_create (pgm_rate_t*, const ssize_t, const size_t, const uint16_t);
 PGM_GNUC_INTERNAL void pgm_rate_destroy (pgm_rate_t*);
 PGM_GNUC_INTERNAL bool pgm_rate_check2 (pgm_rate_t*, pgm_rate_t*, const size_t, const bool);
 PGM_GNUC_INTERNAL bool pgm_rate_check (pgm_rate_t*, const size_t, const bool);
+PGM_GNUC_INTERNAL void pgm_rate_refund2 (pgm_rate_t*, pgm_rate_t*, const size_t);
+PGM_GNUC_INTERNAL void pgm_rate_refund (pgm_rate_t*, const size_t);
 PGM_GNUC_INTERNAL pgm_time_t pgm_rate_remaining2 (pgm_rate_t*, pgm_rate_t*, const size_t);
 PGM_GNUC_INTERNAL pgm_time_t pgm_rate_remaining (pgm_rate_t*, const size_t);
 
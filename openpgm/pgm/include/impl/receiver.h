@@ -107,6 +107,9 @@ struct pgm_peer_t {
 	uint32_t			spm_sqn;
 	pgm_time_t			expiry;
 
+	pgm_time_t			timer_expiry;			/* heap key, never after next state expiry */
+	unsigned			timer_index;			/* 1-based position in sock::peers_timer_heap */
+
 	pgm_time_t			ack_rb_expiry;			/* 0 = no ACK pending */
 	pgm_time_t			ack_last_tstamp;		/* in source time reference */
 	pgm_list_t			ack_link;
@@ -123,6 +126,10 @@ struct pgm_peer_t {
 
 	uint32_t			min_fail_time;
 	uint32_t			max_fail_time;
+	int64_t				last_transit;			/* latency of previous ODATA, nanoseconds */
+	uint64_t			jitter;				/* RFC 3550 interarrival jitter, nanoseconds */
+	bool				has_transit;
+	pgm_hdr_t			hdr[PGM_HDR_MAX];
 };
 
 PGM_GNUC_INTERNAL pgm_peer_t* pgm_new_peer (pgm_sock_t*const restrict, const pgm_tsi_t*const restrict, const struct sockaddr*const restrict, const socklen_t, const struct sockaddr*const restrict, const socklen_t, const pgm_time_t);
@@ -0,0 +1,70 @@
+/* vim:ts=8:sts=4:sw=4:noai:noexpandtab
+ *
+ * Transport recv API.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_RECV_H__
+#define __PGM_IMPL_RECV_H__
+
+#include <impl/framework.h>
+#include <impl/socket.h>
+
+PGM_BEGIN_DECLS
+
+/* upper bound on datagrams read by one recvmmsg() call */
+#define PGM_MAX_RECV_BATCH	1024
+
+/* upper bound on receive shards of one session */
+#define PGM_MAX_RECV_SHARDS	1024
+
+/* upper bound on the busy-poll spin before sleeping, microseconds */
+#define PGM_MAX_BUSY_POLL	1000000
+
+/* receive shard owning the source of a PGM packet, the port is the source's
+ * data-source port for downstream packets and the data-destination port for
+ * upstream and peer packets.  the reuseport steering program in socket.c
+ * computes the same function.
+ */
+
+static inline
+uint32_t
+pgm_shard_of (
+	const struct pgm_header*	header,
+	const uint32_t			shard_count
+	)
+{
+	uint32_t gsi_hi;
+	uint16_t gsi_lo;
+	memcpy (&gsi_hi, &header->pgm_gsi[0], sizeof(gsi_hi));
+	memcpy (&gsi_lo, &header->pgm_gsi[4], sizeof(gsi_lo));
+	const uint16_t port = PGM_IS_DOWNSTREAM (header->pgm_type) ? header->pgm_sport : header->pgm_dport;
+	return (pgm_ntohl (gsi_hi) ^ pgm_ntohs (gsi_lo) ^ pgm_ntohs (port)) % shard_count;
+}
+
+#ifdef HAVE_RECVMMSG
+PGM_GNUC_INTERNAL void pgm_recv_batch_create (pgm_sock_t*const);
+PGM_GNUC_INTERNAL void pgm_recv_batch_destroy (pgm_sock_t*const);
+#endif
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_RECV_H__ */
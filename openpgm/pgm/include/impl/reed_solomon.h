@@ -31,6 +31,7 @@
 typedef struct pgm_rs_t pgm_rs_t;
 
 #include <pgm/types.h>
+#include <impl/cpu.h>
 #include <impl/galois.h>
 
 PGM_BEGIN_DECLS
@@ -43,9 +44,12 @@ struct pgm_rs_t {
 
 #define PGM_RS_DEFAULT_N	255
 
+PGM_GNUC_INTERNAL void pgm_rs_init (const pgm_cpu_t*);
 PGM_GNUC_INTERNAL void pgm_rs_create (pgm_rs_t*, const uint8_t, const uint8_t);
 PGM_GNUC_INTERNAL void pgm_rs_destroy (pgm_rs_t*);
 PGM_GNUC_INTERNAL void pgm_rs_encode (pgm_rs_t*restrict, const pgm_gf8_t**restrict, const uint8_t, pgm_gf8_t*restrict, const uint16_t);
+PGM_GNUC_INTERNAL void pgm_rs_encode_multi (pgm_rs_t*restrict, const pgm_gf8_t**restrict, const uint8_t*restrict, const uint8_t, pgm_gf8_t**restrict, const uint16_t);
+PGM_GNUC_INTERNAL void pgm_rs_encode_accumulate (pgm_rs_t*restrict, const pgm_gf8_t*restrict, const uint8_t, const uint8_t, pgm_gf8_t*restrict, const uint16_t);
 PGM_GNUC_INTERNAL void pgm_rs_decode_parity_inline (pgm_rs_t*restrict, pgm_gf8_t**restrict, const uint8_t*restrict, const uint16_t);
 PGM_GNUC_INTERNAL void pgm_rs_decode_parity_appended (pgm_rs_t*restrict, pgm_gf8_t**restrict, const uint8_t*restrict, const uint16_t);
 
@@ -58,10 +58,22 @@ enum
 	PGM_RXW_UNKNOWN
 };
 
-/* must be smaller than PGM skbuff control buffer */
+/* BACK-OFF state expiry is tracked in coarse time buckets, each a range of
+ * sequence numbers whose members are marked in pgm_rxw_t::nak_map.
+ */
+#define PGM_RXW_NAK_BUCKETS	16
+
+struct pgm_rxw_nak_bucket_t {
+	pgm_time_t	expiry;
+	pgm_time_t	deferred;	/* latest expiry of members pushed back past expiry, 0 for none */
+	uint32_t	first, last;
+};
+
+/* NAK recovery state held per sequence in pgm_rxw_t::states beside the
+ * packet state in pgm_rxw_t::pkt_states, not in the skbuff control buffer.
+ */
 struct pgm_rxw_state_t {
 	pgm_time_t	timer_expiry;
-        int		pkt_state;
 
 	uint8_t		nak_transmit_count;	/* 8-bit for size constraints */
         uint8_t		ncf_retry_count;
@@ -91,6 +103,7 @@ struct pgm_rxw_t {
         unsigned		is_constrained:1;
         unsigned		is_defined:1;
 	unsigned		has_event:1;		/* edge triggered */
+	unsigned		has_nak_event:1;	/* BACK-OFF placeholder added by a read */
 	unsigned		is_fec_available:1;
 	pgm_rs_t		rs;
 	uint32_t		tg_size;		/* transmission group size for parity recovery */
@@ -108,9 +121,22 @@ struct pgm_rxw_t {
 	uint32_t		cumulative_losses;
 	uint32_t		bytes_delivered;
 	uint32_t		msgs_delivered;
+	pgm_hdr_t*		peer_hdr;		/* PGM_HDR_MAX histograms, NULL for none */
+	pgm_hdr_t*		sock_hdr;
+
+	pgm_skb_pool_t*		skb_pool;		/* socket buffer pool, NULL for heap */
+	pgm_skb_pool_t*		placeholder_pool;	/* zero payload skbuffs, NULL for heap */
+
+	pgm_time_t		nak_bucket_ivl;		/* back-off expiry granularity, 0 for exact */
+	unsigned		nak_bucket_len;
+	struct pgm_rxw_nak_bucket_t nak_buckets[PGM_RXW_NAK_BUCKETS];	/* ordered by expiry */
 
 	size_t			size;			/* in bytes */
 	unsigned		alloc;			/* in pkts */
+	uint32_t		mask;			/* length of pdata[] minus one, power of two */
+	uint64_t*		nak_map;		/* BACK-OFF state bit by sequence, follows pdata[] */
+	pgm_rxw_state_t*	states;			/* timers and retry counts by sequence, follows nak_map[] */
+	uint8_t*		pkt_states;		/* PGM_PKT_STATE_* by sequence, follows states[] */
 /* C90 and older */
 	struct pgm_sk_buff_t*   pdata[1];
 };
@@ -128,6 +154,7 @@ PGM_GNUC_INTERNAL unsigned pgm_rxw_update (pgm_rxw_t*const, const uint32_t, cons
 PGM_GNUC_INTERNAL void pgm_rxw_update_fec (pgm_rxw_t*const, const uint8_t);
 PGM_GNUC_INTERNAL int pgm_rxw_confirm (pgm_rxw_t*const, const uint32_t, const pgm_time_t, const pgm_time_t, const pgm_time_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL void pgm_rxw_lost (pgm_rxw_t*const, const uint32_t);
+PGM_GNUC_INTERNAL unsigned pgm_rxw_nak_list (pgm_rxw_t*const restrict, const pgm_time_t, const uint32_t, uint32_t*const restrict, const unsigned) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL void pgm_rxw_state (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict, const int);
 PGM_GNUC_INTERNAL struct pgm_sk_buff_t* pgm_rxw_peek (pgm_rxw_t*const, const uint32_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL const char* pgm_pkt_state_string (const int) PGM_GNUC_WARN_UNUSED_RESULT;
@@ -142,6 +169,7 @@ static inline bool pgm_rxw_is_empty (const pgm_rxw_t*const) PGM_GNUC_WARN_UNUSED
 static inline bool pgm_rxw_is_full (const pgm_rxw_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
 static inline uint32_t pgm_rxw_lead (const pgm_rxw_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
 static inline uint32_t pgm_rxw_next_lead (const pgm_rxw_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
+static inline pgm_rxw_state_t* pgm_rxw_recovery_state (const pgm_rxw_t*const, const uint32_t) PGM_GNUC_WARN_UNUSED_RESULT;
 
 static inline
 unsigned
@@ -213,6 +241,20 @@ pgm_rxw_next_lead (
 	return (uint32_t)(pgm_rxw_lead (window) + 1);
 }
 
+/* NAK timer and retry counts of a sequence inside the window.
+ */
+
+static inline
+pgm_rxw_state_t*
+pgm_rxw_recovery_state (
+	const pgm_rxw_t* const	window,
+	const uint32_t		sequence
+	)
+{
+	pgm_assert (NULL != window);
+	return &window->states[ sequence & window->mask ];
+}
+
 PGM_END_DECLS
 
 #endif /* __PGM_IMPL_RXW_H__ */
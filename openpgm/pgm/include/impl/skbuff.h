@@ -0,0 +1,71 @@
+/* vim:ts=8:sts=4:sw=4:noai:noexpandtab
+ * 
+ * Fixed size skbuff pool.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if !defined (__PGM_IMPL_FRAMEWORK_H_INSIDE__) && !defined (PGM_COMPILATION)
+#	error "Only <framework.h> can be included directly."
+#endif
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_SKBUFF_H__
+#define __PGM_IMPL_SKBUFF_H__
+
+typedef struct pgm_skb_pool_t pgm_skb_pool_t;
+struct pgm_skb_slot_t;
+
+#include <pgm/types.h>
+#include <pgm/skbuff.h>
+#include <impl/mem.h>
+
+PGM_BEGIN_DECLS
+
+/* cap on the default pre-allocation derived from the receive window */
+#define PGM_SKB_POOL_DEFAULT_MAX	4096
+
+/* Allocation is single threaded, serialised by the owning socket's receiver
+ * lock.  Buffers may be returned from any thread through pgm_free_skb(), so
+ * the counters are updated atomically.
+ */
+struct pgm_skb_pool_t {
+	uint16_t			max_tpdu;
+	size_t				slot_size;
+
+	struct pgm_mem_arena_t		slab;		/* pre-allocated slots */
+
+	struct pgm_skb_slot_t*		free_list;	/* owner only */
+	struct pgm_skb_slot_t* volatile	return_list;	/* lock-free LIFO, any thread */
+	volatile uint32_t		ref_count;	/* owner + outstanding skbuffs */
+	volatile uint32_t		heap_count;	/* slots taken from the heap */
+	uint32_t			heap_max;	/* high-water mark of heap slots kept */
+
+	volatile uint32_t		hits;		/* served from free lists */
+	volatile uint32_t		misses;		/* served from heap */
+};
+
+PGM_GNUC_INTERNAL pgm_skb_pool_t* pgm_skb_pool_create (const uint16_t, const unsigned, const int, const bool) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_skb_pool_destroy (pgm_skb_pool_t*const);
+PGM_GNUC_INTERNAL struct pgm_sk_buff_t* pgm_skb_pool_alloc (pgm_skb_pool_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL bool pgm_skb_csum_verify (struct pgm_sk_buff_t*const restrict, void*restrict, const uint16_t) PGM_GNUC_WARN_UNUSED_RESULT;
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_SKBUFF_H__ */
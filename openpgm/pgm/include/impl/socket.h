@@ -26,8 +26,10 @@
 #define __PGM_IMPL_SOCKET_H__
 
 struct pgm_sock_t;
+struct pgm_recv_batch_t;
 
 #include <impl/framework.h>
+#include <impl/loopback.h>
 #include <impl/txw.h>
 #include <impl/source.h>
 
@@ -53,6 +55,7 @@ struct pgm_sock_t {
 	pgm_spinlock_t			txw_spinlock;			/* transmit window */
 	pgm_mutex_t			send_mutex;			/* non-router alert socket */
 	pgm_mutex_t			timer_mutex;			/* next timer expiration */
+	pgm_mutex_t			hdr_mutex;			/* histogram snapshots and resets */
 
 	bool				is_bound;
 	bool				is_connected;
@@ -122,7 +125,7 @@ struct pgm_sock_t {
 	pgm_notify_t			ack_notify;
 	pgm_notify_t			rdata_notify;
 
-	pgm_hash_t			last_hash_key;
+	uint64_t			last_hash_key;		    /* pgm_tsimap_key() of last_hash_value */
 	void* restrict			last_hash_value;
 	unsigned			last_commit;
 	size_t				blocklen;		    /* length of buffer blocked */
@@ -140,7 +143,39 @@ struct pgm_sock_t {
 		unsigned			vector_index;
 		size_t				vector_offset;
 		bool				is_rate_limited;
+		unsigned			batch_len;	/* TPDUs queued in send_batch */
+		unsigned			batch_index;	/* next queued TPDU to send */
 	} pkt_dontwait_state;
+	unsigned			send_batch_size;	    /* TPDUs per sendmmsg(), 0 for sendto() */
+	struct pgm_sk_buff_t** restrict	send_batch;
+	bool				use_udp_gso;		    /* UDP generic segmentation offload */
+	unsigned			repair_burst_size;	    /* RDATA per repair wakeup, 0 for one */
+	struct pgm_repairinfo_t		repair_info;
+	bool				use_service_thread;	    /* timers, NAKs and RDATA off the application thread */
+	int				service_cpu;		    /* processor for service thread, -1 for any */
+	bool				is_service_running;
+	pgm_notify_t			service_notify;		    /* shutdown to service thread */
+#ifndef _WIN32
+	pthread_t			service_thread;
+#else
+	HANDLE				service_thread;
+#endif
+	bool				use_deferred_checksum;	    /* verify data checksums on delivery */
+	bool				use_zero_checksum;	    /* no PGM checksum on data, UDP encapsulation only */
+	uint32_t			shard_count;		    /* receive shards, 0 or 1 for all sources */
+	uint32_t			shard_index;
+	bool				use_txw_hugepages;	    /* transmit window arena on hugepages */
+	bool				use_rxw_hugepages;	    /* receive buffer slabs on hugepages */
+	int				numa_node;		    /* window storage placement, -1 for first touch */
+	unsigned			busy_poll_usecs;	    /* receive spin ceiling, 0 to always sleep */
+	unsigned			busy_poll_budget;	    /* current adaptive spin, microseconds */
+	bool				use_tx_tstamp;		    /* OPT_TSTAMP on copied ODATA */
+	int				rx_tstamp;		    /* PGM_RX_TSTAMP_* receive timestamp source */
+	uint64_t			rx_tstamp_nsecs;	    /* wall clock receipt of packet being parsed, 0 unknown */
+	struct pgm_latencyinfo_t	latency_info;
+	bool				use_loopback;		    /* in-process transport in place of the network */
+	struct pgm_loopbackinfo_t	loopback_info;
+	pgm_loopback_t*  restrict	loopback;		    /* receiving end once bound */
 
 	uint32_t			spm_sqn;
 	unsigned			spm_ambient_interval;	    /* microseconds */
@@ -163,11 +198,19 @@ struct pgm_sock_t {
 	uint8_t				rs_proactive_h;		    /* 0 <= proactive-h <= ( n - k ) */
 	uint8_t				tg_sqn_shift;
 	struct pgm_sk_buff_t* restrict	rx_buffer;
+	unsigned			recv_batch_size;	    /* datagrams per recvmmsg(), 0 for recvmsg() */
+	struct pgm_recv_batch_t* restrict recv_batch;
+	unsigned			rx_skb_pool_size;	    /* pre-allocated skbuffs, 0 to size from receive window */
+	pgm_skb_pool_t* restrict	rx_skb_pool;
+	pgm_skb_pool_t* restrict	rx_placeholder_pool;	    /* zero payload skbuffs for missing sequence numbers */
 
 	pgm_rwlock_t			peers_lock;
-	pgm_hashtable_t* restrict	peers_hashtable;	    /* fast lookup */
+	pgm_tsimap_t*    restrict	peers_map;		    /* fast lookup */
 	pgm_list_t*      restrict	peers_list;		    /* easy iteration */
 	pgm_slist_t*     restrict	peers_pending;		    /* rxw: have or lost data */
+	pgm_peer_t**     restrict	peers_timer_heap;	    /* min-heap on pgm_peer_t::timer_expiry */
+	unsigned			peers_timer_len;
+	unsigned			peers_timer_alloc;
 	pgm_notify_t			pending_notify;		    /* timer to rx */
 	bool				is_pending_read;
 	pgm_time_t			next_poll;
@@ -175,6 +218,7 @@ struct pgm_sock_t {
 	uint32_t			cumulative_stats[PGM_PC_SOURCE_MAX];
 	uint32_t			snap_stats[PGM_PC_SOURCE_MAX];
 	pgm_time_t			snap_time;
+	pgm_hdr_t			hdr[PGM_HDR_MAX];	    /* receiver histograms over all peers */
 };
 
 
@@ -184,6 +228,38 @@ extern pgm_slist_t* pgm_sock_list;
 
 size_t pgm_pkt_offset (bool, sa_family_t);
 
+/* header space for OPT_TSTAMP beyond pgm_pkt_offset(), including OPT_LENGTH
+ * when no other option is present.
+ */
+
+static inline
+size_t
+pgm_pkt_tstamp_offset (
+	const pgm_sock_t* const	sock,
+	const bool		can_fragment
+	)
+{
+	if (!sock->use_tx_tstamp)
+		return 0;
+	return sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_tstamp) +
+	       ((can_fragment || sock->use_pgmcc) ? 0 : sizeof(struct pgm_opt_length));
+}
+
+/* descriptor readable on incoming packets, the loopback transport replaces
+ * the receive socket once bound.
+ */
+
+static inline
+SOCKET
+pgm_sock_recv_fd (
+	const pgm_sock_t* const	sock
+	)
+{
+	if (NULL != sock->loopback)
+		return pgm_loopback_get_socket (sock->loopback);
+	return sock->recv_sock;
+}
+
 PGM_END_DECLS
 
 #endif /* __PGM_IMPL_SOCKET_H__ */
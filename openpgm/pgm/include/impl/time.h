@@ -45,8 +45,55 @@ typedef pgm_time_t (*pgm_time_update_func)(void);
 
 extern pgm_time_update_func		pgm_time_update_now;
 
+#if defined( __GNUC__ ) || defined( __SUNPRO_C )
+#	define PGM_TIME_TLS	__thread
+#elif defined( _MSC_VER )
+#	define PGM_TIME_TLS	__declspec(thread)
+#endif
+
+/* with PGM_TIME_CACHE set, receive and send paths read the clock once per
+ * iteration with pgm_time_refresh() and rate control, timers and skb stamps
+ * take the calling thread's copy from pgm_time_cached_now().
+ */
+extern bool				pgm_time_use_cache;
+#ifdef PGM_TIME_TLS
+extern PGM_TIME_TLS pgm_time_t		pgm_time_cache;
+#endif
+
+static inline
+pgm_time_t
+pgm_time_refresh (void)
+{
+#ifdef PGM_TIME_TLS
+	return pgm_time_cache = pgm_time_update_now();
+#else
+	return pgm_time_update_now();
+#endif
+}
+
+/* start of an iteration, no clock read unless caching */
+static inline
+void
+pgm_time_begin (void)
+{
+	if (pgm_time_use_cache)
+		pgm_time_refresh();
+}
+
+static inline
+pgm_time_t
+pgm_time_cached_now (void)
+{
+#ifdef PGM_TIME_TLS
+	if (pgm_time_use_cache && PGM_LIKELY(0 != pgm_time_cache))
+		return pgm_time_cache;
+#endif
+	return pgm_time_update_now();
+}
+
 PGM_GNUC_INTERNAL bool pgm_time_init (pgm_error_t**) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL bool pgm_time_shutdown (void);
+PGM_GNUC_INTERNAL uint64_t pgm_time_epoch_nsecs (void);
 
 PGM_END_DECLS
 
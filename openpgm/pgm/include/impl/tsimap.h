@@ -0,0 +1,174 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Open-addressing map from transport session identifier (TSI) to peer.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if !defined (__PGM_IMPL_FRAMEWORK_H_INSIDE__) && !defined (PGM_COMPILATION)
+#	error "Only <framework.h> can be included directly."
+#endif
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_TSIMAP_H__
+#define __PGM_IMPL_TSIMAP_H__
+
+typedef struct pgm_tsimap_t pgm_tsimap_t;
+
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_AMD64) || defined(_M_X64)
+#	include <emmintrin.h>
+#	define PGM_TSIMAP_SSE2
+#endif
+#include <pgm/types.h>
+#include <pgm/tsi.h>
+
+PGM_BEGIN_DECLS
+
+/* SwissTable layout: a control byte per slot holds either the low 7 bits
+ * of the key hash or an empty/deleted marker, a probe compares a group of
+ * sixteen control bytes at once and only touches slots with a matching tag.
+ * The first group of control bytes is mirrored past the end so that a group
+ * starting at any slot may be loaded without wrapping.
+ */
+
+#define PGM_TSIMAP_GROUP	16
+#define PGM_TSIMAP_EMPTY	((int8_t)-128)	/* 0b10000000 */
+#define PGM_TSIMAP_DELETED	((int8_t)-2)	/* 0b11111110 */
+
+struct pgm_tsimap_slot_t {
+	uint64_t		key;
+	void*			value;
+};
+
+struct pgm_tsimap_t {
+	int8_t*			ctrl;		/* capacity + PGM_TSIMAP_GROUP */
+	struct pgm_tsimap_slot_t* slots;
+	uint32_t		mask;		/* capacity - 1, capacity a power of two */
+	unsigned		nnodes;
+	unsigned		ndeleted;
+};
+
+PGM_GNUC_INTERNAL pgm_tsimap_t* pgm_tsimap_new (void) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_tsimap_destroy (pgm_tsimap_t*);
+PGM_GNUC_INTERNAL void pgm_tsimap_insert (pgm_tsimap_t*restrict, const pgm_tsi_t*restrict, void*restrict);
+PGM_GNUC_INTERNAL bool pgm_tsimap_remove (pgm_tsimap_t*restrict, const pgm_tsi_t*restrict);
+
+/* TSI as a single 64-bit word, byte order is irrelevant as only equality
+ * and the hash are required.
+ */
+
+static inline
+uint64_t
+pgm_tsimap_key (
+	const pgm_tsi_t*	tsi
+	)
+{
+	uint64_t key;
+	memcpy (&key, tsi, sizeof(key));
+	return key;
+}
+
+/* Fibonacci multiplicative hash folded to spread both the GSI and source
+ * port into the low bits used for the tag and the high bits used for the
+ * group.
+ */
+
+static inline
+uint64_t
+pgm_tsimap_hash (
+	const uint64_t		key
+	)
+{
+	const uint64_t h = key * UINT64_C(0x9e3779b97f4a7c15);
+	return h ^ (h >> 32);
+}
+
+/* bitmask of control bytes in the group starting at ctrl equal to tag.
+ */
+
+static inline
+unsigned
+pgm_tsimap_match (
+	const int8_t*		ctrl,
+	const int8_t		tag
+	)
+{
+#ifdef PGM_TSIMAP_SSE2
+	const __m128i group = _mm_loadu_si128 ((const __m128i*)ctrl);
+	return (unsigned)_mm_movemask_epi8 (_mm_cmpeq_epi8 (group, _mm_set1_epi8 (tag)));
+#else
+	unsigned mask = 0;
+	for (unsigned i = 0; i < PGM_TSIMAP_GROUP; i++)
+		if (ctrl[ i ] == tag)
+			mask |= 1U << i;
+	return mask;
+#endif
+}
+
+static inline
+unsigned
+pgm_tsimap_ctz (
+	const unsigned		mask
+	)
+{
+#if (__GNUC__ > 3) || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4)
+	return (unsigned)__builtin_ctz (mask);
+#else
+	unsigned i = 0;
+	while (!(mask & (1U << i)))
+		i++;
+	return i;
+#endif
+}
+
+/* returns value for tsi, or NULL if not present.
+ */
+
+static inline
+void*
+pgm_tsimap_lookup (
+	const pgm_tsimap_t* restrict map,
+	const pgm_tsi_t*    restrict tsi
+	)
+{
+	const uint64_t key = pgm_tsimap_key (tsi);
+	const uint64_t hash = pgm_tsimap_hash (key);
+	const int8_t tag = (int8_t)(hash & 0x7f);
+	uint32_t pos = (uint32_t)(hash >> 7) & map->mask;
+
+	for (uint32_t stride = 0;;)
+	{
+		for (unsigned match = pgm_tsimap_match (&map->ctrl[ pos ], tag); match; match &= match - 1)
+		{
+			const uint32_t i = (pos + pgm_tsimap_ctz (match)) & map->mask;
+			if (PGM_LIKELY(map->slots[ i ].key == key))
+				return map->slots[ i ].value;
+		}
+		if (PGM_LIKELY(pgm_tsimap_match (&map->ctrl[ pos ], PGM_TSIMAP_EMPTY)))
+			return NULL;
+/* triangular probing visits every group when capacity is a power of two */
+		stride += PGM_TSIMAP_GROUP;
+		pos = (pos + stride) & map->mask;
+	}
+}
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_TSIMAP_H__ */
@@ -29,6 +29,7 @@ typedef struct pgm_txw_state_t pgm_txw_state_t;
 typedef struct pgm_txw_t pgm_txw_t;
 
 #include <impl/framework.h>
+#include <impl/mem.h>
 
 PGM_BEGIN_DECLS
 
@@ -42,6 +43,20 @@ struct pgm_txw_state_t {
 
 	uint8_t		pkt_cnt_requested;	/* # parity packets to send */
 	uint8_t		pkt_cnt_sent;		/* # parity packets already sent */
+
+	pgm_time_t	retransmit_tstamp;	/* when request was queued */
+};
+
+/* pro-active parity accumulated as original data enters the window, each
+ * row holds the payload, appended TSDU length, and encoded OPT_FRAGMENT sums.
+ */
+struct pgm_txw_parity_t {
+	uint32_t	tg_sqn;			/* transmission group lead */
+	uint8_t		pkt_cnt;		/* # original packets accumulated */
+	uint16_t	tsdu_length;		/* largest TSDU in group */
+	unsigned	is_var_pktlen:1;
+	unsigned	is_op_encoded:1;
+	pgm_gf8_t*	rows;			/* rs_proactive_h × parity_stride */
 };
 
 struct pgm_txw_t {
@@ -57,6 +72,12 @@ struct pgm_txw_t {
 	uint8_t				tg_sqn_shift;
 	struct pgm_sk_buff_t* restrict	parity_buffer;
 
+/* incremental pro-active parity, alternating banks by transmission group */
+	uint8_t				rs_proactive_h;
+	uint16_t			max_tsdu;
+	size_t				parity_stride;
+	struct pgm_txw_parity_t		proactive[2];
+
 /* Advance with data */
 	pgm_time_t			adv_ivl_expiry;	
 	unsigned			increment_window_naks;
@@ -64,21 +85,35 @@ struct pgm_txw_t {
 	unsigned			adv_sqns;		/* TXW_ADV_SECS in sequences */
 
 	unsigned			is_fec_enabled:1;
+	unsigned			is_zero_checksum:1;	/* parity sent without PGM checksum */
 	unsigned			adv_mode:1;		/* 0 = advance by time, 1 = advance by data */
 
 	size_t				size;			/* window content size in bytes */
-	unsigned			alloc;			/* length of pdata[] */
+
+/* contiguous skbuff storage, consecutive sequences in consecutive slots */
+	struct pgm_mem_arena_t		arena;
+	size_t				arena_stride;		/* bytes per slot */
+	unsigned			arena_slots;
+	unsigned			arena_next;		/* slot for next allocation */
+
+	unsigned			alloc;			/* maximum window length in sequences */
+	uint32_t			mask;			/* length of pdata[] minus one, power of two */
 /* C90 and older */
 	struct pgm_sk_buff_t*		pdata[1];
 };
 
 PGM_GNUC_INTERNAL pgm_txw_t* pgm_txw_create (const pgm_tsi_t*const, const uint16_t, const uint32_t, const unsigned, const ssize_t, const bool, const uint8_t, const uint8_t) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_txw_set_proactive_parity (pgm_txw_t*const, const uint8_t, const uint16_t);
+PGM_GNUC_INTERNAL void pgm_txw_set_zero_checksum (pgm_txw_t*const);
+PGM_GNUC_INTERNAL void pgm_txw_set_arena (pgm_txw_t*const, const uint16_t, const int, const bool);
+PGM_GNUC_INTERNAL struct pgm_sk_buff_t* pgm_txw_alloc_skb (pgm_txw_t*const, const uint16_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL void pgm_txw_shutdown (pgm_txw_t*const);
 PGM_GNUC_INTERNAL void pgm_txw_add (pgm_txw_t*const restrict, struct pgm_sk_buff_t*const restrict);
 PGM_GNUC_INTERNAL struct pgm_sk_buff_t* pgm_txw_peek (const pgm_txw_t*const, const uint32_t) PGM_GNUC_WARN_UNUSED_RESULT;
-PGM_GNUC_INTERNAL bool pgm_txw_retransmit_push (pgm_txw_t*const, const uint32_t, const bool, const uint8_t) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL bool pgm_txw_retransmit_push (pgm_txw_t*const, const uint32_t, const bool, const uint8_t, const pgm_time_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL struct pgm_sk_buff_t* pgm_txw_retransmit_try_peek (pgm_txw_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
-PGM_GNUC_INTERNAL void pgm_txw_retransmit_remove_head (pgm_txw_t*const);
+PGM_GNUC_INTERNAL unsigned pgm_txw_retransmit_try_peek_burst (pgm_txw_t*const restrict, struct pgm_sk_buff_t**restrict, const unsigned) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL pgm_time_t pgm_txw_retransmit_remove_head (pgm_txw_t*const);
 PGM_GNUC_INTERNAL uint32_t pgm_txw_get_unfolded_checksum (const struct pgm_sk_buff_t*const) PGM_GNUC_PURE;
 PGM_GNUC_INTERNAL void pgm_txw_set_unfolded_checksum (struct pgm_sk_buff_t*const, const uint32_t);
 PGM_GNUC_INTERNAL void pgm_txw_inc_retransmit_count (struct pgm_sk_buff_t*const);
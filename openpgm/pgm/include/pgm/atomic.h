@@ -224,4 +224,120 @@ pgm_atomic_write32 (
 	*atomic = val;
 }
 
+/* pointer compare and swap, returns TRUE if *atomic held oldval and now holds newval.
+ *
+ * 	if (*atomic == oldval) {
+ * 		*atomic = newval;
+ * 		return TRUE;
+ * 	}
+ * 	return FALSE;
+ */
+
+static inline
+bool
+pgm_atomic_compare_and_exchange_pointer (
+	void* volatile*		atomic,
+	void*			oldval,
+	void*			newval
+	)
+{
+#if defined( __GNUC__ ) && ( __GNUC__ * 100 + __GNUC_MINOR__ >= 401 )
+	return __sync_bool_compare_and_swap (atomic, oldval, newval);
+#elif defined( __sun ) || defined( __NetBSD__ )
+	return oldval == atomic_cas_ptr (atomic, oldval, newval);
+#elif defined( __APPLE__ )
+	return OSAtomicCompareAndSwapPtrBarrier (oldval, newval, atomic);
+#elif defined( _AIX ) && defined( __64BIT__ )
+	long cmp = (long)oldval;
+	return compare_and_swaplp ((atomic_l)atomic, &cmp, (long)newval);
+#elif defined( _AIX )
+	int cmp = (int)oldval;
+	return compare_and_swap ((atomic_p)atomic, &cmp, (int)newval);
+#elif defined( _WIN32 )
+	return oldval == InterlockedCompareExchangePointer ((PVOID volatile*)atomic, newval, oldval);
+#else
+#	error "No supported atomic operations for this platform."
+#endif
+}
+
+/* 64-bit word compare and swap, returns TRUE if *atomic held oldval and now holds newval.
+ */
+
+static inline
+bool
+pgm_atomic_compare_and_exchange64 (
+	volatile uint64_t*	atomic,
+	const uint64_t		oldval,
+	const uint64_t		newval
+	)
+{
+#if defined( __GNUC__ ) && ( __GNUC__ * 100 + __GNUC_MINOR__ >= 401 )
+	return __sync_bool_compare_and_swap (atomic, oldval, newval);
+#elif defined( __sun ) || defined( __NetBSD__ )
+	return oldval == atomic_cas_64 (atomic, oldval, newval);
+#elif defined( __APPLE__ )
+	return OSAtomicCompareAndSwap64Barrier ((int64_t)oldval, (int64_t)newval, (volatile int64_t*)atomic);
+#elif defined( _AIX ) && defined( __64BIT__ )
+	long cmp = (long)oldval;
+	return compare_and_swaplp ((atomic_l)atomic, &cmp, (long)newval);
+#elif defined( _WIN32 )
+	return (LONGLONG)oldval == InterlockedCompareExchange64 ((LONGLONG volatile*)atomic, (LONGLONG)newval, (LONGLONG)oldval);
+#else
+#	error "No supported atomic operations for this platform."
+#endif
+}
+
+/* 64-bit word addition.
+ *
+ * 	*atomic += val;
+ */
+
+static inline
+void
+pgm_atomic_add64 (
+	volatile uint64_t*	atomic,
+	const uint64_t		val
+	)
+{
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+	__asm__ volatile ("lock; addq %1, %0"
+		        : "=m" (*atomic)
+		        : "er" (val), "m" (*atomic)
+		        : "memory", "cc"  );
+#elif defined( __GNUC__ ) && ( __GNUC__ * 100 + __GNUC_MINOR__ >= 401 )
+	__sync_add_and_fetch (atomic, val);
+#elif defined( __sun ) || defined( __NetBSD__ )
+	atomic_add_64 (atomic, (int64_t)val);
+#elif defined( __APPLE__ )
+	OSAtomicAdd64Barrier ((int64_t)val, (volatile int64_t*)atomic);
+#else
+	uint64_t oldval;
+	do {
+		oldval = *atomic;
+	} while (!pgm_atomic_compare_and_exchange64 (atomic, oldval, oldval + val));
+#endif
+}
+
+/* 64-bit word load, untorn on 32-bit platforms.
+ */
+
+static inline
+uint64_t
+pgm_atomic_read64 (
+	const volatile uint64_t* atomic
+	)
+{
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __LP64__ ) || defined( _WIN64 )
+	return *atomic;
+#elif defined( __GNUC__ ) && ( __GNUC__ * 100 + __GNUC_MINOR__ >= 401 )
+	return __sync_val_compare_and_swap ((volatile uint64_t*)atomic, 0, 0);
+#else
+	uint64_t val;
+	do {
+		val = *atomic;
+	} while (!pgm_atomic_compare_and_exchange64 ((volatile uint64_t*)atomic, val, val));
+	return val;
+#endif
+}
+
 #endif /* __PGM_ATOMIC_H__ */
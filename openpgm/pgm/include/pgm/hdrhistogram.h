@@ -0,0 +1,75 @@
+/* vim:ts=8:sts=4:sw=4:noai:noexpandtab
+ *
+ * Per-socket and per-peer log-linear histograms.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_HDRHISTOGRAM_H__
+#define __PGM_HDRHISTOGRAM_H__
+
+#include <pgm/types.h>
+#include <pgm/tsi.h>
+#include <pgm/socket.h>
+
+PGM_BEGIN_DECLS
+
+/* values below 2^PGM_HDR_SUB_BITS have a bucket each, above that every power
+ * of two is split into 2^PGM_HDR_SUB_BITS linear buckets, i.e. a relative
+ * error of 12.5%.  values saturate at 2^32 - 1.
+ */
+#define PGM_HDR_SUB_BITS	3
+#define PGM_HDR_VALUE_BITS	32
+#define PGM_HDR_BUCKETS		((PGM_HDR_VALUE_BITS - PGM_HDR_SUB_BITS + 1) << PGM_HDR_SUB_BITS)
+
+/* histograms kept for the socket and for each peer */
+enum {
+	PGM_HDR_REPAIR_TIME = 0,	/* loss detection to repair, microseconds */
+	PGM_HDR_FAIL_TIME,		/* loss detection to unrecoverable, microseconds */
+	PGM_HDR_NAK_TRANSMITS,		/* NAKs sent per repaired sequence */
+	PGM_HDR_NCF_RETRIES,		/* NCF timeouts per repaired sequence */
+	PGM_HDR_DATA_RETRIES,		/* RDATA timeouts per repaired sequence */
+	PGM_HDR_SPMR_RESPONSE_TIME,	/* SPMR to SPM, microseconds */
+	PGM_HDR_DATA_BYTES,		/* TSDU length of each ODATA and RDATA */
+	PGM_HDR_LATENCY,		/* ODATA source transmit to receipt, nanoseconds */
+	PGM_HDR_JITTER,			/* change in latency between ODATA, nanoseconds */
+	PGM_HDR_MAX
+};
+
+/* snapshot modes */
+enum {
+	PGM_HDR_CUMULATIVE = 0,		/* since creation or the last reset */
+	PGM_HDR_DELTA			/* since the previous delta snapshot */
+};
+
+struct pgm_hdr_snapshot_t {
+	uint64_t	hs_count;
+	uint64_t	hs_sum;
+	uint64_t	hs_counts[ PGM_HDR_BUCKETS ];
+};
+
+bool pgm_hdr_snapshot (pgm_sock_t*const restrict, const pgm_tsi_t*const restrict, const int, const int, struct pgm_hdr_snapshot_t*const restrict);
+bool pgm_hdr_reset (pgm_sock_t*const restrict, const pgm_tsi_t*const restrict, const int);
+uint64_t pgm_hdr_bucket_lowest (const unsigned) PGM_GNUC_CONST;
+uint64_t pgm_hdr_percentile (const struct pgm_hdr_snapshot_t*const, const double) PGM_GNUC_PURE;
+
+PGM_END_DECLS
+
+#endif /* __PGM_HDRHISTOGRAM_H__ */
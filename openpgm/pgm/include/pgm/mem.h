@@ -38,6 +38,16 @@ PGM_BEGIN_DECLS
 
 extern bool pgm_mem_gc_friendly;
 
+/* replacement heap allocator, calloc may be NULL */
+struct pgm_mem_vtable_t {
+	void*	(*malloc)	(size_t);
+	void*	(*calloc)	(size_t, size_t);
+	void*	(*realloc)	(void*, size_t);
+	void	(*free)		(void*);
+};
+
+bool pgm_mem_set_vtable (const struct pgm_mem_vtable_t*);
+
 void* pgm_malloc (const size_t) PGM_GNUC_MALLOC PGM_GNUC_ALLOC_SIZE(1);
 void* pgm_malloc_n (const size_t, const size_t) PGM_GNUC_MALLOC PGM_GNUC_ALLOC_SIZE2(1, 2);
 void* pgm_malloc0 (const size_t) PGM_GNUC_MALLOC PGM_GNUC_ALLOC_SIZE(1);
@@ -107,6 +107,8 @@ enum pgm_type_e {
 #define PGM_OPT_PGMCC_DATA	    0x12
 #define PGM_OPT_PGMCC_FEEDBACK	    0x13
 
+#define PGM_OPT_TSTAMP		    0x14	/* sender transmit timestamp */
+
 #define PGM_OPT_NAK_BO_IVL	    0x04	/* nak back-off interval */
 #define PGM_OPT_NAK_BO_RNG	    0x05	/* nak back-off range */
 #define PGM_OPT_NBR_UNREACH	    0x0b	/* neighbour unreachable */
@@ -361,6 +363,15 @@ struct pgm_opt6_pgmcc_feedback {
 	struct in6_addr	opt6_nla;		/* ACKER nla */
 };
 
+/* Transmit timestamp - OPT_TSTAMP, wall clock of the source when the ODATA
+ * was first sent, RDATA repeats the original time.
+ */
+struct pgm_opt_tstamp {
+	uint8_t		opt_reserved;		/* reserved */
+	uint32_t	opt_tstamp_sec;		/* seconds since the Unix epoch */
+	uint32_t	opt_tstamp_nsec;	/* nanoseconds */
+};
+
 
 /*
  * SPM Requests
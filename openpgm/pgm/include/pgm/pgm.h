@@ -37,6 +37,7 @@
 #include <pgm/engine.h>
 #include <pgm/error.h>
 #include <pgm/gsi.h>
+#include <pgm/hdrhistogram.h>
 #include <pgm/if.h>
 #include <pgm/macros.h>
 #include <pgm/mem.h>
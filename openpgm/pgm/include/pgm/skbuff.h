@@ -54,7 +54,11 @@ struct pgm_sk_buff_t {
 
 	uint16_t			len;		/* actual data */
 	unsigned			zero_padded:1;
-	unsigned			__padding2:31;	/* fix bit field */
+	unsigned			is_pooled:1;	/* owned by a socket skbuff pool */
+	unsigned			is_txw_slot:1;	/* owned by a transmit window arena */
+	unsigned			csum_deferred:1;	/* PGM checksum not yet verified */
+	unsigned			csum_optional:1;	/* accept data without PGM checksum */
+	unsigned			__padding2:27;	/* fix bit field */
 
 	struct pgm_header*		pgm_header;
 	struct pgm_opt_fragment* 	pgm_opt_fragment;
@@ -75,6 +79,7 @@ struct pgm_sk_buff_t {
 void pgm_skb_over_panic (const struct pgm_sk_buff_t*const, const uint16_t) PGM_GNUC_NORETURN;
 void pgm_skb_under_panic (const struct pgm_sk_buff_t*const, const uint16_t) PGM_GNUC_NORETURN;
 bool pgm_skb_is_valid (const struct pgm_sk_buff_t*const) PGM_GNUC_PURE PGM_GNUC_WARN_UNUSED_RESULT;
+void pgm_skb_pool_free (struct pgm_sk_buff_t*const);
 
 /* attribute __pure__ only valid for platforms with atomic ops.
  * attribute __malloc__ not used as only part of the memory should be aliased.
@@ -125,8 +130,13 @@ pgm_free_skb (
 	struct pgm_sk_buff_t*const skb
 	)
 {
-	if (pgm_atomic_exchange_and_add32 (&skb->users, (uint32_t)-1) == 1)
-		pgm_free (skb);
+	if (pgm_atomic_exchange_and_add32 (&skb->users, (uint32_t)-1) == 1) {
+		if (skb->is_pooled)
+			pgm_skb_pool_free (skb);
+/* zero users marks a transmit window slot free for reuse */
+		else if (!skb->is_txw_slot)
+			pgm_free (skb);
+	}
 }
 
 /* add data */
@@ -216,6 +226,8 @@ pgm_skb_copy (
 	newskb = (struct pgm_sk_buff_t*)pgm_malloc (skb->truesize);
 	memcpy (newskb, skb, PGM_OFFSETOF(struct pgm_sk_buff_t, pgm_header));
 	newskb->zero_padded = 0;
+	newskb->is_pooled = 0;
+	newskb->is_txw_slot = 0;
 	newskb->truesize = skb->truesize;
 	pgm_atomic_write32 (&newskb->users, 1);
 	newskb->head = newskb + 1;
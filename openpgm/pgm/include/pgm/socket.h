@@ -94,6 +94,47 @@ struct pgm_pgmccinfo_t {
 	uint32_t				ack_c_p;
 };
 
+/* source repair service, latency from a NAK queueing a request to its RDATA */
+struct pgm_repairinfo_t {
+	uint32_t				queue_depth;		/* requests waiting */
+	uint32_t				queue_depth_max;	/* high watermark */
+	uint32_t				bursts;			/* wakeups sending RDATA */
+	uint32_t				repairs;		/* RDATA packets sent */
+	uint64_t				drain_latency_max;	/* microseconds */
+	uint64_t				drain_latency_total;	/* microseconds, mean over repairs */
+};
+
+/* one-way latency of ODATA carrying the source transmit time, over all peers.
+ * latency is negative when the source clock is ahead of the receiver.
+ */
+struct pgm_latencyinfo_t {
+	uint64_t				samples;
+	int64_t					latency_min;		/* nanoseconds */
+	int64_t					latency_max;		/* nanoseconds */
+	int64_t					latency_total;		/* nanoseconds, mean over samples */
+	uint64_t				jitter;			/* nanoseconds, RFC 3550 interarrival jitter */
+};
+
+/* in-process transport replacing the network, impairments apply to packets
+ * delivered to the socket.  rates are in parts per million.
+ */
+struct pgm_loopbackinfo_t {
+	uint32_t				loss_rate;
+	uint32_t				duplicate_rate;
+	uint32_t				reorder_rate;
+	uint32_t				delay;			/* microseconds */
+	uint32_t				ring_size;		/* packets, 0 for the default */
+	uint32_t				seed;			/* 0 for a random seed */
+};
+
+/* receive sharding, sources are divided by TSI between shard_count sockets
+ * bound in shard_index order.
+ */
+struct pgm_shardinfo_t {
+	uint32_t				shard_count;
+	uint32_t				shard_index;
+};
+
 /* socket options */
 enum {
 	PGM_SEND_SOCK		= 0x2000,
@@ -149,7 +190,35 @@ enum {
 	PGM_UNCONTROLLED_ODATA,
 	PGM_UNCONTROLLED_RDATA,
 	PGM_ODATA_MAX_RTE,
-	PGM_RDATA_MAX_RTE
+	PGM_RDATA_MAX_RTE,
+	PGM_RECV_BATCH,
+	PGM_SKB_POOL_SIZE,
+	PGM_SKB_POOL_HITS,
+	PGM_SKB_POOL_MISSES,
+	PGM_SEND_BATCH,
+	PGM_UDP_GSO,
+	PGM_REPAIR_BURST,
+	PGM_REPAIR_INFO,
+	PGM_SERVICE_THREAD,
+	PGM_SERVICE_CPU,
+	PGM_DEFERRED_CHECKSUM,
+	PGM_ZERO_CHECKSUM,
+	PGM_RECV_SHARD,
+	PGM_TXW_HUGEPAGES,
+	PGM_RXW_HUGEPAGES,
+	PGM_NUMA_NODE,
+	PGM_BUSY_POLL,
+	PGM_TX_TSTAMP,
+	PGM_RX_TSTAMP,
+	PGM_LATENCY_INFO,
+	PGM_LOOPBACK
+};
+
+/* receive timestamp source for one-way latency, PGM_RX_TSTAMP */
+enum {
+	PGM_RX_TSTAMP_USER = 0,		/* wall clock read when the packet is parsed */
+	PGM_RX_TSTAMP_SOFTWARE,		/* kernel receive timestamp */
+	PGM_RX_TSTAMP_HARDWARE		/* NIC receive timestamp, falls back to the kernel */
 };
 
 /* IO status */
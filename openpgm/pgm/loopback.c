@@ -0,0 +1,391 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * In-process transport with simulated loss, reordering, delay and
+ * duplication.  Every bound socket with PGM_LOOPBACK owns a ring of
+ * packets, a send copies the packet into the ring of each other such
+ * socket listening on the destination port in place of a network write.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <string.h>
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <impl/socket.h>
+
+
+//#define LOOPBACK_DEBUG
+
+#ifndef LOOPBACK_DEBUG
+#	define PGM_DISABLE_ASSERT
+#endif
+
+struct pgm_loopback_slot_t {
+	pgm_time_t			due;
+	struct sockaddr_storage		src;
+	struct sockaddr_storage		dst;
+	uint16_t			len;
+	char*				data;		/* max_tpdu bytes of loopback_t::buffer */
+};
+
+struct pgm_loopback_t {
+	struct pgm_loopbackinfo_t	info;
+	uint16_t			max_tpdu;
+	pgm_mutex_t			mutex;
+	pgm_notify_t			notify;		/* readable whilst packets are queued */
+	bool				is_notified;
+	pgm_rand_t			rand_;
+
+	struct pgm_loopback_slot_t*	slots;		/* ring_size + 1, the last holds a reordered packet */
+	char*				buffer;
+	uint32_t			mask;		/* ring_size - 1, ring_size a power of two */
+	uint32_t			head, tail;
+	bool				is_held;
+
+	uint64_t			delivered;
+	uint64_t			lost;
+	uint64_t			duplicated;
+	uint64_t			reordered;
+	uint64_t			overflows;
+};
+
+
+/* TRUE with probability rate parts per million.
+ */
+
+static inline
+bool
+_pgm_loopback_chance (
+	pgm_rand_t*	rand_,
+	const uint32_t	rate
+	)
+{
+	if (0 == rate)
+		return FALSE;
+	return (((uint64_t)pgm_rand_int (rand_) * 1000000) >> 32) < rate;
+}
+
+/* create the receiving end of the transport, returns NULL if a notification
+ * channel cannot be created.
+ */
+
+PGM_GNUC_INTERNAL
+pgm_loopback_t*
+pgm_loopback_create (
+	const struct pgm_loopbackinfo_t* const	info,
+	const uint16_t				max_tpdu
+	)
+{
+	pgm_loopback_t* ep;
+	uint32_t ring_size = 1;
+
+/* pre-conditions */
+	pgm_assert (NULL != info);
+	pgm_assert (max_tpdu > 0);
+
+	ep = pgm_new0 (pgm_loopback_t, 1);
+	if (0 != pgm_notify_init (&ep->notify)) {
+		pgm_free (ep);
+		return NULL;
+	}
+	ep->info	= *info;
+	ep->max_tpdu	= max_tpdu;
+	while (ring_size < (info->ring_size ? info->ring_size : PGM_LOOPBACK_RING_SIZE))
+		ring_size <<= 1;
+	ep->info.ring_size = ring_size;
+	ep->mask	= ring_size - 1;
+	ep->slots	= pgm_new0 (struct pgm_loopback_slot_t, ring_size + 1);
+	ep->buffer	= pgm_malloc ((size_t)(ring_size + 1) * max_tpdu);
+	for (uint32_t i = 0; i <= ring_size; i++)
+		ep->slots[ i ].data = ep->buffer + (size_t)i * max_tpdu;
+	if (info->seed)
+		ep->rand_.seed = info->seed;
+	else
+		pgm_rand_create (&ep->rand_);
+	pgm_mutex_init (&ep->mutex);
+	return ep;
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_loopback_destroy (
+	pgm_loopback_t* const	ep
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != ep);
+
+	pgm_trace (PGM_LOG_ROLE_NETWORK,_("Loopback transport delivered %" PRIu64 " packets, lost %" PRIu64 ", duplicated %" PRIu64 ", reordered %" PRIu64 ", overflowed %" PRIu64 "."),
+		ep->delivered, ep->lost, ep->duplicated, ep->reordered, ep->overflows);
+	pgm_mutex_free (&ep->mutex);
+	pgm_notify_destroy (&ep->notify);
+	pgm_free (ep->buffer);
+	pgm_free (ep->slots);
+	pgm_free (ep);
+}
+
+/* append the held packet or a new copy to the ring, a full ring drops the
+ * packet as a socket receive buffer would.
+ */
+
+static
+void
+_pgm_loopback_push (
+	pgm_loopback_t*        const restrict ep,
+	const struct pgm_loopback_slot_t*     restrict src_slot,
+	const void*		     restrict buf,
+	const size_t			      len,
+	const struct sockaddr*	     restrict src,
+	const struct sockaddr*	     restrict dst,
+	const pgm_time_t		      due
+	)
+{
+	if (PGM_UNLIKELY(ep->tail - ep->head > ep->mask)) {
+		ep->overflows++;
+		return;
+	}
+	struct pgm_loopback_slot_t* slot = &ep->slots[ ep->tail++ & ep->mask ];
+	if (NULL != src_slot) {
+		slot->due = src_slot->due;
+		slot->len = src_slot->len;
+		memcpy (&slot->src, &src_slot->src, sizeof(struct sockaddr_storage));
+		memcpy (&slot->dst, &src_slot->dst, sizeof(struct sockaddr_storage));
+		memcpy (slot->data, src_slot->data, src_slot->len);
+		return;
+	}
+	slot->due = due;
+	slot->len = (uint16_t)len;
+	memcpy (&slot->src, src, pgm_sockaddr_len (src));
+	memcpy (&slot->dst, dst, pgm_sockaddr_len (dst));
+	memcpy (slot->data, buf, len);
+}
+
+/* impair and queue one packet on a receiving end.
+ */
+
+static
+void
+_pgm_loopback_deliver (
+	pgm_loopback_t*    const restrict ep,
+	const void*		 restrict buf,
+	const size_t			  len,
+	const struct sockaddr*	 restrict src,
+	const struct sockaddr*	 restrict dst,
+	const pgm_time_t		  now
+	)
+{
+	pgm_mutex_lock (&ep->mutex);
+	if (_pgm_loopback_chance (&ep->rand_, ep->info.loss_rate)) {
+		ep->lost++;
+		goto out;
+	}
+	const pgm_time_t due = now + pgm_usecs (ep->info.delay);
+	const unsigned copies = _pgm_loopback_chance (&ep->rand_, ep->info.duplicate_rate) ? 2 : 1;
+	ep->duplicated += copies - 1;
+/* hold the packet back until the next one has been queued */
+	if (!ep->is_held && _pgm_loopback_chance (&ep->rand_, ep->info.reorder_rate)) {
+		struct pgm_loopback_slot_t* held = &ep->slots[ ep->mask + 1 ];
+		held->due = due;
+		held->len = (uint16_t)len;
+		memcpy (&held->src, src, pgm_sockaddr_len (src));
+		memcpy (&held->dst, dst, pgm_sockaddr_len (dst));
+		memcpy (held->data, buf, len);
+		ep->is_held = TRUE;
+		ep->reordered++;
+		if (copies > 1)
+			_pgm_loopback_push (ep, NULL, buf, len, src, dst, due);
+	}
+	else
+	{
+		for (unsigned i = 0; i < copies; i++)
+			_pgm_loopback_push (ep, NULL, buf, len, src, dst, due);
+		if (ep->is_held) {
+			_pgm_loopback_push (ep, &ep->slots[ ep->mask + 1 ], NULL, 0, NULL, NULL, 0);
+			ep->is_held = FALSE;
+		}
+	}
+/* a held packet is released by a read on an empty ring, so it signals too */
+	if (!ep->is_notified) {
+		pgm_notify_send (&ep->notify);
+		ep->is_notified = TRUE;
+	}
+out:
+	pgm_mutex_unlock (&ep->mutex);
+}
+
+/* copy a packet to every other loopback socket bound to the destination
+ * port, or to all of them for PGM over IP.
+ *
+ * returns len, impairments are invisible to the sender.
+ */
+
+PGM_GNUC_INTERNAL
+ssize_t
+pgm_loopback_sendto (
+	pgm_sock_t*	       const restrict sock,
+	const void*		     restrict buf,
+	const size_t			      len,
+	const struct sockaddr*	     restrict to,
+	const socklen_t			      tolen
+	)
+{
+	pgm_time_t now = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != buf);
+	pgm_assert (len > 0);
+	pgm_assert (NULL != to);
+	pgm_assert (tolen > 0);
+
+	const uint16_t port = ntohs (pgm_sockaddr_port (to));
+	pgm_rwlock_reader_lock (&pgm_sock_list_lock);
+	for (pgm_slist_t* list = pgm_sock_list; NULL != list; list = list->next)
+	{
+		pgm_sock_t* peer = list->data;
+		if (peer == sock || NULL == peer->loopback || len > peer->max_tpdu)
+			continue;
+		if (0 != port &&
+		    port != peer->udp_encap_ucast_port &&
+		    port != peer->udp_encap_mcast_port)
+			continue;
+		if (0 == now && 0 != peer->loopback->info.delay)
+			now = pgm_time_update_now();
+		_pgm_loopback_deliver (peer->loopback, buf, len, (const struct sockaddr*)&sock->send_addr, to, now);
+	}
+	pgm_rwlock_reader_unlock (&pgm_sock_list_lock);
+	return (ssize_t)len;
+}
+
+/* read the next due packet, the held packet is released once nothing else
+ * is queued.
+ *
+ * on success returns packet length, on empty ring returns -1 and sets
+ * PGM_SOCK_EAGAIN.
+ */
+
+PGM_GNUC_INTERNAL
+ssize_t
+pgm_loopback_recvfrom (
+	pgm_loopback_t*	 const restrict ep,
+	void*			restrict buf,
+	const size_t			 buflen,
+	struct sockaddr*	restrict src_addr,
+	const socklen_t			 src_addrlen,
+	struct sockaddr*	restrict dst_addr,
+	const socklen_t			 dst_addrlen
+	)
+{
+	ssize_t len = -1;
+
+/* pre-conditions */
+	pgm_assert (NULL != ep);
+	pgm_assert (NULL != buf);
+	pgm_assert (NULL != src_addr);
+	pgm_assert (NULL != dst_addr);
+
+	pgm_mutex_lock (&ep->mutex);
+	if (ep->head == ep->tail && ep->is_held) {
+		_pgm_loopback_push (ep, &ep->slots[ ep->mask + 1 ], NULL, 0, NULL, NULL, 0);
+		ep->is_held = FALSE;
+	}
+	if (ep->head != ep->tail)
+	{
+		const struct pgm_loopback_slot_t* slot = &ep->slots[ ep->head & ep->mask ];
+		if (0 == ep->info.delay ||
+		    pgm_time_after_eq (pgm_time_update_now(), slot->due))
+		{
+			len = MIN(slot->len, buflen);
+			memcpy (buf, slot->data, len);
+			memcpy (src_addr, &slot->src, MIN(src_addrlen, (socklen_t)sizeof(struct sockaddr_storage)));
+			memcpy (dst_addr, &slot->dst, MIN(dst_addrlen, (socklen_t)sizeof(struct sockaddr_storage)));
+			ep->head++;
+			ep->delivered++;
+		}
+	}
+	if (-1 == len) {
+		if (ep->is_notified) {
+			pgm_notify_clear (&ep->notify);
+			ep->is_notified = FALSE;
+		}
+		pgm_set_last_sock_error (PGM_SOCK_EAGAIN);
+	}
+	pgm_mutex_unlock (&ep->mutex);
+	return len;
+}
+
+/* due time of the next packet, returns FALSE when nothing is queued.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_loopback_next_due (
+	pgm_loopback_t* const restrict	ep,
+	pgm_time_t*	const restrict	due
+	)
+{
+	bool is_queued = TRUE;
+
+/* pre-conditions */
+	pgm_assert (NULL != ep);
+	pgm_assert (NULL != due);
+
+	pgm_mutex_lock (&ep->mutex);
+	if (ep->head != ep->tail)
+		*due = ep->slots[ ep->head & ep->mask ].due;
+	else if (ep->is_held)
+		*due = ep->slots[ ep->mask + 1 ].due;
+	else
+		is_queued = FALSE;
+	pgm_mutex_unlock (&ep->mutex);
+	return is_queued;
+}
+
+/* TRUE when a read at now would return a packet.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_loopback_is_ready (
+	pgm_loopback_t* const	ep,
+	const pgm_time_t	now
+	)
+{
+	pgm_time_t due;
+	return pgm_loopback_next_due (ep, &due) && pgm_time_after_eq (now, due);
+}
+
+/* descriptor readable whilst packets are queued, for the receive socket in
+ * poll, select and epoll sets.
+ */
+
+PGM_GNUC_INTERNAL
+SOCKET
+pgm_loopback_get_socket (
+	pgm_loopback_t* const	ep
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != ep);
+
+	return pgm_notify_get_socket (&ep->notify);
+}
+
+/* eof */
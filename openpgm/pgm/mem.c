@@ -25,11 +25,20 @@
 #	include <config.h>
 #endif
 #include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#ifndef _WIN32
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	ifdef __linux__
+#		include <sys/syscall.h>
+#	endif
+#endif
 #ifdef _WIN32
 #	define strcasecmp	stricmp
 #endif
+#include <impl/i18n.h>
 #include <impl/framework.h>
 #include <impl/mem.h>
 
@@ -52,6 +61,21 @@ typedef struct pgm_debug_key_t pgm_debug_key_t;
 
 static volatile uint32_t mem_ref_count = 0;
 
+static void* mem_calloc (size_t, size_t);
+
+static struct pgm_mem_vtable_t mem_vtable PGM_GNUC_READ_MOSTLY = {
+	.malloc		= malloc,
+	.calloc		= calloc,
+	.realloc	= realloc,
+	.free		= free
+};
+
+/* hugetlb arenas are rounded up to the default x86 and ARM64 large page */
+#define PGM_MEM_HUGEPAGE_SIZE	(2 * 1024 * 1024)
+
+/* mbind(2) policy without a libnuma dependency */
+#define PGM_MPOL_PREFERRED	1
+
 
 static
 bool
@@ -149,6 +173,52 @@ pgm_mem_shutdown (void)
 	/* nop */
 }
 
+/* replace the heap allocator behind pgm_malloc() and friends, must be called
+ * before pgm_init() as memory is never moved between allocators.
+ *
+ * returns TRUE on success, returns FALSE if already initialized or the
+ * vtable is incomplete.
+ */
+
+bool
+pgm_mem_set_vtable (
+	const struct pgm_mem_vtable_t*	vtable
+	)
+{
+	pgm_return_val_if_fail (NULL != vtable, FALSE);
+	pgm_return_val_if_fail (NULL != vtable->malloc, FALSE);
+	pgm_return_val_if_fail (NULL != vtable->realloc, FALSE);
+	pgm_return_val_if_fail (NULL != vtable->free, FALSE);
+
+	if (pgm_atomic_read32 (&mem_ref_count) > 0)
+		return FALSE;
+
+	mem_vtable.malloc	= vtable->malloc;
+	mem_vtable.calloc	= vtable->calloc ? vtable->calloc : mem_calloc;
+	mem_vtable.realloc	= vtable->realloc;
+	mem_vtable.free		= vtable->free;
+	return TRUE;
+}
+
+/* calloc for a vtable without one */
+
+static
+void*
+mem_calloc (
+	size_t		n_blocks,
+	size_t		block_bytes
+	)
+{
+	void* mem;
+
+	if (block_bytes && n_blocks > SIZE_MAX / block_bytes)
+		return NULL;
+	mem = mem_vtable.malloc (n_blocks * block_bytes);
+	if (mem)
+		memset (mem, 0, n_blocks * block_bytes);
+	return mem;
+}
+
 /* malloc wrappers to hard fail */
 void*
 pgm_malloc (
@@ -157,7 +227,7 @@ pgm_malloc (
 {
 	if (PGM_LIKELY (n_bytes))
 	{
-		void* mem = malloc (n_bytes);
+		void* mem = mem_vtable.malloc (n_bytes);
 		if (mem)
 			return mem;
 
@@ -204,7 +274,7 @@ pgm_malloc0 (
 {
 	if (PGM_LIKELY (n_bytes))
 	{
-		void* mem = calloc (1, n_bytes);
+		void* mem = mem_vtable.calloc (1, n_bytes);
 		if (mem)
 			return mem;
 
@@ -230,7 +300,7 @@ pgm_malloc0_n (
 {
 	if (PGM_LIKELY (n_blocks && block_bytes))
 	{
-		void* mem = calloc (n_blocks, block_bytes);
+		void* mem = mem_vtable.calloc (n_blocks, block_bytes);
 		if (mem)
 			return mem;
 
@@ -273,7 +343,7 @@ pgm_realloc (
 	const size_t	n_bytes
 	)
 {
-	return realloc (mem, n_bytes);
+	return mem_vtable.realloc (mem, n_bytes);
 }
 
 void
@@ -282,7 +352,128 @@ pgm_free (
 	)
 {
 	if (PGM_LIKELY (NULL != mem))
-		free (mem);
+		mem_vtable.free (mem);
+}
+
+/* map len zero filled bytes for window storage.  with use_hugepages the
+ * mapping is first tried from the hugetlb pool and then as transparent
+ * hugepages, a non-negative node prefers that NUMA node for every page.
+ * otherwise, or where mapping is unavailable, falls back to the heap.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_mem_arena_init (
+	struct pgm_mem_arena_t*const	arena,
+	const size_t			len,
+	const int			node,		/* -1 for first touch */
+	const bool			use_hugepages
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != arena);
+	pgm_assert_cmpuint (len, >, 0);
+
+	arena->base	 = NULL;
+	arena->len	 = len;
+	arena->is_mapped = 0;
+
+#if !defined( _WIN32 ) && defined( MAP_ANONYMOUS )
+	if (use_hugepages || node >= 0)
+	{
+		void* base = MAP_FAILED;
+		size_t map_len;
+#	ifdef MAP_HUGETLB
+		if (use_hugepages) {
+			map_len = (len + (PGM_MEM_HUGEPAGE_SIZE - 1)) & ~(size_t)(PGM_MEM_HUGEPAGE_SIZE - 1);
+			base = mmap (NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (MAP_FAILED == base) {
+				const int save_errno = errno;
+				char errbuf[1024];
+				pgm_trace (PGM_LOG_ROLE_MEMORY,_("Hugetlb mapping of %" PRIzu " bytes unavailable: %s"),
+					   map_len,
+					   pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			}
+		}
+#	endif
+		if (MAP_FAILED == base) {
+			const size_t page_size = (size_t)sysconf (_SC_PAGESIZE);
+			map_len = (len + (page_size - 1)) & ~(page_size - 1);
+			base = mmap (NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (MAP_FAILED == base) {
+				const int save_errno = errno;
+				char errbuf[1024];
+				pgm_warn (_("Mapping window storage of %" PRIzu " bytes failed: %s"),
+					  map_len,
+					  pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			}
+#	ifdef MADV_HUGEPAGE
+			else if (use_hugepages && 0 != madvise (base, map_len, MADV_HUGEPAGE)) {
+				const int save_errno = errno;
+				char errbuf[1024];
+				pgm_warn (_("Transparent hugepages unavailable for window storage: %s"),
+					  pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			}
+#	else
+			else if (use_hugepages)
+				pgm_warn (_("Hugepage window storage is not supported on this platform."));
+#	endif
+		}
+		if (MAP_FAILED != base) {
+/* pages are untouched so the policy applies to every fault */
+			if (node >= 0) {
+#	if defined( __linux__ ) && defined( SYS_mbind )
+				unsigned long nodemask;
+				if (node >= (int)(sizeof (nodemask) * 8)) {
+					pgm_warn (_("NUMA node %d beyond supported mask."), node);
+				} else {
+					nodemask = 1UL << node;
+					if (0 != syscall (SYS_mbind, base, map_len, PGM_MPOL_PREFERRED, &nodemask, sizeof (nodemask) * 8 + 1, 0)) {
+						const int save_errno = errno;
+						char errbuf[1024];
+						pgm_warn (_("Binding window storage to NUMA node %d failed: %s"),
+							  node,
+							  pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+					}
+				}
+#	else
+				pgm_warn (_("NUMA node binding is not supported on this platform."));
+#	endif
+			}
+			arena->base	 = base;
+			arena->len	 = map_len;
+			arena->is_mapped = 1;
+			return;
+		}
+	}
+#else
+	if (use_hugepages)
+		pgm_warn (_("Hugepage window storage is not supported on this platform."));
+	if (node >= 0)
+		pgm_warn (_("NUMA node binding is not supported on this platform."));
+#endif /* !_WIN32 */
+
+	arena->base = pgm_malloc0 (len);
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_mem_arena_destroy (
+	struct pgm_mem_arena_t*const	arena
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != arena);
+
+	if (NULL == arena->base)
+		return;
+#if !defined( _WIN32 ) && defined( MAP_ANONYMOUS )
+	if (arena->is_mapped)
+		munmap (arena->base, arena->len);
+	else
+#endif
+		pgm_free (arena->base);
+	arena->base = NULL;
 }
 
 /* eof */
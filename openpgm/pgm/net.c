@@ -22,6 +22,11 @@
 #ifdef HAVE_CONFIG_H
 #	include <config.h>
 #endif
+
+#ifndef _GNU_SOURCE
+#	define _GNU_SOURCE
+#endif
+
 #include <errno.h>
 #ifdef HAVE_POLL
 #	include <poll.h>
@@ -29,6 +34,7 @@
 #ifndef _WIN32
 #	include <sys/socket.h>
 #	include <netinet/in.h>
+#	include <netinet/udp.h>		/* UDP_SEGMENT */
 #	include <arpa/inet.h>
 #endif
 #include <impl/i18n.h>
@@ -40,6 +46,86 @@
 //#define NET_DEBUG
 
 
+/* wait for a blocked socket to clear and retry the failed datagram once,
+ * unreachable destinations and non-blocking sockets return immediately.
+ *
+ * on success, returns number of bytes sent.  on error, -1 is returned, and
+ * errno set appropriately.
+ */
+
+static
+ssize_t
+sendto_retry (
+	const SOCKET			send_sock,
+	const void*	       restrict	buf,
+	size_t				len,
+	const struct sockaddr* restrict	to,
+	socklen_t			tolen
+	)
+{
+	ssize_t sent = -1;
+	int save_errno = pgm_get_last_sock_error();
+	if (PGM_UNLIKELY(save_errno != PGM_SOCK_ENETUNREACH &&	/* Network is unreachable */
+	 		 save_errno != PGM_SOCK_EHOSTUNREACH &&	/* No route to host */
+	    		 save_errno != PGM_SOCK_EAGAIN))	/* would block on non-blocking send */
+	{
+#ifdef HAVE_POLL
+/* poll for cleared socket */
+		struct pollfd p = {
+			.fd		= send_sock,
+			.events		= POLLOUT,
+			.revents	= 0
+		};
+		const int ready = poll (&p, 1, 500 /* ms */);
+#else
+		fd_set writefds;
+		FD_ZERO(&writefds);
+		FD_SET(send_sock, &writefds);
+#	ifndef _WIN32
+		const int n_fds = send_sock + 1;	/* largest fd + 1 */
+#	else
+		const int n_fds = 1;			/* count of fds */
+#	endif
+		struct timeval tv = {
+			.tv_sec  = 0,
+			.tv_usec = 500 /* ms */ * 1000
+		};
+		const int ready = select (n_fds, NULL, &writefds, NULL, &tv);
+#endif /* HAVE_POLL */
+		if (ready > 0)
+		{
+			sent = sendto (send_sock, buf, len, 0, to, (socklen_t)tolen);
+			if ( sent < 0 )
+			{
+				char errbuf[1024];
+				char toaddr[INET6_ADDRSTRLEN];
+				save_errno = pgm_get_last_sock_error();
+				pgm_sockaddr_ntop (to, toaddr, sizeof(toaddr));
+				pgm_warn (_("sendto() %s failed: %s"),
+					toaddr,
+					pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			}
+		}
+		else if (ready == 0)
+		{
+			char toaddr[INET6_ADDRSTRLEN];
+			pgm_sockaddr_ntop (to, toaddr, sizeof(toaddr));
+			pgm_warn (_("sendto() %s failed: socket timeout."), toaddr);
+		}
+		else
+		{
+			char errbuf[1024];
+			save_errno = pgm_get_last_sock_error();
+			pgm_warn (_("blocked socket failed: %s"),
+				  pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		}
+/* preserve the send error across logging */
+		if (sent < 0)
+			pgm_set_last_sock_error (save_errno);
+	}
+	return sent;
+}
+
 /* locked and rate regulated sendto
  *
  * on success, returns number of bytes sent.  on error, -1 is returned, and
@@ -105,75 +191,186 @@ pgm_sendto_hops (
 
 	if (!use_router_alert && sock->can_send_data)
 		pgm_mutex_lock (&sock->send_mutex);
+
+/* in-process transport, rate regulated and serialised as the network */
+	if (NULL != sock->loopback) {
+		const ssize_t sent = pgm_loopback_sendto (sock, buf, len, to, tolen);
+		if (!use_router_alert && sock->can_send_data)
+			pgm_mutex_unlock (&sock->send_mutex);
+		return sent;
+	}
+
 	if (-1 != hops)
 		pgm_sockaddr_multicast_hops (send_sock, sock->send_gsr.gsr_group.ss_family, hops);
 
 	ssize_t sent = sendto (send_sock, buf, len, 0, to, (socklen_t)tolen);
 	pgm_debug ("sendto returned %" PRIzd, sent);
-	if (sent < 0) {
-		int save_errno = pgm_get_last_sock_error();
-		if (PGM_UNLIKELY(save_errno != PGM_SOCK_ENETUNREACH &&	/* Network is unreachable */
-		 		 save_errno != PGM_SOCK_EHOSTUNREACH &&	/* No route to host */
-		    		 save_errno != PGM_SOCK_EAGAIN))	/* would block on non-blocking send */
+	if (sent < 0)
+		sent = sendto_retry (send_sock, buf, len, to, tolen);
+
+/* revert to default value hop limit */
+	if (-1 != hops)
+		pgm_sockaddr_multicast_hops (send_sock, sock->send_gsr.gsr_group.ss_family, sock->hops);
+	if (!use_router_alert && sock->can_send_data)
+		pgm_mutex_unlock (&sock->send_mutex);
+	return sent;
+}
+
+/* locked and rate regulated transmit of several datagrams to one address, the
+ * rate limit is charged per datagram and the batch is cut where the bucket
+ * runs dry, router alert datagrams take the unlocked path as pgm_sendto().  with UDP encapsulation and
+ * generic segmentation offload enabled, equal sized datagrams are passed to
+ * the kernel as one super-packet.
+ *
+ * on success, returns number of datagrams sent.  on error, -1 is returned, and
+ * errno set appropriately.
+ */
+
+PGM_GNUC_INTERNAL
+int
+pgm_sendto_batch (
+	pgm_sock_t*	       restrict	sock,
+	bool				use_rate_limit,
+	pgm_rate_t*	       restrict	minor_rate_control,
+	bool				use_router_alert,
+	const struct pgm_iovec*restrict	vector,
+	unsigned			count,
+	const struct sockaddr* restrict	to,
+	socklen_t			tolen
+	)
+{
+	size_t	 total_length = 0;
+	int	 sent = -1;
+
+	pgm_assert( NULL != sock );
+	pgm_assert( NULL != vector );
+	pgm_assert( count > 0 );
+	pgm_assert( count <= PGM_MAX_SEND_BATCH );
+	pgm_assert( NULL != to );
+	pgm_assert( tolen > 0 );
+
+	const SOCKET send_sock = use_router_alert ? sock->send_with_router_alert_sock : sock->send_sock;
+
+/* charge each TPDU as a single send would, a batch larger than the bucket
+ * is cut at the first refused packet rather than refused whole.
+ */
+	if (use_rate_limit)
+	{
+		for (unsigned i = 0; i < count; i++)
 		{
-#ifdef HAVE_POLL
-/* poll for cleared socket */
-			struct pollfd p = {
-				.fd		= send_sock,
-				.events		= POLLOUT,
-				.revents	= 0
-			};
-			const int ready = poll (&p, 1, 500 /* ms */);
-#else
-			fd_set writefds;
-			FD_ZERO(&writefds);
-			FD_SET(send_sock, &writefds);
-#	ifndef _WIN32
-			const int n_fds = send_sock + 1;	/* largest fd + 1 */
-#	else
-			const int n_fds = 1;			/* count of fds */
-#	endif
-			struct timeval tv = {
-				.tv_sec  = 0,
-				.tv_usec = 500 /* ms */ * 1000
-			};
-			const int ready = select (n_fds, NULL, &writefds, NULL, &tv);
-#endif /* HAVE_POLL */
-			if (ready > 0)
-			{
-				sent = sendto (send_sock, buf, len, 0, to, (socklen_t)tolen);
-				if ( sent < 0 )
-				{
-					char errbuf[1024];
-					char toaddr[INET6_ADDRSTRLEN];
-					save_errno = pgm_get_last_sock_error();
-					pgm_sockaddr_ntop (to, toaddr, sizeof(toaddr));
-					pgm_warn (_("sendto() %s failed: %s"),
-						toaddr,
-						pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			const bool is_permitted = (NULL == minor_rate_control) ?
+				pgm_rate_check (&sock->rate_control, vector[i].iov_len, sock->is_nonblocking) :
+				pgm_rate_check2 (&sock->rate_control, minor_rate_control, vector[i].iov_len, sock->is_nonblocking);
+			if (!is_permitted) {
+				if (0 == i) {
+					pgm_set_last_sock_error (PGM_SOCK_ENOBUFS);
+					return -1;
 				}
+				count = i;
+				break;
 			}
-			else if (ready == 0)
-			{
-				char toaddr[INET6_ADDRSTRLEN];
-				pgm_sockaddr_ntop (to, toaddr, sizeof(toaddr));
-				pgm_warn (_("sendto() %s failed: socket timeout."), toaddr);
+		}
+	}
+
+	for (unsigned i = 0; i < count; i++)
+		total_length += vector[i].iov_len;
+
+	if (!use_router_alert && sock->can_send_data)
+		pgm_mutex_lock (&sock->send_mutex);
+
+/* in-process transport, delivery never fails at the sender */
+	if (NULL != sock->loopback) {
+		for (sent = 0; sent < (int)count; sent++)
+			pgm_loopback_sendto (sock, vector[sent].iov_base, vector[sent].iov_len, to, tolen);
+		goto out;
+	}
+
+#ifdef UDP_SEGMENT
+/* every segment but the last must be exactly gso_size */
+	if (sock->use_udp_gso &&
+	    total_length + sock->iphdr_len + sizeof(struct udphdr) <= UINT16_MAX)
+	{
+		const uint16_t gso_size = (uint16_t)vector[0].iov_len;
+		bool is_uniform = (vector[count - 1].iov_len <= gso_size);
+		for (unsigned i = 1; is_uniform && i < count - 1; i++)
+			is_uniform = (vector[i].iov_len == gso_size);
+		if (is_uniform)
+		{
+			char cbuf[CMSG_SPACE(sizeof(uint16_t))];
+			struct msghdr msg;
+			struct cmsghdr* cmsg;
+
+			memset (&msg, 0, sizeof(msg));
+			msg.msg_name		= (void*)to;
+			msg.msg_namelen		= tolen;
+			msg.msg_iov		= (struct iovec*)vector;
+			msg.msg_iovlen		= count;
+			msg.msg_control		= cbuf;
+			msg.msg_controllen	= sizeof(cbuf);
+			cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level	= IPPROTO_UDP;
+			cmsg->cmsg_type		= UDP_SEGMENT;
+			cmsg->cmsg_len		= CMSG_LEN(sizeof(uint16_t));
+			memcpy (CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+			if (sendmsg (send_sock, &msg, 0) >= 0) {
+				sent = (int)count;
+				goto out;
 			}
-			else
-			{
-				char errbuf[1024];
-				save_errno = pgm_get_last_sock_error();
-				pgm_warn (_("blocked socket failed: %s"),
-					  pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			const int save_errno = pgm_get_last_sock_error();
+			if (PGM_SOCK_EAGAIN == save_errno || PGM_SOCK_ENOBUFS == save_errno) {
+				if (sendto_retry (send_sock, vector[0].iov_base, vector[0].iov_len, to, tolen) >= 0)
+					sent = 1;
+				goto out;
 			}
+/* no segmentation offload on this path, e.g. EIO without checksum offload */
+			char errbuf[1024];
+			pgm_trace (PGM_LOG_ROLE_NETWORK,_("UDP segmentation offload failed, disabling: %s"),
+				   pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			sock->use_udp_gso = FALSE;
 		}
 	}
+#endif /* UDP_SEGMENT */
 
-/* revert to default value hop limit */
-	if (-1 != hops)
-		pgm_sockaddr_multicast_hops (send_sock, sock->send_gsr.gsr_group.ss_family, sock->hops);
+#ifdef HAVE_SENDMMSG
+	{
+		struct mmsghdr msgs[ PGM_MAX_SEND_BATCH ];
+		memset (msgs, 0, count * sizeof(struct mmsghdr));
+		for (unsigned i = 0; i < count; i++) {
+			msgs[i].msg_hdr.msg_name	= (void*)to;
+			msgs[i].msg_hdr.msg_namelen	= tolen;
+			msgs[i].msg_hdr.msg_iov		= (struct iovec*)&vector[i];
+			msgs[i].msg_hdr.msg_iovlen	= 1;
+		}
+		sent = sendmmsg (send_sock, msgs, count, 0);
+	}
+#else
+	for (sent = 0; sent < (int)count; sent++) {
+		if (sendto (send_sock, vector[sent].iov_base, vector[sent].iov_len, 0, to, (socklen_t)tolen) < 0) {
+			if (0 == sent)
+				sent = -1;
+			break;
+		}
+	}
+#endif /* HAVE_SENDMMSG */
+	pgm_debug ("sendmmsg returned %d", sent);
+
+/* a failed first datagram is handled as pgm_sendto(), a later failure is
+ * returned by the next call when the caller resumes the batch.
+ */
+	if (sent < 0 && sendto_retry (send_sock, vector[0].iov_base, vector[0].iov_len, to, tolen) >= 0)
+		sent = 1;
+out:
 	if (!use_router_alert && sock->can_send_data)
 		pgm_mutex_unlock (&sock->send_mutex);
+/* return the charge for packets the socket did not take, a retry pays again */
+	if (use_rate_limit) {
+		for (unsigned i = (sent < 0) ? 0 : (unsigned)sent; i < count; i++) {
+			if (NULL == minor_rate_control)
+				pgm_rate_refund (&sock->rate_control, vector[i].iov_len);
+			else
+				pgm_rate_refund2 (&sock->rate_control, minor_rate_control, vector[i].iov_len);
+		}
+	}
 	return sent;
 }
 
@@ -50,6 +50,7 @@ int mock_select (int, fd_set*, fd_set*, fd_set*, struct timeval*);
 
 
 #define pgm_rate_check		mock_pgm_rate_check
+#define pgm_loopback_sendto	mock_pgm_loopback_sendto
 #define sendto			mock_sendto
 #define poll			mock_poll
 #define select			mock_select
@@ -258,6 +259,21 @@ mock_fcntl (
 /* ioctlsocket */
 #endif
 
+/** loopback module */
+PGM_GNUC_INTERNAL
+ssize_t
+mock_pgm_loopback_sendto (
+	pgm_sock_t*		sock,
+	const void*		buf,
+	const size_t		len,
+	const struct sockaddr*	to,
+	const socklen_t		tolen
+	)
+{
+	g_assert_not_reached();
+	return -1;
+}
+
 
 /* target:
  *	ssize_t
@@ -270,8 +270,19 @@ pgm_parse (
 /* pre-conditions */
 	pgm_assert (NULL != skb);
 
+/* data packet checksums may be left for delivery to verify whilst copying out
+ * the payload, parity packets are always verified as they are only consumed
+ * by the decoder.
+ */
+	if (skb->csum_deferred &&
+	    !((PGM_ODATA == skb->pgm_header->pgm_type || PGM_RDATA == skb->pgm_header->pgm_type) &&
+	      !(skb->pgm_header->pgm_options & PGM_OPT_PARITY)))
+	{
+		skb->csum_deferred = 0;
+	}
+
 /* pgm_checksum == 0 means no transmitted checksum */
-	if (skb->pgm_header->pgm_checksum)
+	if (skb->pgm_header->pgm_checksum && !skb->csum_deferred)
 	{
 		const uint16_t sum = skb->pgm_header->pgm_checksum;
 		skb->pgm_header->pgm_checksum = 0;
@@ -285,9 +296,11 @@ pgm_parse (
 			     	     pgm_sum, sum);
 			return FALSE;
 		}
-	} else {
-		if (PGM_ODATA == skb->pgm_header->pgm_type ||
-		    PGM_RDATA == skb->pgm_header->pgm_type)
+	} else if (0 == skb->pgm_header->pgm_checksum) {
+		skb->csum_deferred = 0;
+		if (!skb->csum_optional &&
+		    (PGM_ODATA == skb->pgm_header->pgm_type ||
+		     PGM_RDATA == skb->pgm_header->pgm_type))
 		{
 			pgm_set_error (error,
 				     PGM_ERROR_DOMAIN_PACKET,
@@ -159,6 +159,14 @@ generate_udp_encap_pgm (void)
 	return skb;
 }
 
+static
+void
+mock_setup (void)
+{
+	const pgm_cpu_t cpu = { 0 };
+	pgm_checksum_init (&cpu);
+}
+
 /* mock functions for external references */
 
 size_t
@@ -231,6 +239,60 @@ START_TEST (test_parse_udp_encap_pass_001)
 }
 END_TEST
 
+/* checksum deferred to delivery, verified whilst copying the payload */
+START_TEST (test_parse_udp_encap_pass_002)
+{
+	const char source[] = "i am not a string";
+	char buf[1024];
+	pgm_error_t* err = NULL;
+	struct pgm_sk_buff_t* skb = generate_udp_encap_pgm ();
+	skb->csum_deferred = 1;
+	gboolean success = pgm_parse_udp_encap (skb, &err);
+	if (!success && err) {
+		g_error ("Parsing UDP encapsulated packet: %s", err->message);
+	}
+	fail_unless (TRUE == success, "parse_udp_encap failed");
+	fail_unless (1 == skb->csum_deferred, "checksum not deferred");
+	pgm_skb_pull (skb, sizeof(struct pgm_header) + sizeof(struct pgm_data));
+	fail_unless (TRUE == pgm_skb_csum_verify (skb, buf, skb->len), "csum_verify failed");
+	fail_unless (0 == skb->csum_deferred, "checksum still deferred");
+	fail_unless (0 == memcmp (buf, source, sizeof(source)), "payload mismatch");
+}
+END_TEST
+
+/* corrupt payload passes parsing and fails at delivery */
+START_TEST (test_parse_udp_encap_pass_003)
+{
+	char buf[1024];
+	pgm_error_t* err = NULL;
+	struct pgm_sk_buff_t* skb = generate_udp_encap_pgm ();
+	skb->csum_deferred = 1;
+	((char*)skb->tail)[ -1 ] ^= 0x01;
+	gboolean success = pgm_parse_udp_encap (skb, &err);
+	fail_unless (TRUE == success, "parse_udp_encap failed");
+	pgm_skb_pull (skb, sizeof(struct pgm_header) + sizeof(struct pgm_data));
+	fail_unless (FALSE == pgm_skb_csum_verify (skb, buf, 4), "csum_verify succeeded");
+}
+END_TEST
+
+/* zero checksum only accepted on data when optional */
+START_TEST (test_parse_udp_encap_pass_004)
+{
+	pgm_error_t* err = NULL;
+	struct pgm_sk_buff_t* skb = generate_udp_encap_pgm ();
+	((struct pgm_header*)skb->data)->pgm_checksum = 0;
+	fail_unless (FALSE == pgm_parse_udp_encap (skb, &err), "parse_udp_encap succeeded");
+	pgm_error_free (err);
+	err = NULL;
+	skb->csum_optional = 1;
+	gboolean success = pgm_parse_udp_encap (skb, &err);
+	if (!success && err) {
+		g_error ("Parsing UDP encapsulated packet: %s", err->message);
+	}
+	fail_unless (TRUE == success, "parse_udp_encap failed");
+}
+END_TEST
+
 START_TEST (test_parse_udp_encap_fail_001)
 {
 	pgm_error_t* err = NULL;
@@ -345,6 +407,7 @@ make_test_suite (void)
 
 	TCase* tc_parse_raw = tcase_create ("parse-raw");
 	suite_add_tcase (s, tc_parse_raw);
+	tcase_add_checked_fixture (tc_parse_raw, mock_setup, NULL);
 	tcase_add_test (tc_parse_raw, test_parse_raw_pass_001);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_parse_raw, test_parse_raw_fail_001, SIGABRT);
@@ -352,7 +415,11 @@ make_test_suite (void)
 
 	TCase* tc_parse_udp_encap = tcase_create ("parse-udp-encap");
 	suite_add_tcase (s, tc_parse_udp_encap);
+	tcase_add_checked_fixture (tc_parse_udp_encap, mock_setup, NULL);
 	tcase_add_test (tc_parse_udp_encap, test_parse_udp_encap_pass_001);
+	tcase_add_test (tc_parse_udp_encap, test_parse_udp_encap_pass_002);
+	tcase_add_test (tc_parse_udp_encap, test_parse_udp_encap_pass_003);
+	tcase_add_test (tc_parse_udp_encap, test_parse_udp_encap_pass_004);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_parse_udp_encap, test_parse_udp_encap_fail_001, SIGABRT);
 #endif
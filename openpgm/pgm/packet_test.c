@@ -1003,6 +1003,10 @@ pgm_print_options (
 			printf ("OPT_PGMCC_FEEDBACK ");
 			break;
 
+		case PGM_OPT_TSTAMP:
+			printf ("OPT_TSTAMP ");
+			break;
+
 		case PGM_OPT_NAK_BO_IVL:
 			printf ("OPT_NAK_BO_IVL ");
 			break;
@@ -22,9 +22,136 @@
 #ifdef HAVE_CONFIG_H
 #	include <config.h>
 #endif
+#ifndef _WIN32
+#	include <time.h>
+#endif
 #include <impl/framework.h>
 
 
+/* each bucket is a virtual scheduling clock counting in bytes: the byte clock
+ * advances at rate_per_sec from the bucket epoch and tat records the clock
+ * value at which all bytes charged so far are paid for.  tokens available are
+ * the lead of the clock over tat capped at bucket_size, so charging a packet
+ * is a single compare-and-swap of tat and concurrent senders never serialise
+ * on a lock.
+ */
+
+static inline
+int64_t
+rate_clock (
+	const pgm_rate_t*	bucket,
+	const pgm_time_t	now
+	)
+{
+	const pgm_time_t elapsed = pgm_time_after (now, bucket->epoch) ? now - bucket->epoch : 0;
+	return (int64_t)(pgm_to_secs (elapsed) * bucket->rate_per_sec)
+		+ (int64_t)(((elapsed % pgm_secs(1)) * bucket->rate_per_sec) / 1000000UL);
+}
+
+/* time for the byte clock to advance by bytes, rounded up.
+ */
+
+static inline
+pgm_time_t
+rate_usecs (
+	const pgm_rate_t*	bucket,
+	const int64_t		bytes
+	)
+{
+	return (pgm_time_t)((1000000UL * bytes + bucket->rate_per_sec - 1) / bucket->rate_per_sec);
+}
+
+/* charge a bucket with cost bytes.
+ *
+ * returns TRUE with the wait until the charge is paid for, returns FALSE
+ * without charging when the bucket is short and the non-blocking flag is set.
+ */
+
+static
+bool
+rate_take (
+	pgm_rate_t*		bucket,
+	const int64_t		cost,
+	const pgm_time_t	now,
+	const bool		is_nonblocking,
+	pgm_time_t*		wait
+	)
+{
+	const int64_t clock = rate_clock (bucket, now);
+	uint64_t tat, new_tat;
+
+	do {
+/* torn reads on 32-bit platforms fail the swap */
+		tat = bucket->tat;
+		new_tat = (uint64_t)(MAX((int64_t)tat, clock - bucket->bucket_size) + cost);
+		if (is_nonblocking && (int64_t)new_tat > clock)
+			return FALSE;
+	} while (!pgm_atomic_compare_and_exchange64 (&bucket->tat, tat, new_tat));
+
+	*wait = (int64_t)new_tat > clock ? rate_usecs (bucket, (int64_t)new_tat - clock) : 0;
+	return TRUE;
+}
+
+/* return a charge to the bucket.
+ */
+
+static
+void
+rate_give (
+	pgm_rate_t*		bucket,
+	const int64_t		cost
+	)
+{
+	uint64_t tat;
+	do {
+		tat = bucket->tat;
+	} while (!pgm_atomic_compare_and_exchange64 (&bucket->tat, tat, tat - cost));
+}
+
+/* bytes short of sending n bytes, zero if the bucket permits.
+ */
+
+static inline
+int64_t
+rate_shortfall (
+	const pgm_rate_t*	bucket,
+	const pgm_time_t	now,
+	const size_t		n
+	)
+{
+	const int64_t clock = rate_clock (bucket, now);
+	const int64_t tokens = MIN(bucket->bucket_size, clock - (int64_t)bucket->tat);
+	return tokens >= (int64_t)n ? 0 : (int64_t)n - tokens;
+}
+
+/* sleep until the charged bytes are paid for.
+ */
+
+static
+void
+rate_wait (
+	const pgm_time_t	deadline
+	)
+{
+	pgm_time_t now;
+	while (pgm_time_before (now = pgm_time_refresh(), deadline))
+	{
+		const pgm_time_t remaining = deadline - now;
+#ifndef _WIN32
+		const struct timespec req = {
+			.tv_sec  = (time_t)pgm_to_secs (remaining),
+			.tv_nsec = (long)pgm_to_nsecs (remaining % pgm_secs(1))
+		};
+		nanosleep (&req, NULL);
+#else
+		if (remaining >= pgm_msecs(1))
+			Sleep ((DWORD)pgm_to_msecs (remaining));
+		else
+			pgm_thread_yield();
+#endif
+	}
+}
+
 /* create machinery for rate regulation.
  * the rate_per_sec is ammortized over millisecond time periods.
  *
@@ -46,15 +173,15 @@ pgm_rate_create (
 
 	bucket->rate_per_sec	= rate_per_sec;
 	bucket->iphdr_len	= iphdr_len;
-	bucket->last_rate_check	= pgm_time_update_now ();
-/* pre-fill bucket */
+	bucket->epoch		= pgm_time_update_now ();
 	if ((rate_per_sec / 1000) >= max_tpdu) {
 		bucket->rate_per_msec	= bucket->rate_per_sec / 1000;
-		bucket->rate_limit	= bucket->rate_per_msec;
+		bucket->bucket_size	= bucket->rate_per_msec;
 	} else {
-		bucket->rate_limit	= bucket->rate_per_sec;
+		bucket->bucket_size	= bucket->rate_per_sec;
 	}
-	pgm_spinlock_init (&bucket->spinlock);
+/* pre-fill bucket */
+	bucket->tat		= (uint64_t)-bucket->bucket_size;
 }
 
 PGM_GNUC_INTERNAL
@@ -66,13 +193,16 @@ pgm_rate_destroy (
 /* pre-conditions */
 	pgm_assert (NULL != bucket);
 
-	pgm_spinlock_free (&bucket->spinlock);
+	bucket->rate_per_sec = 0;
 }
 
 /* check bit bucket whether an operation can proceed or should wait.
  *
  * returns TRUE when leaky bucket permits unless non-blocking flag is set.
  * returns FALSE if operation should block and non-blocking flag is set.
+ *
+ * blocking callers are charged up front and sleep until the later of both
+ * buckets has paid for the operation.
  */
 
 PGM_GNUC_INTERNAL
@@ -84,8 +214,7 @@ pgm_rate_check2 (
 	const bool		is_nonblocking
 	)
 {
-	int64_t new_major_limit, new_minor_limit;
-	pgm_time_t now;
+	pgm_time_t now, major_wait = 0, minor_wait = 0;
 
 /* pre-conditions */
 	pgm_assert (NULL != major_bucket);
@@ -95,112 +224,24 @@ pgm_rate_check2 (
 	if (0 == major_bucket->rate_per_sec && 0 == minor_bucket->rate_per_sec)
 		return TRUE;
 
-	if (0 != major_bucket->rate_per_sec)
-	{
-		pgm_spinlock_lock (&major_bucket->spinlock);
-		now = pgm_time_update_now();
-
-		if (major_bucket->rate_per_msec)
-		{
-			const pgm_time_t time_since_last_rate_check = now - major_bucket->last_rate_check;
-			if (time_since_last_rate_check > pgm_msecs(1)) 
-				new_major_limit = major_bucket->rate_per_msec;
-			else {
-				new_major_limit = major_bucket->rate_limit + ((major_bucket->rate_per_msec * time_since_last_rate_check) / 1000UL);
-				if (new_major_limit > major_bucket->rate_per_msec)
-					new_major_limit = major_bucket->rate_per_msec;
-			}
-		}
-		else
-		{
-			const pgm_time_t time_since_last_rate_check = now - major_bucket->last_rate_check;
-			if (time_since_last_rate_check > pgm_secs(1)) 
-				new_major_limit = major_bucket->rate_per_sec;
-			else {
-				new_major_limit = major_bucket->rate_limit + ((major_bucket->rate_per_sec * time_since_last_rate_check) / 1000000UL);
-				if (new_major_limit > major_bucket->rate_per_sec)
-					new_major_limit = major_bucket->rate_per_sec;
-			}
-		}
-
-		new_major_limit -= ( major_bucket->iphdr_len + data_size );
-		if (is_nonblocking && new_major_limit < 0) {
-			pgm_spinlock_unlock (&major_bucket->spinlock);
-			return FALSE;
-		}
-
-		if (new_major_limit < 0) {
-			const pgm_time_t wait_start = now;
-			ssize_t sleep_amount;
-			do {
-				pgm_thread_yield();
-				now = pgm_time_update_now();
-				sleep_amount = (ssize_t)pgm_to_secs (major_bucket->rate_per_sec * (now - wait_start));
-			} while (sleep_amount + new_major_limit < 0);
-			new_major_limit += sleep_amount;
-		} 
-	}
-	else
-	{
-/* ensure we have a timestamp */
-		now = pgm_time_update_now();
-	}
+	now = pgm_time_cached_now();
 
-	if (0 != minor_bucket->rate_per_sec)
+	if (0 != major_bucket->rate_per_sec &&
+	    !rate_take (major_bucket, major_bucket->iphdr_len + data_size, now, is_nonblocking, &major_wait))
 	{
-		if (minor_bucket->rate_per_msec)
-		{
-			const pgm_time_t time_since_last_rate_check = now - minor_bucket->last_rate_check;
-			if (time_since_last_rate_check > pgm_msecs(1)) 
-				new_minor_limit = minor_bucket->rate_per_msec;
-			else {
-				new_minor_limit = minor_bucket->rate_limit + ((minor_bucket->rate_per_msec * time_since_last_rate_check) / 1000UL);
-				if (new_minor_limit > minor_bucket->rate_per_msec)
-					new_minor_limit = minor_bucket->rate_per_msec;
-			}
-		}
-		else
-		{
-			const pgm_time_t time_since_last_rate_check = now - minor_bucket->last_rate_check;
-			if (time_since_last_rate_check > pgm_secs(1)) 
-				new_minor_limit = minor_bucket->rate_per_sec;
-			else {
-				new_minor_limit = minor_bucket->rate_limit + ((minor_bucket->rate_per_sec * time_since_last_rate_check) / 1000000UL);
-				if (new_minor_limit > minor_bucket->rate_per_sec)
-					new_minor_limit = minor_bucket->rate_per_sec;
-			}
-		}
-
-		new_minor_limit -= ( minor_bucket->iphdr_len + data_size );
-		if (is_nonblocking && new_minor_limit < 0) {
-			if (0 != major_bucket->rate_per_sec)
-				pgm_spinlock_unlock (&major_bucket->spinlock);
-			return FALSE;
-		}
-
-/* commit new rate limit */
-		minor_bucket->rate_limit = new_minor_limit;
-		minor_bucket->last_rate_check = now;
+		return FALSE;
 	}
 
-	if (0 != major_bucket->rate_per_sec) {
-		major_bucket->rate_limit = new_major_limit;
-		major_bucket->last_rate_check = now;
-		pgm_spinlock_unlock (&major_bucket->spinlock);
+	if (0 != minor_bucket->rate_per_sec &&
+	    !rate_take (minor_bucket, minor_bucket->iphdr_len + data_size, now, is_nonblocking, &minor_wait))
+	{
+		if (0 != major_bucket->rate_per_sec)
+			rate_give (major_bucket, major_bucket->iphdr_len + data_size);
+		return FALSE;
 	}
 
-/* sleep on minor bucket outside of lock */
-	if (minor_bucket->rate_limit < 0) {
-		ssize_t sleep_amount;
-		do {
-			pgm_thread_yield();
-			now = pgm_time_update_now();
-			sleep_amount = (ssize_t)pgm_to_secs (minor_bucket->rate_per_sec * (now - minor_bucket->last_rate_check));
-		} while (sleep_amount + minor_bucket->rate_limit < 0);
-		minor_bucket->rate_limit += sleep_amount;
-		minor_bucket->last_rate_check = now;
-	} 
-
+	if (major_wait > 0 || minor_wait > 0)
+		rate_wait (now + MAX(major_wait, minor_wait));
 	return TRUE;
 }
 
@@ -212,7 +253,7 @@ pgm_rate_check (
 	const bool		is_nonblocking
 	)
 {
-	int64_t new_rate_limit;
+	pgm_time_t now, wait;
 
 /* pre-conditions */
 	pgm_assert (NULL != bucket);
@@ -221,54 +262,55 @@ pgm_rate_check (
 	if (0 == bucket->rate_per_sec)
 		return TRUE;
 
-	pgm_spinlock_lock (&bucket->spinlock);
-	pgm_time_t now = pgm_time_update_now();
+	now = pgm_time_cached_now();
+	if (!rate_take (bucket, bucket->iphdr_len + data_size, now, is_nonblocking, &wait))
+		return FALSE;
+	if (wait > 0)
+		rate_wait (now + wait);
+	return TRUE;
+}
 
-	if (bucket->rate_per_msec)
-	{
-		const pgm_time_t time_since_last_rate_check = now - bucket->last_rate_check;
-		if (time_since_last_rate_check > pgm_msecs(1)) 
-			new_rate_limit = bucket->rate_per_msec;
-		else {
-			new_rate_limit = bucket->rate_limit + ((bucket->rate_per_msec * time_since_last_rate_check) / 1000UL);
-			if (new_rate_limit > bucket->rate_per_msec)
-				new_rate_limit = bucket->rate_per_msec;
-		}
-	}
-	else
-	{
-		const pgm_time_t time_since_last_rate_check = now - bucket->last_rate_check;
-		if (time_since_last_rate_check > pgm_secs(1)) 
-			new_rate_limit = bucket->rate_per_sec;
-		else {
-			new_rate_limit = bucket->rate_limit + ((bucket->rate_per_sec * time_since_last_rate_check) / 1000000UL);
-			if (new_rate_limit > bucket->rate_per_sec)
-				new_rate_limit = bucket->rate_per_sec;
-		}
-	}
+/* return the charge of an operation that did not complete, e.g. the tail of
+ * a partially accepted batch, so that a retry is not charged twice.
+ */
 
-	new_rate_limit -= ( bucket->iphdr_len + data_size );
-	if (is_nonblocking && new_rate_limit < 0) {
-		pgm_spinlock_unlock (&bucket->spinlock);
-		return FALSE;
-	}
+PGM_GNUC_INTERNAL
+void
+pgm_rate_refund2 (
+	pgm_rate_t*		major_bucket,
+	pgm_rate_t*		minor_bucket,
+	const size_t		data_size
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != major_bucket);
+	pgm_assert (NULL != minor_bucket);
+	pgm_assert (data_size > 0);
 
-	bucket->rate_limit = new_rate_limit;
-	bucket->last_rate_check = now;
-	if (bucket->rate_limit < 0) {
-		ssize_t sleep_amount;
-		do {
-			pgm_thread_yield();
-			now = pgm_time_update_now();
-			sleep_amount = (ssize_t)pgm_to_secs (bucket->rate_per_sec * (now - bucket->last_rate_check));
-		} while (sleep_amount + bucket->rate_limit < 0);
-		bucket->rate_limit += sleep_amount;
-		bucket->last_rate_check = now;
-	} 
-	pgm_spinlock_unlock (&bucket->spinlock);
-	return TRUE;
+	if (0 != major_bucket->rate_per_sec)
+		rate_give (major_bucket, major_bucket->iphdr_len + data_size);
+	if (0 != minor_bucket->rate_per_sec)
+		rate_give (minor_bucket, minor_bucket->iphdr_len + data_size);
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_rate_refund (
+	pgm_rate_t*		bucket,
+	const size_t		data_size
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != bucket);
+	pgm_assert (data_size > 0);
+
+	if (0 != bucket->rate_per_sec)
+		rate_give (bucket, bucket->iphdr_len + data_size);
 }
 
+/* time until both buckets permit n bytes.
+ */
+
 PGM_GNUC_INTERNAL
 pgm_time_t
 pgm_rate_remaining2 (
@@ -287,38 +329,20 @@ pgm_rate_remaining2 (
 	if (PGM_UNLIKELY(0 == major_bucket->rate_per_sec && 0 == minor_bucket->rate_per_sec))
 		return remaining;
 
+	now = pgm_time_cached_now();
+
 	if (0 != major_bucket->rate_per_sec)
 	{
-		pgm_spinlock_lock (&major_bucket->spinlock);
-		now = pgm_time_update_now();
-		const int64_t bucket_bytes = major_bucket->rate_limit + pgm_to_secs (major_bucket->rate_per_sec * (now - major_bucket->last_rate_check)) - n;
-
-		if (bucket_bytes < 0) {
-			const int64_t outstanding_bytes = -bucket_bytes;
-			const pgm_time_t major_remaining = (1000000UL * outstanding_bytes) / major_bucket->rate_per_sec;
-			remaining = major_remaining;
-		}
-	}
-	else
-	{
-/* ensure we have a timestamp */
-		now = pgm_time_update_now();
+		const int64_t outstanding_bytes = rate_shortfall (major_bucket, now, n);
+		if (outstanding_bytes > 0)
+			remaining = rate_usecs (major_bucket, outstanding_bytes);
 	}
 
 	if (0 != minor_bucket->rate_per_sec)
 	{
-		const int64_t bucket_bytes = minor_bucket->rate_limit + pgm_to_secs (minor_bucket->rate_per_sec * (now - minor_bucket->last_rate_check)) - n;
-
-		if (bucket_bytes < 0) {
-			const int64_t outstanding_bytes = -bucket_bytes;
-			const pgm_time_t minor_remaining = (1000000UL * outstanding_bytes) / minor_bucket->rate_per_sec;
-			remaining = remaining > 0 ? MIN(remaining, minor_remaining) : minor_remaining;
-		}
-	}
-
-	if (0 != major_bucket->rate_per_sec)
-	{
-		pgm_spinlock_unlock (&major_bucket->spinlock);
+		const int64_t outstanding_bytes = rate_shortfall (minor_bucket, now, n);
+		if (outstanding_bytes > 0)
+			remaining = MAX(remaining, rate_usecs (minor_bucket, outstanding_bytes));
 	}
 
 	return remaining;
@@ -337,19 +361,11 @@ pgm_rate_remaining (
 	if (PGM_UNLIKELY(0 == bucket->rate_per_sec))
 		return 0;
 
-	pgm_spinlock_lock (&bucket->spinlock);
-	const pgm_time_t now = pgm_time_update_now();
-	const pgm_time_t time_since_last_rate_check = now - bucket->last_rate_check;
-	const int64_t bucket_bytes = bucket->rate_limit + pgm_to_secs (bucket->rate_per_sec * time_since_last_rate_check) - n;
-	pgm_spinlock_unlock (&bucket->spinlock);
-
-	if (bucket_bytes >= 0)
+	const int64_t outstanding_bytes = rate_shortfall (bucket, pgm_time_cached_now(), n);
+	if (outstanding_bytes <= 0)
 		return 0;
 
-	const int64_t outstanding_bytes = -bucket_bytes;
-	const pgm_time_t remaining = (1000000UL * outstanding_bytes) / bucket->rate_per_sec;
-
-	return remaining;
+	return rate_usecs (bucket, outstanding_bytes);
 }
 
 /* eof */
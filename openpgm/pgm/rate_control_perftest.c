@@ -0,0 +1,292 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * performance tests for rate regulation, publisher threads contending on
+ * shared token buckets.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#	include <sys/resource.h>
+#endif
+#include <glib.h>
+#include <check.h>
+
+
+/* mock state */
+
+#define TEST_IPHDR_LEN		20
+#define TEST_MAX_TPDU		1500
+#define TEST_TSDU		1000
+#define TEST_UNLIMITED_RATE	((ssize_t)1000*1000*1000*1000)	/* bucket never drains */
+#define TEST_LIMITED_RATE	((ssize_t)100*1000*1000)
+#define TEST_CHECKS		200000		/* per thread when unlimited */
+#define TEST_LIMITED_PACKETS	50000		/* shared when limited, ~0.5s */
+
+static unsigned perf_threads = 0;
+
+
+static
+void
+mock_setup_1 (void)
+{
+	perf_threads = 1;
+}
+
+static
+void
+mock_setup_2 (void)
+{
+	perf_threads = 2;
+}
+
+static
+void
+mock_setup_4 (void)
+{
+	perf_threads = 4;
+}
+
+static
+void
+mock_setup_8 (void)
+{
+	perf_threads = 8;
+}
+
+#define RATE_CONTROL_DEBUG
+#include "rate_control.c"
+
+struct perf_state_t {
+	pgm_rate_t	major;
+	pgm_rate_t	minor;
+	unsigned	checks;
+};
+
+PGM_GNUC_INTERNAL
+int
+pgm_get_nprocs (void)
+{
+	return 1;
+}
+
+static
+void
+mock_setup (void)
+{
+	if (!g_thread_supported ()) g_thread_init (NULL);
+	g_assert (pgm_time_init (NULL));
+}
+
+static
+void
+mock_teardown (void)
+{
+	g_assert (pgm_time_shutdown ());
+}
+
+/* process cpu time consumed in microseconds.
+ */
+
+static
+pgm_time_t
+cpu_time (void)
+{
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+	return pgm_secs (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+		+ pgm_usecs (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+#else
+	return 0;
+#endif
+}
+
+static
+gpointer
+check_thread (
+	gpointer	data
+	)
+{
+	struct perf_state_t* state = data;
+	for (unsigned i = state->checks; i; i--)
+		pgm_rate_check2 (&state->major, &state->minor, TEST_TSDU, FALSE);
+	return NULL;
+}
+
+/* run perf_threads publishers each performing state->checks blocking checks,
+ * returns wall clock and process cpu time elapsed.
+ */
+
+static
+void
+run_threads (
+	struct perf_state_t*	state,
+	pgm_time_t*		elapsed,
+	pgm_time_t*		cpu_elapsed
+	)
+{
+	GThread* threads[8];
+	g_assert (perf_threads <= G_N_ELEMENTS(threads));
+
+	const pgm_time_t cpu_start = cpu_time();
+	const pgm_time_t start = pgm_time_update_now();
+	for (unsigned i = 0; i < perf_threads; i++) {
+		threads[i] = g_thread_create (check_thread, state, TRUE, NULL);
+		fail_if (NULL == threads[i], "g_thread_create failed");
+	}
+	for (unsigned i = 0; i < perf_threads; i++)
+		g_thread_join (threads[i]);
+	*elapsed = pgm_time_update_now() - start;
+	*cpu_elapsed = cpu_time() - cpu_start;
+}
+
+/* target:
+ *	bool
+ *	pgm_rate_check2 (
+ *		pgm_rate_t*		major_bucket,
+ *		pgm_rate_t*		minor_bucket,
+ *		const size_t		data_size,
+ *		const bool		is_nonblocking
+ *	)
+ *
+ * unlimited: buckets never drain, measures the cost of charging both buckets
+ * under contention.
+ */
+
+START_TEST (test_check2_unlimited)
+{
+	struct perf_state_t state;
+	pgm_time_t elapsed, cpu_elapsed;
+
+	memset (&state, 0, sizeof(state));
+	pgm_rate_create (&state.major, TEST_UNLIMITED_RATE, TEST_IPHDR_LEN, TEST_MAX_TPDU);
+	pgm_rate_create (&state.minor, TEST_UNLIMITED_RATE, TEST_IPHDR_LEN, TEST_MAX_TPDU);
+	state.checks = TEST_CHECKS;
+
+	run_threads (&state, &elapsed, &cpu_elapsed);
+
+	const guint64 checks = (guint64)perf_threads * TEST_CHECKS;
+	g_message ("unlimited/%u: elapsed time %" PGM_TIME_FORMAT " us, cpu time %" PGM_TIME_FORMAT " us, %" G_GUINT64_FORMAT " checks, unit time %.1f ns",
+		perf_threads,
+		elapsed,
+		cpu_elapsed,
+		checks,
+		(1000.0 * (double)cpu_elapsed) / (double)checks);
+
+	pgm_rate_destroy (&state.major);
+	pgm_rate_destroy (&state.minor);
+}
+END_TEST
+
+/* limited: publishers share a fixed number of packets through a saturated
+ * bucket, the achieved rate must not exceed the limit beyond the initial
+ * burst and blocked publishers should sleep rather than consume cpu.
+ */
+
+START_TEST (test_check2_limited)
+{
+	struct perf_state_t state;
+	pgm_time_t elapsed, cpu_elapsed;
+
+	memset (&state, 0, sizeof(state));
+	pgm_rate_create (&state.major, TEST_LIMITED_RATE, TEST_IPHDR_LEN, TEST_MAX_TPDU);
+	pgm_rate_create (&state.minor, TEST_UNLIMITED_RATE, TEST_IPHDR_LEN, TEST_MAX_TPDU);
+	state.checks = TEST_LIMITED_PACKETS / perf_threads;
+
+	run_threads (&state, &elapsed, &cpu_elapsed);
+
+	const guint64 bytes = (guint64)perf_threads * state.checks * (TEST_IPHDR_LEN + TEST_TSDU);
+	const double rate = (1000000.0 * (double)bytes) / (double)elapsed;
+	g_message ("limited/%u: elapsed time %" PGM_TIME_FORMAT " us, cpu time %" PGM_TIME_FORMAT " us (%.1f%%), rate %.1f MB/s (limit %.1f MB/s)",
+		perf_threads,
+		elapsed,
+		cpu_elapsed,
+		(100.0 * (double)cpu_elapsed) / (double)elapsed,
+		rate / 1000000.0,
+		(double)TEST_LIMITED_RATE / 1000000.0);
+	fail_unless (bytes <= (guint64)state.major.bucket_size + (elapsed * TEST_LIMITED_RATE) / 1000000UL, "rate limit exceeded");
+
+	pgm_rate_destroy (&state.major);
+	pgm_rate_destroy (&state.minor);
+}
+END_TEST
+
+
+static
+Suite*
+make_rate_performance_suite (void)
+{
+	Suite* s;
+
+	s = suite_create ("Rate regulation performance");
+
+	TCase* tc_1 = tcase_create ("1-thread");
+	suite_add_tcase (s, tc_1);
+	tcase_add_checked_fixture (tc_1, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_1, mock_setup_1, NULL);
+	tcase_add_test (tc_1, test_check2_unlimited);
+	tcase_add_test (tc_1, test_check2_limited);
+
+	TCase* tc_2 = tcase_create ("2-threads");
+	suite_add_tcase (s, tc_2);
+	tcase_add_checked_fixture (tc_2, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_2, mock_setup_2, NULL);
+	tcase_add_test (tc_2, test_check2_unlimited);
+	tcase_add_test (tc_2, test_check2_limited);
+
+	TCase* tc_4 = tcase_create ("4-threads");
+	suite_add_tcase (s, tc_4);
+	tcase_add_checked_fixture (tc_4, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_4, mock_setup_4, NULL);
+	tcase_add_test (tc_4, test_check2_unlimited);
+	tcase_add_test (tc_4, test_check2_limited);
+
+	TCase* tc_8 = tcase_create ("8-threads");
+	suite_add_tcase (s, tc_8);
+	tcase_add_checked_fixture (tc_8, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_8, mock_setup_8, NULL);
+	tcase_add_test (tc_8, test_check2_unlimited);
+	tcase_add_test (tc_8, test_check2_limited);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_rate_performance_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
@@ -519,6 +519,111 @@ START_TEST (test_check2_pass_003)
 }
 END_TEST
 
+/* 004: a minor bucket fault should return the charge to the major bucket.
+ */
+
+START_TEST (test_check2_pass_004)
+{
+	pgm_rate_t major, minor;
+	memset (&major, 0, sizeof(major));
+	memset (&minor, 0, sizeof(minor));
+	mock_pgm_time_now = 1;
+	pgm_rate_create (&major, 2*1010, 10, 1500);
+	pgm_rate_create (&minor, 2*900, 10, 1500);
+	mock_pgm_time_now += pgm_secs(2);
+	fail_unless (TRUE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+	fail_unless (FALSE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+/* major bucket retains one packet */
+	fail_unless (TRUE == pgm_rate_check (&major, 1000, TRUE), "rate_check failed");
+	fail_unless (FALSE == pgm_rate_check (&major, 1000, TRUE), "rate_check failed");
+	pgm_rate_destroy (&major);
+	pgm_rate_destroy (&minor);
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_rate_refund2 (
+ *		pgm_rate_t*		major_bucket,
+ *		pgm_rate_t*		minor_bucket,
+ *		const size_t		data_size
+ *	)
+ *
+ * 001: a refunded charge should be available to the next check.
+ */
+
+START_TEST (test_refund2_pass_001)
+{
+	pgm_rate_t major, minor;
+	memset (&major, 0, sizeof(major));
+	memset (&minor, 0, sizeof(minor));
+	mock_pgm_time_now = 1;
+	pgm_rate_create (&major, 2*1010, 10, 1500);
+	pgm_rate_create (&minor, 2*1010, 10, 1500);
+	mock_pgm_time_now += pgm_secs(2);
+	fail_unless (TRUE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+	fail_unless (TRUE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+	fail_unless (FALSE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+	pgm_rate_refund2 (&major, &minor, 1000);
+	fail_unless (TRUE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+	fail_unless (FALSE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+	pgm_rate_refund (&major, 1000);
+	fail_unless (TRUE == pgm_rate_check (&major, 1000, TRUE), "rate_check failed");
+	pgm_rate_destroy (&major);
+	pgm_rate_destroy (&minor);
+}
+END_TEST
+
+START_TEST (test_refund2_fail_001)
+{
+	pgm_rate_refund2 (NULL, NULL, 1000);
+	fail ("reached");
+}
+END_TEST
+
+/* target:
+ *	pgm_time_t
+ *	pgm_rate_remaining2 (
+ *		pgm_rate_t*		major_bucket,
+ *		pgm_rate_t*		minor_bucket,
+ *		const size_t		n
+ *	)
+ *
+ * 001: time until the slower of both buckets permits.
+ */
+
+START_TEST (test_remaining2_pass_001)
+{
+	pgm_rate_t major, minor;
+	memset (&major, 0, sizeof(major));
+	memset (&minor, 0, sizeof(minor));
+	mock_pgm_time_now = 1;
+	fail_unless (0 == pgm_rate_remaining2 (&major, &minor, 1010), "rate_remaining2 failed");
+	pgm_rate_create (&major, 2*1010, 10, 1500);
+	pgm_rate_create (&minor, 4*1010, 10, 1500);
+	mock_pgm_time_now += pgm_secs(2);
+	fail_unless (0 == pgm_rate_remaining2 (&major, &minor, 1010), "rate_remaining2 failed");
+	fail_unless (TRUE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+	fail_unless (TRUE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+/* major empty at 2020 bytes per second, minor half full */
+	fail_unless (pgm_msecs(500) == pgm_rate_remaining2 (&major, &minor, 1010), "rate_remaining2 failed");
+	fail_unless (pgm_msecs(500) == pgm_rate_remaining (&major, 1010), "rate_remaining failed");
+	fail_unless (0 == pgm_rate_remaining (&minor, 1010), "rate_remaining failed");
+	mock_pgm_time_now += pgm_msecs(500);
+	fail_unless (0 == pgm_rate_remaining2 (&major, &minor, 1010), "rate_remaining2 failed");
+	fail_unless (TRUE == pgm_rate_check2 (&major, &minor, 1000, TRUE), "rate_check2 failed");
+	pgm_rate_destroy (&major);
+	pgm_rate_destroy (&minor);
+}
+END_TEST
+
+START_TEST (test_remaining2_fail_001)
+{
+	pgm_rate_remaining2 (NULL, NULL, 1000);
+	fail ("reached");
+}
+END_TEST
+
 
 static
 Suite*
@@ -556,9 +661,24 @@ make_test_suite (void)
 	tcase_add_test (tc_check2, test_check2_pass_001);
 	tcase_add_test (tc_check2, test_check2_pass_002);
 	tcase_add_test (tc_check2, test_check2_pass_003);
+	tcase_add_test (tc_check2, test_check2_pass_004);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_check2, test_check2_fail_001, SIGABRT);
 #endif
+
+	TCase* tc_refund2 = tcase_create ("refund2");
+	suite_add_tcase (s, tc_refund2);
+	tcase_add_test (tc_refund2, test_refund2_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_refund2, test_refund2_fail_001, SIGABRT);
+#endif
+
+	TCase* tc_remaining2 = tcase_create ("remaining2");
+	suite_add_tcase (s, tc_remaining2);
+	tcase_add_test (tc_remaining2, test_remaining2_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_remaining2, test_remaining2_fail_001, SIGABRT);
+#endif
 	return s;
 }
 
@@ -48,6 +48,7 @@ static bool nak_rb_state (pgm_sock_t*restrict, pgm_peer_t*restrict, const pgm_ti
 static void nak_rpt_state (pgm_sock_t*restrict, pgm_peer_t*restrict, const pgm_time_t);
 static void nak_rdata_state (pgm_sock_t*restrict, pgm_peer_t*restrict, const pgm_time_t);
 static inline pgm_peer_t* _pgm_peer_ref (pgm_peer_t*);
+static inline void peer_hdr_record (pgm_sock_t*const restrict, pgm_peer_t*const restrict, const int, const uint64_t);
 static bool on_general_poll (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict);
 static bool on_dlr_poll (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict);
 
@@ -74,15 +75,11 @@ next_nak_rb_expiry (
 	const pgm_rxw_t*	window
 	)
 {
-	const struct pgm_sk_buff_t* skb;
-	const pgm_rxw_state_t* state;
-
 	pgm_assert (NULL != window);
 	pgm_assert (NULL != window->nak_backoff_queue.tail);
+	pgm_assert (window->nak_bucket_len > 0);
 
-	skb = (const struct pgm_sk_buff_t*)window->nak_backoff_queue.tail;
-	state = (const pgm_rxw_state_t*)&skb->cb;
-	return state->timer_expiry;
+	return window->nak_buckets[ 0 ].expiry;
 }
 
 static inline
@@ -98,7 +95,7 @@ next_nak_rpt_expiry (
 	pgm_assert (NULL != window->wait_ncf_queue.tail);
 
 	skb = (const struct pgm_sk_buff_t*)window->wait_ncf_queue.tail;
-	state = (const pgm_rxw_state_t*)&skb->cb;
+	state = pgm_rxw_recovery_state (window, skb->sequence);
 	return state->timer_expiry;
 }
 
@@ -115,7 +112,7 @@ next_nak_rdata_expiry (
 	pgm_assert (NULL != window->wait_data_queue.tail);
 
 	skb = (const struct pgm_sk_buff_t*)window->wait_data_queue.tail;
-	state = (const pgm_rxw_state_t*)&skb->cb;
+	state = pgm_rxw_recovery_state (window, skb->sequence);
 	return state->timer_expiry;
 }
 
@@ -150,6 +147,161 @@ nak_rb_ivl (
 	return pgm_rand_int_range (&sock->rand_, 1 /* us */, (int32_t)sock->nak_bo_ivl);
 }
 
+/* earliest state expiration of a peer across SPM-request, ACK and NAK state
+ * queues and the peer expiration itself.
+ */
+
+static
+pgm_time_t
+peer_next_expiry (
+	const pgm_peer_t*	peer
+	)
+{
+	pgm_time_t expiry = peer->expiry;
+
+	if (peer->spmr_expiry && pgm_time_after (expiry, peer->spmr_expiry))
+		expiry = peer->spmr_expiry;
+	if (peer->window->ack_backoff_queue.tail && pgm_time_after (expiry, next_ack_rb_expiry (peer->window)))
+		expiry = next_ack_rb_expiry (peer->window);
+	if (peer->window->nak_backoff_queue.tail && pgm_time_after (expiry, next_nak_rb_expiry (peer->window)))
+		expiry = next_nak_rb_expiry (peer->window);
+	if (peer->window->wait_ncf_queue.tail && pgm_time_after (expiry, next_nak_rpt_expiry (peer->window)))
+		expiry = next_nak_rpt_expiry (peer->window);
+	if (peer->window->wait_data_queue.tail && pgm_time_after (expiry, next_nak_rdata_expiry (peer->window)))
+		expiry = next_nak_rdata_expiry (peer->window);
+	return expiry;
+}
+
+/* peer timer min-heap, each peer is keyed on a time no later than its next
+ * state expiration so timer dispatch only visits peers with expired state.
+ * keys may be early, a peer visited early is re-keyed on its actual expiry.
+ */
+
+static
+void
+peer_timer_sift_up (
+	pgm_sock_t*const	sock,
+	unsigned		i
+	)
+{
+	pgm_peer_t*const peer = sock->peers_timer_heap[i];
+
+	while (i > 0) {
+		const unsigned parent = (i - 1) / 2;
+		pgm_peer_t*const parent_peer = sock->peers_timer_heap[parent];
+		if (!pgm_time_before (peer->timer_expiry, parent_peer->timer_expiry))
+			break;
+		sock->peers_timer_heap[i] = parent_peer;
+		parent_peer->timer_index = i + 1;
+		i = parent;
+	}
+	sock->peers_timer_heap[i] = peer;
+	peer->timer_index = i + 1;
+}
+
+static
+void
+peer_timer_sift_down (
+	pgm_sock_t*const	sock,
+	unsigned		i
+	)
+{
+	pgm_peer_t*const peer = sock->peers_timer_heap[i];
+
+	for (;;) {
+		unsigned child = (2 * i) + 1;
+		if (child >= sock->peers_timer_len)
+			break;
+		if (child + 1 < sock->peers_timer_len &&
+		    pgm_time_before (sock->peers_timer_heap[child + 1]->timer_expiry, sock->peers_timer_heap[child]->timer_expiry))
+			child++;
+		pgm_peer_t*const child_peer = sock->peers_timer_heap[child];
+		if (!pgm_time_before (child_peer->timer_expiry, peer->timer_expiry))
+			break;
+		sock->peers_timer_heap[i] = child_peer;
+		child_peer->timer_index = i + 1;
+		i = child;
+	}
+	sock->peers_timer_heap[i] = peer;
+	peer->timer_index = i + 1;
+}
+
+static
+void
+peer_timer_insert (
+	pgm_sock_t*const	sock,
+	pgm_peer_t*const	peer,
+	const pgm_time_t	expiry
+	)
+{
+	pgm_assert (0 == peer->timer_index);
+
+	if (sock->peers_timer_len == sock->peers_timer_alloc) {
+		sock->peers_timer_alloc = sock->peers_timer_alloc ? 2 * sock->peers_timer_alloc : 16;
+		sock->peers_timer_heap = pgm_realloc (sock->peers_timer_heap, sock->peers_timer_alloc * sizeof(pgm_peer_t*));
+	}
+	peer->timer_expiry = expiry;
+	sock->peers_timer_heap[ sock->peers_timer_len ] = peer;
+	peer_timer_sift_up (sock, sock->peers_timer_len++);
+}
+
+static
+void
+peer_timer_remove (
+	pgm_sock_t*const	sock,
+	pgm_peer_t*const	peer
+	)
+{
+	pgm_peer_t* last;
+	unsigned i;
+
+	pgm_assert (peer->timer_index > 0);
+
+	i = peer->timer_index - 1;
+	last = sock->peers_timer_heap[ --sock->peers_timer_len ];
+	peer->timer_index = 0;
+	if (i == sock->peers_timer_len)
+		return;
+	sock->peers_timer_heap[i] = last;
+	peer_timer_sift_up (sock, i);
+	peer_timer_sift_down (sock, last->timer_index - 1);
+}
+
+/* re-key a peer on any new expiry.
+ */
+
+static
+void
+peer_timer_update (
+	pgm_sock_t*const	sock,
+	pgm_peer_t*const	peer,
+	const pgm_time_t	expiry
+	)
+{
+	pgm_assert (peer->timer_index > 0);
+
+	peer->timer_expiry = expiry;
+	peer_timer_sift_up (sock, peer->timer_index - 1);
+	peer_timer_sift_down (sock, peer->timer_index - 1);
+}
+
+/* bring a peer timer forward to a new state expiration.
+ */
+
+static inline
+void
+peer_timer_schedule (
+	pgm_sock_t*const	sock,
+	pgm_peer_t*const	peer,
+	const pgm_time_t	expiry
+	)
+{
+	if (pgm_time_after (peer->timer_expiry, expiry)) {
+		peer->timer_expiry = expiry;
+		peer_timer_sift_up (sock, peer->timer_index - 1);
+	}
+}
+
 /* mark sequence as recovery failed.
  */
 
@@ -179,6 +331,7 @@ cancel_skb (
 
 	pgm_rxw_lost (peer->window, skb->sequence);
 	PGM_HISTOGRAM_TIMES("Rx.FailTime", fail_time);
+	peer_hdr_record (sock, peer, PGM_HDR_FAIL_TIME, fail_time);
 
 /* mark receiver window for flushing on next recv() */
 	pgm_peer_set_pending (sock, peer);
@@ -286,6 +439,62 @@ _pgm_peer_ref (
 	return peer;
 }
 
+/* record into the peer histogram and the socket total.
+ */
+
+static inline
+void
+peer_hdr_record (
+	pgm_sock_t* const restrict	sock,
+	pgm_peer_t* const restrict	peer,
+	const int			histogram,
+	const uint64_t			value
+	)
+{
+	pgm_hdr_record (&peer->hdr[ histogram ], value);
+	pgm_hdr_record (&sock->hdr[ histogram ], value);
+}
+
+/* one-way latency of ODATA from the source transmit time to receipt, and the
+ * RFC 3550 interarrival jitter from the change in latency between packets.
+ * latency is only meaningful with synchronised clocks, a negative latency
+ * is recorded in the histogram as zero.
+ */
+
+static
+void
+on_tstamp (
+	pgm_sock_t*		     const restrict sock,
+	pgm_peer_t*		     const restrict peer,
+	const struct pgm_opt_tstamp* const restrict opt_tstamp
+	)
+{
+	const uint64_t tx_nsecs = (uint64_t)pgm_ntohl (opt_tstamp->opt_tstamp_sec) * UINT64_C(1000000000) +
+				  pgm_ntohl (opt_tstamp->opt_tstamp_nsec);
+	const uint64_t rx_nsecs = sock->rx_tstamp_nsecs ? sock->rx_tstamp_nsecs : pgm_time_epoch_nsecs();
+	const int64_t transit = (int64_t)(rx_nsecs - tx_nsecs);
+	struct pgm_latencyinfo_t* info = &sock->latency_info;
+
+	peer_hdr_record (sock, peer, PGM_HDR_LATENCY, transit > 0 ? (uint64_t)transit : 0);
+	if (0 == info->samples || transit < info->latency_min)
+		info->latency_min = transit;
+	if (0 == info->samples || transit > info->latency_max)
+		info->latency_max = transit;
+	info->latency_total += transit;
+	info->samples++;
+
+	if (peer->has_transit) {
+		const int64_t d = transit - peer->last_transit;
+		const uint64_t abs_d = (uint64_t)(d < 0 ? -d : d);
+		peer_hdr_record (sock, peer, PGM_HDR_JITTER, abs_d);
+/* J += (|D| - J) / 16 */
+		peer->jitter = (uint64_t)((int64_t)peer->jitter + ((int64_t)abs_d - (int64_t)peer->jitter) / 16);
+		info->jitter = (uint64_t)((int64_t)info->jitter + ((int64_t)abs_d - (int64_t)info->jitter) / 16);
+	}
+	peer->last_transit = transit;
+	peer->has_transit  = TRUE;
+}
+
 /* decrease reference count of peer object, destroying on last reference.
  */
 
@@ -305,12 +514,16 @@ pgm_peer_unref (
 	pgm_rxw_destroy (peer->window);
 	peer->window = NULL;
 
+/* histograms */
+	for (unsigned i = 0; i < PGM_HDR_MAX; i++)
+		pgm_hdr_destroy (&peer->hdr[ i ]);
+
 /* object */
 	pgm_free (peer);
 	peer = NULL;
 }
 
-/* find PGM options in received SKB.
+/* find PGM options in received SKB, OPT_TSTAMP is returned in opt_tstamp.
  *
  * returns TRUE if opt_fragment is found, otherwise FALSE is returned.
  */
@@ -318,7 +531,8 @@ pgm_peer_unref (
 static
 bool
 get_pgm_options (
-	struct pgm_sk_buff_t* const	skb
+	struct pgm_sk_buff_t*   const restrict skb,
+	struct pgm_opt_tstamp**       restrict opt_tstamp
 	)
 {
 	struct pgm_opt_header* opt_header;
@@ -357,6 +571,11 @@ get_pgm_options (
 			found_opt = TRUE;
 			break;
 
+		case PGM_OPT_TSTAMP:
+			if (PGM_LIKELY(opt_header->opt_length == sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_tstamp)))
+				*opt_tstamp = (struct pgm_opt_tstamp*)(opt_header + 1);
+			break;
+
 		default: break;
 		}
 
@@ -416,13 +635,23 @@ pgm_new_peer (
 					sock->rxw_secs,
 					sock->rxw_max_rte,
 					sock->ack_c_p);
+	peer->window->skb_pool = sock->rx_skb_pool;
+	peer->window->placeholder_pool = sock->rx_placeholder_pool;
+/* a fresh back-off interval spans at most nine buckets */
+	peer->window->nak_bucket_ivl = sock->nak_bo_ivl / 8;
+/* written only under the receiver mutex */
+	for (unsigned i = 0; i < PGM_HDR_MAX; i++)
+		pgm_hdr_init (&peer->hdr[ i ], 1);
+	peer->window->peer_hdr = peer->hdr;
+	peer->window->sock_hdr = sock->hdr;
 	peer->spmr_expiry = now + sock->spmr_expiry;
 
 /* add peer to hash table and linked list */
 	pgm_rwlock_writer_lock (&sock->peers_lock);
-	pgm_hashtable_insert (sock->peers_hashtable, &peer->tsi, _pgm_peer_ref (peer));
+	pgm_tsimap_insert (sock->peers_map, &peer->tsi, _pgm_peer_ref (peer));
 	peer->peers_link.data = peer;
 	sock->peers_list = pgm_list_prepend_link (sock->peers_list, &peer->peers_link);
+	peer_timer_insert (sock, peer, peer->spmr_expiry);
 	pgm_rwlock_writer_unlock (&sock->peers_lock);
 
 	pgm_timer_lock (sock);
@@ -468,6 +697,18 @@ pgm_flush_peers_pending (
 			pgm_rxw_remove_commit (peer->window);
 		const ssize_t peer_bytes = pgm_rxw_readv (peer->window, pmsg, (unsigned)(msg_end - *pmsg + 1));
 
+/* corrupt data dropped during reconstruction waits in BACK-OFF state already expired */
+		if (PGM_UNLIKELY(((pgm_rxw_t*)peer->window)->has_nak_event))
+		{
+			const pgm_time_t now = pgm_time_update_now();
+			((pgm_rxw_t*)peer->window)->has_nak_event = 0;
+			peer_timer_schedule (sock, peer, now);
+			pgm_timer_lock (sock);
+			if (pgm_time_after (sock->next_poll, now))
+				sock->next_poll = now;
+			pgm_timer_unlock (sock);
+		}
+
 		if (peer->last_cumulative_losses != ((pgm_rxw_t*)peer->window)->cumulative_losses)
 		{
 			sock->is_reset = TRUE;
@@ -475,6 +716,9 @@ pgm_flush_peers_pending (
 			peer->last_cumulative_losses = ((pgm_rxw_t*)peer->window)->cumulative_losses;
 		}
 
+/* last commit is kept across empty reads so a later loss at the commit lead
+ * can still release the transmission group.
+ */
 		if (peer_bytes >= 0)
 		{
 			(*bytes_read) += peer_bytes;
@@ -484,8 +728,7 @@ pgm_flush_peers_pending (
 				retval = -PGM_SOCK_ENOBUFS;
 				break;
 			}
-		} else
-			peer->last_commit = 0;
+		}
 		if (PGM_UNLIKELY(sock->is_reset)) {
 			retval = -PGM_SOCK_ECONNRESET;
 			break;
@@ -555,7 +798,7 @@ pgm_set_reset_error (
 
 	error_skb = pgm_alloc_skb (0);
 	error_skb->sock	= sock;
-	error_skb->tstamp	= pgm_time_update_now ();
+	error_skb->tstamp	= pgm_time_cached_now ();
 	memcpy (&error_skb->tsi, &source->tsi, sizeof(pgm_tsi_t));
 	error_skb->sequence	= source->lost_count;
 	msgv->msgv_skb[0]	= error_skb;
@@ -614,6 +857,7 @@ pgm_on_spm (
 						      skb->tstamp,
 						      nak_rb_expiry);
 		if (naks) {
+			peer_timer_schedule (sock, source, nak_rb_expiry);
 			pgm_timer_lock (sock);
 			if (pgm_time_after (sock->next_poll, nak_rb_expiry))
 				sock->next_poll = nak_rb_expiry;
@@ -697,6 +941,7 @@ pgm_on_spm (
 	source->spmr_expiry = 0;
 	if (source->spmr_tstamp > 0) {
 		PGM_HISTOGRAM_TIMES("Rx.SpmRequestResponseTime", skb->tstamp - source->spmr_tstamp);
+		peer_hdr_record (sock, source, PGM_HDR_SPMR_RESPONSE_TIME, skb->tstamp - source->spmr_tstamp);
 		source->spmr_tstamp = 0;
 	}
 	return TRUE;
@@ -764,13 +1009,16 @@ pgm_on_peer_nak (
 	}
 
 /* handle as NCF */
+	pgm_time_t nak_rb_expiry = skb->tstamp + nak_rb_ivl(sock);
 	ncf_status = pgm_rxw_confirm (peer->window,
 				      pgm_ntohl (nak->nak_sqn),
 				      skb->tstamp,
 				      skb->tstamp + sock->nak_rdata_ivl,
-				      skb->tstamp + nak_rb_ivl(sock));
-	if (PGM_RXW_UPDATED == ncf_status || PGM_RXW_APPENDED == ncf_status)
+				      nak_rb_expiry);
+	if (PGM_RXW_UPDATED == ncf_status || PGM_RXW_APPENDED == ncf_status) {
+		peer_timer_schedule (sock, peer, MIN(skb->tstamp + sock->nak_rdata_ivl, nak_rb_expiry));
 		peer->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAKS_SUPPRESSED]++;
+	}
 
 /* check NAK list */
 	if (skb->pgm_header->pgm_options & PGM_OPT_PRESENT)
@@ -808,13 +1056,16 @@ pgm_on_peer_nak (
 		} while (!(opt_header->opt_type & PGM_OPT_END));
 
 		while (nak_list_len) {
+			nak_rb_expiry = skb->tstamp + nak_rb_ivl(sock);
 			ncf_status = pgm_rxw_confirm (peer->window,
 						      pgm_ntohl (*nak_list),
 						      skb->tstamp,
 						      skb->tstamp + sock->nak_rdata_ivl,
-						      skb->tstamp + nak_rb_ivl(sock));
-			if (PGM_RXW_UPDATED == ncf_status || PGM_RXW_APPENDED == ncf_status)
+						      nak_rb_expiry);
+			if (PGM_RXW_UPDATED == ncf_status || PGM_RXW_APPENDED == ncf_status) {
+				peer_timer_schedule (sock, peer, MIN(skb->tstamp + sock->nak_rdata_ivl, nak_rb_expiry));
 				peer->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAKS_SUPPRESSED]++;
+			}
 			nak_list++;
 			nak_list_len--;
 		}
@@ -906,6 +1157,7 @@ pgm_on_ncf (
 	if (PGM_RXW_UPDATED == ncf_status || PGM_RXW_APPENDED == ncf_status)
 	{
 		const pgm_time_t ncf_ivl = (PGM_RXW_APPENDED == ncf_status) ? ncf_rb_ivl : ncf_rdata_ivl;
+		peer_timer_schedule (sock, source, ncf_ivl);
 		pgm_timer_lock (sock);
 		if (pgm_time_after (sock->next_poll, ncf_ivl)) {
 			sock->next_poll = ncf_ivl;
@@ -957,8 +1209,10 @@ pgm_on_ncf (
 						      skb->tstamp,
 						      ncf_rdata_ivl,
 						      ncf_rb_ivl);
-			if (PGM_RXW_UPDATED == ncf_status || PGM_RXW_APPENDED == ncf_status)
+			if (PGM_RXW_UPDATED == ncf_status || PGM_RXW_APPENDED == ncf_status) {
+				peer_timer_schedule (sock, source, MIN(ncf_rb_ivl, ncf_rdata_ivl));
 				source->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAKS_SUPPRESSED]++;
+			}
 			ncf_list++;
 			ncf_list_len--;
 		}
@@ -1537,6 +1791,12 @@ nak_rb_state (
 
 /* TODO: process BOTH selective and parity NAKs? */
 
+/* expired sequences are collected from the window bitmap in ascending order,
+ * a batch at a time sized to fit one NAK list.
+ */
+	struct pgm_sqn_list_t nak_list;
+	unsigned n;
+
 /* calculate current transmission group for parity enabled peers */
 	if (peer->has_ondemand_parity)
 	{
@@ -1548,20 +1808,15 @@ nak_rb_state (
 		uint32_t nak_tg_sqn = 0;
 		uint32_t nak_pkt_cnt = 0;
 
-/* parity NAK generation */
+/* parity NAK generation, one per transmission group */
 
-		for (pgm_list_t *it = nak_backoff_queue->tail, *prev = it->prev;
-		     NULL != it;
-		     it = prev)
+		while ((n = pgm_rxw_nak_list (peer->window, now, current_tg_sqn, nak_list.sqn, PGM_N_ELEMENTS(nak_list.sqn))) > 0)
 		{
-			struct pgm_sk_buff_t* skb	= (struct pgm_sk_buff_t*)it;
-			pgm_rxw_state_t* state		= (pgm_rxw_state_t*)&skb->cb;
-
-			prev = it->prev;
-
-/* check this packet for state expiration */
-			if (pgm_time_after_eq (now, state->timer_expiry))
+			for (unsigned i = 0; i < n; i++)
 			{
+				struct pgm_sk_buff_t* skb	= pgm_rxw_peek (peer->window, nak_list.sqn[ i ]);
+				pgm_rxw_state_t* state		= pgm_rxw_recovery_state (peer->window, skb->sequence);
+
 				if (PGM_UNLIKELY(!is_valid_nla)) {
 					dropped_invalid++;
 					pgm_rxw_lost (peer->window, skb->sequence);
@@ -1570,39 +1825,32 @@ nak_rb_state (
 					continue;
 				}
 
-/* TODO: parity nak lists */
 				const uint32_t tg_sqn = skb->sequence & tg_sqn_mask;
-				if (	(  nak_pkt_cnt && tg_sqn == nak_tg_sqn ) ||
-					( !nak_pkt_cnt && tg_sqn != current_tg_sqn )	)
-				{
-					pgm_rxw_state (peer->window, skb, PGM_PKT_STATE_WAIT_NCF);
+				if (nak_pkt_cnt && tg_sqn != nak_tg_sqn) {
+					if (!send_parity_nak (sock, peer, nak_tg_sqn, nak_pkt_cnt))
+						return FALSE;
+					nak_pkt_cnt = 0;
+				}
+
+				pgm_rxw_state (peer->window, skb, PGM_PKT_STATE_WAIT_NCF);
 
-					if (!nak_pkt_cnt++)
-						nak_tg_sqn = tg_sqn;
-					state->nak_transmit_count++;
+				if (!nak_pkt_cnt++)
+					nak_tg_sqn = tg_sqn;
+				state->nak_transmit_count++;
 
 #ifdef PGM_ABSOLUTE_EXPIRY
+				state->timer_expiry += sock->nak_rpt_ivl;
+				while (pgm_time_after_eq (now, state->timer_expiry)) {
 					state->timer_expiry += sock->nak_rpt_ivl;
-					while (pgm_time_after_eq (now, state->timer_expiry)) {
-						state->timer_expiry += sock->nak_rpt_ivl;
-						state->ncf_retry_count++;
-					}
+					state->ncf_retry_count++;
+				}
 #else
-					state->timer_expiry = now + sock->nak_rpt_ivl;
+				state->timer_expiry = now + sock->nak_rpt_ivl;
 #endif
-					pgm_timer_lock (sock);
-					if (pgm_time_after (sock->next_poll, state->timer_expiry))
-						sock->next_poll = state->timer_expiry;
-					pgm_timer_unlock (sock);
-				}
-				else
-				{	/* different transmission group */
-					break;
-				}
-			}
-			else
-			{	/* packet expires some time later */
-				break;
+				pgm_timer_lock (sock);
+				if (pgm_time_after (sock->next_poll, state->timer_expiry))
+					sock->next_poll = state->timer_expiry;
+				pgm_timer_unlock (sock);
 			}
 		}
 
@@ -1611,22 +1859,17 @@ nak_rb_state (
 	}
 	else
 	{
-		struct pgm_sqn_list_t nak_list = { .len = 0 };
 
 /* select NAK generation */
 
-		for (pgm_list_t *it = nak_backoff_queue->tail, *prev = it->prev;
-		     NULL != it;
-		     it = prev)
+		while ((n = pgm_rxw_nak_list (peer->window, now, pgm_rxw_next_lead (peer->window), nak_list.sqn, PGM_N_ELEMENTS(nak_list.sqn))) > 0)
 		{
-			struct pgm_sk_buff_t* skb	= (struct pgm_sk_buff_t*)it;
-			pgm_rxw_state_t* state		= (pgm_rxw_state_t*)&skb->cb;
-
-			prev = it->prev;
-
-/* check this packet for state expiration */
-			if (pgm_time_after_eq(now, state->timer_expiry))
+			nak_list.len = 0;
+			for (unsigned i = 0; i < n; i++)
 			{
+				struct pgm_sk_buff_t* skb	= pgm_rxw_peek (peer->window, nak_list.sqn[ i ]);
+				pgm_rxw_state_t* state		= pgm_rxw_recovery_state (peer->window, skb->sequence);
+
 				if (PGM_UNLIKELY(!is_valid_nla)) {
 					dropped_invalid++;
 					pgm_rxw_lost (peer->window, skb->sequence);
@@ -1658,25 +1901,15 @@ pgm_trace(PGM_LOG_ROLE_NETWORK,_("nak_rpt_expiry in %f seconds."),
 				if (pgm_time_after (sock->next_poll, state->timer_expiry))
 					sock->next_poll = state->timer_expiry;
 				pgm_timer_unlock (sock);
-
-				if (nak_list.len == PGM_N_ELEMENTS(nak_list.sqn)) {
-					if (sock->can_send_nak && !send_nak_list (sock, peer, &nak_list))
-						return FALSE;
-					nak_list.len = 0;
-				}
-			}
-			else
-			{	/* packet expires some time later */
-				break;
 			}
-		}
 
-		if (sock->can_send_nak && nak_list.len)
-		{
-			if (nak_list.len > 1 && !send_nak_list (sock, peer, &nak_list))
-				return FALSE;
-			else if (!send_nak (sock, peer, nak_list.sqn[0]))
-				return FALSE;
+			if (sock->can_send_nak && nak_list.len)
+			{
+				if (nak_list.len > 1 && !send_nak_list (sock, peer, &nak_list))
+					return FALSE;
+				else if (1 == nak_list.len && !send_nak (sock, peer, nak_list.sqn[0]))
+					return FALSE;
+			}
 		}
 
 	}
@@ -1719,8 +1952,9 @@ pgm_trace(PGM_LOG_ROLE_NETWORK,_("nak_rpt_expiry in %f seconds."),
 	return TRUE;
 }
 
-/* check this peer for NAK state timers, uses the tail of each queue for the nearest
- * timer execution.
+/* check peers with expired timers for NAK state timers, uses the tail of each queue
+ * for the nearest timer execution.  peers are visited in order of timer expiry
+ * until reaching one which expires later.
  *
  * returns TRUE on complete sweep, returns FALSE if operation would block.
  */
@@ -1738,16 +1972,13 @@ pgm_check_peer_state (
 	pgm_debug ("pgm_check_peer_state (sock:%p now:%" PGM_TIME_FORMAT ")",
 		(const void*)sock, now);
 
-	if (!sock->peers_list)
-		return TRUE;
-
-	for (pgm_list_t *it = sock->peers_list, *next = it->next;
-	     NULL != it;
-	     it = next)
+	while (sock->peers_timer_len > 0)
 	{
-		pgm_peer_t* peer = it->data;
+		pgm_peer_t* peer = sock->peers_timer_heap[0];
+		pgm_time_t next_expiry;
 
-		next = it->next;
+		if (pgm_time_after (peer->timer_expiry, now))
+			break;
 
 		if (peer->spmr_expiry)
 		{
@@ -1809,14 +2040,19 @@ pgm_check_peer_state (
 			else
 			{
 				pgm_trace (PGM_LOG_ROLE_SESSION,_("Peer expired, tsi %s"), pgm_tsi_print (&peer->tsi));
-				pgm_hashtable_remove (sock->peers_hashtable, &peer->tsi);
+				pgm_tsimap_remove (sock->peers_map, &peer->tsi);
 				sock->peers_list = pgm_list_remove_link (sock->peers_list, &peer->peers_link);
+				peer_timer_remove (sock, peer);
 				if (sock->last_hash_value == peer)
 					sock->last_hash_value = NULL;
 				pgm_peer_unref (peer);
+				continue;
 			}
 		}
 
+/* state left expired is revisited on the next dispatch */
+		next_expiry = peer_next_expiry (peer);
+		peer_timer_update (sock, peer, pgm_time_after (next_expiry, now) ? next_expiry : now + 1);
 	}
 
 /* check for waiting contiguous packets */
@@ -1829,7 +2065,8 @@ pgm_check_peer_state (
 	return TRUE;
 }
 
-/* find the next state expiration time among the socks peers.
+/* find the next state expiration time among the socks peers, read from the
+ * head of the peer timer heap.
  *
  * on success, returns the earliest of the expiration parameter or next
  * peer expiration time.
@@ -1848,48 +2085,10 @@ pgm_min_receiver_expiry (
 	pgm_debug ("pgm_min_receiver_expiry (sock:%p expiration:%" PGM_TIME_FORMAT ")",
 		(void*)sock, expiration);
 
-	if (!sock->peers_list)
-		return expiration;
-
-	for (pgm_list_t *it = sock->peers_list, *next = it->next;
-	     NULL != it;
-	     it = next)
+	if (sock->peers_timer_len > 0 &&
+	    pgm_time_after_eq (expiration, sock->peers_timer_heap[0]->timer_expiry))
 	{
-		pgm_peer_t* peer = it->data;
-
-		next = it->next;
-
-		if (peer->spmr_expiry)
-		{
-			if (pgm_time_after_eq (expiration, peer->spmr_expiry))
-				expiration = peer->spmr_expiry;
-		}
-
-		if (peer->window->ack_backoff_queue.tail)
-		{
-			pgm_assert (sock->use_pgmcc);
-			if (pgm_time_after_eq (expiration, next_ack_rb_expiry (peer->window)))
-				expiration = next_ack_rb_expiry (peer->window);
-		}
-
-		if (peer->window->nak_backoff_queue.tail)
-		{
-			if (pgm_time_after_eq (expiration, next_nak_rb_expiry (peer->window)))
-				expiration = next_nak_rb_expiry (peer->window);
-		}
-
-		if (peer->window->wait_ncf_queue.tail)
-		{
-			if (pgm_time_after_eq (expiration, next_nak_rpt_expiry (peer->window)))
-				expiration = next_nak_rpt_expiry (peer->window);
-		}
-
-		if (peer->window->wait_data_queue.tail)
-		{
-			if (pgm_time_after_eq (expiration, next_nak_rdata_expiry (peer->window)))
-				expiration = next_nak_rdata_expiry (peer->window);
-		}
-
+		expiration = sock->peers_timer_heap[0]->timer_expiry;
 	}
 
 	return expiration;
@@ -1930,7 +2129,7 @@ nak_rpt_state (
 	{
 		struct pgm_sk_buff_t* skb	= (struct pgm_sk_buff_t*)it;
 		pgm_assert (NULL != skb);
-		pgm_rxw_state_t* state		= (pgm_rxw_state_t*)&skb->cb;
+		pgm_rxw_state_t* state		= pgm_rxw_recovery_state (peer->window, skb->sequence);
 
 		prev = it->prev;
 
@@ -2063,7 +2262,7 @@ nak_rdata_state (
 	{
 		struct pgm_sk_buff_t* rdata_skb	= (struct pgm_sk_buff_t*)it;
 		pgm_assert (NULL != rdata_skb);
-		pgm_rxw_state_t* rdata_state	= (pgm_rxw_state_t*)&rdata_skb->cb;
+		pgm_rxw_state_t* rdata_state	= pgm_rxw_recovery_state (peer->window, rdata_skb->sequence);
 
 		prev = it->prev;
 
@@ -2178,8 +2377,9 @@ pgm_on_data (
 /* advance data pointer to payload */
 	pgm_skb_pull (skb, (uint16_t)(sizeof(struct pgm_data) + opt_total_length));
 
+	struct pgm_opt_tstamp* opt_tstamp = NULL;
 	if (opt_total_length > 0 &&			/* there are options */
-	    get_pgm_options (skb) &&			/* valid options */
+	    get_pgm_options (skb, &opt_tstamp) &&	/* valid options */
 	    sock->use_pgmcc &&				/* PGMCC is enabled */
 	    NULL != skb->pgm_opt_pgmcc_data &&		/* PGMCC options */
 	    0 == source->ack_rb_expiry)			/* not partaking in a current election */
@@ -2187,6 +2387,9 @@ pgm_on_data (
 		ack_rb_expiry = skb->tstamp + ack_rb_ivl (sock);
 	}
 
+/* RDATA repeats the original transmit time, repairs are timed separately */
+	const bool is_odata = (PGM_ODATA == skb->pgm_header->pgm_type);
+
 	const int add_status = pgm_rxw_add (source->window, skb, skb->tstamp, nak_rb_expiry);
 
 /* skb reference is now invalid */
@@ -2215,6 +2418,9 @@ discarded:
 
 /* valid data */
 	PGM_HISTOGRAM_COUNTS("Rx.DataBytesReceived", tsdu_length);
+	peer_hdr_record (sock, source, PGM_HDR_DATA_BYTES, tsdu_length);
+	if (NULL != opt_tstamp && is_odata)
+		on_tstamp (sock, source, opt_tstamp);
 	source->cumulative_stats[PGM_PC_RECEIVER_DATA_BYTES_RECEIVED] += tsdu_length;
 	source->cumulative_stats[PGM_PC_RECEIVER_DATA_MSGS_RECEIVED]  += msg_count;
 
@@ -2255,6 +2461,10 @@ discarded:
 	}
 
 	if (flush_naks || 0 != ack_rb_expiry) {
+		if (flush_naks)
+			peer_timer_schedule (sock, source, nak_rb_expiry);
+		if (0 != ack_rb_expiry)
+			peer_timer_schedule (sock, source, ack_rb_expiry);
 /* flush out 1st time nak packets */
 		pgm_timer_lock (sock);
 		if (flush_naks && pgm_time_after (sock->next_poll, nak_rb_expiry))
@@ -72,6 +72,9 @@
 #define pgm_csum_fold		mock_pgm_csum_fold
 #define pgm_compat_csum_partial	mock_pgm_compat_csum_partial
 #define pgm_histogram_init	mock_pgm_histogram_init
+#define pgm_hdr_init		mock_pgm_hdr_init
+#define pgm_hdr_destroy		mock_pgm_hdr_destroy
+#define pgm_hdr_record		mock_pgm_hdr_record
 #define pgm_setsockopt		mock_pgm_setsockopt
 
 
@@ -300,6 +303,8 @@ mock_pgm_rxw_remove_commit (
 {
 }
 
+static bool mock_has_nak_event = FALSE;
+
 ssize_t
 mock_pgm_rxw_readv (
 	pgm_rxw_t* const		window,
@@ -307,6 +312,8 @@ mock_pgm_rxw_readv (
 	const unsigned			pmsglen
 	)
 {
+	if (mock_has_nak_event)
+		window->has_nak_event = 1;
 	return 0;
 }
 
@@ -344,6 +351,29 @@ mock_pgm_histogram_add (
 {
 }
 
+void
+mock_pgm_hdr_init (
+	pgm_hdr_t* const	hdr,
+	const unsigned		shards
+	)
+{
+}
+
+void
+mock_pgm_hdr_destroy (
+	pgm_hdr_t* const	hdr
+	)
+{
+}
+
+void
+mock_pgm_hdr_record (
+	pgm_hdr_t* const	hdr,
+	const uint64_t		value
+	)
+{
+}
+
 /* mock functions for external references */
 
 size_t
@@ -423,6 +453,34 @@ START_TEST (test_check_peer_state_pass_001)
 }
 END_TEST
 
+/* only peers with expired timers are visited, postponed peers are re-keyed.
+ */
+
+START_TEST (test_check_peer_state_pass_002)
+{
+	pgm_sock_t* sock = generate_sock();
+	pgm_peer_t* peers[3];
+	const pgm_time_t expiry[3] = { pgm_secs(10), pgm_secs(5), pgm_secs(20) };
+	sock->is_bound = TRUE;
+	sock->peer_expiry = TEST_PEER_EXPIRY;
+	for (unsigned i = 0; i < G_N_ELEMENTS(peers); i++) {
+		peers[i] = generate_peer();
+		peers[i]->expiry = expiry[i];
+		peers[i]->window->committed_count = 1;		/* postpone expiration */
+		peer_timer_insert (sock, peers[i], peers[i]->expiry);
+	}
+	fail_unless (pgm_secs(5) == pgm_min_receiver_expiry (sock, pgm_secs(100)), "min_receiver_expiry failed");
+	fail_unless (TRUE == pgm_check_peer_state (sock, pgm_secs(7)), "check_peer_state failed");
+	fail_unless (pgm_secs(5) + TEST_PEER_EXPIRY == peers[1]->expiry, "expiry not postponed");
+	fail_unless (pgm_secs(10) == peers[0]->expiry, "unexpired peer visited");
+	fail_unless (pgm_secs(10) == pgm_min_receiver_expiry (sock, pgm_secs(100)), "min_receiver_expiry failed");
+	fail_unless (TRUE == pgm_check_peer_state (sock, pgm_secs(15)), "check_peer_state failed");
+	fail_unless (pgm_secs(20) == pgm_min_receiver_expiry (sock, pgm_secs(100)), "min_receiver_expiry failed");
+	fail_unless (pgm_secs(20) == peers[2]->expiry, "unexpired peer visited");
+	fail_unless (3 == sock->peers_timer_len, "peer removed");
+}
+END_TEST
+
 START_TEST (test_check_peer_state_fail_001)
 {
 	pgm_check_peer_state (NULL, mock_pgm_time_now);
@@ -430,6 +488,43 @@ START_TEST (test_check_peer_state_fail_001)
 }
 END_TEST
 
+/* target:
+ *	int
+ *	pgm_flush_peers_pending (
+ *		pgm_sock_t*		sock,
+ *		struct pgm_msgv_t**	pmsg,
+ *		const struct pgm_msgv_t* msg_end,
+ *		size_t*			bytes_read,
+ *		unsigned*		data_read
+ *		)
+ */
+
+/* a read that adds a NAK placeholder brings the peer timer forward.
+ */
+
+START_TEST (test_flush_peers_pending_pass_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_msgv_t msgv[2], *pmsg = msgv;
+	size_t bytes_read = 0;
+	unsigned data_read = 0;
+	sock->is_bound = TRUE;
+	sock->next_poll = pgm_secs(10);
+	peer->expiry = pgm_secs(10);
+	peer_timer_insert (sock, peer, peer->expiry);
+	pgm_peer_set_pending (sock, peer);
+	mock_pgm_time_now = pgm_secs(1);
+	mock_has_nak_event = TRUE;
+	fail_unless (0 == pgm_flush_peers_pending (sock, &pmsg, msgv + 1, &bytes_read, &data_read), "flush_peers_pending failed");
+	mock_has_nak_event = FALSE;
+	fail_unless (0 == peer->window->has_nak_event, "has_nak_event not cleared");
+	fail_unless (pgm_secs(1) == sock->next_poll, "next_poll not lowered");
+	fail_unless (pgm_secs(1) == pgm_min_receiver_expiry (sock, pgm_secs(100)), "min_receiver_expiry failed");
+	fail_unless (1 == data_read, "data_read failed");
+}
+END_TEST
+
 /* target:
  *	pgm_time_t
  *	pgm_min_receiver_expiry (
@@ -823,11 +918,17 @@ make_test_suite (void)
 	suite_add_tcase (s, tc_check_peer_state);
 	tcase_add_checked_fixture (tc_check_peer_state, mock_setup, NULL);
 	tcase_add_test (tc_check_peer_state, test_check_peer_state_pass_001);
+	tcase_add_test (tc_check_peer_state, test_check_peer_state_pass_002);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_check_peer_state, test_check_peer_state_fail_001, SIGABRT);
 #endif
 
 /* formally min-nak-expiry */
+	TCase* tc_flush_peers_pending = tcase_create ("flush-peers-pending");
+	suite_add_tcase (s, tc_flush_peers_pending);
+	tcase_add_checked_fixture (tc_flush_peers_pending, mock_setup, NULL);
+	tcase_add_test (tc_flush_peers_pending, test_flush_peers_pending_pass_001);
+
 	TCase* tc_min_receiver_expiry = tcase_create ("min-receiver-expiry");
 	suite_add_tcase (s, tc_min_receiver_expiry);
 	tcase_add_checked_fixture (tc_min_receiver_expiry, mock_setup, NULL);
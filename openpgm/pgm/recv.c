@@ -42,6 +42,7 @@
 #include <impl/packet_parse.h>
 #include <impl/timer.h>
 #include <impl/engine.h>
+#include <impl/recv.h>
 
 
 //#define RECV_DEBUG
@@ -75,6 +76,154 @@
 #	define pgm_cmsghdr			cmsghdr
 #endif
 
+#ifndef _WIN32
+#	define pgm_msghdr			msghdr
+#else
+#	define pgm_msghdr			_WSAMSG
+#endif
+
+#ifdef HAVE_RECVMMSG
+/* ancillary data per datagram, enough for one IP_PKTINFO or IPV6_PKTINFO
+ * and SCM_TIMESTAMPING.
+ */
+#	define PGM_RECV_BATCH_AUXLEN		256
+
+/* ring of pre-allocated skbuffs filled by one recvmmsg() call and then
+ * parsed and dispatched one datagram at a time.  sock::rx_buffer always
+ * aliases the slot being dispatched, when the receive window takes ownership
+ * of it the replacement buffer is adopted back into the ring.
+ */
+struct pgm_recv_batch_t {
+	unsigned			size;
+	unsigned			len;		/* datagrams read by last call */
+	unsigned			index;		/* next datagram to dispatch */
+	struct pgm_sk_buff_t**		skb;
+	struct mmsghdr*			msgs;
+	struct pgm_iovec*		iov;
+	struct sockaddr_storage*	src;
+	char*				aux;
+};
+#endif /* HAVE_RECVMMSG */
+
+
+/* read destination address from packet information ancillary data.
+ * returns FALSE on invalid address.
+ */
+
+static
+bool
+get_dst_addr (
+	struct pgm_msghdr*    const restrict msg,
+	struct sockaddr*      const restrict dst_addr
+	)
+{
+	struct pgm_cmsghdr* cmsg;
+	for (cmsg = PGM_CMSG_FIRSTHDR(msg);
+	     cmsg != NULL;
+	     cmsg = PGM_CMSG_NXTHDR(msg, cmsg))
+	{
+/* both IP_PKTINFO and IP_RECVDSTADDR exist on OpenSolaris, so capture
+ * each type if defined.
+ */
+#ifdef IP_PKTINFO
+		if (IPPROTO_IP == cmsg->cmsg_level && 
+		    IP_PKTINFO == cmsg->cmsg_type)
+		{
+			const void* pktinfo		= PGM_CMSG_DATA(cmsg);
+/* discard on invalid address */
+			if (PGM_UNLIKELY(NULL == pktinfo)) {
+				pgm_debug ("in_pktinfo is NULL");
+				return FALSE;
+			}
+			const struct in_pktinfo* in	= pktinfo;
+			struct sockaddr_in s4;
+			memset (&s4, 0, sizeof(s4));
+			s4.sin_family			= AF_INET;
+			s4.sin_addr.s_addr		= in->ipi_addr.s_addr;
+			memcpy (dst_addr, &s4, sizeof(s4));
+			break;
+		}
+#endif
+#ifdef IP_RECVDSTADDR
+		if (IPPROTO_IP == cmsg->cmsg_level &&
+		    IP_RECVDSTADDR == cmsg->cmsg_type)
+		{
+			const void* recvdstaddr		= PGM_CMSG_DATA(cmsg);
+/* discard on invalid address */
+			if (PGM_UNLIKELY(NULL == recvdstaddr)) {
+				pgm_debug ("in_recvdstaddr is NULL");
+				return FALSE;
+			}
+			const struct in_addr* in	= recvdstaddr;
+			struct sockaddr_in s4;
+			memset (&s4, 0, sizeof(s4));
+			s4.sin_family			= AF_INET;
+			s4.sin_addr.s_addr		= in->s_addr;
+			memcpy (dst_addr, &s4, sizeof(s4));
+			break;
+		}
+#endif
+#if !defined(IP_PKTINFO) && !defined(IP_RECVDSTADDR)
+#	error "No defined CMSG type for IPv4 destination address."
+#endif
+
+		if (IPPROTO_IPV6 == cmsg->cmsg_level && 
+		    IPV6_PKTINFO == cmsg->cmsg_type)
+		{
+			const void* pktinfo		= PGM_CMSG_DATA(cmsg);
+/* discard on invalid address */
+			if (PGM_UNLIKELY(NULL == pktinfo)) {
+				pgm_debug ("in6_pktinfo is NULL");
+				return FALSE;
+			}
+			const struct in6_pktinfo* in6	= pktinfo;
+			struct sockaddr_in6 s6;
+			memset (&s6, 0, sizeof(s6));
+			s6.sin6_family			= AF_INET6;
+			s6.sin6_addr			= in6->ipi6_addr;
+			s6.sin6_scope_id		= in6->ipi6_ifindex;
+			memcpy (dst_addr, &s6, sizeof(s6));
+/* does not set flow id */
+			break;
+		}
+	}
+	return TRUE;
+}
+
+#ifdef SO_TIMESTAMPING
+/* read the kernel or NIC receive time from SCM_TIMESTAMPING ancillary data,
+ * the NIC time is only used when requested and present.
+ *
+ * returns nanoseconds since the Unix epoch, or 0 without a timestamp.
+ */
+
+static
+uint64_t
+get_rx_tstamp (
+	struct pgm_msghdr* const	msg,
+	const int			tstamp_source
+	)
+{
+	struct pgm_cmsghdr* cmsg;
+	for (cmsg = PGM_CMSG_FIRSTHDR(msg);
+	     cmsg != NULL;
+	     cmsg = PGM_CMSG_NXTHDR(msg, cmsg))
+	{
+		if (SOL_SOCKET == cmsg->cmsg_level &&
+		    SCM_TIMESTAMPING == cmsg->cmsg_type)
+		{
+/* [0] software, [1] unused, [2] raw hardware */
+			struct timespec ts[3];
+			memcpy (ts, PGM_CMSG_DATA(cmsg), sizeof(ts));
+			if (PGM_RX_TSTAMP_HARDWARE == tstamp_source &&
+			    (0 != ts[2].tv_sec || 0 != ts[2].tv_nsec))
+				return (uint64_t)ts[2].tv_sec * UINT64_C(1000000000) + ts[2].tv_nsec;
+			return (uint64_t)ts[0].tv_sec * UINT64_C(1000000000) + ts[0].tv_nsec;
+		}
+	}
+	return 0;
+}
+#endif /* SO_TIMESTAMPING */
 
 /* read a packet into a PGM skbuff
  * on success returns packet length, on closed socket returns 0,
@@ -107,6 +256,21 @@ recvskb (
 	if (PGM_UNLIKELY(sock->is_destroyed))
 		return 0;
 
+/* in-process transport, packets carry no IP header and addresses are copied */
+	if (NULL != sock->loopback) {
+		const ssize_t len = pgm_loopback_recvfrom (sock->loopback, skb->head, sock->max_tpdu, src_addr, src_addrlen, dst_addr, dst_addrlen);
+		if (len <= 0)
+			return len;
+		skb->sock		= sock;
+		skb->tstamp		= pgm_time_cached_now();
+		skb->data		= skb->head;
+		skb->len		= (uint16_t)len;
+		skb->zero_padded	= 0;
+		skb->tail		= (char*)skb->data + len;
+		sock->rx_tstamp_nsecs	= 0;
+		return len;
+	}
+
 	struct pgm_iovec iov = {
 		.iov_base	= skb->head,
 		.iov_len	= sock->max_tpdu
@@ -153,87 +317,220 @@ recvskb (
 #endif
 
 	skb->sock		= sock;
-	skb->tstamp		= pgm_time_update_now();
+	skb->tstamp		= pgm_time_cached_now();
 	skb->data		= skb->head;
 	skb->len		= (uint16_t)len;
 	skb->zero_padded	= 0;
 	skb->tail		= (char*)skb->data + len;
+#ifdef SO_TIMESTAMPING
+	sock->rx_tstamp_nsecs	= (PGM_RX_TSTAMP_USER != sock->rx_tstamp) ? get_rx_tstamp (&msg, sock->rx_tstamp) : 0;
+#endif
 
-	if (sock->udp_encap_ucast_port ||
-	    AF_INET6 == pgm_sockaddr_family (src_addr))
+	if ((sock->udp_encap_ucast_port ||
+	     AF_INET6 == pgm_sockaddr_family (src_addr)) &&
+	    !get_dst_addr (&msg, dst_addr))
 	{
-		struct pgm_cmsghdr* cmsg;
-		for (cmsg = PGM_CMSG_FIRSTHDR(&msg);
-		     cmsg != NULL;
-		     cmsg = PGM_CMSG_NXTHDR(&msg, cmsg))
-		{
-/* both IP_PKTINFO and IP_RECVDSTADDR exist on OpenSolaris, so capture
- * each type if defined.
+		return -1;
+	}
+	return len;
+}
+
+#ifdef HAVE_RECVMMSG
+/* allocate the receive batch ring, the current receive buffer becomes the
+ * first slot.
  */
-#ifdef IP_PKTINFO
-			if (IPPROTO_IP == cmsg->cmsg_level && 
-			    IP_PKTINFO == cmsg->cmsg_type)
-			{
-				const void* pktinfo		= PGM_CMSG_DATA(cmsg);
-/* discard on invalid address */
-				if (PGM_UNLIKELY(NULL == pktinfo)) {
-					pgm_debug ("in_pktinfo is NULL");
-					return -1;
-				}
-				const struct in_pktinfo* in	= pktinfo;
-				struct sockaddr_in s4;
-				memset (&s4, 0, sizeof(s4));
-				s4.sin_family			= AF_INET;
-				s4.sin_addr.s_addr		= in->ipi_addr.s_addr;
-				memcpy (dst_addr, &s4, sizeof(s4));
-				break;
-			}
-#endif
-#ifdef IP_RECVDSTADDR
-			if (IPPROTO_IP == cmsg->cmsg_level &&
-			    IP_RECVDSTADDR == cmsg->cmsg_type)
-			{
-				const void* recvdstaddr		= PGM_CMSG_DATA(cmsg);
-/* discard on invalid address */
-				if (PGM_UNLIKELY(NULL == recvdstaddr)) {
-					pgm_debug ("in_recvdstaddr is NULL");
-					return -1;
-				}
-				const struct in_addr* in	= recvdstaddr;
-				struct sockaddr_in s4;
-				memset (&s4, 0, sizeof(s4));
-				s4.sin_family			= AF_INET;
-				s4.sin_addr.s_addr		= in->s_addr;
-				memcpy (dst_addr, &s4, sizeof(s4));
-				break;
-			}
-#endif
-#if !defined(IP_PKTINFO) && !defined(IP_RECVDSTADDR)
-#	error "No defined CMSG type for IPv4 destination address."
+
+PGM_GNUC_INTERNAL
+void
+pgm_recv_batch_create (
+	pgm_sock_t* const	sock
+	)
+{
+	struct pgm_recv_batch_t* batch;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != sock->rx_buffer);
+	pgm_assert (NULL == sock->recv_batch);
+	pgm_assert_cmpuint (sock->recv_batch_size, >, 1);
+	pgm_assert_cmpuint (sock->recv_batch_size, <=, PGM_MAX_RECV_BATCH);
+
+	pgm_debug ("pgm_recv_batch_create (sock:%p)", (const void*)sock);
+
+	batch = pgm_new0 (struct pgm_recv_batch_t, 1);
+	batch->size = sock->recv_batch_size;
+	batch->skb  = pgm_new (struct pgm_sk_buff_t*, batch->size);
+	batch->msgs = pgm_new0 (struct mmsghdr, batch->size);
+	batch->iov  = pgm_new0 (struct pgm_iovec, batch->size);
+	batch->src  = pgm_new0 (struct sockaddr_storage, batch->size);
+	batch->aux  = pgm_malloc (batch->size * PGM_RECV_BATCH_AUXLEN);
+
+	batch->skb[0] = sock->rx_buffer;
+	for (unsigned i = 1; i < batch->size; i++)
+		batch->skb[i] = pgm_skb_pool_alloc (sock->rx_skb_pool);
+	for (unsigned i = 0; i < batch->size; i++) {
+		struct msghdr* msg = &batch->msgs[i].msg_hdr;
+		msg->msg_name	= &batch->src[i];
+		msg->msg_iov	= (void*)&batch->iov[i];
+		msg->msg_iovlen	= 1;
+		msg->msg_control = batch->aux + (i * PGM_RECV_BATCH_AUXLEN);
+	}
+	sock->recv_batch = batch;
+}
+
+/* release the receive batch ring including any undispatched datagrams.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_recv_batch_destroy (
+	pgm_sock_t* const	sock
+	)
+{
+	struct pgm_recv_batch_t* batch;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != sock->recv_batch);
+
+	pgm_debug ("pgm_recv_batch_destroy (sock:%p)", (const void*)sock);
+
+	batch = sock->recv_batch;
+	if (batch->index > 0)
+		batch->skb[ batch->index - 1 ] = sock->rx_buffer;
+	for (unsigned i = 0; i < batch->size; i++)
+		pgm_free_skb (batch->skb[i]);
+	pgm_free (batch->aux);
+	pgm_free (batch->src);
+	pgm_free (batch->iov);
+	pgm_free (batch->msgs);
+	pgm_free (batch->skb);
+	pgm_free (batch);
+	sock->recv_batch = NULL;
+	sock->rx_buffer = NULL;
+}
+
+static inline
+bool
+recv_batch_is_pending (
+	const pgm_sock_t* const	sock
+	)
+{
+	return (NULL != sock->recv_batch && sock->recv_batch->index < sock->recv_batch->len);
+}
+
+/* read the next packet from the receive batch into sock::rx_buffer, refilling
+ * the batch with one recvmmsg() call when empty.
+ *
+ * on success returns packet length, on closed socket returns 0,
+ * on error returns -1.
+ */
+
+static
+ssize_t
+recvskb_batch (
+	pgm_sock_t*           const restrict sock,
+	const int			     flags,
+	struct sockaddr*      const restrict src_addr,
+	const socklen_t			     src_addrlen,
+	struct sockaddr*      const restrict dst_addr,
+	const socklen_t			     dst_addrlen
+	)
+{
+	struct pgm_recv_batch_t* batch;
+	struct pgm_sk_buff_t* skb;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != sock->recv_batch);
+	pgm_assert (NULL != src_addr);
+	pgm_assert (src_addrlen > 0);
+	pgm_assert (NULL != dst_addr);
+	pgm_assert (dst_addrlen > 0);
+
+	pgm_debug ("recvskb_batch (sock:%p flags:%d src-addr:%p src-addrlen:%d dst-addr:%p dst-addrlen:%d)",
+		(void*)sock, flags, (void*)src_addr, (int)src_addrlen, (void*)dst_addr, (int)dst_addrlen);
+
+	if (PGM_UNLIKELY(sock->is_destroyed))
+		return 0;
+
+	batch = sock->recv_batch;
+
+/* adopt replacement buffer if the receive window kept the previous packet */
+	if (batch->index > 0)
+		batch->skb[ batch->index - 1 ] = sock->rx_buffer;
+
+	if (batch->index == batch->len)
+	{
+		batch->index = batch->len = 0;
+		for (unsigned i = 0; i < batch->size; i++) {
+			struct msghdr* msg = &batch->msgs[i].msg_hdr;
+			batch->iov[i].iov_base	= batch->skb[i]->head;
+			batch->iov[i].iov_len	= sock->max_tpdu;
+			msg->msg_namelen	= sizeof(struct sockaddr_storage);
+			msg->msg_controllen	= PGM_RECV_BATCH_AUXLEN;
+			msg->msg_flags		= 0;
+		}
+		const int count = recvmmsg (sock->recv_sock, batch->msgs, batch->size, flags, NULL);
+		if (count <= 0)
+			return count;
+
+		PGM_HISTOGRAM_COUNTS("Rx.BatchSize", count);
+		const pgm_time_t now = pgm_time_refresh();
+		for (int i = 0; i < count; i++) {
+			skb		= batch->skb[i];
+			skb->sock	= sock;
+			skb->tstamp	= now;
+			skb->data	= skb->head;
+			skb->len	= (uint16_t)batch->msgs[i].msg_len;
+			skb->zero_padded = 0;
+			skb->tail	= (char*)skb->data + skb->len;
+		}
+		batch->len = count;
+	}
+
+	struct msghdr* msg = &batch->msgs[ batch->index ].msg_hdr;
+	skb = sock->rx_buffer = batch->skb[ batch->index++ ];
+	memcpy (src_addr, msg->msg_name, MIN(src_addrlen, msg->msg_namelen));
+#ifdef SO_TIMESTAMPING
+	sock->rx_tstamp_nsecs = (PGM_RX_TSTAMP_USER != sock->rx_tstamp) ? get_rx_tstamp (msg, sock->rx_tstamp) : 0;
 #endif
 
-			if (IPPROTO_IPV6 == cmsg->cmsg_level && 
-			    IPV6_PKTINFO == cmsg->cmsg_type)
-			{
-				const void* pktinfo		= PGM_CMSG_DATA(cmsg);
-/* discard on invalid address */
-				if (PGM_UNLIKELY(NULL == pktinfo)) {
-					pgm_debug ("in6_pktinfo is NULL");
-					return -1;
-				}
-				const struct in6_pktinfo* in6	= pktinfo;
-				struct sockaddr_in6 s6;
-				memset (&s6, 0, sizeof(s6));
-				s6.sin6_family			= AF_INET6;
-				s6.sin6_addr			= in6->ipi6_addr;
-				s6.sin6_scope_id		= in6->ipi6_ifindex;
-				memcpy (dst_addr, &s6, sizeof(s6));
-/* does not set flow id */
-				break;
-			}
+#ifdef PGM_DEBUG
+	if (PGM_UNLIKELY(pgm_loss_rate > 0)) {
+		const unsigned percent = pgm_rand_int_range (&sock->rand_, 0, 100);
+		if (percent <= pgm_loss_rate) {
+			pgm_debug ("Simulated packet loss");
+			pgm_set_last_sock_error (PGM_SOCK_EAGAIN);
+			return SOCKET_ERROR;
 		}
 	}
-	return len;
+#endif
+
+	if ((sock->udp_encap_ucast_port ||
+	     AF_INET6 == pgm_sockaddr_family (src_addr)) &&
+	    !get_dst_addr (msg, dst_addr))
+	{
+		return -1;
+	}
+	return skb->len;
+}
+#endif /* HAVE_RECVMMSG */
+
+/* test whether a UDP encapsulated packet belongs to a source owned by this
+ * receive shard, truncated packets are left for the parser to reject.
+ */
+
+static inline
+bool
+is_shard_local (
+	const pgm_sock_t*	    const restrict sock,
+	const struct pgm_sk_buff_t* const restrict skb
+	)
+{
+	if (PGM_UNLIKELY(skb->len < sizeof(struct pgm_header)))
+		return TRUE;
+	return sock->shard_index == pgm_shard_of (skb->data, sock->shard_count);
 }
 
 /* upstream = receiver to source, peer-to-peer = receive to receiver
@@ -355,7 +652,7 @@ on_peer (
 	upstream_tsi.sport = skb->pgm_header->pgm_dport;
 
 	pgm_rwlock_reader_lock (&sock->peers_lock);
-	*source = pgm_hashtable_lookup (sock->peers_hashtable, &upstream_tsi);
+	*source = pgm_tsimap_lookup (sock->peers_map, &upstream_tsi);
 	pgm_rwlock_reader_unlock (&sock->peers_lock);
 	if (PGM_UNLIKELY(NULL == *source)) {
 /* this source is unknown, we don't care about messages about it */
@@ -436,7 +733,7 @@ on_downstream (
 	}
 
 /* search for TSI peer context or create a new one */
-	if (PGM_LIKELY(pgm_tsi_hash (&skb->tsi) == sock->last_hash_key &&
+	if (PGM_LIKELY(pgm_tsimap_key (&skb->tsi) == sock->last_hash_key &&
 			NULL != sock->last_hash_value))
 	{
 		*source = sock->last_hash_value;
@@ -444,7 +741,7 @@ on_downstream (
 	else
 	{
 		pgm_rwlock_reader_lock (&sock->peers_lock);
-		*source = pgm_hashtable_lookup_extended (sock->peers_hashtable, &skb->tsi, &sock->last_hash_key);
+		*source = pgm_tsimap_lookup (sock->peers_map, &skb->tsi);
 		pgm_rwlock_reader_unlock (&sock->peers_lock);
 		if (PGM_UNLIKELY(NULL == *source)) {
 			*source = pgm_new_peer (sock,
@@ -453,6 +750,7 @@ on_downstream (
 					       (struct sockaddr*)dst_addr, pgm_sockaddr_len(dst_addr),
 						skb->tstamp);
 		}
+		sock->last_hash_key = pgm_tsimap_key (&skb->tsi);
 		sock->last_hash_value = *source;
 	}
 
@@ -468,7 +766,7 @@ on_downstream (
 	case PGM_RDATA:
 		if (PGM_UNLIKELY(!pgm_on_data (sock, *source, skb)))
 			goto out_discarded;
-		sock->rx_buffer = pgm_alloc_skb (sock->max_tpdu);
+		sock->rx_buffer = pgm_skb_pool_alloc (sock->rx_skb_pool);
 		break;
 
 	case PGM_NCF:
@@ -554,6 +852,59 @@ on_pgm (
 	return FALSE;
 }
 
+/* spin on the descriptors wait_for_event() blocks on until one is readable,
+ * the spin budget is spent or the next timer is due, so that repairs and
+ * notifications queued by other threads also end the spin.  a caught event
+ * restores the full budget, an empty spin halves it so that sparse traffic
+ * falls back to sleeping.
+ *
+ * returns TRUE when an event is waiting, otherwise reduces timeout by the
+ * time spent spinning.
+ */
+
+static
+bool
+busy_poll (
+	pgm_sock_t*   const restrict	sock,
+#ifdef HAVE_POLL
+	struct pollfd*	     restrict	fds,
+#else
+	const fd_set* const restrict	readfds,
+#endif
+	const int			n_fds,
+	pgm_time_t*   const restrict	timeout		/* microseconds */
+	)
+{
+	const pgm_time_t spin = MIN((pgm_time_t)sock->busy_poll_budget, *timeout);
+	const pgm_time_t start = pgm_time_update_now();
+	pgm_time_t elapsed;
+
+	do {
+#ifdef HAVE_POLL
+		const int ready = poll (fds, n_fds, 0);
+#else
+		fd_set ready_fds = *readfds;
+		struct timeval tv_zero = { 0, 0 };
+		const int ready = select (n_fds, &ready_fds, NULL, NULL, &tv_zero);
+#endif
+/* delayed loopback packets become due without a notification */
+		if (ready > 0 ||
+		    (NULL != sock->loopback &&
+		     pgm_loopback_is_ready (sock->loopback, pgm_time_update_now())))
+		{
+			sock->busy_poll_budget = sock->busy_poll_usecs;
+			return TRUE;
+		}
+		elapsed = pgm_to_usecs (pgm_time_update_now() - start);
+	} while (elapsed < spin);
+
+/* a spin cut short by a timer says nothing about the traffic */
+	if (spin == sock->busy_poll_budget)
+		sock->busy_poll_budget = MAX(sock->busy_poll_budget / 2, MAX(1, sock->busy_poll_usecs / 16));
+	*timeout = elapsed < *timeout ? *timeout - elapsed : 0;
+	return FALSE;
+}
+
 /* block on receiving socket whilst holding sock::waiting-mutex
  * returns EAGAIN for waiting data, returns EINTR for waiting timer event,
  * returns ENOENT on closed sock, and returns EFAULT for libc error.
@@ -598,21 +949,40 @@ wait_for_event (
 			sock->is_pending_read = FALSE;
 		}
 
-		int timeout;
+		pgm_time_t timeout;
 		if (sock->can_send_data && !pgm_txw_retransmit_is_empty (sock->window))
 			timeout = 0;
 		else
-			timeout = (int)pgm_timer_expiration (sock);
-		
+			timeout = pgm_timer_expiration (sock);
+
+		if (sock->busy_poll_usecs && timeout > 0 &&
 #ifdef HAVE_POLL
-		const int ready = poll (fds, n_fds, timeout /* μs */ / 1000 /* to ms */);
+		    busy_poll (sock, fds, n_fds, &timeout))
+#else
+		    busy_poll (sock, &readfds, n_fds, &timeout))
+#endif
+		{
+			pgm_time_begin();
+			return EAGAIN;
+		}
+		
+#ifdef HAVE_PPOLL
+		const struct timespec ts_timeout = {
+			.tv_sec		= (time_t)(timeout / 1000000L),
+			.tv_nsec	= (long)(timeout % 1000000L) * 1000L
+		};
+		const int ready = ppoll (fds, n_fds, &ts_timeout, NULL);
+#elif defined( HAVE_POLL )
+/* round up so that a sub-millisecond timer does not spin */
+		const int ready = poll (fds, n_fds, (int)MIN((timeout + 999) / 1000, INT32_MAX));
 #else
 		struct timeval tv_timeout = {
-			.tv_sec		= timeout > 1000000L ? (timeout / 1000000L) : 0,
-			.tv_usec	= timeout > 1000000L ? (timeout % 1000000L) : timeout
+			.tv_sec		= (long)(timeout / 1000000L),
+			.tv_usec	= (long)(timeout % 1000000L)
 		};
 		const int ready = select (n_fds, &readfds, NULL, NULL, &tv_timeout);
 #endif /* HAVE_POLL */
+		pgm_time_begin();
 		if (PGM_UNLIKELY(SOCKET_ERROR == ready)) {
 			pgm_debug ("block returned errno=%i",errno);
 			return EFAULT;
@@ -620,6 +990,12 @@ wait_for_event (
 			pgm_debug ("recv again on empty");
 			return EAGAIN;
 		}
+/* delayed loopback packets become due without a notification */
+		if (NULL != sock->loopback &&
+		    pgm_loopback_is_ready (sock->loopback, pgm_time_cached_now()))
+		{
+			return EAGAIN;
+		}
 	} while (pgm_timer_check (sock));
 	pgm_debug ("state generated event");
 	return EINTR;
@@ -642,8 +1018,9 @@ wait_for_event (
  * closed, returns PGM_IO_STATUS_EOF.  On error, returns PGM_IO_STATUS_ERROR.
  */
 
+static
 int
-pgm_recvmsgv (
+recvmsgv (
 	pgm_sock_t*   	   const restrict sock,
 	struct pgm_msgv_t* const restrict msg_start,
 	const size_t			  msg_len,
@@ -676,13 +1053,14 @@ pgm_recvmsgv (
 	pgm_assert (NULL != sock->rx_buffer);
 	pgm_assert (sock->max_tpdu > 0);
 	if (sock->can_recv_data) {
-		pgm_assert (NULL != sock->peers_hashtable);
+		pgm_assert (NULL != sock->peers_map);
 		pgm_assert_cmpuint (sock->nak_bo_ivl, >, 1);
 		pgm_assert (pgm_notify_is_valid (&sock->pending_notify));
 	}
 
 /* receiver */
 	pgm_mutex_lock (&sock->receiver_mutex);
+	pgm_time_begin();
 
 	if (PGM_UNLIKELY(sock->is_reset)) {
 		pgm_assert (NULL != sock->peers_pending);
@@ -750,6 +1128,16 @@ pgm_recvmsgv (
 
 recv_again:
 
+#ifdef HAVE_RECVMMSG
+	if (NULL != sock->recv_batch)
+		len = recvskb_batch (sock,
+				     0,
+				     (struct sockaddr*)&src,
+				     sizeof(src),
+				     (struct sockaddr*)&dst,
+				     sizeof(dst));
+	else
+#endif
 	len = recvskb (sock,
 		       sock->rx_buffer,		/* PGM skbuff */
 		       0,
@@ -783,8 +1171,17 @@ recv_again:
 		bytes_received += len;
 	}
 
+/* sources owned by another shard are dropped before any parsing */
+	if (sock->shard_count > 1 &&
+	    !is_shard_local (sock, sock->rx_buffer))
+	{
+		goto recv_again;
+	}
+
 	pgm_error_t* err = NULL;
-	const bool is_valid = (sock->udp_encap_ucast_port || AF_INET6 == src.ss_family) ?
+	sock->rx_buffer->csum_deferred = sock->use_deferred_checksum;
+	sock->rx_buffer->csum_optional = sock->use_zero_checksum;
+	const bool is_valid = (sock->udp_encap_ucast_port || AF_INET6 == src.ss_family || NULL != sock->loopback) ?
 					pgm_parse_udp_encap (sock->rx_buffer, &err) :
 					pgm_parse_raw (sock->rx_buffer, (struct sockaddr*)&dst, &err);
 	if (PGM_UNLIKELY(!is_valid))
@@ -838,6 +1235,10 @@ check_for_repeat:
 /* repeat if blocking and empty, i.e. received non data packet.
  */
 		if (0 == data_read) {
+#ifdef HAVE_RECVMMSG
+			if (recv_batch_is_pending (sock))
+				goto recv_again;
+#endif
 			const int wait_status = wait_for_event (sock);
 			switch (wait_status) {
 			case EAGAIN:
@@ -910,7 +1311,11 @@ out:
 		return status;
 	}
 
+#ifdef HAVE_RECVMMSG
+	if (sock->peers_pending || recv_batch_is_pending (sock))
+#else
 	if (sock->peers_pending)
+#endif
 	{
 /* set event notification for additional available data */
 		if (sock->is_pending_read && sock->is_edge_triggered_recv)
@@ -934,6 +1339,61 @@ out:
 	return PGM_IO_STATUS_NORMAL;
 }
 
+/* report a data packet failing checksum verification deferred to delivery,
+ * the containing apdu has already been consumed from the receive window.
+ */
+
+static
+int
+csum_mismatch (
+	const struct pgm_sk_buff_t* const restrict skb,
+	pgm_error_t**		    restrict error
+	)
+{
+	char tsi[PGM_TSISTRLEN];
+	pgm_tsi_print_r (&skb->tsi, tsi, sizeof(tsi));
+	pgm_trace (PGM_LOG_ROLE_NETWORK,_("PGM checksum mismatch on #%" PRIu32 " from %s."), skb->sequence, tsi);
+	pgm_set_error (error,
+		     PGM_ERROR_DOMAIN_RECV,
+		     PGM_ERROR_CKSUM,
+		     _("PGM packet checksum mismatch on #%" PRIu32 " from %s."),
+		     skb->sequence, tsi);
+	return PGM_IO_STATUS_ERROR;
+}
+
+int
+pgm_recvmsgv (
+	pgm_sock_t*   	   const restrict sock,
+	struct pgm_msgv_t* const restrict msg_start,
+	const size_t			  msg_len,
+	const int			  flags,	/* MSG_DONTWAIT for non-blocking */
+	size_t*			 restrict _bytes_read,	/* may be NULL */
+	pgm_error_t**		 restrict error
+	)
+{
+	size_t bytes_read = 0, bytes_verified = 0;
+
+	const int status = recvmsgv (sock, msg_start, msg_len, flags, &bytes_read, error);
+	if (PGM_IO_STATUS_NORMAL != status)
+		return status;
+
+/* verify deferred checksums in place, each skbuff is visited once */
+	for (struct pgm_msgv_t* pmsg = msg_start; bytes_verified < bytes_read; pmsg++)
+	{
+		for (unsigned i = 0; i < pmsg->msgv_len; i++)
+		{
+			struct pgm_sk_buff_t* skb = pmsg->msgv_skb[ i ];
+			if (skb->csum_deferred &&
+			    PGM_UNLIKELY(!pgm_skb_csum_verify (skb, NULL, 0)))
+				return csum_mismatch (skb, error);
+			bytes_verified += skb->len;
+		}
+	}
+	if (NULL != _bytes_read)
+		*_bytes_read = bytes_read;
+	return PGM_IO_STATUS_NORMAL;
+}
+
 /* read one contiguous apdu and return as a IO scatter/gather array.  msgv is owned by
  * the caller, tpdu contents are owned by the receive window.
  *
@@ -990,7 +1450,7 @@ pgm_recvfrom (
 	pgm_debug ("pgm_recvfrom (sock:%p buf:%p buflen:%" PRIzu " flags:%d bytes-read:%p from:%p from:%p error:%p)",
 		(const void*)sock, buf, buflen, flags, (const void*)_bytes_read, (const void*)from, (const void*)fromlen, (const void*)error);
 
-	const int status = pgm_recvmsg (sock, &msgv, flags & ~(MSG_ERRQUEUE), &bytes_read, error);
+	const int status = recvmsgv (sock, &msgv, 1, flags & ~(MSG_ERRQUEUE), &bytes_read, error);
 	if (PGM_IO_STATUS_NORMAL != status)
 		return status;
 
@@ -1012,7 +1472,12 @@ pgm_recvfrom (
 			copy_len = buflen - bytes_copied;
 			bytes_read = buflen;
 		}
-		memcpy ((char*)buf + bytes_copied, pskb->data, copy_len);
+/* checksum whilst copying rather than in a separate pass over the payload */
+		if (pskb->csum_deferred) {
+			if (PGM_UNLIKELY(!pgm_skb_csum_verify (pskb, (char*)buf + bytes_copied, (uint16_t)copy_len)))
+				return csum_mismatch (pskb, error);
+		} else
+			memcpy ((char*)buf + bytes_copied, pskb->data, copy_len);
 		bytes_copied += copy_len;
 		pskb = *(++skb);
 	}
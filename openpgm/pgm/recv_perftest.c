@@ -0,0 +1,430 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * performance tests for transport recv api, single datagram vs. batched
+ * receive over the loopback interface.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _GNU_SOURCE
+#	define _GNU_SOURCE
+#endif
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <glib.h>
+#include <check.h>
+
+
+/* mock state */
+
+#define TEST_DPORT		7500
+#define TEST_SPORT		1000
+#define TEST_XPORT		1001
+#define TEST_MAX_TPDU		1500
+#define TEST_TSDU		1000
+#define TEST_BURST		64		/* datagrams queued per round, must fit SO_RCVBUF */
+#define TEST_ITERATIONS		2000
+
+static unsigned perf_batch_size = 0;
+unsigned mock_pgm_loss_rate = 0;
+
+#define pgm_parse_raw			mock_pgm_parse_raw
+#define pgm_parse_udp_encap		mock_pgm_parse_udp_encap
+#define pgm_verify_spm			mock_pgm_verify_spm
+#define pgm_verify_nak			mock_pgm_verify_nak
+#define pgm_verify_ncf			mock_pgm_verify_ncf
+#define pgm_select_info			mock_pgm_select_info
+#define pgm_poll_info			mock_pgm_poll_info
+#define pgm_set_reset_error		mock_pgm_set_reset_error
+#define pgm_flush_peers_pending		mock_pgm_flush_peers_pending
+#define pgm_peer_has_pending		mock_pgm_peer_has_pending
+#define pgm_peer_set_pending		mock_pgm_peer_set_pending
+#define pgm_txw_retransmit_is_empty	mock_pgm_txw_retransmit_is_empty
+#define pgm_new_peer			mock_pgm_new_peer
+#define pgm_on_data			mock_pgm_on_data
+#define pgm_on_spm			mock_pgm_on_spm
+#define pgm_on_ack			mock_pgm_on_ack
+#define pgm_on_nak			mock_pgm_on_nak
+#define pgm_on_deferred_nak		mock_pgm_on_deferred_nak
+#define pgm_on_peer_nak			mock_pgm_on_peer_nak
+#define pgm_on_nnak			mock_pgm_on_nnak
+#define pgm_on_ncf			mock_pgm_on_ncf
+#define pgm_on_spmr			mock_pgm_on_spmr
+#define pgm_timer_check			mock_pgm_timer_check
+#define pgm_timer_expiration		mock_pgm_timer_expiration
+#define pgm_timer_dispatch		mock_pgm_timer_dispatch
+#define pgm_loss_rate			mock_pgm_loss_rate
+#define pgm_loopback_recvfrom		mock_pgm_loopback_recvfrom
+#define pgm_loopback_is_ready		mock_pgm_loopback_is_ready
+
+#include "recv.c"
+
+
+static
+void
+mock_setup_single (void)
+{
+	perf_batch_size = 0;
+}
+
+static
+void
+mock_setup_batch_8 (void)
+{
+	perf_batch_size = 8;
+}
+
+static
+void
+mock_setup_batch_32 (void)
+{
+	perf_batch_size = 32;
+}
+
+static
+void
+mock_setup_batch_64 (void)
+{
+	perf_batch_size = 64;
+}
+
+/* receiving socket bound to an ephemeral loopback port, packets are
+ * delivered by a plain UDP sender as per UDP encapsulation.
+ */
+
+static
+struct pgm_sock_t*
+generate_sock (
+	struct sockaddr_in*	addr
+	)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, g_htons((guint16)TEST_SPORT) };
+	struct pgm_sock_t* sock = g_new0 (struct pgm_sock_t, 1);
+	memcpy (&sock->tsi, &tsi, sizeof(pgm_tsi_t));
+	sock->is_nonblocking = TRUE;
+	sock->is_bound = TRUE;
+	sock->max_tpdu = TEST_MAX_TPDU;
+	sock->dport = g_htons((guint16)TEST_DPORT);
+	sock->udp_encap_ucast_port = TEST_DPORT;
+/* discard after dispatch: measures ingest rather than window costs */
+	sock->can_recv_data = FALSE;
+	sock->rx_skb_pool = pgm_skb_pool_create (TEST_MAX_TPDU, 0, -1, FALSE);
+	sock->rx_buffer = pgm_skb_pool_alloc (sock->rx_skb_pool);
+	sock->recv_sock = socket (AF_INET, SOCK_DGRAM, 0);
+	fail_unless (INVALID_SOCKET != sock->recv_sock, "socket failed");
+	memset (addr, 0, sizeof(*addr));
+	addr->sin_family	= AF_INET;
+	addr->sin_addr.s_addr	= htonl (INADDR_LOOPBACK);
+	fail_unless (0 == bind (sock->recv_sock, (struct sockaddr*)addr, sizeof(*addr)), "bind failed");
+	socklen_t addrlen = sizeof(*addr);
+	fail_unless (0 == getsockname (sock->recv_sock, (struct sockaddr*)addr, &addrlen), "getsockname failed");
+	pgm_sockaddr_nonblocking (sock->recv_sock, TRUE);
+	pgm_notify_init (&sock->pending_notify);
+	pgm_mutex_init (&sock->receiver_mutex);
+	pgm_rwlock_init (&sock->lock);
+	pgm_rwlock_init (&sock->peers_lock);
+	sock->recv_batch_size = perf_batch_size;
+#ifdef HAVE_RECVMMSG
+	if (sock->recv_batch_size > 1)
+		pgm_recv_batch_create (sock);
+#endif
+	return sock;
+}
+
+static
+void
+destroy_sock (
+	struct pgm_sock_t*	sock
+	)
+{
+#ifdef HAVE_RECVMMSG
+	if (sock->recv_batch)
+		pgm_recv_batch_destroy (sock);
+#endif
+	if (sock->rx_buffer)
+		pgm_free_skb (sock->rx_buffer);
+	closesocket (sock->recv_sock);
+	pgm_notify_destroy (&sock->pending_notify);
+	pgm_rwlock_free (&sock->peers_lock);
+	pgm_rwlock_free (&sock->lock);
+	pgm_mutex_free (&sock->receiver_mutex);
+	g_free (sock);
+}
+
+static
+void
+generate_odata (
+	char*			buf,
+	const size_t		len
+	)
+{
+	struct pgm_header* pgmhdr = (struct pgm_header*)buf;
+	memset (buf, 0, len);
+	pgmhdr->pgm_sport	= g_htons ((guint16)TEST_XPORT);
+	pgmhdr->pgm_dport	= g_htons ((guint16)TEST_DPORT);
+	pgmhdr->pgm_type	= PGM_ODATA;
+	pgmhdr->pgm_gsi[0]	= 1;
+	pgmhdr->pgm_gsi[1]	= 2;
+	pgmhdr->pgm_gsi[2]	= 3;
+	pgmhdr->pgm_gsi[3]	= 4;
+	pgmhdr->pgm_gsi[4]	= 5;
+	pgmhdr->pgm_gsi[5]	= 6;
+	pgmhdr->pgm_tsdu_length = g_htons ((guint16)(len - sizeof(struct pgm_header) - sizeof(struct pgm_data)));
+}
+
+/** packet module */
+bool
+mock_pgm_parse_raw (
+	struct pgm_sk_buff_t* const	skb,
+	struct sockaddr* const		dst,
+	pgm_error_t**			error
+	)
+{
+	return FALSE;
+}
+
+bool
+mock_pgm_parse_udp_encap (
+	struct pgm_sk_buff_t* const	skb,
+	pgm_error_t**			error
+	)
+{
+	skb->pgm_header = skb->data;
+	memcpy (&skb->tsi.gsi, skb->pgm_header->pgm_gsi, sizeof(pgm_gsi_t));
+	skb->tsi.sport = skb->pgm_header->pgm_sport;
+	return TRUE;
+}
+
+bool mock_pgm_verify_spm (const struct pgm_sk_buff_t* const skb) { return TRUE; }
+bool mock_pgm_verify_nak (const struct pgm_sk_buff_t* const skb) { return TRUE; }
+bool mock_pgm_verify_ncf (const struct pgm_sk_buff_t* const skb) { return TRUE; }
+
+/** socket module */
+#ifdef HAVE_POLL
+int
+mock_pgm_poll_info (
+	pgm_sock_t* const	sock,
+	struct pollfd*		fds,
+	int*			n_fds,
+	short			events
+	)
+{
+	return 0;
+}
+#else
+int
+mock_pgm_select_info (
+	pgm_sock_t* const	sock,
+	fd_set*const		readfds,
+	fd_set*const		writefds,
+	int*const		n_fds
+	)
+{
+	return 0;
+}
+#endif
+
+/** receiver module */
+PGM_GNUC_INTERNAL
+pgm_peer_t*
+mock_pgm_new_peer (
+	pgm_sock_t* const		sock,
+	const pgm_tsi_t* const		tsi,
+	const struct sockaddr* const	src_addr,
+	const socklen_t			src_addr_len,
+	const struct sockaddr* const	dst_addr,
+	const socklen_t			dst_addr_len,
+	const pgm_time_t		now
+	)
+{
+	g_assert_not_reached ();
+	return NULL;
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_set_reset_error (
+	pgm_sock_t* const		sock,
+	pgm_peer_t* const		source,
+	struct pgm_msgv_t* const	msgv
+	)
+{
+}
+
+PGM_GNUC_INTERNAL
+int
+mock_pgm_flush_peers_pending (
+	pgm_sock_t* const		sock,
+	struct pgm_msgv_t**		pmsg,
+	const struct pgm_msgv_t* const	msg_end,
+	size_t* const			bytes_read,
+	unsigned* const			data_read
+	)
+{
+	return 0;
+}
+
+PGM_GNUC_INTERNAL bool mock_pgm_peer_has_pending (pgm_peer_t* const peer) { return FALSE; }
+PGM_GNUC_INTERNAL void mock_pgm_peer_set_pending (pgm_sock_t* const sock, pgm_peer_t* const peer) {}
+PGM_GNUC_INTERNAL bool mock_pgm_on_data (pgm_sock_t* const sock, pgm_peer_t* const sender, struct pgm_sk_buff_t* const skb) { return TRUE; }
+PGM_GNUC_INTERNAL bool mock_pgm_on_ack (pgm_sock_t* const sock, struct pgm_sk_buff_t* const skb) { return TRUE; }
+PGM_GNUC_INTERNAL bool mock_pgm_on_deferred_nak (pgm_sock_t* const sock) { return TRUE; }
+PGM_GNUC_INTERNAL bool mock_pgm_on_nak (pgm_sock_t* const sock, struct pgm_sk_buff_t* const skb) { return TRUE; }
+PGM_GNUC_INTERNAL bool mock_pgm_on_peer_nak (pgm_sock_t* const sock, pgm_peer_t* const sender, struct pgm_sk_buff_t* const skb) { return TRUE; }
+PGM_GNUC_INTERNAL bool mock_pgm_on_ncf (pgm_sock_t* const sock, pgm_peer_t* const sender, struct pgm_sk_buff_t* const skb) { return TRUE; }
+PGM_GNUC_INTERNAL bool mock_pgm_on_nnak (pgm_sock_t* const sock, struct pgm_sk_buff_t* const skb) { return TRUE; }
+PGM_GNUC_INTERNAL bool mock_pgm_on_spm (pgm_sock_t* const sock, pgm_peer_t* const sender, struct pgm_sk_buff_t* const skb) { return TRUE; }
+PGM_GNUC_INTERNAL bool mock_pgm_on_spmr (pgm_sock_t* const sock, pgm_peer_t* const peer, struct pgm_sk_buff_t* const skb) { return TRUE; }
+
+/** transmit window */
+PGM_GNUC_INTERNAL bool mock_pgm_txw_retransmit_is_empty (const pgm_txw_t*const window) { return TRUE; }
+
+/** loopback module */
+PGM_GNUC_INTERNAL ssize_t mock_pgm_loopback_recvfrom (pgm_loopback_t* const ep, void* buf, const size_t buflen, struct sockaddr* src_addr, const socklen_t src_addrlen, struct sockaddr* dst_addr, const socklen_t dst_addrlen) { g_assert_not_reached(); return -1; }
+PGM_GNUC_INTERNAL bool mock_pgm_loopback_is_ready (pgm_loopback_t* const ep, const pgm_time_t now) { g_assert_not_reached(); return FALSE; }
+
+/** timer module */
+PGM_GNUC_INTERNAL bool mock_pgm_timer_check (pgm_sock_t* const sock) { return FALSE; }
+PGM_GNUC_INTERNAL pgm_time_t mock_pgm_timer_expiration (pgm_sock_t* const sock) { return 100L; }
+PGM_GNUC_INTERNAL bool mock_pgm_timer_dispatch (pgm_sock_t* const sock) { return TRUE; }
+
+
+/* target:
+ *	int
+ *	pgm_recvmsgv (
+ *		pgm_sock_t* const	sock,
+ *		struct pgm_msgv_t* const msg_start,
+ *		const size_t		msg_len,
+ *		const int		flags,
+ *		size_t*			bytes_read,
+ *		pgm_error_t**		error
+ *		)
+ *
+ * each round queues a burst of ODATA on the loopback socket then drains it,
+ * only the drain is timed.
+ */
+
+START_TEST (test_recvmsgv)
+{
+	struct sockaddr_in addr;
+	struct pgm_sock_t* sock = generate_sock (&addr);
+	const SOCKET send_sock = socket (AF_INET, SOCK_DGRAM, 0);
+	fail_unless (INVALID_SOCKET != send_sock, "socket failed");
+	const size_t tpdu_length = sizeof(struct pgm_header) + sizeof(struct pgm_data) + TEST_TSDU;
+	char* buf = g_malloc (tpdu_length);
+	generate_odata (buf, tpdu_length);
+
+	struct pgm_msgv_t msgv[TEST_BURST];
+	pgm_time_t elapsed = 0;
+	guint64 packets = 0;
+
+	for (unsigned i = TEST_ITERATIONS; i; i--) {
+		for (unsigned j = 0; j < TEST_BURST; j++) {
+			const ssize_t sent = sendto (send_sock, buf, tpdu_length, 0, (struct sockaddr*)&addr, sizeof(addr));
+			fail_unless ((ssize_t)tpdu_length == sent, "sendto failed");
+		}
+		const pgm_time_t start = pgm_time_update_now();
+		int status;
+		do {
+			status = pgm_recvmsgv (sock, msgv, G_N_ELEMENTS(msgv), MSG_DONTWAIT, NULL, NULL);
+		} while (PGM_IO_STATUS_NORMAL == status);
+		elapsed += pgm_time_update_now() - start;
+		fail_unless (PGM_IO_STATUS_WOULD_BLOCK == status, "unexpected status %d", status);
+		packets += TEST_BURST;
+	}
+
+	g_message ("%s/%u: elapsed time %" PGM_TIME_FORMAT " us, %" G_GUINT64_FORMAT " packets, unit time %.3f us",
+		sock->recv_batch_size > 1 ? "recvmmsg" : "recvmsg",
+		sock->recv_batch_size,
+		elapsed,
+		packets,
+		(double)elapsed / (double)packets);
+
+	g_free (buf);
+	closesocket (send_sock);
+	destroy_sock (sock);
+}
+END_TEST
+
+static
+Suite*
+make_recv_performance_suite (void)
+{
+	Suite* s;
+
+	s = suite_create ("Receive performance");
+
+	TCase* tc_single = tcase_create ("recvmsg");
+	suite_add_tcase (s, tc_single);
+	tcase_add_checked_fixture (tc_single, mock_setup_single, NULL);
+	tcase_add_test (tc_single, test_recvmsgv);
+
+#ifdef HAVE_RECVMMSG
+	TCase* tc_batch_8 = tcase_create ("recvmmsg-8");
+	suite_add_tcase (s, tc_batch_8);
+	tcase_add_checked_fixture (tc_batch_8, mock_setup_batch_8, NULL);
+	tcase_add_test (tc_batch_8, test_recvmsgv);
+
+	TCase* tc_batch_32 = tcase_create ("recvmmsg-32");
+	suite_add_tcase (s, tc_batch_32);
+	tcase_add_checked_fixture (tc_batch_32, mock_setup_batch_32, NULL);
+	tcase_add_test (tc_batch_32, test_recvmsgv);
+
+	TCase* tc_batch_64 = tcase_create ("recvmmsg-64");
+	suite_add_tcase (s, tc_batch_64);
+	tcase_add_checked_fixture (tc_batch_64, mock_setup_batch_64, NULL);
+	tcase_add_test (tc_batch_64, test_recvmsgv);
+#endif
+
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	g_assert (pgm_time_init (NULL));
+	pgm_rand_init();
+	pgm_messages_init();
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_recv_performance_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	pgm_messages_shutdown();
+	pgm_rand_shutdown();
+	g_assert (pgm_time_shutdown());
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
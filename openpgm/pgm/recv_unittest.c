@@ -19,6 +19,10 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
 #ifndef _GNU_SOURCE
 #	define _GNU_SOURCE
 #endif
@@ -87,6 +91,9 @@ unsigned mock_pgm_loss_rate = 0;
 
 #ifndef _WIN32
 static ssize_t mock_recvmsg (int, struct msghdr*, int);
+#	ifdef HAVE_RECVMMSG
+static int mock_recvmmsg (int, struct mmsghdr*, unsigned int, int, struct timespec*);
+#	endif
 #else
 static int mock_recvfrom (SOCKET, char*, int, int, struct sockaddr*, int*);
 #endif
@@ -123,9 +130,12 @@ static int mock_recvfrom (SOCKET, char*, int, int, struct sockaddr*, int*);
 #define pgm_time_now			mock_pgm_time_now
 #define pgm_time_update_now		mock_pgm_time_update_now
 #define recvmsg				mock_recvmsg
+#define recvmmsg			mock_recvmmsg
 #define recvfrom			mock_recvfrom
 #define pgm_WSARecvMsg			mock_pgm_WSARecvMsg
 #define pgm_loss_rate			mock_pgm_loss_rate
+#define pgm_loopback_recvfrom		mock_pgm_loopback_recvfrom
+#define pgm_loopback_is_ready		mock_pgm_loopback_is_ready
 
 #define RECV_DEBUG
 #include "recv.c"
@@ -169,14 +179,15 @@ generate_sock (void)
 	sock->is_bound = TRUE;
 	sock->is_destroyed = FALSE;
 	sock->is_reset = FALSE;
-	sock->rx_buffer = pgm_alloc_skb (TEST_MAX_TPDU);
+	sock->rx_skb_pool = pgm_skb_pool_create (TEST_MAX_TPDU, 0, -1, FALSE);
+	sock->rx_buffer = pgm_skb_pool_alloc (sock->rx_skb_pool);
 	sock->max_tpdu = TEST_MAX_TPDU;
 	sock->rxw_sqns = TEST_RXW_SQNS;
 	sock->dport = g_htons((guint16)TEST_DPORT);
 	sock->can_send_data = TRUE;
 	sock->can_send_nak = TRUE;
 	sock->can_recv_data = TRUE;
-	sock->peers_hashtable = pgm_hashtable_new (pgm_tsi_hash, pgm_tsi_equal);
+	sock->peers_map = pgm_tsimap_new ();
 	pgm_rand_create (&sock->rand_);
 	sock->nak_bo_ivl = 100*1000;
 	pgm_notify_init (&sock->pending_notify);
@@ -671,7 +682,7 @@ mock_pgm_new_peer (
 					    sock->ack_c_p);
 	peer->spmr_expiry = now + sock->spmr_expiry;
 	gpointer entry = mock__pgm_peer_ref(peer);
-	pgm_hashtable_insert (sock->peers_hashtable, &peer->tsi, entry);
+	pgm_tsimap_insert (sock->peers_map, &peer->tsi, entry);
 	peer->peers_link.next = sock->peers_list;
 	peer->peers_link.data = peer;
 	if (sock->peers_list)
@@ -922,6 +933,10 @@ mock_pgm_sendto (
 	return len;
 }
 
+/** loopback module */
+PGM_GNUC_INTERNAL ssize_t mock_pgm_loopback_recvfrom (pgm_loopback_t* const ep, void* buf, const size_t buflen, struct sockaddr* src_addr, const socklen_t src_addrlen, struct sockaddr* dst_addr, const socklen_t dst_addrlen) { g_assert_not_reached(); return -1; }
+PGM_GNUC_INTERNAL bool mock_pgm_loopback_is_ready (pgm_loopback_t* const ep, const pgm_time_t now) { g_assert_not_reached(); return FALSE; }
+
 /** timer module */
 PGM_GNUC_INTERNAL
 bool
@@ -1010,6 +1025,39 @@ mock_recvmsg (
 	errno = mock_errno;
 	return mock_retval;
 }
+
+#	ifdef HAVE_RECVMMSG
+/* fill as many messages as are queued before the next block event.
+ */
+static
+int
+mock_recvmmsg (
+	int			s,
+	struct mmsghdr*		msgvec,
+	unsigned int		vlen,
+	int			flags,
+	struct timespec*	timeout
+	)
+{
+	g_assert (NULL != msgvec);
+	g_assert (vlen > 0);
+
+	g_debug ("mock_recvmmsg (s:%d msgvec:%p vlen:%u flags:%d timeout:%p)",
+		s, (gpointer)msgvec, vlen, flags, (gpointer)timeout);
+
+	int count = 0;
+	while (count < (int)vlen && NULL != mock_recvmsg_list) {
+		struct mock_recvmsg_t* mr = mock_recvmsg_list->data;
+		if (count > 0 && mr->mr_retval < 0)
+			break;
+		const ssize_t len = mock_recvmsg (s, &msgvec[count].msg_hdr, flags);
+		if (len < 0)
+			return len;
+		msgvec[count++].msg_len = len;
+	}
+	return count;
+}
+#	endif
 #else
 static
 int
@@ -1171,6 +1219,37 @@ START_TEST (test_data_pass_001)
 }
 END_TEST
 
+#if !defined(_WIN32) && defined(HAVE_RECVMMSG)
+/* recvmmsg batch -> on_data, receive window keeps each skb */
+START_TEST (test_batch_data_pass_001)
+{
+	const char source[] = "i am not a string";
+	pgm_sock_t* sock = generate_sock();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->recv_batch_size = 4;
+	pgm_recv_batch_create (sock);
+	fail_if (NULL == sock->recv_batch, "recv_batch_create failed");
+	struct pgm_sk_buff_t* first = sock->rx_buffer;
+	guint8 buffer[ TEST_TXW_SQNS * TEST_MAX_TPDU ];
+	gpointer packet; gsize packet_len;
+	generate_odata (source, sizeof(source), 0 /* sqn */, -1 /* trail */, &packet, &packet_len);
+	generate_msghdr (packet, packet_len);
+	generate_odata (source, sizeof(source), 1 /* sqn */, -1 /* trail */, &packet, &packet_len);
+	generate_msghdr (packet, packet_len);
+	push_block_event ();
+	gsize bytes_read;
+	pgm_error_t* err = NULL;
+	fail_unless (PGM_IO_STATUS_TIMER_PENDING == pgm_recv (sock, buffer, sizeof(buffer), MSG_DONTWAIT, &bytes_read, &err), "recv failed");
+	fail_unless (PGM_ODATA == mock_pgm_type, "unexpected PGM packet");
+	fail_unless (first != sock->recv_batch->skb[0], "receive buffer not replaced");
+	fail_unless (sock->rx_buffer == sock->recv_batch->skb[1], "receive buffer not adopted");
+	pgm_recv_batch_destroy (sock);
+	fail_unless (NULL == sock->recv_batch, "recv_batch_destroy failed");
+	fail_unless (NULL == sock->rx_buffer, "receive buffer not released");
+}
+END_TEST
+#endif
+
 /* recv -> on_spm */
 START_TEST (test_spm_pass_001)
 {
@@ -1636,6 +1715,44 @@ START_TEST (test_recvmsgv_fail_001)
 }
 END_TEST
 
+/* target:
+ *	uint32_t
+ *	pgm_shard_of (
+ *		const struct pgm_header*	header,
+ *		uint32_t			shard_count
+ *		)
+ *
+ * packets from a source and peer packets about it select the same shard.
+ */
+
+START_TEST (test_shard_of_pass_001)
+{
+	const guint shard_count = 7;
+	guint hits[7] = { 0 };
+	for (guint i = 0, r = 1; i < 1000; i++) {
+		struct pgm_header odata, nak;
+		memset (&odata, 0, sizeof(odata));
+		for (guint j = 0; j < sizeof(odata.pgm_gsi); j++) {
+			r = r * 1103515245 + 12345;
+			odata.pgm_gsi[ j ] = r >> 16;
+		}
+		odata.pgm_sport	= g_htons ((guint16)(r >> 8));
+		odata.pgm_dport	= g_htons (7500);
+		odata.pgm_type	= PGM_ODATA;
+		memcpy (&nak, &odata, sizeof(nak));
+		nak.pgm_sport	= odata.pgm_dport;
+		nak.pgm_dport	= odata.pgm_sport;
+		nak.pgm_type	= PGM_NAK;
+		const uint32_t shard = pgm_shard_of (&odata, shard_count);
+		fail_unless (shard < shard_count, "shard out of range");
+		fail_unless (shard == pgm_shard_of (&nak, shard_count), "peer packet on different shard");
+		hits[ shard ]++;
+	}
+	for (guint i = 0; i < shard_count; i++)
+		fail_unless (hits[ i ] > 0, "shard never selected");
+}
+END_TEST
+
 
 static
 Suite*
@@ -1655,6 +1772,13 @@ make_test_suite (void)
 	tcase_add_checked_fixture (tc_data, mock_setup, mock_teardown);
 	tcase_add_test (tc_data, test_data_pass_001);
 
+#if !defined(_WIN32) && defined(HAVE_RECVMMSG)
+	TCase* tc_batch_data = tcase_create ("batch-data");
+	suite_add_tcase (s, tc_batch_data);
+	tcase_add_checked_fixture (tc_batch_data, mock_setup, mock_teardown);
+	tcase_add_test (tc_batch_data, test_batch_data_pass_001);
+#endif
+
 	TCase* tc_spm = tcase_create ("spm");
 	suite_add_tcase (s, tc_spm);
 	tcase_add_checked_fixture (tc_spm, mock_setup, mock_teardown);
@@ -1745,6 +1869,10 @@ make_test_suite (void)
 	tcase_add_checked_fixture (tc_recvmsgv, mock_setup, mock_teardown);
 	tcase_add_test (tc_recvmsgv, test_recvmsgv_fail_001);
 
+	TCase* tc_shard_of = tcase_create ("shard-of");
+	suite_add_tcase (s, tc_shard_of);
+	tcase_add_test (tc_shard_of, test_shard_of_pass_001);
+
 	return s;
 }
 
@@ -29,16 +29,59 @@
 #endif
 #include <impl/framework.h>
 
-#ifdef USE_GALOIS_SSE3
+#ifdef _MSC_VER
+#	include <intrin.h>
+#else
+#if defined(__i386__) || defined(__x86_64__)
 #	include <x86intrin.h>
 #endif
+#endif
+
+
+/* Vector kernels carry their own target attributes and are selected by
+ * pgm_rs_init() from the run-time cpuid, the library need not be built
+ * with -march flags.  GFNI intrinsics require GCC 8 or Clang 7.
+ */
+#if defined(_M_AMD64) || defined(_M_X64)
+#	define USE_GALOIS_SIMD
+#	define GALOIS_TARGET(x)
+#elif defined(__x86_64__) && ((defined(__clang__) && __clang_major__ >= 7) || (!defined(__clang__) && __GNUC__ >= 8))
+#	define USE_GALOIS_SIMD
+#	define GALOIS_TARGET(x)		__attribute__((__target__(x)))
+#endif
+
+/* locals */
+
+static void _pgm_gf_vec_addmul_scalar (pgm_gf8_t*restrict, const pgm_gf8_t, const pgm_gf8_t*restrict, uint16_t);
+#ifdef USE_GALOIS_SIMD
+static void _pgm_gf_vec_addmul_ssse3 (pgm_gf8_t*restrict, const pgm_gf8_t, const pgm_gf8_t*restrict, uint16_t);
+static void _pgm_gf_vec_addmul_avx2 (pgm_gf8_t*restrict, const pgm_gf8_t, const pgm_gf8_t*restrict, uint16_t);
+static void _pgm_gf_vec_addmul_avx512bw (pgm_gf8_t*restrict, const pgm_gf8_t, const pgm_gf8_t*restrict, uint16_t);
+static void _pgm_gf_vec_addmul_gfni (pgm_gf8_t*restrict, const pgm_gf8_t, const pgm_gf8_t*restrict, uint16_t);
+static void _pgm_gf_vec_addmul_gfni_avx512 (pgm_gf8_t*restrict, const pgm_gf8_t, const pgm_gf8_t*restrict, uint16_t);
+
+/* Per multiplier lookup tables built once by pgm_rs_init().
+ *
+ * Nibble table per the Intel IPP whitepaper, The Use of Finite Field GF(256)
+ * in the Performance Primitives (2008), row b holds b • x for x ∈ [0,15]
+ * followed by b • (x << 4), i.e. operate on GF((2⁴)²) through PSHUFB.
+ *
+ * Affine table holds multiplication by b as an 8×8 bit matrix for
+ * GF2P8AFFINEQB, as GF2P8MULB is fixed to the AES polynomial 0x11b and not
+ * the 0x11d used here.
+ */
+static pgm_gf8_t gf_nibble_table[ PGM_GF_NO_ELEMENTS ][ 32 ];
+static uint64_t gf_affine_table[ PGM_GF_NO_ELEMENTS ];
+#endif
+
+static void (*gf_vec_addmul) (pgm_gf8_t*restrict, const pgm_gf8_t, const pgm_gf8_t*restrict, uint16_t) = _pgm_gf_vec_addmul_scalar;
 
 /* Vector GF(2⁸) plus-equals multiplication.
  *
  * d[] += b • s[]
  */
 
-static
+static inline
 void
 _pgm_gf_vec_addmul (
 	pgm_gf8_t*	 restrict d,
@@ -47,65 +90,71 @@ _pgm_gf_vec_addmul (
 	uint16_t		  len	/* length of vectors */
 	)
 {
-	uint_fast16_t i;
-#ifdef USE_GALOIS_SSE3
-	uint_fast16_t count16;
-#else
-	uint_fast16_t count8;
-#endif
-
 	if (PGM_UNLIKELY(b == 0))
 		return;
+	gf_vec_addmul (d, b, s, len);
+}
 
-#ifdef USE_GALOIS_MUL_LUT
-        const pgm_gf8_t* gfmul_b = &pgm_gftable[ (uint16_t)b << 8 ];
-#endif
-
-/* Implementation per the Intel IPP whitepaper
- * The Use of Finite Field GF(256) in the Performance Primitives (2008)
+/* Blocked GF(2⁸) matrix-vector plus-equals multiplication.
+ *
+ *           cols
+ * d_j[] += ∑  M_j,i • s_i[]	for each row j
+ *          i=1
+ *
+ * Each source block is read once for every row, the block size is chosen
+ * such that the rows and one source block remain resident in L1.
  */
-#ifdef USE_GALOIS_SSE3
-	i = 0;
-	count16 = len >> 4;		/* 16-way unrolls */
-	if (count16)
+
+#define PGM_GF_BLOCK_BYTES	(16 * 1024)
+
+static
+void
+_pgm_gf_mat_addmul (
+	pgm_gf8_t**	  restrict d,		/* rows */
+	const pgm_gf8_t*  restrict M,		/* rows-by-cols */
+	const pgm_gf8_t** restrict s,		/* cols */
+	const uint8_t		   rows,
+	const uint8_t		   cols,
+	const uint16_t		   len		/* length of vectors */
+	)
+{
+	const uint_fast16_t block = MAX(64, (PGM_GF_BLOCK_BYTES / (rows + 1)) & ~63);
+
+	for (uint_fast16_t offset = 0; offset < len; offset += block)
 	{
-/* generate nibble size lookup table for feeding into SSE3 instruction PSHUFB */
-		struct {
-			pgm_gf8_t hi[PGM_GF_NO_ELEMENTS][16];
-			pgm_gf8_t lo[PGM_GF_NO_ELEMENTS][16];
-		} nibble_gftable;
-		for (int i = 0; i < PGM_GF_NO_ELEMENTS; i++) {
-			for (int j = 0; j < 16; j++) {
-				nibble_gftable.hi[i][j] = pgm_gfmul (i, j << 4);
-				nibble_gftable.lo[i][j] = pgm_gfmul (i, j);
+		const uint16_t block_len = (uint16_t)MIN(block, len - offset);
+		for (uint_fast8_t i = 0; i < cols; i++)
+		{
+			for (uint_fast8_t j = 0; j < rows; j++)
+			{
+				_pgm_gf_vec_addmul (d[ j ] + offset, M[ (j * cols) + i ], s[ i ] + offset, block_len);
 			}
 		}
+	}
+}
 
-/* operate on GF((2^4)^2) */
-		const __m128i hi = _mm_loadu_si128 ((const __m128i*)nibble_gftable.hi[ b ]);
-		const __m128i lo = _mm_loadu_si128 ((const __m128i*)nibble_gftable.lo[ b ]);
-		const __m128i nibble_mask = _mm_set1_epi8 (0x0f);
-		while (count16--) {
-			const __m128i dst = _mm_load_si128 ((__m128i *)(&d[i]));
-			const __m128i src = _mm_load_si128 ((__m128i *)(&s[i]));
-			__m128i tmp = _mm_shuffle_epi8 (lo, _mm_and_si128 (nibble_mask, src));
-			tmp = _mm_xor_si128 (tmp, _mm_shuffle_epi8 (hi, _mm_and_si128 (nibble_mask, _mm_srli_epi64 (src, 4))));
-
-			tmp = _mm_xor_si128 (dst, tmp);
-			_mm_store_si128 ((__m128i *)(&d[i]), tmp);
-			i += 16;
-		}
+static
+void
+_pgm_gf_vec_addmul_scalar (
+	pgm_gf8_t*	 restrict d,
+	const pgm_gf8_t		  b,
+	const pgm_gf8_t* restrict s,
+	uint16_t		  len
+	)
+{
+	uint_fast16_t i;
+	uint_fast16_t count8;
+
+#ifdef USE_GALOIS_MUL_LUT
+        const pgm_gf8_t* gfmul_b = &pgm_gftable[ (uint16_t)b << 8 ];
+#endif
 
-/* remaining */
-		len %= 16;
-	}
-#else
 	i = 0;
 	count8 = len >> 3;		/* 8-way unrolls */
 	if (count8)
 	{
 		while (count8--) {
-#	ifdef USE_GALOIS_MUL_LUT
+#ifdef USE_GALOIS_MUL_LUT
 			d[i  ] ^= gfmul_b[ s[i  ] ];
 			d[i+1] ^= gfmul_b[ s[i+1] ];
 			d[i+2] ^= gfmul_b[ s[i+2] ];
@@ -114,34 +163,272 @@ _pgm_gf_vec_addmul (
 			d[i+5] ^= gfmul_b[ s[i+5] ];
 			d[i+6] ^= gfmul_b[ s[i+6] ];
 			d[i+7] ^= gfmul_b[ s[i+7] ];
-#	else
-			d[i  ] ^= gfmul( b, s[i  ] );
-			d[i+1] ^= gfmul( b, s[i+1] );
-			d[i+2] ^= gfmul( b, s[i+2] );
-			d[i+3] ^= gfmul( b, s[i+3] );
-			d[i+4] ^= gfmul( b, s[i+4] );
-			d[i+5] ^= gfmul( b, s[i+5] );
-			d[i+6] ^= gfmul( b, s[i+6] );
-			d[i+7] ^= gfmul( b, s[i+7] );
-#	endif
+#else
+			d[i  ] ^= pgm_gfmul( b, s[i  ] );
+			d[i+1] ^= pgm_gfmul( b, s[i+1] );
+			d[i+2] ^= pgm_gfmul( b, s[i+2] );
+			d[i+3] ^= pgm_gfmul( b, s[i+3] );
+			d[i+4] ^= pgm_gfmul( b, s[i+4] );
+			d[i+5] ^= pgm_gfmul( b, s[i+5] );
+			d[i+6] ^= pgm_gfmul( b, s[i+6] );
+			d[i+7] ^= pgm_gfmul( b, s[i+7] );
+#endif
 			i += 8;
 		}
 
 /* remaining */
 		len %= 8;
 	}
-#endif
 
 	while (len--) {
 #ifdef USE_GALOIS_MUL_LUT
 		d[i] ^= gfmul_b[ s[i] ];
 #else
-		d[i] ^= gfmul( b, s[i] );
+		d[i] ^= pgm_gfmul( b, s[i] );
 #endif
 		i++;
 	}
 }
 
+#ifdef USE_GALOIS_SIMD
+/* SSSE3 - 16 bytes per PSHUFB pair.
+ */
+
+GALOIS_TARGET("ssse3")
+static
+void
+_pgm_gf_vec_addmul_ssse3 (
+	pgm_gf8_t*	 restrict d,
+	const pgm_gf8_t		  b,
+	const pgm_gf8_t* restrict s,
+	uint16_t		  len
+	)
+{
+	const __m128i lo = _mm_loadu_si128 ((const __m128i*)&gf_nibble_table[ b ][  0 ]);
+	const __m128i hi = _mm_loadu_si128 ((const __m128i*)&gf_nibble_table[ b ][ 16 ]);
+	const __m128i nibble_mask = _mm_set1_epi8 (0x0f);
+	uint_fast16_t i = 0;
+
+	for (; (i + 16) <= len; i += 16) {
+		const __m128i src = _mm_loadu_si128 ((const __m128i*)&s[ i ]);
+		const __m128i dst = _mm_loadu_si128 ((const __m128i*)&d[ i ]);
+		__m128i tmp = _mm_shuffle_epi8 (lo, _mm_and_si128 (nibble_mask, src));
+		tmp = _mm_xor_si128 (tmp, _mm_shuffle_epi8 (hi, _mm_and_si128 (nibble_mask, _mm_srli_epi64 (src, 4))));
+		_mm_storeu_si128 ((__m128i*)&d[ i ], _mm_xor_si128 (dst, tmp));
+	}
+
+/* remaining */
+	if (i < len)
+		_pgm_gf_vec_addmul_scalar (&d[ i ], b, &s[ i ], len - i);
+}
+
+/* AVX2 - 32 bytes per VPSHUFB pair.
+ */
+
+GALOIS_TARGET("avx2")
+static
+void
+_pgm_gf_vec_addmul_avx2 (
+	pgm_gf8_t*	 restrict d,
+	const pgm_gf8_t		  b,
+	const pgm_gf8_t* restrict s,
+	uint16_t		  len
+	)
+{
+	const __m256i lo = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i*)&gf_nibble_table[ b ][  0 ]));
+	const __m256i hi = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i*)&gf_nibble_table[ b ][ 16 ]));
+	const __m256i nibble_mask = _mm256_set1_epi8 (0x0f);
+	uint_fast16_t i = 0;
+
+	for (; (i + 32) <= len; i += 32) {
+		const __m256i src = _mm256_loadu_si256 ((const __m256i*)&s[ i ]);
+		const __m256i dst = _mm256_loadu_si256 ((const __m256i*)&d[ i ]);
+		__m256i tmp = _mm256_shuffle_epi8 (lo, _mm256_and_si256 (nibble_mask, src));
+		tmp = _mm256_xor_si256 (tmp, _mm256_shuffle_epi8 (hi, _mm256_and_si256 (nibble_mask, _mm256_srli_epi64 (src, 4))));
+		_mm256_storeu_si256 ((__m256i*)&d[ i ], _mm256_xor_si256 (dst, tmp));
+	}
+
+/* remaining, VEX encoded to avoid an SSE transition penalty */
+	if ((i + 16) <= len) {
+		const __m128i src = _mm_loadu_si128 ((const __m128i*)&s[ i ]);
+		const __m128i dst = _mm_loadu_si128 ((const __m128i*)&d[ i ]);
+		__m128i tmp = _mm_shuffle_epi8 (_mm256_castsi256_si128 (lo), _mm_and_si128 (_mm256_castsi256_si128 (nibble_mask), src));
+		tmp = _mm_xor_si128 (tmp, _mm_shuffle_epi8 (_mm256_castsi256_si128 (hi), _mm_and_si128 (_mm256_castsi256_si128 (nibble_mask), _mm_srli_epi64 (src, 4))));
+		_mm_storeu_si128 ((__m128i*)&d[ i ], _mm_xor_si128 (dst, tmp));
+		i += 16;
+	}
+	_mm256_zeroupper ();
+	if (i < len)
+		_pgm_gf_vec_addmul_scalar (&d[ i ], b, &s[ i ], len - i);
+}
+
+/* AVX-512BW - 64 bytes per VPSHUFB pair, tail with a byte mask.
+ */
+
+GALOIS_TARGET("avx512f,avx512bw")
+static
+void
+_pgm_gf_vec_addmul_avx512bw (
+	pgm_gf8_t*	 restrict d,
+	const pgm_gf8_t		  b,
+	const pgm_gf8_t* restrict s,
+	uint16_t		  len
+	)
+{
+	const __m512i lo = _mm512_broadcast_i32x4 (_mm_loadu_si128 ((const __m128i*)&gf_nibble_table[ b ][  0 ]));
+	const __m512i hi = _mm512_broadcast_i32x4 (_mm_loadu_si128 ((const __m128i*)&gf_nibble_table[ b ][ 16 ]));
+	const __m512i nibble_mask = _mm512_set1_epi8 (0x0f);
+	uint_fast16_t i = 0;
+
+	for (; (i + 64) <= len; i += 64) {
+		const __m512i src = _mm512_loadu_si512 ((const void*)&s[ i ]);
+		const __m512i dst = _mm512_loadu_si512 ((const void*)&d[ i ]);
+		__m512i tmp = _mm512_shuffle_epi8 (lo, _mm512_and_si512 (nibble_mask, src));
+		tmp = _mm512_xor_si512 (tmp, _mm512_shuffle_epi8 (hi, _mm512_and_si512 (nibble_mask, _mm512_srli_epi64 (src, 4))));
+		_mm512_storeu_si512 ((void*)&d[ i ], _mm512_xor_si512 (dst, tmp));
+	}
+
+/* remaining */
+	if (i < len) {
+		const __mmask64 k = (__mmask64)((UINT64_C(1) << (len - i)) - 1);
+		const __m512i src = _mm512_maskz_loadu_epi8 (k, (const void*)&s[ i ]);
+		const __m512i dst = _mm512_maskz_loadu_epi8 (k, (const void*)&d[ i ]);
+		__m512i tmp = _mm512_shuffle_epi8 (lo, _mm512_and_si512 (nibble_mask, src));
+		tmp = _mm512_xor_si512 (tmp, _mm512_shuffle_epi8 (hi, _mm512_and_si512 (nibble_mask, _mm512_srli_epi64 (src, 4))));
+		_mm512_mask_storeu_epi8 ((void*)&d[ i ], k, _mm512_xor_si512 (dst, tmp));
+	}
+}
+
+/* GFNI - one affine transform per 32 bytes.
+ */
+
+GALOIS_TARGET("gfni,avx2")
+static
+void
+_pgm_gf_vec_addmul_gfni (
+	pgm_gf8_t*	 restrict d,
+	const pgm_gf8_t		  b,
+	const pgm_gf8_t* restrict s,
+	uint16_t		  len
+	)
+{
+	const __m256i matrix = _mm256_set1_epi64x ((long long)gf_affine_table[ b ]);
+	uint_fast16_t i = 0;
+
+	for (; (i + 32) <= len; i += 32) {
+		const __m256i src = _mm256_loadu_si256 ((const __m256i*)&s[ i ]);
+		const __m256i dst = _mm256_loadu_si256 ((const __m256i*)&d[ i ]);
+		_mm256_storeu_si256 ((__m256i*)&d[ i ], _mm256_xor_si256 (dst, _mm256_gf2p8affine_epi64_epi8 (src, matrix, 0)));
+	}
+
+/* remaining, VEX encoded to avoid an SSE transition penalty */
+	if ((i + 16) <= len) {
+		const __m128i src = _mm_loadu_si128 ((const __m128i*)&s[ i ]);
+		const __m128i dst = _mm_loadu_si128 ((const __m128i*)&d[ i ]);
+		_mm_storeu_si128 ((__m128i*)&d[ i ], _mm_xor_si128 (dst, _mm_gf2p8affine_epi64_epi8 (src, _mm256_castsi256_si128 (matrix), 0)));
+		i += 16;
+	}
+	_mm256_zeroupper ();
+	if (i < len)
+		_pgm_gf_vec_addmul_scalar (&d[ i ], b, &s[ i ], len - i);
+}
+
+/* GFNI with AVX-512BW - one affine transform per 64 bytes, tail with a byte mask.
+ */
+
+GALOIS_TARGET("gfni,avx512f,avx512bw")
+static
+void
+_pgm_gf_vec_addmul_gfni_avx512 (
+	pgm_gf8_t*	 restrict d,
+	const pgm_gf8_t		  b,
+	const pgm_gf8_t* restrict s,
+	uint16_t		  len
+	)
+{
+	const __m512i matrix = _mm512_set1_epi64 ((long long)gf_affine_table[ b ]);
+	uint_fast16_t i = 0;
+
+	for (; (i + 64) <= len; i += 64) {
+		const __m512i src = _mm512_loadu_si512 ((const void*)&s[ i ]);
+		const __m512i dst = _mm512_loadu_si512 ((const void*)&d[ i ]);
+		_mm512_storeu_si512 ((void*)&d[ i ], _mm512_xor_si512 (dst, _mm512_gf2p8affine_epi64_epi8 (src, matrix, 0)));
+	}
+
+/* remaining */
+	if (i < len) {
+		const __mmask64 k = (__mmask64)((UINT64_C(1) << (len - i)) - 1);
+		const __m512i src = _mm512_maskz_loadu_epi8 (k, (const void*)&s[ i ]);
+		const __m512i dst = _mm512_maskz_loadu_epi8 (k, (const void*)&d[ i ]);
+		_mm512_mask_storeu_epi8 ((void*)&d[ i ], k, _mm512_xor_si512 (dst, _mm512_gf2p8affine_epi64_epi8 (src, matrix, 0)));
+	}
+}
+
+/* Fill the per multiplier tables, GF2P8AFFINEQB computes result bit i as the
+ * parity of source byte AND matrix byte 7 - i.
+ */
+
+static
+void
+_pgm_gf_tables_init (void)
+{
+	for (unsigned b = 0; b < PGM_GF_NO_ELEMENTS; b++) {
+		for (unsigned x = 0; x < 16; x++) {
+			gf_nibble_table[ b ][ x      ] = pgm_gfmul ((pgm_gf8_t)b, (pgm_gf8_t)x);
+			gf_nibble_table[ b ][ x + 16 ] = pgm_gfmul ((pgm_gf8_t)b, (pgm_gf8_t)(x << 4));
+		}
+		uint64_t matrix = 0;
+		for (unsigned j = 0; j < 8; j++) {
+			const pgm_gf8_t column = pgm_gfmul ((pgm_gf8_t)b, (pgm_gf8_t)(1 << j));
+			for (unsigned i = 0; i < 8; i++)
+				if (column & (1 << i))
+					matrix |= UINT64_C(1) << ((8 * (7 - i)) + j);
+		}
+		gf_affine_table[ b ] = matrix;
+	}
+}
+#endif /* USE_GALOIS_SIMD */
+
+/* Select the widest available kernel for GF(2⁸) multiply-add.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_rs_init (const pgm_cpu_t* cpu)
+{
+#ifdef USE_GALOIS_SIMD
+	_pgm_gf_tables_init ();
+	if (cpu->has_gfni && cpu->has_avx512bw) {
+		pgm_minor (_("Using GFNI with AVX-512BW instructions for Reed-Solomon."));
+		gf_vec_addmul = _pgm_gf_vec_addmul_gfni_avx512;
+		return;
+	}
+	if (cpu->has_gfni && cpu->has_avx2) {
+		pgm_minor (_("Using GFNI instructions for Reed-Solomon."));
+		gf_vec_addmul = _pgm_gf_vec_addmul_gfni;
+		return;
+	}
+	if (cpu->has_avx512bw) {
+		pgm_minor (_("Using AVX-512BW instructions for Reed-Solomon."));
+		gf_vec_addmul = _pgm_gf_vec_addmul_avx512bw;
+		return;
+	}
+	if (cpu->has_avx2) {
+		pgm_minor (_("Using AVX2 instructions for Reed-Solomon."));
+		gf_vec_addmul = _pgm_gf_vec_addmul_avx2;
+		return;
+	}
+	if (cpu->has_ssse3) {
+		pgm_minor (_("Using SSSE3 instructions for Reed-Solomon."));
+		gf_vec_addmul = _pgm_gf_vec_addmul_ssse3;
+		return;
+	}
+#else
+	(void)cpu;
+#endif
+	gf_vec_addmul = _pgm_gf_vec_addmul_scalar;
+}
+
 /* Basic matrix multiplication.
  *
  * C = AB
@@ -531,6 +818,141 @@ pgm_rs_encode (
 	}
 }
 
+/* create several parity packets in one pass over the original data packets.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_rs_encode_multi (
+	pgm_rs_t*	  restrict rs,
+	const pgm_gf8_t** restrict src,		/* length rs_t::k */
+	const uint8_t*	  restrict offsets,	/* parity packet offsets, length count */
+	const uint8_t		   count,
+	pgm_gf8_t**	  restrict dst,		/* length count */
+	const uint16_t		   len
+	)
+{
+	pgm_assert (NULL != rs);
+	pgm_assert (NULL != src);
+	pgm_assert (NULL != offsets);
+	pgm_assert (count > 0);
+	pgm_assert (NULL != dst);
+	pgm_assert (len > 0);
+
+#ifndef _MSC_VER
+	pgm_gf8_t M[ count * rs->k ];
+#else
+	pgm_gf8_t* M = pgm_newa (pgm_gf8_t, count * rs->k);
+#endif
+
+	for (uint_fast8_t j = 0; j < count; j++)
+	{
+		pgm_assert (offsets[ j ] >= rs->k && offsets[ j ] < rs->n);	/* parity packet */
+		memcpy (&M[ j * rs->k ], &rs->GM[ offsets[ j ] * rs->k ], rs->k * sizeof(pgm_gf8_t));
+		memset (dst[ j ], 0, len);
+	}
+	_pgm_gf_mat_addmul (dst, M, src, count, rs->k, len);
+}
+
+/* add the contribution of one original data packet to a parity packet,
+ * accumulating every offset of the block is equivalent to pgm_rs_encode()
+ * without requiring the entire block at once.
+ *
+ * parity packet must be zeroed before the first contribution.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_rs_encode_accumulate (
+	pgm_rs_t*	 restrict rs,
+	const pgm_gf8_t* restrict src,		/* original data packet */
+	const uint8_t		  src_offset,	/* 0 <= src_offset < k */
+	const uint8_t		  offset,
+	pgm_gf8_t*	 restrict dst,
+	const uint16_t		  len
+	)
+{
+	pgm_assert (NULL != rs);
+	pgm_assert (NULL != src);
+	pgm_assert (src_offset < rs->k);
+	pgm_assert (offset >= rs->k && offset < rs->n);	/* parity packet */
+	pgm_assert (NULL != dst);
+
+	const pgm_gf8_t c = rs->GM[ (offset * rs->k) + src_offset ];
+	_pgm_gf_vec_addmul (dst, c, src, len);
+}
+
+/* create recovery matrix for erased original data packets.
+ *
+ * Only the e erased rows of the inverse are required, each original data
+ * packet x_i that was received contributes directly.  With parity packet
+ * p_a at erased offset E_a,
+ *
+ * p_a = ∑ GM_{p_a,E_b} × x_{E_b} + ∑ GM_{p_a,i} × x_i
+ *       b                       i∉E
+ *
+ * hence with A_{a,b} = GM_{p_a,E_b} only the e-by-e matrix A need be
+ * inverted,
+ *
+ * x_{E_a} = ∑ A⁻¹_{a,b} × (p_b + ∑ GM_{p_b,i} × x_i)
+ *           b                  i∉E
+ *
+ * rs_t::RM is populated as e-by-k with the coefficient for each packet of
+ * the block, parity packets taking the place of their erased offset.
+ *
+ * returns count of erasures.
+ */
+
+static
+uint8_t
+_pgm_rs_recovery_matrix (
+	pgm_rs_t*      restrict rs,
+	const uint8_t* restrict offsets,	/* offsets within FEC block */
+	uint8_t*       restrict erasures	/* length rs_t::k */
+	)
+{
+	uint8_t e = 0;
+
+	for (uint_fast8_t i = 0; i < rs->k; i++)
+	{
+		if (offsets[ i ] >= rs->k)
+			erasures[ e++ ] = i;
+	}
+	if (0 == e)
+		return 0;
+
+#ifndef _MSC_VER
+	pgm_gf8_t A[ e * e ];
+#else
+	pgm_gf8_t* A = pgm_newa (pgm_gf8_t, e * e);
+#endif
+
+	for (uint_fast8_t a = 0; a < e; a++)
+	{
+		const pgm_gf8_t* GM_p = &rs->GM[ offsets[ erasures[ a ] ] * rs->k ];
+		for (uint_fast8_t b = 0; b < e; b++)
+			A[ (a * e) + b ] = GM_p[ erasures[ b ] ];
+	}
+
+/* invert */
+	_pgm_matinv (A, e);
+
+	memset (rs->RM, 0, e * rs->k * sizeof(pgm_gf8_t));
+	for (uint_fast8_t a = 0; a < e; a++)
+	{
+		pgm_gf8_t* RM_a = &rs->RM[ a * rs->k ];
+		for (uint_fast8_t b = 0; b < e; b++)
+		{
+			const pgm_gf8_t c = A[ (a * e) + b ];
+			_pgm_gf_vec_addmul (RM_a, c, &rs->GM[ offsets[ erasures[ b ] ] * rs->k ], rs->k);
+		}
+/* parity packets replace the erased contribution */
+		for (uint_fast8_t b = 0; b < e; b++)
+			RM_a[ erasures[ b ] ] = A[ (a * e) + b ];
+	}
+	return e;
+}
+
 /* original data block of packets with missing packet entries replaced
  * with on-demand parity packets.
  */
@@ -549,54 +971,37 @@ pgm_rs_decode_parity_inline (
 	pgm_assert (NULL != offsets);
 	pgm_assert (len > 0);
 
-/* create new recovery matrix from generator
- */
-	for (uint_fast8_t i = 0; i < rs->k; i++)
-	{
-		if (offsets[i] < rs->k) {
-			memset (&rs->RM[ i * rs->k ], 0, rs->k * sizeof(pgm_gf8_t));
-			rs->RM[ (i * rs->k) + i ] = 1;
-			continue;
-		}
-		memcpy (&rs->RM[ i * rs->k ], &rs->GM[ offsets[ i ] * rs->k ], rs->k * sizeof(pgm_gf8_t));
-	}
-
-/* invert */
-	_pgm_matinv (rs->RM, rs->k);
-
 #ifndef _MSC_VER
+	uint8_t erasures[ rs->k ];
 	pgm_gf8_t* repairs[ rs->k ];
 #else
+	uint8_t* erasures = pgm_newa (uint8_t, rs->k);
 	pgm_gf8_t** repairs = pgm_newa (pgm_gf8_t*, rs->k);
 #endif
 
-/* multiply out, through the length of erasures[] */
-	for (uint_fast8_t j = 0; j < rs->k; j++)
-	{
-		if (offsets[ j ] < rs->k)
-			continue;
+/* create new recovery matrix from generator
+ */
+	const uint8_t e = _pgm_rs_recovery_matrix (rs, offsets, erasures);
+	if (0 == e)
+		return;
 
+	for (uint_fast8_t j = 0; j < e; j++)
+	{
 #ifdef USE_MALLOC_MATRIX
-		pgm_gf8_t* erasure = repairs[ j ] = pgm_malloc0 (len);
+		repairs[ j ] = pgm_malloc0 (len);
 #else
-		pgm_gf8_t* erasure = repairs[ j ] = pgm_alloca (len);
-		memset (erasure, 0, len);
+		repairs[ j ] = pgm_alloca (len);
+		memset (repairs[ j ], 0, len);
 #endif
-		for (uint_fast8_t i = 0; i < rs->k; i++)
-		{
-			pgm_gf8_t* src = block[ i ];
-			pgm_gf8_t c = rs->RM[ (j * rs->k) + i ];
-			_pgm_gf_vec_addmul (erasure, c, src, len);
-		}
 	}
 
+/* multiply out all erasures in one pass over the block */
+	_pgm_gf_mat_addmul (repairs, rs->RM, (const pgm_gf8_t**)block, e, rs->k, len);
+
 /* move repaired over parity packets */
-	for (uint_fast8_t j = 0; j < rs->k; j++)
+	for (uint_fast8_t j = 0; j < e; j++)
 	{
-		if (offsets[ j ] < rs->k)
-			continue;
-
-		memcpy (block[ j ], repairs[ j ], len * sizeof(pgm_gf8_t));
+		memcpy (block[ erasures[ j ] ], repairs[ j ], len * sizeof(pgm_gf8_t));
 #ifdef USE_MALLOC_MATRIX
 		pgm_free (repairs[ j ]);
 #endif
@@ -622,40 +1027,36 @@ pgm_rs_decode_parity_appended (
 	pgm_assert (NULL != offsets);
 	pgm_assert (len > 0);
 
+#ifndef _MSC_VER
+	uint8_t erasures[ rs->k ];
+	pgm_gf8_t* repairs[ rs->k ];
+	const pgm_gf8_t* src[ rs->k ];
+#else
+	uint8_t* erasures = pgm_newa (uint8_t, rs->k);
+	pgm_gf8_t** repairs = pgm_newa (pgm_gf8_t*, rs->k);
+	const pgm_gf8_t** src = pgm_newa (const pgm_gf8_t*, rs->k);
+#endif
+
 /* create new recovery matrix from generator
  */
+	const uint8_t e = _pgm_rs_recovery_matrix (rs, offsets, erasures);
+	if (0 == e)
+		return;
+
+/* parity packets are appended in order of erasure */
+	uint_fast8_t p = rs->k;
 	for (uint_fast8_t i = 0; i < rs->k; i++)
 	{
-		if (offsets[i] < rs->k) {
-			memset (&rs->RM[ i * rs->k ], 0, rs->k * sizeof(pgm_gf8_t));
-			rs->RM[ (i * rs->k) + i ] = 1;
-			continue;
-		}
-		memcpy (&rs->RM[ i * rs->k ], &rs->GM[ offsets[ i ] * rs->k ], rs->k * sizeof(pgm_gf8_t));
+		if (offsets[ i ] < rs->k)
+			src[ i ] = block[ i ];
+		else
+			src[ i ] = block[ p++ ];
 	}
+	for (uint_fast8_t j = 0; j < e; j++)
+		repairs[ j ] = block[ erasures[ j ] ];
 
-/* invert */
-	_pgm_matinv (rs->RM, rs->k);
-
-/* multiply out, through the length of erasures[] */
-	for (uint_fast8_t j = 0; j < rs->k; j++)
-	{
-		if (offsets[ j ] < rs->k)
-			continue;
-
-		uint_fast8_t p = rs->k;
-		pgm_gf8_t* erasure = block[ j ];
-		for (uint_fast8_t i = 0; i < rs->k; i++)
-		{
-			pgm_gf8_t* src;
-			if (offsets[ i ] < rs->k)
-				src = block[ i ];
-			else
-				src = block[ p++ ];
-			const pgm_gf8_t c = rs->RM[ (j * rs->k) + i ];
-			_pgm_gf_vec_addmul (erasure, c, src, len);
-		}
-	}
+/* multiply out all erasures in one pass over the block */
+	_pgm_gf_mat_addmul (repairs, rs->RM, src, e, rs->k, len);
 }
 
 /* eof */
@@ -0,0 +1,384 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * performance tests for Reed-Solomon encoding and decoding
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+
+/* mock state */
+
+#define TEST_TPDU		1500
+#define TEST_BYTES		(64 * 1024 * 1024)	/* source bytes per measurement */
+
+static unsigned perf_k	= 0;		/* transmission group size */
+static unsigned perf_h	= 0;		/* parity packets per group */
+
+
+static
+void
+mock_setup_8_2 (void)
+{
+	perf_k	= 8;
+	perf_h	= 2;
+}
+
+static
+void
+mock_setup_16_4 (void)
+{
+	perf_k	= 16;
+	perf_h	= 4;
+}
+
+static
+void
+mock_setup_32_4 (void)
+{
+	perf_k	= 32;
+	perf_h	= 4;
+}
+
+static
+void
+mock_setup_64_8 (void)
+{
+	perf_k	= 64;
+	perf_h	= 8;
+}
+
+static
+void
+mock_setup_223_32 (void)
+{
+	perf_k	= 223;
+	perf_h	= 32;
+}
+
+/* mock functions for external references */
+
+size_t
+pgm_transport_pkt_offset2 (
+	const bool			can_fragment,
+	const bool			use_pgmcc
+	)
+{
+	return 0;
+}
+
+#define REED_SOLOMON_DEBUG
+#include "reed_solomon.c"
+
+PGM_GNUC_INTERNAL
+int
+pgm_get_nprocs (void)
+{
+	return 1;
+}
+
+static pgm_cpu_t perf_cpu;
+
+static
+void
+mock_setup (void)
+{
+	g_assert (pgm_time_init (NULL));
+	pgm_cpuid (&perf_cpu);
+	pgm_rs_init (&perf_cpu);
+}
+
+static
+void
+mock_teardown (void)
+{
+/* restore preferred kernel */
+	pgm_rs_init (&perf_cpu);
+	g_assert (pgm_time_shutdown ());
+}
+
+/* target:
+ *	void
+ *	pgm_rs_encode (
+ *		pgm_rs_t*		rs,
+ *		const pgm_gf8_t**	src,
+ *		const uint8_t		offset,
+ *		pgm_gf8_t*		dst,
+ *		const uint16_t		len
+ *	)
+ *
+ *	void
+ *	pgm_rs_encode_multi (
+ *		pgm_rs_t*		rs,
+ *		const pgm_gf8_t**	src,
+ *		const uint8_t*		offsets,
+ *		const uint8_t		count,
+ *		pgm_gf8_t**		dst,
+ *		const uint16_t		len
+ *	)
+ *
+ *	void
+ *	pgm_rs_decode_parity_inline (
+ *		pgm_rs_t*		rs,
+ *		pgm_gf8_t**		block,
+ *		const uint8_t*		offsets,
+ *		const uint16_t		len
+ *	)
+ *
+ * RS(255, k) with h parity packets, throughput counts source bytes, i.e. k
+ * packets encoded into h parities, or recovered with h erasures.
+ */
+
+static
+void
+run_codec (
+	const char*	name
+	)
+{
+	const unsigned k = perf_k, h = perf_h;
+	const unsigned iterations = MAX(1, TEST_BYTES / (k * TEST_TPDU));
+	pgm_gf8_t* source[ k ];
+	pgm_gf8_t* parity[ h ];
+	pgm_gf8_t* block[ k ];
+	guint8 offsets[ k ];
+	guint8 parity_offsets[ h ];
+	pgm_rs_t rs;
+	pgm_time_t start, check;
+
+	pgm_rs_create (&rs, PGM_RS_DEFAULT_N, k);
+	for (unsigned i = 0, j = 0; i < k; i++) {
+		source[ i ] = g_malloc (TEST_TPDU);
+		block[ i ]  = g_malloc (TEST_TPDU);
+		for (unsigned x = 0; x < TEST_TPDU; x++) {
+			j = j * 1103515245 + 12345;
+			source[ i ][ x ] = j >> 16;
+		}
+	}
+	for (unsigned i = 0; i < h; i++)
+		parity[ i ] = g_malloc (TEST_TPDU);
+
+/* encode */
+	start = pgm_time_update_now();
+	for (unsigned i = iterations; i; i--) {
+		for (unsigned j = 0; j < h; j++)
+			pgm_rs_encode (&rs, (const pgm_gf8_t**)source, k + j, parity[ j ], TEST_TPDU);
+	}
+	check = pgm_time_update_now();
+	g_message ("%s/encode/%u+%u: elapsed time %" PGM_TIME_FORMAT " us, unit time %" PGM_TIME_FORMAT " us, %.2f GB/s",
+		name, k, h,
+		(guint64)(check - start),
+		(guint64)((check - start) / iterations),
+		((double)iterations * k * TEST_TPDU) / (1000.0 * (double)MAX(1, check - start)));
+
+/* encode all parity rows in one sweep */
+	for (unsigned j = 0; j < h; j++)
+		parity_offsets[ j ] = k + j;
+	start = pgm_time_update_now();
+	for (unsigned i = iterations; i; i--)
+		pgm_rs_encode_multi (&rs, (const pgm_gf8_t**)source, parity_offsets, h, parity, TEST_TPDU);
+	check = pgm_time_update_now();
+	g_message ("%s/encode-multi/%u+%u: elapsed time %" PGM_TIME_FORMAT " us, unit time %" PGM_TIME_FORMAT " us, %.2f GB/s",
+		name, k, h,
+		(guint64)(check - start),
+		(guint64)((check - start) / iterations),
+		((double)iterations * k * TEST_TPDU) / (1000.0 * (double)MAX(1, check - start)));
+
+/* decode, erasing the leading h packets of the group */
+	for (unsigned i = 0; i < k; i++)
+		offsets[ i ] = (i < h) ? k + i : i;
+	start = pgm_time_update_now();
+	for (unsigned i = iterations; i; i--) {
+		for (unsigned j = 0; j < k; j++)
+			memcpy (block[ j ], (j < h) ? parity[ j ] : source[ j ], TEST_TPDU);
+		pgm_rs_decode_parity_inline (&rs, block, offsets, TEST_TPDU);
+	}
+	check = pgm_time_update_now();
+	g_message ("%s/decode/%u+%u: elapsed time %" PGM_TIME_FORMAT " us, unit time %" PGM_TIME_FORMAT " us, %.2f GB/s",
+		name, k, h,
+		(guint64)(check - start),
+		(guint64)((check - start) / iterations),
+		((double)iterations * k * TEST_TPDU) / (1000.0 * (double)MAX(1, check - start)));
+	for (unsigned i = 0; i < h; i++)
+		fail_unless (0 == memcmp (block[ i ], source[ i ], TEST_TPDU), "decode mismatch");
+
+	for (unsigned i = 0; i < h; i++)
+		g_free (parity[ i ]);
+	for (unsigned i = 0; i < k; i++) {
+		g_free (block[ i ]);
+		g_free (source[ i ]);
+	}
+	pgm_rs_destroy (&rs);
+}
+
+START_TEST (test_scalar)
+{
+	gf_vec_addmul = _pgm_gf_vec_addmul_scalar;
+	run_codec ("scalar");
+}
+END_TEST
+
+START_TEST (test_ssse3)
+{
+#ifdef USE_GALOIS_SIMD
+	if (!perf_cpu.has_ssse3)
+		return;
+	gf_vec_addmul = _pgm_gf_vec_addmul_ssse3;
+	run_codec ("ssse3");
+#endif
+}
+END_TEST
+
+START_TEST (test_avx2)
+{
+#ifdef USE_GALOIS_SIMD
+	if (!perf_cpu.has_avx2)
+		return;
+	gf_vec_addmul = _pgm_gf_vec_addmul_avx2;
+	run_codec ("avx2");
+#endif
+}
+END_TEST
+
+START_TEST (test_avx512bw)
+{
+#ifdef USE_GALOIS_SIMD
+	if (!perf_cpu.has_avx512bw)
+		return;
+	gf_vec_addmul = _pgm_gf_vec_addmul_avx512bw;
+	run_codec ("avx512bw");
+#endif
+}
+END_TEST
+
+START_TEST (test_gfni)
+{
+#ifdef USE_GALOIS_SIMD
+	if (!perf_cpu.has_gfni || !perf_cpu.has_avx2)
+		return;
+	gf_vec_addmul = _pgm_gf_vec_addmul_gfni;
+	run_codec ("gfni");
+#endif
+}
+END_TEST
+
+START_TEST (test_gfni_avx512)
+{
+#ifdef USE_GALOIS_SIMD
+	if (!perf_cpu.has_gfni || !perf_cpu.has_avx512bw)
+		return;
+	gf_vec_addmul = _pgm_gf_vec_addmul_gfni_avx512;
+	run_codec ("gfni-avx512");
+#endif
+}
+END_TEST
+
+
+static
+Suite*
+make_rs_performance_suite (void)
+{
+	Suite* s;
+
+	s = suite_create ("Reed-Solomon performance");
+
+	TCase* tc_8_2 = tcase_create ("8+2");
+	suite_add_tcase (s, tc_8_2);
+	tcase_add_checked_fixture (tc_8_2, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_8_2, mock_setup_8_2, NULL);
+	tcase_add_test (tc_8_2, test_scalar);
+	tcase_add_test (tc_8_2, test_ssse3);
+	tcase_add_test (tc_8_2, test_avx2);
+	tcase_add_test (tc_8_2, test_avx512bw);
+	tcase_add_test (tc_8_2, test_gfni);
+	tcase_add_test (tc_8_2, test_gfni_avx512);
+
+	TCase* tc_16_4 = tcase_create ("16+4");
+	suite_add_tcase (s, tc_16_4);
+	tcase_add_checked_fixture (tc_16_4, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_16_4, mock_setup_16_4, NULL);
+	tcase_add_test (tc_16_4, test_scalar);
+	tcase_add_test (tc_16_4, test_ssse3);
+	tcase_add_test (tc_16_4, test_avx2);
+	tcase_add_test (tc_16_4, test_avx512bw);
+	tcase_add_test (tc_16_4, test_gfni);
+	tcase_add_test (tc_16_4, test_gfni_avx512);
+
+	TCase* tc_32_4 = tcase_create ("32+4");
+	suite_add_tcase (s, tc_32_4);
+	tcase_add_checked_fixture (tc_32_4, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_32_4, mock_setup_32_4, NULL);
+	tcase_add_test (tc_32_4, test_scalar);
+	tcase_add_test (tc_32_4, test_ssse3);
+	tcase_add_test (tc_32_4, test_avx2);
+	tcase_add_test (tc_32_4, test_avx512bw);
+	tcase_add_test (tc_32_4, test_gfni);
+	tcase_add_test (tc_32_4, test_gfni_avx512);
+
+	TCase* tc_64_8 = tcase_create ("64+8");
+	suite_add_tcase (s, tc_64_8);
+	tcase_add_checked_fixture (tc_64_8, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_64_8, mock_setup_64_8, NULL);
+	tcase_add_test (tc_64_8, test_scalar);
+	tcase_add_test (tc_64_8, test_ssse3);
+	tcase_add_test (tc_64_8, test_avx2);
+	tcase_add_test (tc_64_8, test_avx512bw);
+	tcase_add_test (tc_64_8, test_gfni);
+	tcase_add_test (tc_64_8, test_gfni_avx512);
+
+/* maximum group size at the default n, recovery latency dominated by the
+ * recovery matrix and 32 repaired rows.
+ */
+	TCase* tc_223_32 = tcase_create ("223+32");
+	suite_add_tcase (s, tc_223_32);
+	tcase_add_checked_fixture (tc_223_32, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_223_32, mock_setup_223_32, NULL);
+	tcase_add_test (tc_223_32, test_scalar);
+	tcase_add_test (tc_223_32, test_ssse3);
+	tcase_add_test (tc_223_32, test_avx2);
+	tcase_add_test (tc_223_32, test_avx512bw);
+	tcase_add_test (tc_223_32, test_gfni);
+	tcase_add_test (tc_223_32, test_gfni_avx512);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_rs_performance_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
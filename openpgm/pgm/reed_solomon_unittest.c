@@ -56,6 +56,63 @@ pgm_get_nprocs (void)
 	return 1;
 }
 
+/* target:
+ *	void
+ *	pgm_rs_init (
+ *		const pgm_cpu_t*	cpu
+ *	)
+ *
+ * every kernel the processor supports must agree with the scalar kernel
+ * for any length and alignment.
+ */
+
+static
+void
+check_addmul (
+	void		(*kernel)(pgm_gf8_t*restrict, const pgm_gf8_t, const pgm_gf8_t*restrict, uint16_t),
+	const char*	name
+	)
+{
+	pgm_gf8_t src[ 300 ], expected[ 300 ], actual[ 300 ];
+	for (unsigned i = 0, j = 0; i < sizeof(src); i++) {
+		j = j * 1103515245 + 12345;
+		src[ i ] = j >> 16;
+	}
+	for (unsigned b = 1; b < PGM_GF_NO_ELEMENTS; b += 7) {
+		for (unsigned offset = 0; offset < 4; offset++) {
+			for (unsigned len = 0; len <= (sizeof(src) - offset); len += (len < 80) ? 1 : 13) {
+				memset (expected, 0xa5, sizeof(expected));
+				memset (actual, 0xa5, sizeof(actual));
+				_pgm_gf_vec_addmul_scalar (expected + offset, b, src + offset, len);
+				kernel (actual + offset, b, src + offset, len);
+				fail_unless (0 == memcmp (expected, actual, sizeof(actual)), "%s mismatch b=%u offset=%u len=%u", name, b, offset, len);
+			}
+		}
+	}
+}
+
+START_TEST (test_init_pass_001)
+{
+	pgm_cpu_t cpu;
+	pgm_cpuid (&cpu);
+	pgm_rs_init (&cpu);
+	fail_if (NULL == gf_vec_addmul, "init failed");
+#ifdef USE_GALOIS_SIMD
+	if (cpu.has_ssse3)
+		check_addmul (_pgm_gf_vec_addmul_ssse3, "ssse3");
+	if (cpu.has_avx2)
+		check_addmul (_pgm_gf_vec_addmul_avx2, "avx2");
+	if (cpu.has_avx512bw)
+		check_addmul (_pgm_gf_vec_addmul_avx512bw, "avx512bw");
+	if (cpu.has_gfni && cpu.has_avx2)
+		check_addmul (_pgm_gf_vec_addmul_gfni, "gfni");
+	if (cpu.has_gfni && cpu.has_avx512bw)
+		check_addmul (_pgm_gf_vec_addmul_gfni_avx512, "gfni-avx512");
+#endif
+	check_addmul (gf_vec_addmul, "selected");
+}
+END_TEST
+
 /* target:
  *	void
  *	pgm_rs_create (
@@ -134,6 +191,67 @@ START_TEST (test_encode_pass_001)
 }
 END_TEST
 
+/* accumulating each source packet matches a single encode */
+START_TEST (test_encode_accumulate_pass_001)
+{
+	pgm_rs_t rs;
+	const guint8 k = 8;
+	const guint16 packet_len = 100;
+	pgm_gf8_t* source_packets[k];
+	pgm_gf8_t* parity_packet = g_malloc0 (packet_len);
+	pgm_gf8_t* accumulated_packet = g_malloc0 (packet_len);
+	pgm_rs_create (&rs, 255, k);
+	for (unsigned i = 0, j = 0; i < k; i++) {
+		source_packets[i] = g_malloc0 (packet_len);
+		for (unsigned x = 0; x < packet_len; x++) {
+			j = j * 1103515245 + 12345;
+			source_packets[i][x] = j >> 16;
+		}
+	}
+	for (unsigned h = 0; h < 4; h++) {
+		pgm_rs_encode (&rs, (const pgm_gf8_t**)source_packets, k + h, parity_packet, packet_len);
+		memset (accumulated_packet, 0, packet_len);
+		for (unsigned i = 0; i < k; i++)
+			pgm_rs_encode_accumulate (&rs, source_packets[i], i, k + h, accumulated_packet, packet_len);
+		fail_unless (0 == memcmp (parity_packet, accumulated_packet, packet_len), "parity mismatch h=%u", h);
+	}
+	pgm_rs_destroy (&rs);
+}
+END_TEST
+
+/* encoding several rows in one sweep matches encoding each row */
+START_TEST (test_encode_multi_pass_001)
+{
+	pgm_rs_t rs;
+	const guint8 k = 223;
+	const guint8 h = 32;
+	const guint16 packet_len = 1500;
+	pgm_gf8_t* source_packets[k];
+	pgm_gf8_t* parity_packets[h];
+	guint8 parity_offsets[h];
+	pgm_gf8_t* parity_packet = g_malloc0 (packet_len);
+	pgm_rs_create (&rs, 255, k);
+	for (unsigned i = 0, j = 0; i < k; i++) {
+		source_packets[i] = g_malloc0 (packet_len);
+		for (unsigned x = 0; x < packet_len; x++) {
+			j = j * 1103515245 + 12345;
+			source_packets[i][x] = j >> 16;
+		}
+	}
+/* parity rows in arbitrary order */
+	for (unsigned j = 0; j < h; j++) {
+		parity_packets[j] = g_malloc0 (packet_len);
+		parity_offsets[j] = k + ((j * 7) % h);
+	}
+	pgm_rs_encode_multi (&rs, (const pgm_gf8_t**)source_packets, parity_offsets, h, parity_packets, packet_len);
+	for (unsigned j = 0; j < h; j++) {
+		pgm_rs_encode (&rs, (const pgm_gf8_t**)source_packets, parity_offsets[j], parity_packet, packet_len);
+		fail_unless (0 == memcmp (parity_packet, parity_packets[j], packet_len), "parity mismatch j=%u", j);
+	}
+	pgm_rs_destroy (&rs);
+}
+END_TEST
+
 START_TEST (test_encode_fail_001)
 {
 	pgm_rs_encode (NULL, NULL, 0, NULL, 0);
@@ -191,6 +309,41 @@ START_TEST (test_decode_parity_inline_pass_001)
 }
 END_TEST
 
+/* maximum group size with scattered erasures */
+START_TEST (test_decode_parity_inline_pass_002)
+{
+	pgm_rs_t rs;
+	const guint8 k = 223;
+	const guint8 h = 32;
+	const guint16 packet_len = 1500;
+	pgm_gf8_t* source_packets[k];
+	pgm_gf8_t* block[k];
+	guint8 offsets[k];
+	pgm_rs_create (&rs, 255, k);
+	for (unsigned i = 0, j = 0; i < k; i++) {
+		source_packets[i] = g_malloc0 (packet_len);
+		block[i] = g_malloc0 (packet_len);
+		offsets[i] = i;
+		for (unsigned x = 0; x < packet_len; x++) {
+			j = j * 1103515245 + 12345;
+			source_packets[i][x] = j >> 16;
+		}
+	}
+	for (unsigned j = 0; j < h; j++)
+		offsets[(j * 7) % k] = k + j;
+	for (unsigned i = 0; i < k; i++) {
+		if (offsets[i] < k)
+			memcpy (block[i], source_packets[i], packet_len);
+		else
+			pgm_rs_encode (&rs, (const pgm_gf8_t**)source_packets, offsets[i], block[i], packet_len);
+	}
+	pgm_rs_decode_parity_inline (&rs, block, offsets, packet_len);
+	pgm_rs_destroy (&rs);
+	for (unsigned i = 0; i < k; i++)
+		fail_unless (0 == memcmp (block[i], source_packets[i], packet_len), "repair mismatch i=%u", i);
+}
+END_TEST
+
 START_TEST (test_decode_parity_inline_fail_001)
 {
 	pgm_rs_decode_parity_inline (NULL, NULL, NULL, 0);
@@ -249,6 +402,43 @@ START_TEST (test_decode_parity_appended_pass_001)
 }
 END_TEST
 
+/* maximum group size with scattered erasures, parity appended in order */
+START_TEST (test_decode_parity_appended_pass_002)
+{
+	pgm_rs_t rs;
+	const guint8 k = 223;
+	const guint8 h = 32;
+	const guint16 packet_len = 1500;
+	pgm_gf8_t* source_packets[k];
+	pgm_gf8_t* block[k + h];
+	guint8 offsets[k];
+	pgm_rs_create (&rs, 255, k);
+	for (unsigned i = 0, j = 0; i < k; i++) {
+		source_packets[i] = g_malloc0 (packet_len);
+		block[i] = g_malloc0 (packet_len);
+		offsets[i] = i;
+		for (unsigned x = 0; x < packet_len; x++) {
+			j = j * 1103515245 + 12345;
+			source_packets[i][x] = j >> 16;
+		}
+	}
+	for (unsigned j = 0; j < h; j++)
+		offsets[(j * 7) % k] = k + j;
+	for (unsigned i = 0, p = k; i < k; i++) {
+		if (offsets[i] < k) {
+			memcpy (block[i], source_packets[i], packet_len);
+			continue;
+		}
+		block[p] = g_malloc0 (packet_len);
+		pgm_rs_encode (&rs, (const pgm_gf8_t**)source_packets, offsets[i], block[p++], packet_len);
+	}
+	pgm_rs_decode_parity_appended (&rs, block, offsets, packet_len);
+	pgm_rs_destroy (&rs);
+	for (unsigned i = 0; i < k; i++)
+		fail_unless (0 == memcmp (block[i], source_packets[i], packet_len), "repair mismatch i=%u", i);
+}
+END_TEST
+
 START_TEST (test_decode_parity_appended_fail_001)
 {
 	pgm_rs_decode_parity_appended (NULL, NULL, NULL, 0);
@@ -265,6 +455,10 @@ make_test_suite (void)
 
 	s = suite_create (__FILE__);
 
+	TCase* tc_init = tcase_create ("init");
+	suite_add_tcase (s, tc_init);
+	tcase_add_test (tc_init, test_init_pass_001);
+
 	TCase* tc_create = tcase_create ("create");
 	suite_add_tcase (s, tc_create);
 	tcase_add_test (tc_create, test_create_pass_001);
@@ -282,6 +476,8 @@ make_test_suite (void)
 	TCase* tc_encode = tcase_create ("encode");
 	suite_add_tcase (s, tc_encode);
 	tcase_add_test (tc_encode, test_encode_pass_001);
+	tcase_add_test (tc_encode, test_encode_accumulate_pass_001);
+	tcase_add_test (tc_encode, test_encode_multi_pass_001);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_encode, test_encode_fail_001, SIGABRT);
 #endif
@@ -289,6 +485,7 @@ make_test_suite (void)
 	TCase* tc_decode_parity_inline = tcase_create ("decode-parity-inline");
 	suite_add_tcase (s, tc_decode_parity_inline);
 	tcase_add_test (tc_decode_parity_inline, test_decode_parity_inline_pass_001);
+	tcase_add_test (tc_decode_parity_inline, test_decode_parity_inline_pass_002);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_decode_parity_inline, test_decode_parity_inline_fail_001, SIGABRT);
 #endif
@@ -296,6 +493,7 @@ make_test_suite (void)
 	TCase* tc_decode_parity_appended = tcase_create ("decode-parity-appended");
 	suite_add_tcase (s, tc_decode_parity_appended);
 	tcase_add_test (tc_decode_parity_appended, test_decode_parity_appended_pass_001);
+	tcase_add_test (tc_decode_parity_appended, test_decode_parity_appended_pass_002);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_decode_parity_appended, test_decode_parity_appended_fail_001, SIGABRT);
 #endif
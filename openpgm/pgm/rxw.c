@@ -56,9 +56,6 @@ _pgm_tsi_is_null (
 	return (0 == u->l[0] && 0 == u->l[1]);
 }
 
-/* sequence state must be smaller than PGM skbuff control buffer */
-PGM_STATIC_ASSERT(sizeof(struct pgm_rxw_state_t) <= sizeof(((struct pgm_sk_buff_t*)0)->cb));
-
 static void _pgm_rxw_define (pgm_rxw_t*const, const uint32_t);
 static void _pgm_rxw_update_trail (pgm_rxw_t*const, const uint32_t);
 static inline uint32_t _pgm_rxw_update_lead (pgm_rxw_t*const, const uint32_t, const pgm_time_t, const pgm_time_t);
@@ -72,12 +69,75 @@ static int _pgm_rxw_add_placeholder_range (pgm_rxw_t*const, const uint32_t, cons
 static void _pgm_rxw_unlink (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict);
 static uint32_t _pgm_rxw_remove_trail (pgm_rxw_t*const);
 static void _pgm_rxw_state (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict, const int);
-static inline void _pgm_rxw_shuffle_parity (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict);
+static inline struct pgm_sk_buff_t* _pgm_rxw_shuffle_parity (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict);
 static inline ssize_t _pgm_rxw_incoming_read (pgm_rxw_t*const restrict, struct pgm_msgv_t**restrict, uint32_t);
 static bool _pgm_rxw_is_apdu_complete (pgm_rxw_t*const, const uint32_t);
 static inline ssize_t _pgm_rxw_incoming_read_apdu (pgm_rxw_t*const restrict, struct pgm_msgv_t**restrict);
 static inline int _pgm_rxw_recovery_update (pgm_rxw_t*const, const uint32_t, const pgm_time_t);
 static inline int _pgm_rxw_recovery_append (pgm_rxw_t*const, const pgm_time_t, const pgm_time_t);
+static void _pgm_rxw_nak_schedule (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict);
+
+
+static inline
+unsigned
+_pgm_rxw_ctz64 (
+	const uint64_t		word
+	)
+{
+#if (__GNUC__ > 3) || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4)
+	return (unsigned)__builtin_ctzll (word);
+#else
+	unsigned i = 0;
+	while (!(word & (UINT64_C(1) << i)))
+		i++;
+	return i;
+#endif
+}
+
+/* record into the peer histogram and the socket total.
+ */
+
+static inline
+void
+_pgm_rxw_hdr_record (
+	pgm_rxw_t* const	window,
+	const int		histogram,
+	const uint64_t		value
+	)
+{
+	pgm_hdr_record (&window->peer_hdr[ histogram ], value);
+	pgm_hdr_record (&window->sock_hdr[ histogram ], value);
+}
+
+/* allocate a full size skbuff for reconstructed packets.
+ */
+
+static inline
+struct pgm_sk_buff_t*
+_pgm_rxw_alloc_skb (
+	pgm_rxw_t* const	window
+	)
+{
+	if (PGM_LIKELY(NULL != window->skb_pool))
+		return pgm_skb_pool_alloc (window->skb_pool);
+	return pgm_alloc_skb (window->max_tpdu);
+}
+
+/* allocate a metadata only skbuff for a missing or lost sequence number, the
+ * control buffer carries the recovery state and the placeholder is replaced
+ * whole when RDATA or parity arrives.
+ */
+
+static inline
+struct pgm_sk_buff_t*
+_pgm_rxw_alloc_placeholder (
+	pgm_rxw_t* const	window
+	)
+{
+	if (PGM_LIKELY(NULL != window->placeholder_pool))
+		return pgm_skb_pool_alloc (window->placeholder_pool);
+	return pgm_alloc_skb (0);
+}
 
 
 /* returns the pointer at the given index of the window.
@@ -98,8 +158,7 @@ _pgm_rxw_peek (
 
 	if (pgm_uint32_gte (sequence, window->trail) && pgm_uint32_lte (sequence, window->lead))
 	{
-		const uint_fast32_t index_ = sequence % pgm_rxw_max_length (window);
-		struct pgm_sk_buff_t* skb = window->pdata[index_];
+		struct pgm_sk_buff_t* skb = window->pdata[ sequence & window->mask ];
 /* availability only guaranteed inside commit window */
 		if (pgm_uint32_lt (sequence, window->commit_lead)) {
 			pgm_assert (NULL != skb);
@@ -112,6 +171,41 @@ _pgm_rxw_peek (
 	return NULL;
 }
 
+/* packet state of a sequence inside the window, read without touching the
+ * skbuff.
+ */
+
+static inline
+int
+_pgm_rxw_pkt_state (
+	const pgm_rxw_t* const	window,
+	const uint32_t		sequence
+	)
+{
+	return window->pkt_states[ sequence & window->mask ];
+}
+
+/* returns TRUE if the sequence holds original or parity payload rather than
+ * a placeholder for missing data.
+ */
+
+static inline
+bool
+_pgm_rxw_has_payload (
+	const pgm_rxw_t* const	window,
+	const uint32_t		sequence
+	)
+{
+	switch (_pgm_rxw_pkt_state (window, sequence)) {
+	case PGM_PKT_STATE_HAVE_DATA:
+	case PGM_PKT_STATE_HAVE_PARITY:
+	case PGM_PKT_STATE_COMMIT_DATA:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 /* sections of the receive window:
  * 
  *  |     Commit       |   Incoming   |
@@ -202,7 +296,18 @@ pgm_rxw_create (
 /* calculate receive window parameters */
 	pgm_assert (sqns || (secs && max_rte));
 	const unsigned alloc_sqns = sqns ? sqns : (unsigned)( (secs * max_rte) / tpdu_size );
-	window = pgm_malloc0 (sizeof(pgm_rxw_t) + ( alloc_sqns * sizeof(struct pgm_sk_buff_t*) ));
+/* pointer array rounded up to a power of two for mask indexing, followed by
+ * the BACK-OFF bitmap, the recovery state and one byte of packet state per
+ * entry.
+ */
+	const uint32_t pdata_len = (uint32_t)pgm_nearest_power (1, alloc_sqns);
+	const uint32_t nak_map_len = (pdata_len + 63) / 64;
+	window = pgm_malloc0 (sizeof(pgm_rxw_t) +
+			      ( pdata_len * (sizeof(struct pgm_sk_buff_t*) + sizeof(pgm_rxw_state_t) + sizeof(uint8_t)) ) +
+			      ( nak_map_len * sizeof(uint64_t) ));
+	window->nak_map = (uint64_t*)(window->pdata + pdata_len);
+	window->states = (pgm_rxw_state_t*)(window->nak_map + nak_map_len);
+	window->pkt_states = (uint8_t*)(window->states + pdata_len);
 
 	window->tsi		= tsi;
 	window->max_tpdu	= tpdu_size;
@@ -227,6 +332,7 @@ pgm_rxw_create (
 
 /* pointer array */
 	window->alloc = alloc_sqns;
+	window->mask = pdata_len - 1;
 
 /* post-conditions */
 	pgm_assert_cmpuint (pgm_rxw_max_length (window), ==, alloc_sqns);
@@ -302,7 +408,6 @@ pgm_rxw_add (
 	const pgm_time_t		     nak_rb_expiry	/* calculated expiry time for this skb */
 	)
 {
-	pgm_rxw_state_t* const state = (pgm_rxw_state_t*)&skb->cb;
 	int status;
 
 /* pre-conditions */
@@ -371,20 +476,21 @@ pgm_rxw_add (
 			return _pgm_rxw_insert (window, skb);
 		}
 
-		const struct pgm_sk_buff_t* const first_skb = _pgm_rxw_peek (window, _pgm_rxw_tg_sqn (window, skb->sequence));
-		const pgm_rxw_state_t* const first_state = (const pgm_rxw_state_t*)&first_skb->cb;
+		const uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, skb->sequence);
 
-		if (_pgm_rxw_tg_sqn (window, skb->sequence) == _pgm_rxw_tg_sqn (window, window->lead)) {
+		if (tg_sqn == _pgm_rxw_tg_sqn (window, window->lead)) {
+			const pgm_rxw_state_t* const first_state = _pgm_rxw_peek (window, tg_sqn) ? pgm_rxw_recovery_state (window, tg_sqn) : NULL;
 			window->has_event = 1;
 			if (NULL == first_state || first_state->is_contiguous) {
-				state->is_contiguous = 1;
-				return _pgm_rxw_append (window, skb, now);
+				status = _pgm_rxw_append (window, skb, now);
+				if (PGM_RXW_APPENDED == status)
+					pgm_rxw_recovery_state (window, skb->sequence)->is_contiguous = 1;
+				return status;
 			} else
 				return _pgm_rxw_insert (window, skb);
 		}
 
-		pgm_assert (NULL != first_state);
-		status = _pgm_rxw_add_placeholder_range (window, _pgm_rxw_tg_sqn (window, skb->sequence), now, nak_rb_expiry);
+		status = _pgm_rxw_add_placeholder_range (window, tg_sqn, now, nak_rb_expiry);
 	}
 	else
 	{
@@ -402,9 +508,10 @@ pgm_rxw_add (
 
 		if (skb->sequence == pgm_rxw_next_lead (window)) {
 			window->has_event = 1;
-			if (_pgm_rxw_is_first_of_tg_sqn (window, skb->sequence))
-				state->is_contiguous = 1;
-			return _pgm_rxw_append (window, skb, now);
+			status = _pgm_rxw_append (window, skb, now);
+			if (PGM_RXW_APPENDED == status && _pgm_rxw_is_first_of_tg_sqn (window, skb->sequence))
+				pgm_rxw_recovery_state (window, skb->sequence)->is_contiguous = 1;
+			return status;
 		}
 
 		status = _pgm_rxw_add_placeholder_range (window, skb->sequence, now, nak_rb_expiry);
@@ -554,14 +661,9 @@ _pgm_rxw_update_trail (
 	     pgm_uint32_gt (window->rxw_trail, sequence) && pgm_uint32_gte (window->lead, sequence);
 	     sequence++)
 	{
-		struct pgm_sk_buff_t* skb;
-		pgm_rxw_state_t* state;
-
-		skb = _pgm_rxw_peek (window, sequence);
-		pgm_assert (NULL != skb);
-		state = (pgm_rxw_state_t*)&skb->cb;
+		pgm_assert (NULL != _pgm_rxw_peek (window, sequence));
 
-		switch (state->pkt_state) {
+		switch (_pgm_rxw_pkt_state (window, sequence)) {
 		case PGM_PKT_STATE_HAVE_DATA:
 		case PGM_PKT_STATE_HAVE_PARITY:
 		case PGM_PKT_STATE_LOST_DATA:
@@ -638,24 +740,22 @@ _pgm_rxw_add_placeholder (
  */
 	window->data_loss = window->ack_c_p + pgm_fp16mul ((pgm_fp16 (1) - window->ack_c_p), window->data_loss);
 
-	skb			= pgm_alloc_skb (window->max_tpdu);
-	state			= (pgm_rxw_state_t*)&skb->cb;
+	skb			= _pgm_rxw_alloc_placeholder (window);
 	skb->tstamp		= now;
 	skb->sequence		= window->lead;
+	state			= pgm_rxw_recovery_state (window, skb->sequence);
+	memset (state, 0, sizeof(pgm_rxw_state_t));
 	state->timer_expiry	= nak_rb_expiry;
 
 	if (!_pgm_rxw_is_first_of_tg_sqn (window, skb->sequence))
 	{
-		struct pgm_sk_buff_t* first_skb = _pgm_rxw_peek (window, _pgm_rxw_tg_sqn (window, skb->sequence));
-		if (first_skb) {
-			pgm_rxw_state_t* first_state = (pgm_rxw_state_t*)&first_skb->cb;
-			first_state->is_contiguous = 0;
-		}
+		const uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, skb->sequence);
+		if (_pgm_rxw_peek (window, tg_sqn))
+			pgm_rxw_recovery_state (window, tg_sqn)->is_contiguous = 0;
 	}
 
 /* add skb to window */
-	const uint_fast32_t index_	= skb->sequence % pgm_rxw_max_length (window);
-	window->pdata[index_]		= skb;
+	window->pdata[ skb->sequence & window->mask ] = skb;
 
 	pgm_rxw_state (window, skb, PGM_PKT_STATE_BACK_OFF);
 
@@ -766,7 +866,8 @@ _pgm_rxw_update_lead (
 	return lost;
 }
 
-/* checks whether an APDU is unrecoverable due to lost TPDUs.
+/* checks whether an APDU is unrecoverable due to lost TPDUs, skb is an
+ * incoming packet not yet in the window.
  */
 
 static inline
@@ -776,16 +877,10 @@ _pgm_rxw_is_apdu_lost (
 	struct pgm_sk_buff_t* const restrict skb
 	)
 {
-	const pgm_rxw_state_t* state = (pgm_rxw_state_t*)&skb->cb;
-
 /* pre-conditions */
 	pgm_assert (NULL != window);
 	pgm_assert (NULL != skb);
 
-/* lost is lost */
-	if (PGM_PKT_STATE_LOST_DATA == state->pkt_state)
-		return TRUE;
-
 /* by definition, a single-TPDU APDU is complete */
 	if (!skb->pgm_opt_fragment)
 		return FALSE;
@@ -801,8 +896,7 @@ _pgm_rxw_is_apdu_lost (
 	if (NULL == first_skb)
 		return TRUE;
 
-	const pgm_rxw_state_t* first_state = (const pgm_rxw_state_t*)&first_skb->cb;
-	if (PGM_PKT_STATE_LOST_DATA == first_state->pkt_state)
+	if (PGM_PKT_STATE_LOST_DATA == _pgm_rxw_pkt_state (window, apdu_first_sqn))
 		return TRUE;
 
 	return FALSE;
@@ -819,26 +913,26 @@ _pgm_rxw_find_missing (
 	const uint32_t			tg_sqn		/* tg_sqn | pkt_sqn */
 	)
 {
-	struct pgm_sk_buff_t* skb;
-	pgm_rxw_state_t* state;
-
 /* pre-conditions */
 	pgm_assert (NULL != window);
 
-	for (uint32_t i = tg_sqn, j = 0; j < window->tg_size; i++, j++)
+/* group already partially purged cannot be reconstructed */
+	if (pgm_uint32_lt (tg_sqn, window->trail))
+		return NULL;
+
+	for (uint32_t i = tg_sqn, j = 0; j < window->tg_size && pgm_uint32_lte (i, window->lead); i++, j++)
 	{
-		skb = _pgm_rxw_peek (window, i);
-		pgm_assert (NULL != skb);
-		state = (pgm_rxw_state_t*)&skb->cb;
-		switch (state->pkt_state) {
+		pgm_assert (NULL != _pgm_rxw_peek (window, i));
+		switch (_pgm_rxw_pkt_state (window, i)) {
 		case PGM_PKT_STATE_BACK_OFF:
 		case PGM_PKT_STATE_WAIT_NCF:
 		case PGM_PKT_STATE_WAIT_DATA:
 		case PGM_PKT_STATE_LOST_DATA:
-			return skb;
+			return _pgm_rxw_peek (window, i);
 
 		case PGM_PKT_STATE_HAVE_DATA:
 		case PGM_PKT_STATE_HAVE_PARITY:
+		case PGM_PKT_STATE_COMMIT_DATA:
 			break;
 
 		default: pgm_assert_not_reached(); break;
@@ -878,6 +972,8 @@ _pgm_rxw_is_invalid_var_pktlen (
 	first_skb = _pgm_rxw_peek (window, tg_sqn);
 	if (NULL == first_skb)
 		return TRUE;	/* transmission group unrecoverable */
+	if (!_pgm_rxw_has_payload (window, tg_sqn))
+		return FALSE;	/* nothing to compare against yet */
 
 	if (first_skb->len == skb->len)
 		return FALSE;
@@ -924,6 +1020,8 @@ _pgm_rxw_is_invalid_payload_op (
 	first_skb = _pgm_rxw_peek (window, tg_sqn);
 	if (NULL == first_skb)
 		return TRUE;	/* transmission group unrecoverable */
+	if (!_pgm_rxw_has_payload (window, tg_sqn))
+		return FALSE;	/* nothing to compare against yet */
 
 	if (_pgm_rxw_has_payload_op (first_skb) == _pgm_rxw_has_payload_op (skb))
 		return FALSE;
@@ -962,19 +1060,20 @@ _pgm_rxw_insert (
 
 	if (new_skb->pgm_header->pgm_options & PGM_OPT_PARITY)
 	{
-		skb = _pgm_rxw_find_missing (window, new_skb->sequence);
+		skb = _pgm_rxw_find_missing (window, _pgm_rxw_tg_sqn (window, new_skb->sequence));
 		if (NULL == skb)
 			return PGM_RXW_DUPLICATE;
-		state = (pgm_rxw_state_t*)&skb->cb;
+/* parity takes the place of the missing sequence */
+		new_skb->sequence = skb->sequence;
 	}
 	else
 	{
+/* duplicate detection without loading the skbuff */
+		if (PGM_PKT_STATE_HAVE_DATA == _pgm_rxw_pkt_state (window, new_skb->sequence))
+			return PGM_RXW_DUPLICATE;
+
 		skb = _pgm_rxw_peek (window, new_skb->sequence);
 		pgm_assert (NULL != skb);
-		state = (pgm_rxw_state_t*)&skb->cb;
-
-		if (state->pkt_state == PGM_PKT_STATE_HAVE_DATA)
-			return PGM_RXW_DUPLICATE;
 	}
 
 /* APDU fragments are already declared lost */
@@ -986,7 +1085,7 @@ _pgm_rxw_insert (
 	}
 
 /* verify placeholder state */
-	switch (state->pkt_state) {
+	switch (_pgm_rxw_pkt_state (window, skb->sequence)) {
 	case PGM_PKT_STATE_BACK_OFF:
 	case PGM_PKT_STATE_WAIT_NCF:
 	case PGM_PKT_STATE_WAIT_DATA:
@@ -994,18 +1093,26 @@ _pgm_rxw_insert (
 		break;
 
 	case PGM_PKT_STATE_HAVE_PARITY:
-		_pgm_rxw_shuffle_parity (window, skb);
+		skb = _pgm_rxw_shuffle_parity (window, skb);
 		break;
 
 	default: pgm_assert_not_reached(); break;
 	}
+	state = pgm_rxw_recovery_state (window, skb->sequence);
 
 /* statistics */
-	const uint32_t fill_time = (uint32_t)(new_skb->tstamp - skb->tstamp);
+/* reconstructed data carries the parity time stamp which may precede the gap */
+	const uint32_t fill_time = pgm_time_after (new_skb->tstamp, skb->tstamp) ? (uint32_t)(new_skb->tstamp - skb->tstamp) : 0;
 	PGM_HISTOGRAM_TIMES("Rx.RepairTime", fill_time);
 	PGM_HISTOGRAM_COUNTS("Rx.NakTransmits", state->nak_transmit_count);
 	PGM_HISTOGRAM_COUNTS("Rx.NcfRetries", state->ncf_retry_count);
 	PGM_HISTOGRAM_COUNTS("Rx.DataRetries", state->data_retry_count);
+	if (window->peer_hdr) {
+		_pgm_rxw_hdr_record (window, PGM_HDR_REPAIR_TIME, fill_time);
+		_pgm_rxw_hdr_record (window, PGM_HDR_NAK_TRANSMITS, state->nak_transmit_count);
+		_pgm_rxw_hdr_record (window, PGM_HDR_NCF_RETRIES, state->ncf_retry_count);
+		_pgm_rxw_hdr_record (window, PGM_HDR_DATA_RETRIES, state->data_retry_count);
+	}
 	if (!window->max_fill_time) {
 		window->max_fill_time = window->min_fill_time = fill_time;
 	}
@@ -1041,14 +1148,11 @@ _pgm_rxw_insert (
 	if (s > window->data_loss)	window->data_loss = 0;
 	else				window->data_loss -= s;
 
-/* replace place holder skb with incoming skb */
-	memcpy (new_skb->cb, skb->cb, sizeof(skb->cb));
-	state = (void*)new_skb->cb;
-	state->pkt_state = PGM_PKT_STATE_ERROR;
+/* replace place holder skb with incoming skb, or parity with reconstructed data */
 	_pgm_rxw_unlink (window, skb);
+	window->size -= skb->len;
 	pgm_free_skb (skb);
-	const uint_fast32_t index_ = new_skb->sequence % pgm_rxw_max_length (window);
-	window->pdata[index_] = new_skb;
+	window->pdata[ new_skb->sequence & window->mask ] = new_skb;
 	if (new_skb->pgm_header->pgm_options & PGM_OPT_PARITY)
 		_pgm_rxw_state (window, new_skb, PGM_PKT_STATE_HAVE_PARITY);
 	else
@@ -1058,36 +1162,52 @@ _pgm_rxw_insert (
 	return PGM_RXW_INSERTED;
 }
 
-/* shuffle parity packet at skb->sequence to any other needed spot.
+/* shuffle parity packet at skb->sequence to any other needed spot, the
+ * missing placeholder takes its place.
+ *
+ * returns the skb now at the original sequence to be replaced by data.
  */
 
 static inline
-void
+struct pgm_sk_buff_t*
 _pgm_rxw_shuffle_parity (
 	pgm_rxw_t*	      const restrict window,
 	struct pgm_sk_buff_t* const restrict skb
 	)
 {
 	struct pgm_sk_buff_t* restrict missing;
-	char cb[48];
+	pgm_rxw_state_t state;
+	uint32_t sequence;
+	uint8_t pkt_state;
 
 /* pre-conditions */
 	pgm_assert (NULL != window);
 	pgm_assert (NULL != skb);
 
-	missing = _pgm_rxw_find_missing (window, skb->sequence);
+	missing = _pgm_rxw_find_missing (window, _pgm_rxw_tg_sqn (window, skb->sequence));
 	if (NULL == missing)
-		return;
+		return skb;
 
-/* replace place holder skb with parity skb */
-	_pgm_rxw_unlink (window, missing);
-	memcpy (cb, skb->cb, sizeof(skb->cb));
-	memcpy (skb->cb, missing->cb, sizeof(skb->cb));
-	memcpy (missing->cb, cb, sizeof(skb->cb));
-	const uint32_t parity_index = skb->sequence % pgm_rxw_max_length (window);
-	window->pdata[parity_index] = skb;
-	const uint32_t missing_index = missing->sequence % pgm_rxw_max_length (window);
-	window->pdata[missing_index] = missing;
+/* exchange sequence numbers with state, the placeholder remains queued */
+	const uint32_t parity_index = skb->sequence & window->mask;
+	const uint32_t missing_index = missing->sequence & window->mask;
+	sequence = skb->sequence;
+	skb->sequence = missing->sequence;
+	missing->sequence = sequence;
+	pkt_state = window->pkt_states[parity_index];
+	window->pkt_states[parity_index] = window->pkt_states[missing_index];
+	window->pkt_states[missing_index] = pkt_state;
+	state = window->states[parity_index];
+	window->states[parity_index] = window->states[missing_index];
+	window->states[missing_index] = state;
+	window->pdata[parity_index] = missing;
+	window->pdata[missing_index] = skb;
+/* the NAK bitmap is indexed by sequence, move a BACK-OFF bit with its placeholder */
+	if (PGM_PKT_STATE_BACK_OFF == window->pkt_states[parity_index]) {
+		window->nak_map[ missing_index >> 6 ] &= ~(UINT64_C(1) << (missing_index & 63));
+		_pgm_rxw_nak_schedule (window, missing);
+	}
+	return missing;
 }
 
 /* skb advances the window lead.
@@ -1119,6 +1239,11 @@ _pgm_rxw_append (
 	    _pgm_rxw_is_invalid_payload_op (window, skb)))
 		return PGM_RXW_MALFORMED;
 
+/* parity for a group already complete at the lead */
+	if ((skb->pgm_header->pgm_options & PGM_OPT_PARITY) &&
+	    _pgm_rxw_is_last_of_tg_sqn (window, pgm_rxw_lead (window)))
+		return PGM_RXW_DUPLICATE;
+
 	if (pgm_rxw_is_full (window)) {
 		if (_pgm_rxw_commit_is_empty (window)) {
 			pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Receive window full on new data."));
@@ -1145,29 +1270,26 @@ _pgm_rxw_append (
 	if (PGM_UNLIKELY(skb->pgm_opt_fragment &&
 	    _pgm_rxw_is_apdu_lost (window, skb)))
 	{
-		struct pgm_sk_buff_t* lost_skb	= pgm_alloc_skb (window->max_tpdu);
+		struct pgm_sk_buff_t* lost_skb	= _pgm_rxw_alloc_placeholder (window);
 		lost_skb->tstamp		= now;
 		lost_skb->sequence		= skb->sequence;
 
 /* add lost-placeholder skb to window */
-		const uint_fast32_t index_	= lost_skb->sequence % pgm_rxw_max_length (window);
-		window->pdata[index_]		= lost_skb;
+		memset (pgm_rxw_recovery_state (window, lost_skb->sequence), 0, sizeof(pgm_rxw_state_t));
+		window->pdata[ lost_skb->sequence & window->mask ] = lost_skb;
 
 		_pgm_rxw_state (window, lost_skb, PGM_PKT_STATE_LOST_DATA);
 		return PGM_RXW_BOUNDS;
 	}
 
-/* add skb to window */
-	if (skb->pgm_header->pgm_options & PGM_OPT_PARITY)
-	{
-		const uint_fast32_t index_	= skb->sequence % pgm_rxw_max_length (window);
-		window->pdata[index_]		= skb;
+/* add skb to window, parity extends the transmission group */
+	memset (pgm_rxw_recovery_state (window, window->lead), 0, sizeof(pgm_rxw_state_t));
+	if (skb->pgm_header->pgm_options & PGM_OPT_PARITY) {
+		skb->sequence = window->lead;
+		window->pdata[ skb->sequence & window->mask ] = skb;
 		_pgm_rxw_state (window, skb, PGM_PKT_STATE_HAVE_PARITY);
-	}
-	else
-	{
-		const uint_fast32_t index_	= skb->sequence % pgm_rxw_max_length (window);
-		window->pdata[index_]		= skb;
+	} else {
+		window->pdata[ skb->sequence & window->mask ] = skb;
 		_pgm_rxw_state (window, skb, PGM_PKT_STATE_HAVE_DATA);
 	}
 
@@ -1191,9 +1313,12 @@ pgm_rxw_remove_commit (
 	pgm_assert (NULL != window);
 
 	const uint32_t tg_sqn_of_commit_lead = _pgm_rxw_tg_sqn (window, window->commit_lead);
+/* a lost commit lead leaves the transmission group unrecoverable */
+	const bool is_tg_lost = !_pgm_rxw_incoming_is_empty (window) &&
+				PGM_PKT_STATE_LOST_DATA == _pgm_rxw_pkt_state (window, window->commit_lead);
 
 	while (!_pgm_rxw_commit_is_empty (window) &&
-	       tg_sqn_of_commit_lead != _pgm_rxw_tg_sqn (window, window->trail))
+	       (is_tg_lost || tg_sqn_of_commit_lead != _pgm_rxw_tg_sqn (window, window->trail)))
 	{
 		_pgm_rxw_remove_trail (window);
 	}
@@ -1210,6 +1335,9 @@ pgm_rxw_remove_commit (
  *
  * PGM skbuffs will have an increased reference count and must be unreferenced by the 
  * calling application.
+ *
+ * has_nak_event is set when reconstruction drops corrupt data back to BACK-OFF
+ * state, the caller must then reschedule NAK processing.
  */
 
 PGM_GNUC_INTERNAL
@@ -1221,8 +1349,6 @@ pgm_rxw_readv (
 	)
 {
 	const struct pgm_msgv_t* msg_end;
-	struct pgm_sk_buff_t* skb;
-	pgm_rxw_state_t* state;
 	ssize_t bytes_read;
 
 /* pre-conditions */
@@ -1238,11 +1364,17 @@ pgm_rxw_readv (
 	if (_pgm_rxw_incoming_is_empty (window))
 		return -1;
 
-	skb = _pgm_rxw_peek (window, window->commit_lead);
-	pgm_assert (NULL != skb);
+	pgm_assert (NULL != _pgm_rxw_peek (window, window->commit_lead));
+
+	switch (_pgm_rxw_pkt_state (window, window->commit_lead)) {
+/* parity in place of the commit lead reconstructs the transmission group */
+	case PGM_PKT_STATE_HAVE_PARITY:
+		if (!window->is_fec_available) {
+			bytes_read = -1;
+			break;
+		}
+		/* fallthrough */
 
-	state = (pgm_rxw_state_t*)&skb->cb;
-	switch (state->pkt_state) {
 	case PGM_PKT_STATE_HAVE_DATA:
 		bytes_read = _pgm_rxw_incoming_read (window, pmsg, (unsigned)(msg_end - *pmsg + 1));
 		break;
@@ -1260,7 +1392,6 @@ pgm_rxw_readv (
 	case PGM_PKT_STATE_BACK_OFF:
 	case PGM_PKT_STATE_WAIT_NCF:
 	case PGM_PKT_STATE_WAIT_DATA:
-	case PGM_PKT_STATE_HAVE_PARITY:
 		bytes_read = -1;
 		break;
 
@@ -1298,10 +1429,8 @@ _pgm_rxw_remove_trail (
 	_pgm_rxw_unlink (window, skb);
 	window->size -= skb->len;
 /* remove reference to skb */
-	if (PGM_UNLIKELY(pgm_mem_gc_friendly)) {
-		const uint_fast32_t index_ = skb->sequence % pgm_rxw_max_length (window);
-		window->pdata[index_] = NULL;
-	}
+	if (PGM_UNLIKELY(pgm_mem_gc_friendly))
+		window->pdata[ skb->sequence & window->mask ] = NULL;
 	pgm_free_skb (skb);
 	if (window->trail++ == window->commit_lead) {
 /* data-loss */
@@ -1356,6 +1485,10 @@ _pgm_rxw_incoming_read (
 
 	msg_end = *pmsg + pmsglen - 1;
 	do {
+/* without parity a missing sequence at the commit lead ends the read */
+		if (!window->is_fec_available &&
+		    PGM_PKT_STATE_HAVE_DATA != _pgm_rxw_pkt_state (window, window->commit_lead))
+			break;
 		skb = _pgm_rxw_peek (window, window->commit_lead);
 		pgm_assert (NULL != skb);
 		if (_pgm_rxw_is_apdu_complete (window,
@@ -1400,6 +1533,52 @@ _pgm_rxw_is_tg_sqn_lost (
 	return FALSE;
 }
 
+/* replace original data that failed verification with a placeholder in
+ * BACK-OFF state.  the timer is set to the bucket holding the arrival time so
+ * it has already expired, has_nak_event tells the reader to re-arm the peer
+ * timer.
+ */
+
+static
+void
+_pgm_rxw_drop_corrupt (
+	pgm_rxw_t*	      const restrict window,
+	struct pgm_sk_buff_t* const restrict skb
+	)
+{
+	struct pgm_sk_buff_t* missing;
+	pgm_rxw_state_t* state;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (NULL != skb);
+	pgm_assert_cmpint (PGM_PKT_STATE_HAVE_DATA, ==, _pgm_rxw_pkt_state (window, skb->sequence));
+
+	_pgm_rxw_unlink (window, skb);
+	window->size -= skb->len;
+
+	missing			= _pgm_rxw_alloc_placeholder (window);
+	missing->tstamp		= skb->tstamp;
+	missing->sequence	= skb->sequence;
+	state			= pgm_rxw_recovery_state (window, missing->sequence);
+	memset (state, 0, sizeof(pgm_rxw_state_t));
+	state->timer_expiry	= skb->tstamp;
+	if (window->nak_bucket_ivl > 1)
+		state->timer_expiry -= state->timer_expiry % window->nak_bucket_ivl;
+
+	if (!_pgm_rxw_is_first_of_tg_sqn (window, missing->sequence))
+	{
+		const uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, missing->sequence);
+		if (_pgm_rxw_peek (window, tg_sqn))
+			pgm_rxw_recovery_state (window, tg_sqn)->is_contiguous = 0;
+	}
+
+	window->pdata[ missing->sequence & window->mask ] = missing;
+	pgm_free_skb (skb);
+	_pgm_rxw_state (window, missing, PGM_PKT_STATE_BACK_OFF);
+	window->has_nak_event = 1;
+}
+
 /* reconstruct missing sequences in a transmission group using embedded parity data.
  */
 
@@ -1411,7 +1590,6 @@ _pgm_rxw_reconstruct (
 	)
 {
 	struct pgm_sk_buff_t	*skb;
-	pgm_rxw_state_t		*state;
 	struct pgm_sk_buff_t   **tg_skbs;
 	pgm_gf8_t	       **tg_data, **tg_opts;
 	uint8_t			*offsets;
@@ -1428,6 +1606,27 @@ _pgm_rxw_reconstruct (
 	tg_opts = pgm_newa (pgm_gf8_t*, window->rs.n);
 	offsets = pgm_newa (uint8_t, window->rs.k);
 
+/* original data with deferred checksums feeds the decoder and must be verified
+ * first, a corrupt packet is dropped to become another erasure.  the group is
+ * decoded once further parity fills the gap.
+ */
+	bool is_corrupt = FALSE;
+	for (uint32_t i = tg_sqn; i != (tg_sqn + window->rs.k); i++)
+	{
+		skb = _pgm_rxw_peek (window, i);
+		pgm_assert (NULL != skb);
+		if (PGM_PKT_STATE_HAVE_DATA == _pgm_rxw_pkt_state (window, i) &&
+		    skb->csum_deferred &&
+		    !pgm_skb_csum_verify (skb, NULL, 0))
+		{
+			pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("PGM checksum mismatch on #%" PRIu32 " in transmission group, dropping packet."), i);
+			_pgm_rxw_drop_corrupt (window, skb);
+			is_corrupt = TRUE;
+		}
+	}
+	if (is_corrupt)
+		return;
+
 	skb = _pgm_rxw_peek (window, tg_sqn);
 	pgm_assert (NULL != skb);
 
@@ -1439,9 +1638,10 @@ _pgm_rxw_reconstruct (
 	{
 		skb = _pgm_rxw_peek (window, i);
 		pgm_assert (NULL != skb);
-		state = (pgm_rxw_state_t*)&skb->cb;
-		switch (state->pkt_state) {
+		switch (_pgm_rxw_pkt_state (window, i)) {
+/* leading packets of the group may already be held by the application */
 		case PGM_PKT_STATE_HAVE_DATA:
+		case PGM_PKT_STATE_COMMIT_DATA:
 			tg_skbs[ j ] = skb;
 			tg_data[ j ] = skb->data;
 			tg_opts[ j ] = (pgm_gf8_t*)skb->pgm_opt_fragment;
@@ -1461,10 +1661,11 @@ _pgm_rxw_reconstruct (
 		case PGM_PKT_STATE_WAIT_NCF:
 		case PGM_PKT_STATE_WAIT_DATA:
 		case PGM_PKT_STATE_LOST_DATA:
-			skb = pgm_alloc_skb (window->max_tpdu);
+			skb = _pgm_rxw_alloc_skb (window);
 			pgm_skb_reserve (skb, sizeof(struct pgm_header) + sizeof(struct pgm_data));
 			skb->pgm_header = skb->head;
 			skb->pgm_data = (void*)( skb->pgm_header + 1 );
+			memset (skb->pgm_header, 0, sizeof(struct pgm_header) + sizeof(struct pgm_data));
 			if (is_op_encoded) {
 				const uint16_t opt_total_length = sizeof(struct pgm_opt_length) +
 								 sizeof(struct pgm_opt_header) +
@@ -1505,6 +1706,13 @@ _pgm_rxw_reconstruct (
 					       offsets,
 					       sizeof(struct pgm_opt_fragment));
 
+/* reconstructed data inherits the identity of the first parity packet, which
+ * may be released by the swaps below.
+ */
+	pgm_tsi_t tsi;
+	memcpy (&tsi, &tg_skbs[ window->rs.k ]->tsi, sizeof(pgm_tsi_t));
+	const pgm_time_t tstamp = tg_skbs[ window->rs.k ]->tstamp;
+
 /* swap parity skbs with reconstructed skbs */
 	for (uint_fast8_t i = 0; i < window->rs.k; i++)
 	{
@@ -1525,7 +1733,7 @@ _pgm_rxw_reconstruct (
 				{
 					if (offsets[j] < window->rs.k)
 						continue;
-					pgm_rxw_lost (window, tg_skbs[offsets[j]]->sequence);
+					pgm_rxw_lost (window, tg_sqn + j);
 				}
 				break;
 			}
@@ -1534,6 +1742,12 @@ _pgm_rxw_reconstruct (
 			repair_skb->tail = (char*)repair_skb->tail - padding;
 		}
 
+		memcpy (&repair_skb->tsi, &tsi, sizeof(pgm_tsi_t));
+		repair_skb->tstamp		= tstamp;
+		repair_skb->sequence		= tg_sqn + i;
+		repair_skb->pgm_data->data_sqn	= pgm_htonl (repair_skb->sequence);
+		repair_skb->pgm_header->pgm_tsdu_length = pgm_htons (repair_skb->len);
+
 #ifdef PGM_DISABLE_ASSERT
 		_pgm_rxw_insert (window, repair_skb);
 #else
@@ -1581,7 +1795,7 @@ _pgm_rxw_is_apdu_complete (
 	}
 
 	const size_t apdu_size = skb->pgm_opt_fragment ? pgm_ntohl (skb->of_apdu_len) : skb->len;
-	const uint32_t  tg_sqn = _pgm_rxw_tg_sqn (window, first_sequence);
+	uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, first_sequence);
 
 	pgm_assert_cmpuint (apdu_size, >=, skb->len);
 
@@ -1595,18 +1809,19 @@ _pgm_rxw_is_apdu_complete (
 	     skb;
 	     skb = _pgm_rxw_peek (window, ++sequence))
 	{
-		pgm_rxw_state_t* state = (pgm_rxw_state_t*)&skb->cb;
+		const int pkt_state = _pgm_rxw_pkt_state (window, sequence);
 
 		if (!check_parity &&
-		    PGM_PKT_STATE_HAVE_DATA != state->pkt_state)
+		    PGM_PKT_STATE_HAVE_DATA != pkt_state)
 		{
+/* the first gap selects the transmission group to reconstruct */
+			tg_sqn = _pgm_rxw_tg_sqn (window, sequence);
 			if (window->is_fec_available &&
 			    !_pgm_rxw_is_tg_sqn_lost (window, tg_sqn) )
 			{
 				check_parity = TRUE;
-/* pre-seed committed sequence count */
-				if (pgm_uint32_lte (tg_sqn, window->commit_lead))
-					contiguous_tpdus += window->commit_lead - tg_sqn;
+/* pre-seed with the committed or contiguous sequences before the gap */
+				contiguous_tpdus = sequence - tg_sqn;
 			}
 			else
 			{
@@ -1616,8 +1831,17 @@ _pgm_rxw_is_apdu_complete (
 
 		if (check_parity)
 		{
-			if (PGM_PKT_STATE_HAVE_DATA == state->pkt_state ||
-			    PGM_PKT_STATE_HAVE_PARITY == state->pkt_state)
+/* parity is only counted within the transmission group */
+			if (sequence - tg_sqn >= window->tg_size)
+				return FALSE;
+/* a lost member leaves the group short, parity at the commit lead can never be read */
+			if (PGM_PKT_STATE_LOST_DATA == pkt_state) {
+				if (PGM_PKT_STATE_HAVE_PARITY == _pgm_rxw_pkt_state (window, first_sequence))
+					pgm_rxw_lost (window, first_sequence);
+				return FALSE;
+			}
+			if (PGM_PKT_STATE_HAVE_DATA == pkt_state ||
+			    PGM_PKT_STATE_HAVE_PARITY == pkt_state)
 				++contiguous_tpdus;
 
 /* have sufficient been received for reconstruction */
@@ -1629,7 +1853,7 @@ _pgm_rxw_is_apdu_complete (
 		else
 		{
 /* single packet APDU, already complete */
-			if (PGM_PKT_STATE_HAVE_DATA == state->pkt_state &&
+			if (PGM_PKT_STATE_HAVE_DATA == pkt_state &&
 			    !skb->pgm_opt_fragment)
 				return TRUE;
 
@@ -1789,21 +2013,19 @@ _pgm_rxw_state (
 	const int			     new_pkt_state
 	)
 {
-	pgm_rxw_state_t* state;
-
 /* pre-conditions */
 	pgm_assert (NULL != window);
 	pgm_assert (NULL != skb);
-
-	state = (pgm_rxw_state_t*)&skb->cb;
+	pgm_assert (skb == window->pdata[ skb->sequence & window->mask ]);
 
 /* remove current state */
-	if (PGM_PKT_STATE_ERROR != state->pkt_state)
+	if (PGM_PKT_STATE_ERROR != _pgm_rxw_pkt_state (window, skb->sequence))
 		_pgm_rxw_unlink (window, skb);
 
 	switch (new_pkt_state) {
 	case PGM_PKT_STATE_BACK_OFF:
 		pgm_queue_push_head_link (&window->nak_backoff_queue, (pgm_list_t*)skb);
+		_pgm_rxw_nak_schedule (window, skb);
 		break;
 
 	case PGM_PKT_STATE_WAIT_NCF:
@@ -1842,7 +2064,7 @@ _pgm_rxw_state (
 	default: pgm_assert_not_reached(); break;
 	}
 
-	state->pkt_state = new_pkt_state;
+	window->pkt_states[ skb->sequence & window->mask ] = (uint8_t)new_pkt_state;
 }
 
 PGM_GNUC_INTERNAL
@@ -1868,18 +2090,22 @@ _pgm_rxw_unlink (
 	struct pgm_sk_buff_t* const restrict skb
 	)
 {
-	pgm_rxw_state_t* state;
 	pgm_queue_t* queue;
 
 /* pre-conditions */
 	pgm_assert (NULL != window);
 	pgm_assert (NULL != skb);
 
-	state = (pgm_rxw_state_t*)&skb->cb;
-
-	switch (state->pkt_state) {
+	switch (_pgm_rxw_pkt_state (window, skb->sequence)) {
 	case PGM_PKT_STATE_BACK_OFF:
 		pgm_assert (!pgm_queue_is_empty (&window->nak_backoff_queue));
+		{
+			const uint32_t index = skb->sequence & window->mask;
+			window->nak_map[ index >> 6 ] &= ~(UINT64_C(1) << (index & 63));
+		}
+/* buckets only hold BACK-OFF sequences */
+		if (1 == window->nak_backoff_queue.length)
+			window->nak_bucket_len = 0;
 		queue = &window->nak_backoff_queue;
 		goto unlink_queue;
 
@@ -1921,11 +2147,175 @@ unlink_queue:
 	default: pgm_assert_not_reached(); break;
 	}
 
-	state->pkt_state = PGM_PKT_STATE_ERROR;
+	window->pkt_states[ skb->sequence & window->mask ] = PGM_PKT_STATE_ERROR;
 	pgm_assert (((pgm_list_t*)skb)->next == NULL);
 	pgm_assert (((pgm_list_t*)skb)->prev == NULL);
 }
 
+/* mark sequence in BACK-OFF state and place it in the bucket covering its
+ * expiry, the expiry is rounded up to the bucket granularity and never
+ * brought forward.
+ */
+
+static
+void
+_pgm_rxw_nak_schedule (
+	pgm_rxw_t*	      const restrict window,
+	struct pgm_sk_buff_t* const restrict skb
+	)
+{
+	pgm_rxw_state_t* state = pgm_rxw_recovery_state (window, skb->sequence);
+	struct pgm_rxw_nak_bucket_t* bucket;
+	const uint32_t index = skb->sequence & window->mask;
+	pgm_time_t expiry = state->timer_expiry;
+	unsigned i;
+
+	window->nak_map[ index >> 6 ] |= UINT64_C(1) << (index & 63);
+
+	if (window->nak_bucket_ivl > 1) {
+		expiry += window->nak_bucket_ivl - 1;
+		expiry -= expiry % window->nak_bucket_ivl;
+	}
+
+	for (i = 0; i < window->nak_bucket_len; i++)
+		if (pgm_time_after_eq (window->nak_buckets[ i ].expiry, expiry))
+			break;
+
+	if (i < window->nak_bucket_len && window->nak_buckets[ i ].expiry == expiry)
+	{
+		bucket = &window->nak_buckets[ i ];
+	}
+	else if (window->nak_bucket_len < PGM_N_ELEMENTS(window->nak_buckets))
+	{
+		memmove (&window->nak_buckets[ i + 1 ],
+			 &window->nak_buckets[ i ],
+			 (window->nak_bucket_len - i) * sizeof(struct pgm_rxw_nak_bucket_t));
+		window->nak_bucket_len++;
+		bucket = &window->nak_buckets[ i ];
+		bucket->expiry = expiry;
+		bucket->deferred = 0;
+		bucket->first = bucket->last = skb->sequence;
+	}
+	else if (i < window->nak_bucket_len)
+	{
+/* all buckets in use, defer to the next later bucket */
+		bucket = &window->nak_buckets[ i ];
+	}
+	else
+	{
+/* or join the latest keeping its own expiry, the bucket is re-armed for it
+ * once drained so existing members are not delayed.
+ */
+		bucket = &window->nak_buckets[ window->nak_bucket_len - 1 ];
+		if (0 == bucket->deferred || pgm_time_after (expiry, bucket->deferred))
+			bucket->deferred = expiry;
+	}
+
+	if (pgm_uint32_lt (skb->sequence, bucket->first))
+		bucket->first = skb->sequence;
+	if (pgm_uint32_gt (skb->sequence, bucket->last))
+		bucket->last = skb->sequence;
+	state->timer_expiry = pgm_time_after (expiry, bucket->expiry) ? expiry : bucket->expiry;
+}
+
+/* collect sequences in BACK-OFF state that have expired, taken in ascending
+ * order from each expired bucket in turn by scanning the bitmap.  sequences
+ * from bound onwards are left for a later call.  the caller must move each
+ * returned sequence out of BACK-OFF state.
+ *
+ * returns count of sequences written to sqn.
+ */
+
+PGM_GNUC_INTERNAL
+unsigned
+pgm_rxw_nak_list (
+	pgm_rxw_t*    const restrict window,
+	const pgm_time_t	     now,
+	const uint32_t		     bound,	/* first sequence not to collect */
+	uint32_t*     const restrict sqn,
+	const unsigned		     len
+	)
+{
+	unsigned n = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (NULL != sqn);
+	pgm_assert_cmpuint (len, >, 0);
+
+	while (window->nak_bucket_len > 0 && n < len)
+	{
+		struct pgm_rxw_nak_bucket_t* bucket = &window->nak_buckets[ 0 ];
+		if (pgm_time_after (bucket->expiry, now))
+			break;
+
+/* clamp to window and bound, members outside have already been unlinked */
+		uint32_t i = pgm_uint32_lt (bucket->first, window->trail) ? window->trail : bucket->first;
+		const uint32_t last = pgm_uint32_gt (bucket->last, window->lead) ? window->lead : bucket->last;
+		const uint32_t end = pgm_uint32_lt (last, bound) ? last : bound - 1;
+
+		while (n < len && pgm_uint32_lte (i, end))
+		{
+			const uint32_t index = i & window->mask;
+			const uint64_t word = window->nak_map[ index >> 6 ] >> (index & 63);
+			if (0 == word) {
+/* next word or wrap to the start of the ring */
+				i += MIN(64 - (index & 63), window->mask + 1 - index);
+				continue;
+			}
+			i += _pgm_rxw_ctz64 (word);
+			if (pgm_uint32_gt (i, end))
+				break;
+/* members of later buckets may fall inside this range */
+			if (pgm_time_after_eq (now, window->states[ i & window->mask ].timer_expiry))
+				sqn[ n++ ] = i;
+			i++;
+		}
+
+		if (pgm_uint32_lte (i, last)) {
+/* pushed back members may be anywhere in the range */
+			if (0 == bucket->deferred)
+				bucket->first = i;
+			break;
+		}
+
+		const struct pgm_rxw_nak_bucket_t drained = *bucket;
+		memmove (&window->nak_buckets[ 0 ],
+			 &window->nak_buckets[ 1 ],
+			 --window->nak_bucket_len * sizeof(struct pgm_rxw_nak_bucket_t));
+
+/* re-arm at the expiry of members pushed back into the drained bucket */
+		if (0 != drained.deferred && pgm_time_after (drained.deferred, now))
+		{
+			unsigned j;
+			for (j = 0; j < window->nak_bucket_len; j++)
+				if (pgm_time_after_eq (window->nak_buckets[ j ].expiry, drained.deferred))
+					break;
+			if (j < window->nak_bucket_len && window->nak_buckets[ j ].expiry == drained.deferred)
+			{
+				bucket = &window->nak_buckets[ j ];
+				if (pgm_uint32_lt (drained.first, bucket->first))
+					bucket->first = drained.first;
+				if (pgm_uint32_gt (drained.last, bucket->last))
+					bucket->last = drained.last;
+			}
+			else
+			{
+				memmove (&window->nak_buckets[ j + 1 ],
+					 &window->nak_buckets[ j ],
+					 (window->nak_bucket_len - j) * sizeof(struct pgm_rxw_nak_bucket_t));
+				window->nak_bucket_len++;
+				bucket = &window->nak_buckets[ j ];
+				bucket->expiry = drained.deferred;
+				bucket->deferred = 0;
+				bucket->first = drained.first;
+				bucket->last = drained.last;
+			}
+		}
+	}
+	return n;
+}
+
 /* returns the pointer at the given index of the window.
  */
 
@@ -1951,7 +2341,6 @@ pgm_rxw_lost (
 	)
 {
 	struct pgm_sk_buff_t* skb;
-	pgm_rxw_state_t* state;
 
 /* pre-conditions */
 	pgm_assert (NULL != window);
@@ -1963,15 +2352,14 @@ pgm_rxw_lost (
 	skb = _pgm_rxw_peek (window, sequence);
 	pgm_assert (NULL != skb);
 
-	state = (pgm_rxw_state_t*)&skb->cb;
-
-	if (PGM_UNLIKELY(!(state->pkt_state == PGM_PKT_STATE_BACK_OFF  ||
-	                 state->pkt_state == PGM_PKT_STATE_WAIT_NCF  ||
-	                 state->pkt_state == PGM_PKT_STATE_WAIT_DATA ||
-			 state->pkt_state == PGM_PKT_STATE_HAVE_DATA ||	/* fragments */
-			 state->pkt_state == PGM_PKT_STATE_HAVE_PARITY)))
+	const int pkt_state = _pgm_rxw_pkt_state (window, sequence);
+	if (PGM_UNLIKELY(!(pkt_state == PGM_PKT_STATE_BACK_OFF  ||
+	                 pkt_state == PGM_PKT_STATE_WAIT_NCF  ||
+	                 pkt_state == PGM_PKT_STATE_WAIT_DATA ||
+			 pkt_state == PGM_PKT_STATE_HAVE_DATA ||	/* fragments */
+			 pkt_state == PGM_PKT_STATE_HAVE_PARITY)))
 	{
-		pgm_fatal (_("Unexpected state %s(%u)"), pgm_pkt_state_string (state->pkt_state), state->pkt_state);
+		pgm_fatal (_("Unexpected state %s(%u)"), pgm_pkt_state_string (pkt_state), pkt_state);
 		pgm_assert_not_reached();
 	}
 
@@ -2051,8 +2439,8 @@ _pgm_rxw_recovery_update (
 /* fetch skb from window and bump expiration times */
 	skb = _pgm_rxw_peek (window, sequence);
 	pgm_assert (NULL != skb);
-	state = (pgm_rxw_state_t*)&skb->cb;
-	switch (state->pkt_state) {
+	state = pgm_rxw_recovery_state (window, sequence);
+	switch (_pgm_rxw_pkt_state (window, sequence)) {
 	case PGM_PKT_STATE_BACK_OFF:
 	case PGM_PKT_STATE_WAIT_NCF:
 		pgm_rxw_state (window, skb, PGM_PKT_STATE_WAIT_DATA);
@@ -2117,14 +2505,14 @@ _pgm_rxw_recovery_append (
  */
 	window->data_loss = window->ack_c_p + pgm_fp16mul (pgm_fp16 (1) - window->ack_c_p, window->data_loss);
 
-	skb			= pgm_alloc_skb (window->max_tpdu);
-	state			= (pgm_rxw_state_t*)&skb->cb;
+	skb			= _pgm_rxw_alloc_placeholder (window);
 	skb->tstamp		= now;
 	skb->sequence		= window->lead;
+	state			= pgm_rxw_recovery_state (window, skb->sequence);
+	memset (state, 0, sizeof(pgm_rxw_state_t));
 	state->timer_expiry	= nak_rdata_expiry;
 
-	const uint_fast32_t index_	= pgm_rxw_lead (window) % pgm_rxw_max_length (window);
-	window->pdata[index_]		= skb;
+	window->pdata[ skb->sequence & window->mask ] = skb;
 	_pgm_rxw_state (window, skb, PGM_PKT_STATE_WAIT_DATA);
 
 	return PGM_RXW_APPENDED;
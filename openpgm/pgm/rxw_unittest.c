@@ -77,6 +77,8 @@ mock_pgm_rs_create (
 	uint8_t			k
 	)
 {
+	rs->n = n;
+	rs->k = k;
 }
 
 void
@@ -321,6 +323,37 @@ START_TEST (test_add_pass_002)
 }
 END_TEST
 
+/* missing placeholders carry no payload until replaced */
+START_TEST (test_add_pass_006)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (0);
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not appended");
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (3);
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not missing");
+	for (uint32_t i = 1; i < 3; i++) {
+		const struct pgm_sk_buff_t* placeholder = pgm_rxw_peek (window, i);
+		fail_if (NULL == placeholder, "peek failed");
+		fail_unless (sizeof(struct pgm_sk_buff_t) == placeholder->truesize, "placeholder has payload");
+	}
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (1);
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+	fail_unless (skb == pgm_rxw_peek (window, 1), "peek failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
 /* duplicate + append */
 START_TEST (test_add_pass_003)
 {
@@ -976,6 +1009,110 @@ START_TEST (test_readv_pass_006)
 }
 END_TEST
 
+/* non-power-of-two window wrapped several times with repairs */
+START_TEST (test_readv_pass_010)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	struct pgm_msgv_t msgv[2], *pmsg;
+	struct pgm_sk_buff_t* skb;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	for (unsigned i = 0; i < 350; i += 2)
+	{
+/* #i is missing */
+		skb = generate_valid_skb ();
+		fail_if (NULL == skb, "generate_valid_skb failed");
+		skb->pgm_data->data_sqn = g_htonl (i + 1);
+		fail_unless ((0 == i ? PGM_RXW_APPENDED : PGM_RXW_MISSING) == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add failed");
+		pmsg = msgv;
+		if (0 != i)
+			fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+/* repair */
+		if (0 != i) {
+			skb = generate_valid_skb ();
+			fail_if (NULL == skb, "generate_valid_skb failed");
+			skb->pgm_data->data_sqn = g_htonl (i);
+			fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+			fail_unless (PGM_RXW_DUPLICATE == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not duplicate");
+		}
+		pmsg = msgv;
+		fail_unless ((0 == i ? 1000 : 2000) == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+		fail_unless (pgm_uint32_lte (pgm_rxw_length (window), 100), "length failed");
+		pgm_rxw_remove_commit (window);
+	}
+	fail_unless (349 == pgm_rxw_lead (window), "lead failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* original data failing a deferred checksum is dropped from the transmission
+ * group and later parity still reconstructs it.
+ */
+START_TEST (test_readv_pass_011)
+{
+	const pgm_cpu_t cpu = { 0 };
+	pgm_checksum_init (&cpu);
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	struct pgm_msgv_t msgv[4], *pmsg;
+	struct pgm_sk_buff_t* skb;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+/* #0, #1 is missing, #2 is corrupt, #3 */
+	for (unsigned i = 0; i < 4; i++)
+	{
+		if (1 == i)
+			continue;
+		skb = generate_valid_skb ();
+		fail_if (NULL == skb, "generate_valid_skb failed");
+		skb->pgm_data->data_sqn = g_htonl (i);
+		memset (skb->data, i, skb->len);
+		if (2 == i) {
+			const uint16_t csum = pgm_csum_fold (pgm_csum_partial (skb->head, (char*)skb->tail - (char*)skb->head, 0));
+			skb->pgm_header->pgm_checksum = ~csum;
+			skb->csum_deferred = 1;
+		}
+		fail_unless ((2 == i ? PGM_RXW_MISSING : PGM_RXW_APPENDED) == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add failed");
+	}
+/* parity fills #1 */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_header->pgm_options = PGM_OPT_PARITY;
+	skb->pgm_data->data_sqn = g_htonl (0);
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+/* #2 fails verification and is NAKed again */
+	pmsg = msgv;
+	fail_unless (1000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (PGM_PKT_STATE_BACK_OFF == _pgm_rxw_pkt_state (window, 2), "state failed");
+	fail_unless (0 == window->lost_count, "lost_count failed");
+	fail_unless (0 == _pgm_rxw_peek (window, 2)->len, "placeholder failed");
+	fail_unless (1 == window->has_nak_event, "has_nak_event failed");
+/* already expired for the next timer pass */
+	uint32_t sqn[4];
+	fail_unless (1 == pgm_rxw_nak_list (window, now, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (2 == sqn[0], "nak_list sqn failed");
+	pgm_rxw_remove_commit (window);
+/* second parity fills #2 */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_header->pgm_options = PGM_OPT_PARITY;
+	skb->pgm_data->data_sqn = g_htonl (1);
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+	fail_unless (PGM_PKT_STATE_HAVE_PARITY == _pgm_rxw_pkt_state (window, 2), "state failed");
+/* reconstruct #1, #2 */
+	pmsg = msgv;
+	fail_unless (3000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (0 == window->cumulative_losses, "cumulative_losses failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
 /* NULL window */
 START_TEST (test_readv_fail_001)
 {
@@ -1357,6 +1494,162 @@ START_TEST (test_lost_fail_001)
 }
 END_TEST
 
+/* target:
+ *	unsigned
+ *	pgm_rxw_nak_list (
+ *		pgm_rxw_t* const	window,
+ *		const pgm_time_t	now,
+ *		const uint32_t		bound,
+ *		uint32_t* const		sqn,
+ *		const unsigned		len
+ *		)
+ */
+
+START_TEST (test_nak_list_pass_001)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	uint32_t sqn[4];
+	const pgm_time_t now = 1;
+/* #1 at 0 */
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (0);
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, skb, now, 2), "add not appended");
+	fail_unless (0 == pgm_rxw_nak_list (window, 100, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+/* #2 at 6, 1-5 missing */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (6);
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, 10), "add not missing");
+	fail_unless (0 == pgm_rxw_nak_list (window, 9, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+/* expired, in batches */
+	fail_unless (4 == pgm_rxw_nak_list (window, 10, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	for (unsigned i = 0; i < 4; i++) {
+		fail_unless ((1 + i) == sqn[i], "sequence failed");
+		pgm_rxw_state (window, pgm_rxw_peek (window, sqn[i]), PGM_PKT_STATE_WAIT_NCF);
+	}
+	fail_unless (1 == pgm_rxw_nak_list (window, 10, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (5 == sqn[0], "sequence failed");
+	pgm_rxw_state (window, pgm_rxw_peek (window, sqn[0]), PGM_PKT_STATE_WAIT_NCF);
+	fail_unless (0 == pgm_rxw_nak_list (window, 10, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (0 == window->nak_bucket_len, "bucket not released");
+/* #3 at 9, 7-8 missing, collected up to bound */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (9);
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, 20), "add not missing");
+	fail_unless (1 == pgm_rxw_nak_list (window, 20, 8, sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (7 == sqn[0], "sequence failed");
+	pgm_rxw_state (window, pgm_rxw_peek (window, sqn[0]), PGM_PKT_STATE_WAIT_NCF);
+	fail_unless (0 == pgm_rxw_nak_list (window, 20, 8, sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+/* repaired before expiry */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (8);
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, 20), "add not inserted");
+	fail_unless (0 == pgm_rxw_nak_list (window, 20, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (0 == window->nak_bucket_len, "bucket not released");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* coarse buckets */
+START_TEST (test_nak_list_pass_002)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	window->nak_bucket_ivl = 10;
+	uint32_t sqn[4];
+	const pgm_time_t now = 1;
+/* #1 at 0 */
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (0);
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, skb, now, 2), "add not appended");
+/* #2 at 2, 1 missing expiring at 11 */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (2);
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, 11), "add not missing");
+/* #3 at 4, 3 missing expiring at 19 */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (4);
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, 19), "add not missing");
+	fail_unless (1 == window->nak_bucket_len, "bucket failed");
+	fail_unless (0 == pgm_rxw_nak_list (window, 19, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (2 == pgm_rxw_nak_list (window, 20, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (1 == sqn[0] && 3 == sqn[1], "sequence failed");
+	pgm_rxw_state (window, pgm_rxw_peek (window, 1), PGM_PKT_STATE_WAIT_NCF);
+	pgm_rxw_state (window, pgm_rxw_peek (window, 3), PGM_PKT_STATE_WAIT_NCF);
+/* #4 at 6, 5 missing expiring at 30 */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (6);
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, 30), "add not missing");
+/* 1 retries into the bucket of 5, 3 retries later but inside that range */
+	skb = pgm_rxw_peek (window, 1);
+	pgm_rxw_recovery_state (window, 1)->timer_expiry = 25;
+	pgm_rxw_state (window, skb, PGM_PKT_STATE_BACK_OFF);
+	skb = pgm_rxw_peek (window, 3);
+	pgm_rxw_recovery_state (window, 3)->timer_expiry = 35;
+	pgm_rxw_state (window, skb, PGM_PKT_STATE_BACK_OFF);
+	fail_unless (2 == window->nak_bucket_len, "bucket failed");
+	fail_unless (2 == pgm_rxw_nak_list (window, 30, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (1 == sqn[0] && 5 == sqn[1], "sequence failed");
+	pgm_rxw_state (window, pgm_rxw_peek (window, 1), PGM_PKT_STATE_WAIT_NCF);
+	pgm_rxw_state (window, pgm_rxw_peek (window, 5), PGM_PKT_STATE_WAIT_NCF);
+	fail_unless (0 == pgm_rxw_nak_list (window, 39, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (1 == pgm_rxw_nak_list (window, 40, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (3 == sqn[0], "sequence failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* all buckets in use, a later expiry does not delay the latest bucket */
+START_TEST (test_nak_list_pass_003)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	uint32_t sqn[PGM_RXW_NAK_BUCKETS];
+	const pgm_time_t now = 1;
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (0);
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, skb, now, 2), "add not appended");
+/* #2i at i, 2i-1 missing expiring at 10i */
+	for (unsigned i = 1; i <= PGM_RXW_NAK_BUCKETS + 1; i++)
+	{
+		skb = generate_valid_skb ();
+		fail_if (NULL == skb, "generate_valid_skb failed");
+		skb->pgm_data->data_sqn = g_htonl (2 * i);
+		fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, 10 * i), "add not missing");
+	}
+	fail_unless (PGM_RXW_NAK_BUCKETS == window->nak_bucket_len, "bucket failed");
+	fail_unless ((PGM_RXW_NAK_BUCKETS - 1) == pgm_rxw_nak_list (window, 10 * (PGM_RXW_NAK_BUCKETS - 1), pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	for (unsigned i = 0; i < PGM_RXW_NAK_BUCKETS - 1; i++)
+		pgm_rxw_state (window, pgm_rxw_peek (window, sqn[i]), PGM_PKT_STATE_WAIT_NCF);
+/* latest bucket expires on time without the pushed back sequence */
+	fail_unless (1 == pgm_rxw_nak_list (window, 10 * PGM_RXW_NAK_BUCKETS, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless ((2 * PGM_RXW_NAK_BUCKETS - 1) == sqn[0], "sequence failed");
+	pgm_rxw_state (window, pgm_rxw_peek (window, sqn[0]), PGM_PKT_STATE_WAIT_NCF);
+	fail_unless (1 == window->nak_bucket_len, "bucket not re-armed");
+	fail_unless (0 == pgm_rxw_nak_list (window, 10 * (PGM_RXW_NAK_BUCKETS + 1) - 1, pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless (1 == pgm_rxw_nak_list (window, 10 * (PGM_RXW_NAK_BUCKETS + 1), pgm_rxw_next_lead (window), sqn, G_N_ELEMENTS(sqn)), "nak_list failed");
+	fail_unless ((2 * PGM_RXW_NAK_BUCKETS + 1) == sqn[0], "sequence failed");
+	pgm_rxw_state (window, pgm_rxw_peek (window, sqn[0]), PGM_PKT_STATE_WAIT_NCF);
+	fail_unless (0 == window->nak_bucket_len, "bucket not released");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
 /* target:
  *	void
  *	pgm_rxw_state (
@@ -1507,6 +1800,7 @@ make_basic_test_suite (void)
 	tcase_add_test (tc_add, test_add_pass_003);
 	tcase_add_test (tc_add, test_add_pass_004);
 	tcase_add_test (tc_add, test_add_pass_005);
+	tcase_add_test (tc_add, test_add_pass_006);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_add, test_add_fail_001, SIGABRT);
 	tcase_add_test_raise_signal (tc_add, test_add_fail_002, SIGABRT);
@@ -1577,6 +1871,8 @@ make_basic_test_suite (void)
 	tcase_add_test (tc_readv, test_readv_pass_004);
 	tcase_add_test (tc_readv, test_readv_pass_005);
 	tcase_add_test (tc_readv, test_readv_pass_006);
+	tcase_add_test (tc_readv, test_readv_pass_010);
+	tcase_add_test (tc_readv, test_readv_pass_011);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_readv, test_readv_fail_001, SIGABRT);
 	tcase_add_test_raise_signal (tc_readv, test_readv_fail_002, SIGABRT);
@@ -1613,6 +1909,12 @@ make_basic_test_suite (void)
 	tcase_add_test_raise_signal (tc_lost, test_lost_fail_001, SIGABRT);
 #endif
 
+	TCase* tc_nak_list = tcase_create ("nak-list");
+	suite_add_tcase (s, tc_nak_list);
+	tcase_add_test (tc_nak_list, test_nak_list_pass_001);
+	tcase_add_test (tc_nak_list, test_nak_list_pass_002);
+	tcase_add_test (tc_nak_list, test_nak_list_pass_003);
+
         TCase* tc_state = tcase_create ("state");
 	suite_add_tcase (s, tc_state);
 	tcase_add_test (tc_state, test_state_pass_001);
@@ -0,0 +1,314 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Per-socket service thread for source timers, NAKs and repairs.
+ *
+ * A send-only socket otherwise only runs its SPM heartbeats, NAK intake and
+ * RDATA transmission when the application calls pgm_recvmsgv(), with the
+ * service thread enabled that loop runs internally and publishing threads
+ * only touch the transmit window add path.
+ *
+ * Copyright (c) 2006-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#ifndef _GNU_SOURCE
+#	define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#ifndef _WIN32
+#	include <sched.h>
+#	include <sys/socket.h>
+#else
+#	include <process.h>
+#endif
+#ifdef HAVE_POLL
+#	include <poll.h>
+#endif
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <impl/socket.h>
+#include <impl/timer.h>
+#include <impl/service.h>
+
+
+//#define SERVICE_DEBUG
+
+#ifndef SERVICE_DEBUG
+#	define PGM_DISABLE_ASSERT
+#endif
+
+#ifndef _WIN32
+static void* service_routine (void*);
+#else
+static unsigned __stdcall service_routine (void*);
+#endif
+static void service_set_affinity (pgm_sock_t*const);
+static bool service_wait (pgm_sock_t*const, const pgm_time_t);
+
+
+/* spawn the service thread for a connected send-only socket.
+ *
+ * on success, returns TRUE.  on failure, returns FALSE and sets error appropriately.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_service_start (
+	pgm_sock_t*  const restrict sock,
+	pgm_error_t**      restrict error
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (sock->can_send_data);
+	pgm_assert (!sock->can_recv_data);
+	pgm_assert (!sock->is_service_running);
+
+	if (0 != pgm_notify_init (&sock->service_notify)) {
+		const int save_errno = pgm_get_last_sock_error();
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_sock_errno (save_errno),
+			     _("Creating service notification channel: %s"),
+			     pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		return FALSE;
+	}
+
+#ifndef _WIN32
+	const int status = pthread_create (&sock->service_thread, NULL, &service_routine, sock);
+	if (0 != status) {
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (status),
+			     _("Creating service thread: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), status));
+		pgm_notify_destroy (&sock->service_notify);
+		return FALSE;
+	}
+#else
+	sock->service_thread = (HANDLE)_beginthreadex (NULL, 0, &service_routine, sock, 0, NULL);
+	if (0 == sock->service_thread) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Creating service thread: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		pgm_notify_destroy (&sock->service_notify);
+		return FALSE;
+	}
+#endif /* _WIN32 */
+	sock->is_service_running = TRUE;
+	return TRUE;
+}
+
+/* notify the service thread to shutdown and wait for it to exit, must be
+ * called before the socket is flagged destroyed.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_service_stop (
+	pgm_sock_t* const sock
+	)
+{
+	pgm_assert (NULL != sock);
+
+	if (!sock->is_service_running)
+		return;
+
+	pgm_notify_send (&sock->service_notify);
+#ifndef _WIN32
+	pthread_join (sock->service_thread, NULL);
+#else
+	WaitForSingleObject (sock->service_thread, INFINITE);
+	CloseHandle (sock->service_thread);
+#endif
+	pgm_notify_destroy (&sock->service_notify);
+	sock->is_service_running = FALSE;
+}
+
+/* the application receive loop: timers, NAKs and deferred repairs are all
+ * processed inside pgm_recvmsgv(), a send-only socket never returns data.
+ */
+
+static
+#ifndef _WIN32
+void*
+#else
+unsigned
+__stdcall
+#endif
+service_routine (
+	void*		arg
+	)
+{
+	pgm_sock_t* const sock = arg;
+	struct pgm_msgv_t msgv;
+	size_t bytes_read;
+	pgm_time_t timeout;
+
+	service_set_affinity (sock);
+
+	do {
+		const int status = pgm_recvmsgv (sock, &msgv, 1, MSG_DONTWAIT, &bytes_read, NULL);
+		switch (status) {
+		case PGM_IO_STATUS_RATE_LIMITED:
+/* repair is blocked, wait on the RDATA budget rather than the notification */
+			pgm_notify_clear (&sock->rdata_notify);
+			timeout = pgm_rate_remaining2 (&sock->rate_control, &sock->rdata_rate_control, sock->blocklen);
+			if (timeout > 0)
+				break;
+/* blocked on congestion tokens until an ACK arrives */
+			/* fallthrough */
+
+		case PGM_IO_STATUS_TIMER_PENDING:
+		case PGM_IO_STATUS_WOULD_BLOCK:
+			timeout = pgm_timer_expiration (sock);
+			break;
+		default:
+			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Service thread receive returned status %d."), status);
+			timeout = pgm_timer_expiration (sock);
+			break;
+		}
+	} while (service_wait (sock, timeout));
+
+#ifndef _WIN32
+	return NULL;
+#else
+	return 0;
+#endif
+}
+
+/* bind the calling thread to the configured processor, failure is not fatal.
+ */
+
+static
+void
+service_set_affinity (
+	pgm_sock_t* const sock
+	)
+{
+	if (sock->service_cpu < 0)
+		return;
+
+#if defined( CPU_SETSIZE )
+	if (sock->service_cpu >= CPU_SETSIZE) {
+		pgm_warn (_("Service thread CPU %d beyond CPU_SETSIZE."), sock->service_cpu);
+		return;
+	}
+	cpu_set_t cpu_set;
+	CPU_ZERO (&cpu_set);
+	CPU_SET (sock->service_cpu, &cpu_set);
+	if (0 != sched_setaffinity (0, sizeof (cpu_set), &cpu_set)) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_warn (_("Binding service thread to CPU %d failed: %s"),
+			  sock->service_cpu,
+			  pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+	}
+#elif defined( _WIN32 )
+	if (sock->service_cpu >= (int)(sizeof (DWORD_PTR) * 8)) {
+		pgm_warn (_("Service thread CPU %d beyond affinity mask."), sock->service_cpu);
+		return;
+	}
+	if (0 == SetThreadAffinityMask (GetCurrentThread(), (DWORD_PTR)1 << sock->service_cpu)) {
+		const int save_errno = GetLastError();
+		char winstr[1024];
+		pgm_warn (_("Binding service thread to CPU %d failed: %s"),
+			  sock->service_cpu,
+			  pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+	}
+#else
+	pgm_warn (_("Processor binding is not supported on this platform."));
+#endif
+}
+
+/* wait for network events, the next timer or shutdown.
+ *
+ * returns FALSE when the service thread should exit.
+ */
+
+static
+bool
+service_wait (
+	pgm_sock_t* const	sock,
+	const pgm_time_t	timeout		/* microseconds */
+	)
+{
+	const SOCKET service_fd = pgm_notify_get_socket (&sock->service_notify);
+
+#ifdef HAVE_POLL
+	struct pollfd fds[ 4 ];
+	int n_fds = PGM_N_ELEMENTS(fds) - 1;
+	memset (fds, 0, sizeof(fds));
+	if (-1 == pgm_poll_info (sock, fds, &n_fds, POLLIN))
+		return FALSE;
+	fds[n_fds].fd = service_fd;
+	fds[n_fds].events = POLLIN;
+#	ifdef HAVE_PPOLL
+	const struct timespec ts = {
+		.tv_sec  = (time_t)(timeout / 1000000L),
+		.tv_nsec = (long)(timeout % 1000000L) * 1000L
+	};
+	const int ready = ppoll (fds, n_fds + 1, &ts, NULL);
+#	else
+/* round up so that a sub-millisecond timer does not spin */
+	const int ready = poll (fds, n_fds + 1, (int)MIN ((timeout + 999) / 1000, INT32_MAX));
+#	endif
+	if (ready > 0 && (fds[n_fds].revents & POLLIN))
+		return FALSE;
+#else
+	fd_set readfds;
+	int n_fds = 0;
+	FD_ZERO(&readfds);
+	if (SOCKET_ERROR == pgm_select_info (sock, &readfds, NULL, &n_fds))
+		return FALSE;
+	FD_SET(service_fd, &readfds);
+#	ifndef _WIN32
+	n_fds = MAX(n_fds, service_fd + 1);
+#	else
+	n_fds = 1;
+#	endif
+	struct timeval tv = {
+		.tv_sec  = (long)(timeout / 1000000L),
+		.tv_usec = (long)(timeout % 1000000L)
+	};
+	const int ready = select (n_fds, &readfds, NULL, NULL, &tv);
+	if (ready > 0 && FD_ISSET(service_fd, &readfds))
+		return FALSE;
+#endif /* HAVE_POLL */
+	if (SOCKET_ERROR == ready) {
+		const int save_errno = pgm_get_last_sock_error();
+		if (PGM_SOCK_EINTR != save_errno) {
+			char errbuf[1024];
+			pgm_warn (_("Service thread wait failed: %s"),
+				  pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* eof */
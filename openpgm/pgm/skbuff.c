@@ -48,6 +48,247 @@ pgm_skb_under_panic (
 	pgm_assert_not_reached();
 }
 
+/* Every pooled skbuff is preceded by a slot header linking it back to the
+ * owning pool, slots are padded to whole cache lines.
+ */
+
+struct pgm_skb_slot_t {
+	pgm_skb_pool_t*		pool;
+	struct pgm_skb_slot_t*	next;
+};
+
+#define PGM_SKB_SLOT_ALIGN	64
+
+static inline
+struct pgm_skb_slot_t*
+_pgm_skb_slot (
+	struct pgm_sk_buff_t*const skb
+	)
+{
+	return (struct pgm_skb_slot_t*)skb - 1;
+}
+
+static inline
+bool
+_pgm_skb_pool_is_slab (
+	const pgm_skb_pool_t*const		pool,
+	const struct pgm_skb_slot_t*const	slot
+	)
+{
+	return (const char*)slot >= pool->slab.base && (const char*)slot < pool->slab.base + pool->slab.len;
+}
+
+/* create a pool of skbuffs with room for max_tpdu bytes, pre-allocating
+ * prealloc skbuffs in one contiguous slab.  A max_tpdu of zero creates
+ * metadata only skbuffs.  The slab may be placed on a NUMA node or backed
+ * by hugepages, heap overflow is not.  Up to prealloc heap slots are kept
+ * for reuse, a burst beyond that is returned to the heap.
+ */
+
+PGM_GNUC_INTERNAL
+pgm_skb_pool_t*
+pgm_skb_pool_create (
+	const uint16_t		max_tpdu,
+	const unsigned		prealloc,
+	const int		node,		/* NUMA node, -1 for first touch */
+	const bool		use_hugepages
+	)
+{
+	pgm_skb_pool_t* pool;
+
+	pgm_debug ("pgm_skb_pool_create (max-tpdu:%" PRIu16 " prealloc:%u node:%d use-hugepages:%s)",
+		max_tpdu, prealloc, node, use_hugepages ? "YES" : "NO");
+
+	pool = pgm_new0 (pgm_skb_pool_t, 1);
+	pool->max_tpdu  = max_tpdu;
+	pool->slot_size = sizeof(struct pgm_skb_slot_t) + sizeof(struct pgm_sk_buff_t) + max_tpdu;
+	pool->slot_size = (pool->slot_size + PGM_SKB_SLOT_ALIGN - 1) & ~(size_t)(PGM_SKB_SLOT_ALIGN - 1);
+	pool->heap_max  = prealloc;
+	pgm_atomic_write32 (&pool->ref_count, 1);
+	if (prealloc > 0) {
+		pgm_mem_arena_init (&pool->slab, prealloc * pool->slot_size, node, use_hugepages);
+		for (unsigned i = prealloc; i > 0; i--) {
+			struct pgm_skb_slot_t* slot = (struct pgm_skb_slot_t*)(pool->slab.base + (i - 1) * pool->slot_size);
+			slot->pool = pool;
+			slot->next = pool->free_list;
+			pool->free_list = slot;
+		}
+	}
+	return pool;
+}
+
+/* drop one reference, the last releases all slots back to the heap.
+ */
+
+static
+void
+_pgm_skb_pool_unref (
+	pgm_skb_pool_t*const	pool
+	)
+{
+	struct pgm_skb_slot_t* lists[2], *slot;
+
+	if (pgm_atomic_exchange_and_add32 (&pool->ref_count, (uint32_t)-1) != 1)
+		return;
+
+	lists[0] = pool->free_list;
+	lists[1] = pool->return_list;
+	for (unsigned i = 0; i < PGM_N_ELEMENTS(lists); i++) {
+		slot = lists[i];
+		while (slot) {
+			struct pgm_skb_slot_t* next = slot->next;
+			if (!_pgm_skb_pool_is_slab (pool, slot))
+				pgm_free (slot);
+			slot = next;
+		}
+	}
+	pgm_mem_arena_destroy (&pool->slab);
+	pgm_free (pool);
+}
+
+/* release the owner reference, the pool lingers until every outstanding
+ * skbuff has been freed.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_skb_pool_destroy (
+	pgm_skb_pool_t*const	pool
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != pool);
+
+	pgm_debug ("pgm_skb_pool_destroy (pool:%p hits:%" PRIu32 " misses:%" PRIu32 ")",
+		(const void*)pool, pgm_atomic_read32 (&pool->hits), pgm_atomic_read32 (&pool->misses));
+	_pgm_skb_pool_unref (pool);
+}
+
+/* equivalent to pgm_alloc_skb (max_tpdu), taking the slot from the free list,
+ * then any skbuffs returned by other threads, and finally the heap.
+ */
+
+PGM_GNUC_INTERNAL
+struct pgm_sk_buff_t*
+pgm_skb_pool_alloc (
+	pgm_skb_pool_t*const	pool
+	)
+{
+	struct pgm_skb_slot_t* slot;
+	struct pgm_sk_buff_t* skb;
+
+/* pre-conditions */
+	pgm_assert (NULL != pool);
+
+	if (NULL == pool->free_list) {
+/* only the owner removes entries, so taking the whole list cannot suffer ABA */
+		do {
+			slot = pool->return_list;
+		} while (NULL != slot &&
+			 !pgm_atomic_compare_and_exchange_pointer ((void* volatile*)&pool->return_list, slot, NULL));
+		pool->free_list = slot;
+	}
+
+	slot = pool->free_list;
+	if (PGM_LIKELY(NULL != slot)) {
+		pool->free_list = slot->next;
+		pgm_atomic_inc32 (&pool->hits);
+	} else {
+		slot = pgm_malloc (pool->slot_size);
+		slot->pool = pool;
+		pgm_atomic_inc32 (&pool->heap_count);
+		pgm_atomic_inc32 (&pool->misses);
+	}
+	pgm_atomic_inc32 (&pool->ref_count);
+
+	skb = (struct pgm_sk_buff_t*)(slot + 1);
+	if (PGM_UNLIKELY(pgm_mem_gc_friendly)) {
+		memset (skb, 0, sizeof(struct pgm_sk_buff_t) + pool->max_tpdu);
+		skb->zero_padded = 1;
+	} else {
+		memset (skb, 0, sizeof(struct pgm_sk_buff_t));
+	}
+	skb->is_pooled = 1;
+	skb->truesize = pool->max_tpdu + sizeof(struct pgm_sk_buff_t);
+	pgm_atomic_write32 (&skb->users, 1);
+	skb->head = skb + 1;
+	skb->data = skb->tail = skb->head;
+	skb->end  = (char*)skb->data + pool->max_tpdu;
+	return skb;
+}
+
+/* called by pgm_free_skb() on the last reference of a pooled skbuff from
+ * any thread.  heap slots above the high-water mark go back to the heap.
+ */
+
+void
+pgm_skb_pool_free (
+	struct pgm_sk_buff_t*const skb
+	)
+{
+	struct pgm_skb_slot_t* slot = _pgm_skb_slot (skb);
+	pgm_skb_pool_t* pool = slot->pool;
+
+	if (!_pgm_skb_pool_is_slab (pool, slot)) {
+		if (pgm_atomic_exchange_and_add32 (&pool->heap_count, (uint32_t)-1) > pool->heap_max) {
+			pgm_free (slot);
+			_pgm_skb_pool_unref (pool);
+			return;
+		}
+		pgm_atomic_inc32 (&pool->heap_count);
+	}
+
+	do {
+		slot->next = pool->return_list;
+	} while (!pgm_atomic_compare_and_exchange_pointer ((void* volatile*)&pool->return_list, slot->next, slot));
+	_pgm_skb_pool_unref (pool);
+}
+
+/* verify the PGM checksum of a data packet whose verification was deferred
+ * from parsing, copying the first copy_len bytes of payload to dst within
+ * the same pass.  dst may be NULL when copy_len is zero.
+ *
+ * returns TRUE if the checksum matches.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_skb_csum_verify (
+	struct pgm_sk_buff_t* const restrict skb,
+	void*			    restrict dst,
+	const uint16_t			     copy_len
+	)
+{
+	uint32_t header_csum, payload_csum = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != skb);
+	pgm_assert (NULL != skb->pgm_header);
+	pgm_assert (copy_len <= skb->len);
+	pgm_assert (0 == copy_len || NULL != dst);
+	pgm_assert ((char*)skb->tail == (char*)skb->data + skb->len);
+
+	const uint16_t header_length = (uint16_t)((char*)skb->data - (char*)skb->pgm_header);
+	const uint16_t csum_offset = offsetof (struct pgm_header, pgm_checksum);
+
+/* sum around the transmitted checksum, the packet is not modified */
+	header_csum = pgm_csum_partial (skb->pgm_header, csum_offset, 0);
+	header_csum = pgm_csum_block_add (header_csum,
+					  pgm_csum_partial ((const char*)skb->pgm_header + csum_offset + sizeof(uint16_t),
+							    header_length - csum_offset - sizeof(uint16_t), 0),
+					  csum_offset + sizeof(uint16_t));
+
+	if (copy_len > 0)
+		payload_csum = pgm_csum_partial_copy (skb->data, dst, copy_len, 0);
+	if (copy_len < skb->len)
+		payload_csum = pgm_csum_block_add (payload_csum,
+						   pgm_csum_partial ((const char*)skb->data + copy_len, skb->len - copy_len, 0),
+						   copy_len);
+
+	skb->csum_deferred = 0;
+	return skb->pgm_header->pgm_checksum == pgm_csum_fold (pgm_csum_block_add (header_csum, payload_csum, header_length));
+}
+
 #ifndef SKB_DEBUG
 bool
 pgm_skb_is_valid (
@@ -30,6 +30,13 @@
 #ifdef HAVE_EPOLL_CTL
 #	include <sys/epoll.h>
 #endif
+#ifndef _WIN32
+#	include <netinet/udp.h>		/* UDP_SEGMENT */
+#endif
+#ifdef __linux__
+#	include <linux/filter.h>	/* SO_ATTACH_REUSEPORT_CBPF */
+#	include <linux/net_tstamp.h>	/* SOF_TIMESTAMPING_* */
+#endif
 #include <stdio.h>
 #include <impl/i18n.h>
 #include <impl/framework.h>
@@ -37,6 +44,9 @@
 #include <impl/receiver.h>
 #include <impl/source.h>
 #include <impl/timer.h>
+#include <impl/recv.h>
+#include <impl/net.h>
+#include <impl/service.h>
 
 
 #define SOCK_DEBUG
@@ -50,6 +60,9 @@ pgm_slist_t* pgm_sock_list = NULL;
 
 static const char* pgm_sock_type_string (const int) PGM_GNUC_CONST;
 static const char* pgm_protocol_string (const int) PGM_GNUC_CONST;
+#if defined( SO_ATTACH_REUSEPORT_CBPF ) && defined( SO_REUSEPORT ) && !defined( DISABLE_REUSEPORT )
+static void pgm_shard_attach_filter (pgm_sock_t*const);
+#endif
 
 
 size_t
@@ -233,6 +246,8 @@ pgm_close (
 	pgm_debug ("pgm_sock_destroy (sock:%p flush:%s)",
 		(const void*)sock,
 		flush ? "TRUE":"FALSE");
+/* stop internal calls */
+	pgm_service_stop (sock);
 /* flag existing calls */
 	sock->is_destroyed = TRUE;
 /* cancel running blocking operations */
@@ -269,10 +284,10 @@ pgm_close (
 		}
 	}
 
-	if (sock->peers_hashtable) {
+	if (sock->peers_map) {
 		pgm_debug ("destroying peer lookup table.");
-		pgm_hashtable_destroy (sock->peers_hashtable);
-		sock->peers_hashtable = NULL;
+		pgm_tsimap_destroy (sock->peers_map);
+		sock->peers_map = NULL;
 	}
 	if (sock->peers_list) {
 		pgm_debug ("destroying peer list.");
@@ -283,7 +298,21 @@ pgm_close (
 			sock->peers_list = next;
 		} while (sock->peers_list);
 	}
+	if (sock->peers_timer_heap) {
+		pgm_free (sock->peers_timer_heap);
+		sock->peers_timer_heap = NULL;
+		sock->peers_timer_len = sock->peers_timer_alloc = 0;
+	}
+	for (unsigned i = 0; i < PGM_HDR_MAX; i++)
+		pgm_hdr_destroy (&sock->hdr[ i ]);
 
+	if (sock->send_batch) {
+		pgm_debug ("freeing send batch.");
+		for (unsigned i = sock->pkt_dontwait_state.batch_index; i < sock->pkt_dontwait_state.batch_len; i++)
+			pgm_free_skb (sock->send_batch[i]);
+		pgm_free (sock->send_batch);
+		sock->send_batch = NULL;
+	}
 	if (sock->window) {
 		pgm_trace (PGM_LOG_ROLE_TX_WINDOW,_("Destroying transmit window."));
 		pgm_txw_shutdown (sock->window);
@@ -301,11 +330,32 @@ pgm_close (
 		pgm_free (sock->spm_heartbeat_interval);
 		sock->spm_heartbeat_interval = NULL;
 	}
+#ifdef HAVE_RECVMMSG
+	if (sock->recv_batch) {
+		pgm_debug ("freeing receive batch.");
+		pgm_recv_batch_destroy (sock);
+	}
+#endif
 	if (sock->rx_buffer) {
 		pgm_debug ("freeing receive buffer.");
 		pgm_free_skb (sock->rx_buffer);
 		sock->rx_buffer = NULL;
 	}
+	if (sock->rx_skb_pool) {
+		pgm_debug ("releasing receive buffer pool.");
+		pgm_skb_pool_destroy (sock->rx_skb_pool);
+		sock->rx_skb_pool = NULL;
+	}
+	if (sock->rx_placeholder_pool) {
+		pgm_debug ("releasing placeholder pool.");
+		pgm_skb_pool_destroy (sock->rx_placeholder_pool);
+		sock->rx_placeholder_pool = NULL;
+	}
+	if (sock->loopback) {
+		pgm_debug ("destroying loopback transport.");
+		pgm_loopback_destroy (sock->loopback);
+		sock->loopback = NULL;
+	}
 	pgm_debug ("destroying notification channels.");
 	if (sock->can_send_data) {
 		if (sock->use_pgmcc) {
@@ -319,6 +369,7 @@ pgm_close (
 	pgm_spinlock_free (&sock->txw_spinlock);
 	pgm_mutex_free (&sock->send_mutex);
 	pgm_mutex_free (&sock->timer_mutex);
+	pgm_mutex_free (&sock->hdr_mutex);
 	pgm_mutex_free (&sock->source_mutex);
 	pgm_mutex_free (&sock->receiver_mutex);
 	pgm_rwlock_writer_unlock (&sock->lock);
@@ -377,6 +428,8 @@ pgm_socket (
 	new_sock->dport		= DEFAULT_DATA_DESTINATION_PORT;
 	new_sock->tsi.sport	= DEFAULT_DATA_SOURCE_PORT;
 	new_sock->adv_mode	= 0;	/* advance with time */
+	new_sock->service_cpu	= -1;
+	new_sock->numa_node	= -1;
 
 /* PGMCC */
 	new_sock->acker_nla.ss_family = family;
@@ -389,6 +442,8 @@ pgm_socket (
 	pgm_mutex_init (&new_sock->send_mutex);
 /* next timer & spm expiration */
 	pgm_mutex_init (&new_sock->timer_mutex);
+/* histogram snapshots */
+	pgm_mutex_init (&new_sock->hdr_mutex);
 /* receiver-side */
 	pgm_mutex_init (&new_sock->receiver_mutex);
 /* peer hash map & list lock */
@@ -695,7 +750,7 @@ pgm_getsockopt (
 			break;
 		if (PGM_UNLIKELY(*optlen != sizeof (SOCKET)))
 			break;
-		*(SOCKET*restrict)optval = sock->recv_sock;
+		*(SOCKET*restrict)optval = pgm_sock_recv_fd (sock);
 		status = TRUE;
 		break;
 
@@ -740,6 +795,7 @@ pgm_getsockopt (
 			break;
 		{
 			struct timeval* tv = optval;
+			pgm_time_begin();
 			const long usecs = (long)pgm_timer_expiration (sock);
 			tv->tv_sec  = usecs / 1000000L;
 			tv->tv_usec = usecs % 1000000L;
@@ -755,6 +811,7 @@ pgm_getsockopt (
 			break;
 		{
 			struct timeval* tv = optval;
+			pgm_time_begin();
 			const long usecs = (long)pgm_rate_remaining2 (&sock->rate_control, &sock->odata_rate_control, sock->blocklen);
 			tv->tv_sec  = usecs / 1000000L;
 			tv->tv_usec = usecs % 1000000L;
@@ -762,6 +819,26 @@ pgm_getsockopt (
 		status = TRUE;
 		break;
 
+/* receive skbuffs served from the socket pool */
+	case PGM_SKB_POOL_HITS:
+		if (PGM_UNLIKELY(!sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(*optlen != sizeof (uint32_t)))
+			break;
+		*(uint32_t*restrict)optval = pgm_atomic_read32 (&sock->rx_skb_pool->hits);
+		status = TRUE;
+		break;
+
+/* receive skbuffs the pool had to take from the heap */
+	case PGM_SKB_POOL_MISSES:
+		if (PGM_UNLIKELY(!sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(*optlen != sizeof (uint32_t)))
+			break;
+		*(uint32_t*restrict)optval = pgm_atomic_read32 (&sock->rx_skb_pool->misses);
+		status = TRUE;
+		break;
+
 /** read-write options **/
 /* maximum transmission packet size */
 	case PGM_MTU:
@@ -1041,6 +1118,159 @@ pgm_getsockopt (
 		status = TRUE;
 		break;
 
+	case PGM_RECV_BATCH:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = (int)sock->recv_batch_size;
+		status = TRUE;
+		break;
+
+	case PGM_SKB_POOL_SIZE:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = (int)sock->rx_skb_pool_size;
+		status = TRUE;
+		break;
+
+	case PGM_SEND_BATCH:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = (int)sock->send_batch_size;
+		status = TRUE;
+		break;
+
+	case PGM_UDP_GSO:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_udp_gso ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_REPAIR_BURST:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = (int)sock->repair_burst_size;
+		status = TRUE;
+		break;
+
+/* repair queue depth and drain latency */
+	case PGM_REPAIR_INFO:
+		if (PGM_UNLIKELY(!sock->is_bound || !sock->can_send_data))
+			break;
+		if (PGM_UNLIKELY(*optlen != sizeof (struct pgm_repairinfo_t)))
+			break;
+		{
+			struct pgm_repairinfo_t*const info = optval;
+/* copy under the lock the timer thread updates the counters with */
+			pgm_spinlock_lock (&sock->txw_spinlock);
+			*info = sock->repair_info;
+			info->queue_depth = sock->window->retransmit_queue.length;
+			pgm_spinlock_unlock (&sock->txw_spinlock);
+		}
+		status = TRUE;
+		break;
+
+	case PGM_SERVICE_THREAD:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_service_thread ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_SERVICE_CPU:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->service_cpu;
+		status = TRUE;
+		break;
+
+	case PGM_DEFERRED_CHECKSUM:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_deferred_checksum ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_ZERO_CHECKSUM:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_zero_checksum ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_TXW_HUGEPAGES:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_txw_hugepages ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_RXW_HUGEPAGES:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_rxw_hugepages ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_NUMA_NODE:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->numa_node;
+		status = TRUE;
+		break;
+
+	case PGM_BUSY_POLL:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = (int)sock->busy_poll_usecs;
+		status = TRUE;
+		break;
+
+	case PGM_TX_TSTAMP:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_tx_tstamp ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_RX_TSTAMP:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->rx_tstamp;
+		status = TRUE;
+		break;
+
+	case PGM_LATENCY_INFO:
+		if (PGM_UNLIKELY(!sock->is_bound || !sock->can_recv_data))
+			break;
+		if (PGM_UNLIKELY(*optlen != sizeof (struct pgm_latencyinfo_t)))
+			break;
+		pgm_mutex_lock (&sock->receiver_mutex);
+		*(struct pgm_latencyinfo_t*restrict)optval = sock->latency_info;
+		pgm_mutex_unlock (&sock->receiver_mutex);
+		status = TRUE;
+		break;
+
+	case PGM_LOOPBACK:
+		if (PGM_UNLIKELY(!sock->use_loopback))
+			break;
+		if (PGM_UNLIKELY(*optlen != sizeof (struct pgm_loopbackinfo_t)))
+			break;
+		*(struct pgm_loopbackinfo_t*restrict)optval = sock->loopback_info;
+		status = TRUE;
+		break;
+
+	case PGM_RECV_SHARD:
+		if (PGM_UNLIKELY(*optlen != sizeof (struct pgm_shardinfo_t)))
+			break;
+		{
+			struct pgm_shardinfo_t*const shardinfo = optval;
+			shardinfo->shard_count = MAX(1, sock->shard_count);
+			shardinfo->shard_index = sock->shard_index;
+		}
+		status = TRUE;
+		break;
+
 /** write-only options **/
 	case PGM_IP_ROUTER_ALERT:
 	case PGM_MULTICAST_LOOP:
@@ -1875,6 +2105,265 @@ pgm_setsockopt (
 		status = TRUE;
 		break;
 
+/* read up to n datagrams per system call, 0 or 1 to read one at a time.
+ * 0 <= recv_batch_size <= PGM_MAX_RECV_BATCH
+ */
+	case PGM_RECV_BATCH:
+#ifdef HAVE_RECVMMSG
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < 0 || *(const int*)optval > PGM_MAX_RECV_BATCH))
+			break;
+		sock->recv_batch_size = *(const int*)optval;
+		status = TRUE;
+#endif
+		break;
+
+/* number of receive skbuffs to pre-allocate, 0 to size from the receive window.
+ * 0 <= rx_skb_pool_size
+ */
+	case PGM_SKB_POOL_SIZE:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < 0))
+			break;
+		sock->rx_skb_pool_size = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* build up to n original data packets per send call, 0 or 1 to send each as built.
+ * 0 <= send_batch_size <= PGM_MAX_SEND_BATCH
+ */
+	case PGM_SEND_BATCH:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < 0 || *(const int*)optval > PGM_MAX_SEND_BATCH))
+			break;
+		sock->send_batch_size = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* pass equal sized batched packets to the kernel as one UDP GSO super-packet,
+ * only applicable with UDP encapsulation.
+ */
+	case PGM_UDP_GSO:
+#ifdef UDP_SEGMENT
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(0 != *(const int*)optval && 0 == sock->udp_encap_ucast_port))
+			break;
+		sock->use_udp_gso = (0 != *(const int*)optval);
+		status = TRUE;
+#endif
+		break;
+
+/* drain up to n repairs per wakeup within the RDATA rate limit as one batched
+ * send, 0 or 1 to send a single repair per wakeup.
+ * 0 <= repair_burst_size <= PGM_MAX_SEND_BATCH
+ */
+	case PGM_REPAIR_BURST:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < 0 || *(const int*)optval > PGM_MAX_SEND_BATCH))
+			break;
+		sock->repair_burst_size = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* run SPM timers, NAK intake and repairs on an internal thread from
+ * pgm_connect() until pgm_close(), requires a send-only socket.
+ */
+	case PGM_SERVICE_THREAD:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_connected))
+			break;
+		sock->use_service_thread = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* processor the service thread is bound to, -1 for no binding.
+ * -1 <= service_cpu
+ */
+	case PGM_SERVICE_CPU:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_connected))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < -1))
+			break;
+		sock->service_cpu = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* verify ODATA and RDATA checksums whilst copying to the application in
+ * pgm_recvfrom() instead of on arrival, corrupt headers are only detected
+ * at delivery.  requires UDP encapsulation so the UDP checksum covers the
+ * header fields acted on before verification.
+ */
+	case PGM_DEFERRED_CHECKSUM:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		sock->use_deferred_checksum = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* transmit ODATA, RDATA and parity with a zero PGM checksum and accept the
+ * same from peers, the UDP checksum covers the payload.  non-zero checksums
+ * are always verified.  requires UDP encapsulation.
+ */
+	case PGM_ZERO_CHECKSUM:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		sock->use_zero_checksum = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* divide sources between several receive-only sockets of one session by TSI,
+ * each with its own peers, windows and timers to be serviced by a separate
+ * thread.  unicast delivery is steered by the kernel where reuseport filters
+ * are supported, otherwise and for multicast each shard drops the sources
+ * owned by the others before parsing.
+ * 1 <= shard_count <= PGM_MAX_RECV_SHARDS, shard_index < shard_count
+ */
+	case PGM_RECV_SHARD:
+		if (PGM_UNLIKELY(optlen != sizeof (struct pgm_shardinfo_t)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		{
+			const struct pgm_shardinfo_t* shardinfo = optval;
+			if (PGM_UNLIKELY(0 == shardinfo->shard_count || shardinfo->shard_count > PGM_MAX_RECV_SHARDS))
+				break;
+			if (PGM_UNLIKELY(shardinfo->shard_index >= shardinfo->shard_count))
+				break;
+			sock->shard_count = shardinfo->shard_count;
+			sock->shard_index = shardinfo->shard_index;
+		}
+		status = TRUE;
+		break;
+
+/* back the transmit window skbuff arena with hugepages, falls back to the
+ * heap with a warning when none are reserved.
+ */
+	case PGM_TXW_HUGEPAGES:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		sock->use_txw_hugepages = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* back the pre-allocated receive buffers with hugepages, falls back to
+ * regular pages with a warning.
+ */
+	case PGM_RXW_HUGEPAGES:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		sock->use_rxw_hugepages = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* NUMA node preferred for transmit window and receive buffer storage, -1
+ * to leave placement to the first thread touching each page.
+ * -1 <= numa_node
+ */
+	case PGM_NUMA_NODE:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < -1))
+			break;
+		sock->numa_node = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* spin on the receive socket for up to n microseconds before a blocking read
+ * sleeps in poll(), the spin adapts down when data does not arrive within it.
+ * also requests the same SO_BUSY_POLL interval from the kernel.
+ * 0 <= busy_poll_usecs <= PGM_MAX_BUSY_POLL
+ */
+	case PGM_BUSY_POLL:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < 0 || *(const int*)optval > PGM_MAX_BUSY_POLL))
+			break;
+		sock->busy_poll_usecs = sock->busy_poll_budget = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* carry the wall clock transmit time in OPT_TSTAMP on ODATA sent by copying
+ * from the application, pgm_send_skbv() headers are laid out by the
+ * application with pgm_pkt_offset() and carry no timestamp.
+ */
+	case PGM_TX_TSTAMP:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		sock->use_tx_tstamp = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* receive time source for one-way latency of ODATA with OPT_TSTAMP, kernel
+ * and NIC timestamps use SO_TIMESTAMPING and fall back to the wall clock
+ * where unavailable.  NIC timestamps require hardware timestamping enabled
+ * on the interface and a NIC clock synchronised with the sources.
+ */
+	case PGM_RX_TSTAMP:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < PGM_RX_TSTAMP_USER || *(const int*)optval > PGM_RX_TSTAMP_HARDWARE))
+			break;
+		sock->rx_tstamp = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* replace the network with an in-process transport between sockets of this
+ * process for deterministic protocol benchmarks.  packets delivered to this
+ * socket are dropped, duplicated, held back behind the next packet and
+ * delayed as configured.
+ * 0 <= loss_rate, duplicate_rate, reorder_rate <= 1000000
+ */
+	case PGM_LOOPBACK:
+		if (PGM_UNLIKELY(optlen != sizeof (struct pgm_loopbackinfo_t)))
+			break;
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		{
+			const struct pgm_loopbackinfo_t* loopbackinfo = optval;
+			if (PGM_UNLIKELY(loopbackinfo->loss_rate > 1000000 ||
+					 loopbackinfo->duplicate_rate > 1000000 ||
+					 loopbackinfo->reorder_rate > 1000000))
+				break;
+			if (PGM_UNLIKELY(loopbackinfo->ring_size > UINT16_MAX))
+				break;
+			sock->loopback_info = *loopbackinfo;
+			sock->use_loopback = TRUE;
+		}
+		status = TRUE;
+		break;
+
 /** read-only options **/
 	case PGM_MSSS:
 	case PGM_MSS:
@@ -1886,6 +2375,10 @@ pgm_setsockopt (
 	case PGM_ACK_SOCK:
 	case PGM_TIME_REMAIN:
 	case PGM_RATE_REMAIN:
+	case PGM_SKB_POOL_HITS:
+	case PGM_SKB_POOL_MISSES:
+	case PGM_REPAIR_INFO:
+	case PGM_LATENCY_INFO:
 	default:
 		break;
 	}
@@ -1899,6 +2392,108 @@ pgm_setsockopt (
 	return status;
 }
 
+/* histogram of the socket, or of the peer with the given TSI, caller holds
+ * sock::lock and sock::hdr-mutex.  returns NULL with sock::peers-lock
+ * released for an unknown peer, otherwise the lock is held for a peer.
+ */
+
+static
+pgm_hdr_t*
+hdr_lookup (
+	pgm_sock_t*	 const restrict	sock,
+	const pgm_tsi_t* const restrict	tsi,
+	const int			histogram
+	)
+{
+	if (NULL == tsi)
+		return &sock->hdr[ histogram ];
+	pgm_rwlock_reader_lock (&sock->peers_lock);
+	pgm_peer_t* peer = pgm_tsimap_lookup (sock->peers_map, tsi);
+	if (NULL == peer) {
+		pgm_rwlock_reader_unlock (&sock->peers_lock);
+		return NULL;
+	}
+	return &peer->hdr[ histogram ];
+}
+
+/* copy a receiver histogram of the socket, or with a TSI of one peer.
+ * PGM_HDR_CUMULATIVE returns samples since the socket or peer was created
+ * or last reset, PGM_HDR_DELTA since the previous delta snapshot.
+ *
+ * returns TRUE on success, returns FALSE on invalid parameters, a socket
+ * without a receiver, or an unknown peer.
+ */
+
+bool
+pgm_hdr_snapshot (
+	pgm_sock_t*		   const restrict sock,
+	const pgm_tsi_t*	   const restrict tsi,		/* NULL for all peers */
+	const int				  histogram,
+	const int				  mode,
+	struct pgm_hdr_snapshot_t* const restrict snapshot
+	)
+{
+	pgm_return_val_if_fail (NULL != sock, FALSE);
+	pgm_return_val_if_fail (histogram >= 0 && histogram < PGM_HDR_MAX, FALSE);
+	pgm_return_val_if_fail (PGM_HDR_CUMULATIVE == mode || PGM_HDR_DELTA == mode, FALSE);
+	pgm_return_val_if_fail (NULL != snapshot, FALSE);
+	if (PGM_UNLIKELY(!pgm_rwlock_reader_trylock (&sock->lock)))
+		pgm_return_val_if_reached (FALSE);
+	if (PGM_UNLIKELY(!sock->is_bound || sock->is_destroyed || !sock->can_recv_data)) {
+		pgm_rwlock_reader_unlock (&sock->lock);
+		return FALSE;
+	}
+
+	pgm_mutex_lock (&sock->hdr_mutex);
+	pgm_hdr_t* hdr = hdr_lookup (sock, tsi, histogram);
+	if (NULL != hdr) {
+		pgm_hdr_read (hdr, mode, snapshot);
+		if (NULL != tsi)
+			pgm_rwlock_reader_unlock (&sock->peers_lock);
+	}
+	pgm_mutex_unlock (&sock->hdr_mutex);
+	pgm_rwlock_reader_unlock (&sock->lock);
+	return (NULL != hdr);
+}
+
+/* restart cumulative and delta snapshots of a socket or peer histogram,
+ * PGM_HDR_MAX for every histogram.
+ *
+ * returns TRUE on success, returns FALSE on invalid parameters, a socket
+ * without a receiver, or an unknown peer.
+ */
+
+bool
+pgm_hdr_reset (
+	pgm_sock_t*	 const restrict	sock,
+	const pgm_tsi_t* const restrict	tsi,		/* NULL for all peers */
+	const int			histogram
+	)
+{
+	pgm_return_val_if_fail (NULL != sock, FALSE);
+	pgm_return_val_if_fail (histogram >= 0 && histogram <= PGM_HDR_MAX, FALSE);
+	if (PGM_UNLIKELY(!pgm_rwlock_reader_trylock (&sock->lock)))
+		pgm_return_val_if_reached (FALSE);
+	if (PGM_UNLIKELY(!sock->is_bound || sock->is_destroyed || !sock->can_recv_data)) {
+		pgm_rwlock_reader_unlock (&sock->lock);
+		return FALSE;
+	}
+
+	pgm_mutex_lock (&sock->hdr_mutex);
+	const int first = (PGM_HDR_MAX == histogram) ? 0 : histogram;
+	pgm_hdr_t* hdr = hdr_lookup (sock, tsi, first);
+	if (NULL != hdr) {
+		const int count = (PGM_HDR_MAX == histogram) ? PGM_HDR_MAX : 1;
+		for (int i = 0; i < count; i++)
+			pgm_hdr_clear (&hdr[ i ]);
+		if (NULL != tsi)
+			pgm_rwlock_reader_unlock (&sock->peers_lock);
+	}
+	pgm_mutex_unlock (&sock->hdr_mutex);
+	pgm_rwlock_reader_unlock (&sock->lock);
+	return (NULL != hdr);
+}
+
 bool
 pgm_bind (
 	pgm_sock_t*                       restrict sock,
@@ -1956,6 +2551,30 @@ pgm_bind3 (
 		pgm_rwlock_writer_unlock (&sock->lock);
 		return FALSE;
 	}
+	if (PGM_UNLIKELY(sock->use_zero_checksum && 0 == sock->udp_encap_ucast_port)) {
+		pgm_set_error (error,
+			       PGM_ERROR_DOMAIN_SOCKET,
+			       PGM_ERROR_FAILED,
+			       _("Zero PGM checksum requires UDP encapsulation."));
+		pgm_rwlock_writer_unlock (&sock->lock);
+		return FALSE;
+	}
+	if (PGM_UNLIKELY(sock->use_deferred_checksum && 0 == sock->udp_encap_ucast_port)) {
+		pgm_set_error (error,
+			       PGM_ERROR_DOMAIN_SOCKET,
+			       PGM_ERROR_FAILED,
+			       _("Deferred PGM checksum requires UDP encapsulation."));
+		pgm_rwlock_writer_unlock (&sock->lock);
+		return FALSE;
+	}
+	if (PGM_UNLIKELY(sock->shard_count > 1 && (0 == sock->udp_encap_ucast_port || sock->can_send_data))) {
+		pgm_set_error (error,
+			       PGM_ERROR_DOMAIN_SOCKET,
+			       PGM_ERROR_FAILED,
+			       _("Receive sharding requires a receive-only UDP encapsulated socket."));
+		pgm_rwlock_writer_unlock (&sock->lock);
+		return FALSE;
+	}
 	if (sock->can_send_data) {
 		if (PGM_UNLIKELY(0 == sock->spm_ambient_interval)) {
 			pgm_set_error (error,
@@ -2141,8 +2760,8 @@ pgm_bind3 (
 	}
 
 	const sa_family_t pgmcc_family = sock->use_pgmcc ? sock->family : 0;
-	sock->max_tsdu = (uint16_t)(sock->max_tpdu - sock->iphdr_len - pgm_pkt_offset (FALSE, pgmcc_family));
-	sock->max_tsdu_fragment = (uint16_t)(sock->max_tpdu - sock->iphdr_len - pgm_pkt_offset (TRUE, pgmcc_family));
+	sock->max_tsdu = (uint16_t)(sock->max_tpdu - sock->iphdr_len - pgm_pkt_offset (FALSE, pgmcc_family) - pgm_pkt_tstamp_offset (sock, FALSE));
+	sock->max_tsdu_fragment = (uint16_t)(sock->max_tpdu - sock->iphdr_len - pgm_pkt_offset (TRUE, pgmcc_family) - pgm_pkt_tstamp_offset (sock, TRUE));
 	const unsigned max_fragments = sock->txw_sqns ? MIN( PGM_MAX_FRAGMENTS, sock->txw_sqns ) : PGM_MAX_FRAGMENTS;
 	sock->max_apdu = MIN( PGM_MAX_APDU, max_fragments * sock->max_tsdu_fragment );
 
@@ -2167,12 +2786,34 @@ pgm_bind3 (
 							sock->rs_n,
 							sock->rs_k);
 		pgm_assert (NULL != sock->window);
+		if (sock->use_ondemand_parity || sock->use_proactive_parity)
+			sock->tg_sqn_shift = pgm_power2_log2 (sock->rs_k);
+		if (sock->use_proactive_parity) {
+			pgm_trace (PGM_LOG_ROLE_FEC,_("Encoding %u pro-active parity packets as original data is sent."),
+					sock->rs_proactive_h);
+			pgm_txw_set_proactive_parity (sock->window, sock->rs_proactive_h, sock->max_tsdu);
+		}
+		if (sock->use_zero_checksum) {
+			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Sending data without PGM checksum."));
+			pgm_txw_set_zero_checksum (sock->window);
+		}
+		pgm_trace (PGM_LOG_ROLE_TX_WINDOW,_("Pre-allocating transmit window storage%s."),
+				sock->use_txw_hugepages ? " on hugepages" : "");
+		pgm_txw_set_arena (sock->window, sock->max_tpdu, sock->numa_node, sock->use_txw_hugepages);
+		if (sock->send_batch_size > 1) {
+			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Sending up to %u original data packets per send call."),
+					sock->send_batch_size);
+		}
+		sock->send_batch = pgm_new (struct pgm_sk_buff_t*, MAX(1, sock->send_batch_size));
 	}
 
 /* create peer list */
 	if (sock->can_recv_data) {
-		sock->peers_hashtable = pgm_hashtable_new (pgm_tsi_hash, pgm_tsi_equal);
-		pgm_assert (NULL != sock->peers_hashtable);
+		sock->peers_map = pgm_tsimap_new ();
+		pgm_assert (NULL != sock->peers_map);
+/* a shard per processor that may run the receive path */
+		for (unsigned i = 0; i < PGM_HDR_MAX; i++)
+			pgm_hdr_init (&sock->hdr[ i ], (unsigned)pgm_get_nprocs());
 	}
 
 /* Bind UDP sockets to interfaces, note multicast on a bound interface is
@@ -2265,6 +2906,48 @@ pgm_bind3 (
 		pgm_debug ("bind succeeded on recv_gsr[0] interface %s", s);
 	}
 
+	if (sock->shard_count > 1) {
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Receive shard %" PRIu32 " of %" PRIu32 "."),
+				sock->shard_index, sock->shard_count);
+#if defined( SO_ATTACH_REUSEPORT_CBPF ) && defined( SO_REUSEPORT ) && !defined( DISABLE_REUSEPORT )
+		pgm_shard_attach_filter (sock);
+#endif
+	}
+
+#ifdef SO_BUSY_POLL
+/* kernel driver polling for blocking reads, raising above the system default
+ * requires CAP_NET_ADMIN so failure only loses the in-kernel half.
+ */
+	if (sock->busy_poll_usecs) {
+		const int v = (int)sock->busy_poll_usecs;
+		if (SOCKET_ERROR == setsockopt (sock->recv_sock, SOL_SOCKET, SO_BUSY_POLL, (const char*)&v, sizeof(v))) {
+			const int save_errno = pgm_get_last_sock_error();
+			char errbuf[1024];
+			pgm_warn (_("Enabling SO_BUSY_POLL on receive socket: %s"),
+				  pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		}
+	}
+#endif
+
+/* kernel or NIC receive timestamps for one-way latency */
+	if (PGM_RX_TSTAMP_USER != sock->rx_tstamp) {
+#ifdef SO_TIMESTAMPING
+		int v = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+		if (PGM_RX_TSTAMP_HARDWARE == sock->rx_tstamp)
+			v |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+		if (SOCKET_ERROR == setsockopt (sock->recv_sock, SOL_SOCKET, SO_TIMESTAMPING, (const char*)&v, sizeof(v))) {
+			const int save_errno = pgm_get_last_sock_error();
+			char errbuf[1024];
+			pgm_warn (_("Enabling SO_TIMESTAMPING on receive socket: %s"),
+				  pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			sock->rx_tstamp = PGM_RX_TSTAMP_USER;
+		}
+#else
+		pgm_warn (_("Kernel receive timestamps not supported on this platform."));
+		sock->rx_tstamp = PGM_RX_TSTAMP_USER;
+#endif
+	}
+
 /* keep a copy of the original address source to re-use for router alert bind */
 	memset (&send_addr, 0, sizeof(send_addr));
 
@@ -2387,8 +3070,49 @@ pgm_bind3 (
 		}
 	}
 
+/* receive buffer pool, by default one receive window plus the in-flight buffers */
+	if (0 == sock->rx_skb_pool_size) {
+		const unsigned rxw_sqns = sock->rxw_sqns ? sock->rxw_sqns : (sock->rxw_max_rte ? (unsigned)( (sock->rxw_secs * sock->rxw_max_rte) / sock->max_tpdu ) : 0);
+		sock->rx_skb_pool_size = MIN(rxw_sqns, PGM_SKB_POOL_DEFAULT_MAX) + 1 + sock->recv_batch_size;
+	}
+	pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Pre-allocating %u receive buffers%s."),
+			sock->rx_skb_pool_size,
+			sock->use_rxw_hugepages ? " on hugepages" : "");
+	sock->rx_skb_pool = pgm_skb_pool_create (sock->max_tpdu, sock->rx_skb_pool_size, sock->numa_node, sock->use_rxw_hugepages);
+	sock->rx_placeholder_pool = pgm_skb_pool_create (0, sock->rx_skb_pool_size, sock->numa_node, sock->use_rxw_hugepages);
+
 /* allocate first incoming packet buffer */
-	sock->rx_buffer = pgm_alloc_skb (sock->max_tpdu);
+	sock->rx_buffer = pgm_skb_pool_alloc (sock->rx_skb_pool);
+#ifdef HAVE_RECVMMSG
+	if (sock->recv_batch_size > 1 && !sock->use_loopback) {
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Reading up to %u datagrams per receive call."),
+				sock->recv_batch_size);
+		pgm_recv_batch_create (sock);
+	}
+#endif
+
+/* in-process transport, published under the socket list lock as senders
+ * walk the list for receiving ends.
+ */
+	if (sock->use_loopback) {
+		pgm_loopback_t* loopback = pgm_loopback_create (&sock->loopback_info, sock->max_tpdu);
+		if (PGM_UNLIKELY(NULL == loopback)) {
+			const int save_errno = pgm_get_last_sock_error();
+			char errbuf[1024];
+			pgm_set_error (error,
+				       PGM_ERROR_DOMAIN_SOCKET,
+				       pgm_error_from_sock_errno (save_errno),
+				       _("Creating loopback transport notification channel: %s"),
+				       pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			pgm_rwlock_writer_unlock (&sock->lock);
+			return FALSE;
+		}
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Using loopback transport, %u packet ring."),
+				sock->loopback_info.ring_size ? sock->loopback_info.ring_size : PGM_LOOPBACK_RING_SIZE);
+		pgm_rwlock_writer_lock (&pgm_sock_list_lock);
+		sock->loopback = loopback;
+		pgm_rwlock_writer_unlock (&pgm_sock_list_lock);
+	}
 
 /* bind complete */
 	sock->is_bound = TRUE;
@@ -2425,6 +3149,16 @@ pgm_connect (
 	pgm_debug ("connect (sock:%p error:%p)",
 		 (const void*)sock, (const void*)error);
 
+/* service thread would consume application data */
+	if (sock->use_service_thread && sock->can_recv_data) {
+		pgm_set_error (error,
+			       PGM_ERROR_DOMAIN_SOCKET,
+			       PGM_ERROR_INVAL,
+			       _("Service thread requires a send-only socket."));
+		pgm_rwlock_writer_unlock (&sock->lock);
+		return FALSE;
+	}
+
 /* rx to nak processor notify channel */
 	if (sock->can_send_data)
 	{
@@ -2468,6 +3202,13 @@ pgm_connect (
 
 /* cleanup */
 	pgm_rwlock_writer_unlock (&sock->lock);
+
+/* service thread takes the reader lock via pgm_recvmsgv() */
+	if (sock->use_service_thread &&
+	    !pgm_service_start (sock, error))
+	{
+		return FALSE;
+	}
 	pgm_debug ("PGM socket successfully connected.");
 	return TRUE;
 }
@@ -2524,9 +3265,10 @@ pgm_select_info (
 
 	if (readfds)
 	{
-		FD_SET(sock->recv_sock, readfds);
+		const SOCKET recv_fd = pgm_sock_recv_fd (sock);
+		FD_SET(recv_fd, readfds);
 #ifndef _WIN32
-		fds = sock->recv_sock + 1;
+		fds = recv_fd + 1;
 #else
 		fds = 1;
 #endif
@@ -2628,7 +3370,7 @@ pgm_wsapoll_info (
 	if (events & PGM_POLLIN)
 	{
 		pgm_assert ( (1 + nfds) <= *n_fds );
-		fds[nfds].fd = sock->recv_sock;
+		fds[nfds].fd = pgm_sock_recv_fd (sock);
 		fds[nfds].events = PGM_POLLIN;
 		nfds++;
 		if (sock->can_send_data) {
@@ -2696,7 +3438,7 @@ pgm_epoll_ctl (
 	{
 		event.events = events & (EPOLLIN | EPOLLET | EPOLLONESHOT);
 		event.data.ptr = sock;
-		retval = epoll_ctl (epfd, op, sock->recv_sock, &event);
+		retval = epoll_ctl (epfd, op, pgm_sock_recv_fd (sock), &event);
 		if (retval)
 			goto out;
 		if (sock->can_send_data) {
@@ -2782,4 +3524,55 @@ pgm_protocol_string (
 	return c;
 }
 
+#if defined( SO_ATTACH_REUSEPORT_CBPF ) && defined( SO_REUSEPORT ) && !defined( DISABLE_REUSEPORT )
+/* steer unicast datagrams within the reuseport group by pgm_shard_of(), the
+ * returned index selects the group member by bind order.  the program replaces
+ * any for the group so every shard attaches the same one, failure is not fatal
+ * as shards filter foreign sources regardless.
+ */
+
+static
+void
+pgm_shard_attach_filter (
+	pgm_sock_t* const	sock
+	)
+{
+/* bitmap of downstream packet types by low nibble */
+	const uint32_t downstream = (1 << PGM_SPM) | (1 << PGM_POLL) | (1 << PGM_ODATA) | (1 << PGM_RDATA) | (1 << PGM_NCF);
+	struct sock_filter code[] = {
+		BPF_STMT (BPF_LD  | BPF_B   | BPF_ABS, offsetof (struct pgm_header, pgm_type)),
+		BPF_STMT (BPF_ALU | BPF_AND | BPF_K,   0x0f),
+		BPF_STMT (BPF_MISC| BPF_TAX,           0),
+		BPF_STMT (BPF_LD  | BPF_IMM,           downstream),
+		BPF_STMT (BPF_ALU | BPF_RSH | BPF_X,   0),
+		BPF_STMT (BPF_ALU | BPF_AND | BPF_K,   1),
+		BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K,   0, 0, 2),
+/* upstream and peer: data-destination port */
+		BPF_STMT (BPF_LD  | BPF_H   | BPF_ABS, offsetof (struct pgm_header, pgm_dport)),
+		BPF_STMT (BPF_JMP | BPF_JA,            1),
+/* downstream: data-source port */
+		BPF_STMT (BPF_LD  | BPF_H   | BPF_ABS, offsetof (struct pgm_header, pgm_sport)),
+		BPF_STMT (BPF_MISC| BPF_TAX,           0),
+		BPF_STMT (BPF_LD  | BPF_W   | BPF_ABS, offsetof (struct pgm_header, pgm_gsi)),
+		BPF_STMT (BPF_ALU | BPF_XOR | BPF_X,   0),
+		BPF_STMT (BPF_MISC| BPF_TAX,           0),
+		BPF_STMT (BPF_LD  | BPF_H   | BPF_ABS, offsetof (struct pgm_header, pgm_gsi) + 4),
+		BPF_STMT (BPF_ALU | BPF_XOR | BPF_X,   0),
+		BPF_STMT (BPF_ALU | BPF_MOD | BPF_K,   sock->shard_count),
+		BPF_STMT (BPF_RET | BPF_A,             0)
+	};
+	const struct sock_fprog prog = {
+		.len	= PGM_N_ELEMENTS(code),
+		.filter	= code
+	};
+
+	if (SOCKET_ERROR == setsockopt (sock->recv_sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, (const char*)&prog, sizeof(prog))) {
+		const int save_errno = pgm_get_last_sock_error();
+		char errbuf[1024];
+		pgm_warn (_("Attaching receive shard steering program: %s"),
+			  pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+	}
+}
+#endif
+
 /* eof */
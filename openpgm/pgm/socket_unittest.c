@@ -62,6 +62,8 @@
 #define pgm_timer_check		mock_pgm_timer_check
 #define pgm_timer_expiration	mock_pgm_timer_expiration
 #define pgm_timer_dispatch	mock_pgm_timer_dispatch
+#define pgm_service_start	mock_pgm_service_start
+#define pgm_service_stop	mock_pgm_service_stop
 #define pgm_txw_create		mock_pgm_txw_create
 #define pgm_txw_shutdown	mock_pgm_txw_shutdown
 #define pgm_rate_create		mock_pgm_rate_create
@@ -70,6 +72,9 @@
 #define pgm_rs_create		mock_pgm_rs_create
 #define pgm_rs_destroy		mock_pgm_rs_destroy
 #define pgm_time_update_now	mock_pgm_time_update_now
+#define pgm_loopback_create	mock_pgm_loopback_create
+#define pgm_loopback_destroy	mock_pgm_loopback_destroy
+#define pgm_loopback_get_socket	mock_pgm_loopback_get_socket
 
 #define SOCK_DEBUG
 #include "socket.c"
@@ -258,6 +263,27 @@ mock_pgm_timer_dispatch (
 	return TRUE;
 }
 
+/** service module */
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_service_start (
+	pgm_sock_t* const		sock,
+	pgm_error_t**			error
+	)
+{
+	sock->is_service_running = TRUE;
+	return TRUE;
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_service_stop (
+	pgm_sock_t* const		sock
+	)
+{
+	sock->is_service_running = FALSE;
+}
+
 /** transmit window module */
 pgm_txw_t*
 mock_pgm_txw_create (
@@ -330,6 +356,34 @@ mock_pgm_rs_destroy (
 {
 }
 
+/** loopback module */
+PGM_GNUC_INTERNAL
+pgm_loopback_t*
+mock_pgm_loopback_create (
+	const struct pgm_loopbackinfo_t*const	info,
+	const uint16_t				max_tpdu
+	)
+{
+	return (pgm_loopback_t*)0x1;
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_loopback_destroy (
+	pgm_loopback_t*const	ep
+	)
+{
+}
+
+PGM_GNUC_INTERNAL
+SOCKET
+mock_pgm_loopback_get_socket (
+	pgm_loopback_t*const	ep
+	)
+{
+	return 0;
+}
+
 /** time module */
 static pgm_time_t _mock_pgm_time_update_now (void);
 pgm_time_update_func mock_pgm_time_update_now = _mock_pgm_time_update_now;
@@ -528,6 +582,27 @@ START_TEST (test_connect_pass_001)
 }
 END_TEST
 
+/* send-only with service thread */
+START_TEST (test_connect_pass_002)
+{
+	pgm_error_t* err = NULL;
+	pgm_sock_t* sock = NULL;
+	const int send_only = 1, service_thread = 1;
+	struct pgm_sockaddr_t* pgmsa = generate_asm_sockaddr ();
+	fail_if (NULL == pgmsa, "generate_asm_sockaddr failed");
+	fail_unless (TRUE == pgm_socket (&sock, AF_INET, SOCK_SEQPACKET, IPPROTO_PGM, &err), "create failed");
+	fail_unless (NULL == err, "error raised");
+	fail_unless (TRUE == pgm_setsockopt (sock, IPPROTO_PGM, PGM_SEND_ONLY, &send_only, sizeof(send_only)), "setsockopt failed");
+	fail_unless (TRUE == pgm_setsockopt (sock, IPPROTO_PGM, PGM_SERVICE_THREAD, &service_thread, sizeof(service_thread)), "setsockopt failed");
+	prebind_socket (sock);
+	fail_unless (TRUE == pgm_bind (sock, pgmsa, sizeof(*pgmsa), &err), "bind failed");
+	preconnect_socket (sock);
+	fail_unless (TRUE == pgm_connect (sock, &err), "connect failed");
+	fail_unless (sock->is_service_running, "service not running");
+	fail_unless (TRUE == pgm_close (sock, FALSE), "destroy failed");
+}
+END_TEST
+
 /* invalid parameters */
 START_TEST (test_connect_fail_001)
 {
@@ -536,6 +611,25 @@ START_TEST (test_connect_fail_001)
 }
 END_TEST
 
+/* service thread on a receiving socket */
+START_TEST (test_connect_fail_002)
+{
+	pgm_error_t* err = NULL;
+	pgm_sock_t* sock = NULL;
+	const int service_thread = 1;
+	struct pgm_sockaddr_t* pgmsa = generate_asm_sockaddr ();
+	fail_if (NULL == pgmsa, "generate_asm_sockaddr failed");
+	fail_unless (TRUE == pgm_socket (&sock, AF_INET, SOCK_SEQPACKET, IPPROTO_PGM, &err), "create failed");
+	fail_unless (NULL == err, "error raised");
+	fail_unless (TRUE == pgm_setsockopt (sock, IPPROTO_PGM, PGM_SERVICE_THREAD, &service_thread, sizeof(service_thread)), "setsockopt failed");
+	prebind_socket (sock);
+	fail_unless (TRUE == pgm_bind (sock, pgmsa, sizeof(*pgmsa), &err), "bind failed");
+	preconnect_socket (sock);
+	fail_unless (FALSE == pgm_connect (sock, &err), "connect failed");
+	fail_if (NULL == err, "no error raised");
+}
+END_TEST
+
 /* target:
  *	bool
  *	pgm_close (
@@ -1181,7 +1275,9 @@ make_test_suite (void)
 	suite_add_tcase (s, tc_connect);
 	tcase_add_checked_fixture (tc_connect, mock_setup, mock_teardown);
 	tcase_add_test (tc_connect, test_connect_pass_001);
+	tcase_add_test (tc_connect, test_connect_pass_002);
 	tcase_add_test (tc_connect, test_connect_fail_001);
+	tcase_add_test (tc_connect, test_connect_fail_002);
 
 	TCase* tc_destroy = tcase_create ("destroy");
 	suite_add_tcase (s, tc_destroy);
@@ -48,7 +48,11 @@ static bool send_ncf_list (pgm_sock_t*const restrict, const struct sockaddr*cons
 static int send_odata (pgm_sock_t*const restrict, struct pgm_sk_buff_t*const restrict, size_t*restrict);
 static int send_odata_copy (pgm_sock_t*const restrict, const void*restrict, const uint16_t, size_t*restrict);
 static int send_odatav (pgm_sock_t*const restrict, const struct pgm_iovec*const restrict, const unsigned, size_t*restrict);
+static int send_odata_batch (pgm_sock_t*const restrict, size_t*restrict, unsigned*restrict, size_t*restrict);
 static bool send_rdata (pgm_sock_t*restrict, struct pgm_sk_buff_t*restrict);
+static bool send_rdata_burst (pgm_sock_t*const);
+static void rdata_prepare (pgm_sock_t*restrict, struct pgm_sk_buff_t*restrict);
+static void rdata_sent (pgm_sock_t*restrict, struct pgm_sk_buff_t*restrict);
 
 
 static inline
@@ -110,6 +114,115 @@ source_max_tsdu (
 	return max_tsdu;
 }
 
+/* write OPT_TSTAMP with the current wall clock, returns the following option
+ * header.
+ */
+
+static inline
+struct pgm_opt_header*
+source_opt_tstamp (
+	struct pgm_opt_header* const	opt_header,
+	const bool			is_last
+	)
+{
+	struct pgm_opt_tstamp* opt_tstamp = (struct pgm_opt_tstamp*)(opt_header + 1);
+	const uint64_t now = pgm_time_epoch_nsecs();
+
+	opt_header->opt_type	= is_last ? (PGM_OPT_TSTAMP | PGM_OPT_END) : PGM_OPT_TSTAMP;
+	opt_header->opt_length	= sizeof (struct pgm_opt_header) + sizeof (struct pgm_opt_tstamp);
+	opt_header->opt_reserved = PGM_OPX_IGNORE;
+	opt_tstamp->opt_reserved	= 0;
+	opt_tstamp->opt_tstamp_sec	= pgm_htonl ((uint32_t)(now / UINT64_C(1000000000)));
+	opt_tstamp->opt_tstamp_nsec	= pgm_htonl ((uint32_t)(now % UINT64_C(1000000000)));
+	return (struct pgm_opt_header*)(opt_tstamp + 1);
+}
+
+/* partial checksum of a TSDU, zero without summing when the socket transmits
+ * data with no PGM checksum.
+ */
+
+static inline
+uint32_t
+tsdu_csum (
+	const pgm_sock_t*	sock,
+	const void*		data,
+	const uint16_t		len
+	)
+{
+	if (sock->use_zero_checksum)
+		return 0;
+	return pgm_csum_partial (data, len, 0);
+}
+
+static inline
+uint32_t
+tsdu_csum_copy (
+	const pgm_sock_t*	sock,
+	const void*    restrict	src,
+	void*	       restrict	dst,
+	const uint16_t		len
+	)
+{
+	if (sock->use_zero_checksum) {
+		memcpy (dst, src, len);
+		return 0;
+	}
+	return pgm_csum_partial_copy (src, dst, len, 0);
+}
+
+/* fold header and payload partial checksums into the TPDU, the checksum field
+ * must already be zero.
+ */
+
+static inline
+void
+tpdu_set_checksum (
+	const pgm_sock_t*	sock,
+	struct pgm_header*	header,
+	const uint16_t		header_len,
+	const uint32_t		unfolded_odata
+	)
+{
+	if (sock->use_zero_checksum)
+		return;
+	const uint32_t unfolded_header = pgm_csum_partial (header, header_len, 0);
+	header->pgm_checksum = pgm_csum_fold (pgm_csum_block_add (unfolded_header, unfolded_odata, header_len));
+}
+
+/* track the retransmit queue high watermark for PGM_REPAIR_INFO, repair_info
+ * is only updated under txw_spinlock.
+ */
+
+static inline
+void
+repair_queue_update_depth (
+	pgm_sock_t*		sock
+	)
+{
+	const uint32_t depth = sock->window->retransmit_queue.length;
+	if (depth > sock->repair_info.queue_depth_max)
+		sock->repair_info.queue_depth_max = depth;
+}
+
+/* account a repair leaving the retransmit queue, latency is measured from the
+ * request being queued to the RDATA being sent.
+ */
+
+static inline
+void
+repair_queue_drained (
+	pgm_sock_t*		sock,
+	const pgm_time_t	queued,
+	const pgm_time_t	now
+	)
+{
+	const pgm_time_t latency = pgm_time_after (now, queued) ? now - queued : 0;
+	sock->repair_info.repairs++;
+	sock->repair_info.drain_latency_total += latency;
+	if (latency > sock->repair_info.drain_latency_max)
+		sock->repair_info.drain_latency_max = latency;
+}
+
 /* prototype of function to send pro-active parity NAKs.
  */
 
@@ -124,7 +237,13 @@ pgm_schedule_proactive_nak (
 	const bool status = pgm_txw_retransmit_push (sock->window,
 						     nak_tg_sqn | sock->rs_proactive_h,
 						     TRUE /* is_parity */,
-						     sock->tg_sqn_shift);
+						     sock->tg_sqn_shift,
+						     pgm_time_cached_now());
+	if (status) {
+		pgm_spinlock_lock (&sock->txw_spinlock);
+		repair_queue_update_depth (sock);
+		pgm_spinlock_unlock (&sock->txw_spinlock);
+	}
 	return status;
 }
 
@@ -149,6 +268,8 @@ pgm_on_deferred_nak (
 /* We can flush queue and block all odata, or process one set, or process each
  * sequence number individually.
  */
+	if (sock->repair_burst_size > 1)
+		return send_rdata_burst (sock);
 
 /* parity packets are re-numbered across the transmission group with index h, sharing the space
  * with the original packets.  beyond the transmission group size (k), the PGM option OPT_PARITY_GRP
@@ -170,7 +291,10 @@ pgm_on_deferred_nak (
 		}
 		pgm_free_skb (skb);
 /* now remove sequence number from retransmit queue, re-enabling NAK processing for this sequence number */
-		pgm_txw_retransmit_remove_head (sock->window);
+		pgm_spinlock_lock (&sock->txw_spinlock);
+		repair_queue_drained (sock, pgm_txw_retransmit_remove_head (sock->window), pgm_time_cached_now());
+		sock->repair_info.bursts++;
+		pgm_spinlock_unlock (&sock->txw_spinlock);
 	} else
 		pgm_spinlock_unlock (&sock->txw_spinlock);
 	return TRUE;
@@ -416,11 +540,14 @@ pgm_on_nak (
 
 /* queue retransmit requests */
 	for (uint_fast8_t i = 0; i < sqn_list.len; i++) {
-		const bool push_status = pgm_txw_retransmit_push (sock->window, sqn_list.sqn[i], is_parity, sock->tg_sqn_shift);
+		const bool push_status = pgm_txw_retransmit_push (sock->window, sqn_list.sqn[i], is_parity, sock->tg_sqn_shift, skb->tstamp);
 		if (PGM_UNLIKELY(!push_status)) {
 			pgm_trace (PGM_LOG_ROLE_TX_WINDOW,_("Failed to push retransmit request for #%" PRIu32), sqn_list.sqn[i]);
 		}
 	}
+	pgm_spinlock_lock (&sock->txw_spinlock);
+	repair_queue_update_depth (sock);
+	pgm_spinlock_unlock (&sock->txw_spinlock);
 	return TRUE;
 }
 
@@ -1079,6 +1206,112 @@ reset_heartbeat_spm (
  */
 #define STATE(x)	(sock->pkt_dontwait_state.x)
 
+/* number of original data TPDUs built before transmission.
+ */
+
+static inline
+unsigned
+source_batch_size (
+	const pgm_sock_t*const sock
+	)
+{
+	return sock->send_batch_size ? sock->send_batch_size : 1;
+}
+
+/* transmit the original data TPDUs queued in send_batch from STATE(batch_index),
+ * a single TPDU takes the regular sendto() path.  each sent TPDU releases the
+ * in-transit reference taken when it was queued.
+ *
+ * on success, returns PGM_IO_STATUS_NORMAL, on block for non-blocking sockets
+ * returns PGM_IO_STATUS_WOULD_BLOCK, returns PGM_IO_STATUS_RATE_LIMITED if
+ * packet size exceeds the current rate limit.
+ */
+
+static
+int
+send_odata_batch (
+	pgm_sock_t* const restrict sock,
+	size_t*		  restrict bytes_sent,
+	unsigned*	  restrict packets_sent,
+	size_t*		  restrict data_bytes_sent
+	)
+{
+	struct pgm_iovec vector[ PGM_MAX_SEND_BATCH ];
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+
+	while (STATE(batch_index) < STATE(batch_len))
+	{
+		struct pgm_sk_buff_t**const skbs = &sock->send_batch[ STATE(batch_index) ];
+		const unsigned count = STATE(batch_len) - STATE(batch_index);
+		unsigned done;
+		int sent;
+
+		for (unsigned i = 0; i < count; i++) {
+			pgm_assert ((char*)skbs[i]->tail > (char*)skbs[i]->head);
+			vector[i].iov_base = skbs[i]->head;
+			vector[i].iov_len  = (char*)skbs[i]->tail - (char*)skbs[i]->head;
+		}
+		if (1 == count) {
+			const ssize_t bytes = pgm_sendto (sock,
+							  !STATE(is_rate_limited),	/* rate limit on blocking */
+							  &sock->odata_rate_control,
+							  FALSE,			/* regular socket */
+							  vector[0].iov_base,
+							  vector[0].iov_len,
+							  (struct sockaddr*)&sock->send_gsr.gsr_group,
+							  pgm_sockaddr_len((struct sockaddr*)&sock->send_gsr.gsr_group));
+			sent = (bytes < 0) ? -1 : 1;
+		} else {
+			sent = pgm_sendto_batch (sock,
+						 !STATE(is_rate_limited),	/* rate limit on blocking */
+						 &sock->odata_rate_control,
+						 FALSE,			/* regular socket */
+						 vector,
+						 count,
+						 (struct sockaddr*)&sock->send_gsr.gsr_group,
+						 pgm_sockaddr_len((struct sockaddr*)&sock->send_gsr.gsr_group));
+		}
+		if (sent < 0) {
+			const int save_errno = pgm_get_last_sock_error();
+			if (PGM_LIKELY(PGM_SOCK_EAGAIN == save_errno || PGM_SOCK_ENOBUFS == save_errno))
+			{
+				sock->is_apdu_eagain = TRUE;
+/* a batch is only refused whole when its first TPDU does not fit */
+				sock->blocklen = vector[0].iov_len + sock->iphdr_len;
+				if (PGM_SOCK_ENOBUFS == save_errno)
+					return PGM_IO_STATUS_RATE_LIMITED;
+				return PGM_IO_STATUS_WOULD_BLOCK;
+			}
+/* fall through silently on other errors */
+		}
+
+		done = (sent < 0) ? count : (unsigned)sent;
+		for (unsigned i = 0; i < done; i++)
+		{
+			struct pgm_sk_buff_t*const skb = skbs[i];
+			if (PGM_LIKELY(sent >= 0)) {
+				*bytes_sent += vector[i].iov_len + sock->iphdr_len;	/* as counted at IP layer */
+				(*packets_sent)++;					/* IP packets */
+				*data_bytes_sent += pgm_ntohs (skb->pgm_header->pgm_tsdu_length);
+			}
+/* check for end of transmission group */
+			if (sock->use_proactive_parity) {
+				const uint32_t odata_sqn   = pgm_ntohl (skb->pgm_data->data_sqn);
+				const uint32_t tg_sqn_mask = 0xffffffff << sock->tg_sqn_shift;
+				if (!((odata_sqn + 1) & ~tg_sqn_mask))
+					pgm_schedule_proactive_nak (sock, odata_sqn & tg_sqn_mask);
+			}
+			pgm_free_skb (skb);
+		}
+		STATE(batch_index) += done;
+	}
+
+	STATE(batch_len) = STATE(batch_index) = 0;
+	return PGM_IO_STATUS_NORMAL;
+}
+
 /* send one PGM data packet, transmit window owned memory.
  *
  * On success, returns PGM_IO_STATUS_NORMAL and the number of data bytes pushed
@@ -1117,14 +1350,14 @@ send_odata (
 
 /* continue if send would block */
 	if (sock->is_apdu_eagain) {
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = pgm_time_cached_now();
 		goto retry_send;
 	}
 
 /* add PGM header to skbuff */
 	STATE(skb) = pgm_skb_get(skb);
 	STATE(skb)->sock = sock;
-	STATE(skb)->tstamp = pgm_time_update_now();
+	STATE(skb)->tstamp = pgm_time_cached_now();
 
 	STATE(skb)->pgm_header = (struct pgm_header*)STATE(skb)->head;
 	STATE(skb)->pgm_data   = (struct pgm_data*)(STATE(skb)->pgm_header + 1);
@@ -1166,9 +1399,8 @@ send_odata (
 		data = (char*)opt_header + opt_header->opt_length;
 	}
 	const size_t   pgm_header_len		= (char*)data - (char*)STATE(skb)->pgm_header;
-	const uint32_t unfolded_header		= pgm_csum_partial (STATE(skb)->pgm_header, (uint16_t)pgm_header_len, 0);
-	STATE(unfolded_odata)			= pgm_csum_partial (data, (uint16_t)tsdu_length, 0);
-        STATE(skb)->pgm_header->pgm_checksum	= pgm_csum_fold (pgm_csum_block_add (unfolded_header, STATE(unfolded_odata), (uint16_t)pgm_header_len));
+	STATE(unfolded_odata)			= tsdu_csum (sock, data, (uint16_t)tsdu_length);
+        tpdu_set_checksum (sock, STATE(skb)->pgm_header, (uint16_t)pgm_header_len, STATE(unfolded_odata));
 
 /* add to transmit window, skb::data set to payload */
 	pgm_spinlock_lock (&sock->txw_spinlock);
@@ -1288,18 +1520,19 @@ send_odata_copy (
 		(void*)sock, tsdu, tsdu_length, (void*)bytes_written);
 
 	const sa_family_t pgmcc_family = sock->use_pgmcc ? sock->family : 0;
-	const size_t      tpdu_length  = tsdu_length + pgm_pkt_offset (FALSE, pgmcc_family);
+	const size_t      header_length = pgm_pkt_offset (FALSE, pgmcc_family) + pgm_pkt_tstamp_offset (sock, FALSE);
+	const size_t      tpdu_length  = tsdu_length + header_length;
 
 /* continue if blocked mid-apdu, updating timestamp */
 	if (sock->is_apdu_eagain) {
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = pgm_time_cached_now();
 		goto retry_send;
 	}
 
-	STATE(skb) = pgm_alloc_skb (sock->max_tpdu);
+	STATE(skb) = pgm_txw_alloc_skb (sock->window, sock->max_tpdu);
 	STATE(skb)->sock = sock;
-	STATE(skb)->tstamp = pgm_time_update_now();
-	pgm_skb_reserve (STATE(skb), (uint16_t)pgm_pkt_offset (FALSE, pgmcc_family));
+	STATE(skb)->tstamp = pgm_time_cached_now();
+	pgm_skb_reserve (STATE(skb), (uint16_t)header_length);
 	pgm_skb_put (STATE(skb), (uint16_t)tsdu_length);
 
 	STATE(skb)->pgm_header	= (struct pgm_header*)STATE(skb)->head;
@@ -1308,7 +1541,7 @@ send_odata_copy (
 	STATE(skb)->pgm_header->pgm_sport	= sock->tsi.sport;
 	STATE(skb)->pgm_header->pgm_dport	= sock->dport;
 	STATE(skb)->pgm_header->pgm_type	= PGM_ODATA;
-	STATE(skb)->pgm_header->pgm_options	= sock->use_pgmcc ? PGM_OPT_PRESENT : 0;
+	STATE(skb)->pgm_header->pgm_options	= (sock->use_pgmcc || sock->use_tx_tstamp) ? PGM_OPT_PRESENT : 0;
 	STATE(skb)->pgm_header->pgm_tsdu_length = pgm_htons (tsdu_length);
 
 /* ODATA */
@@ -1317,35 +1550,44 @@ send_odata_copy (
 
 	STATE(skb)->pgm_header->pgm_checksum	= 0;
 	data = STATE(skb)->pgm_data + 1;
-/* congestion control option header indicating elected peer for ACKs. */
-	if (sock->use_pgmcc) {
+	if (sock->use_pgmcc || sock->use_tx_tstamp) {
 		struct pgm_opt_header		*opt_header;
 		struct pgm_opt_length		*opt_len;
-		struct pgm_opt_pgmcc_data	*pgmcc_data;
-		const size_t opt_pgmcc_data_len = ((AF_INET6 == sock->acker_nla.ss_family) ?
+		const size_t opt_pgmcc_data_len = !sock->use_pgmcc ? 0 :
+						  ((AF_INET6 == sock->acker_nla.ss_family) ?
 							sizeof (struct pgm_opt6_pgmcc_data) :
 							sizeof (struct pgm_opt_pgmcc_data));
+		const size_t opt_tstamp_len	= !sock->use_tx_tstamp ? 0 :
+						  (sizeof (struct pgm_opt_header) + sizeof (struct pgm_opt_tstamp));
 		opt_len = data;
 		opt_len->opt_type	= PGM_OPT_LENGTH;
 		opt_len->opt_length	= sizeof (struct pgm_opt_length);
 		opt_len->opt_total_length = pgm_htons ((uint16_t)(sizeof (struct pgm_opt_length) +
-							sizeof (struct pgm_opt_header) +
+							opt_tstamp_len +
+							(sock->use_pgmcc ? sizeof (struct pgm_opt_header) : 0) +
 							opt_pgmcc_data_len));
 		opt_header = (struct pgm_opt_header*)(opt_len + 1);
-		opt_header->opt_type	= PGM_OPT_PGMCC_DATA | PGM_OPT_END;
-		opt_header->opt_length	= sizeof (struct pgm_opt_header) +
-						opt_pgmcc_data_len;
-		pgmcc_data  = (struct pgm_opt_pgmcc_data *)(opt_header + 1);
-		pgmcc_data->opt_reserved = 0;
-		pgmcc_data->opt_tstamp = pgm_htonl ((uint32_t)pgm_to_msecs (STATE(skb)->tstamp));
+/* source transmit time for receiver latency */
+		if (sock->use_tx_tstamp)
+			opt_header = source_opt_tstamp (opt_header, !sock->use_pgmcc);
+/* congestion control option header indicating elected peer for ACKs. */
+		if (sock->use_pgmcc) {
+			struct pgm_opt_pgmcc_data	*pgmcc_data;
+			opt_header->opt_type	= PGM_OPT_PGMCC_DATA | PGM_OPT_END;
+			opt_header->opt_length	= sizeof (struct pgm_opt_header) +
+							opt_pgmcc_data_len;
+			pgmcc_data  = (struct pgm_opt_pgmcc_data *)(opt_header + 1);
+			pgmcc_data->opt_reserved = 0;
+			pgmcc_data->opt_tstamp = pgm_htonl ((uint32_t)pgm_to_msecs (STATE(skb)->tstamp));
 /* acker nla */
-		pgm_sockaddr_to_nla ((struct sockaddr*)&sock->acker_nla, (char*)&pgmcc_data->opt_nla_afi);
-		data = (char*)opt_header + opt_header->opt_length;
+			pgm_sockaddr_to_nla ((struct sockaddr*)&sock->acker_nla, (char*)&pgmcc_data->opt_nla_afi);
+			opt_header = (struct pgm_opt_header*)((char*)opt_header + opt_header->opt_length);
+		}
+		data = opt_header;
 	}
 	const size_t   pgm_header_len		= (char*)data - (char*)STATE(skb)->pgm_header;
-	const uint32_t unfolded_header		= pgm_csum_partial (STATE(skb)->pgm_header, (uint16_t)pgm_header_len, 0);
-	STATE(unfolded_odata)			= pgm_csum_partial_copy (tsdu, data, (uint16_t)tsdu_length, 0);
-	STATE(skb)->pgm_header->pgm_checksum	= pgm_csum_fold (pgm_csum_block_add (unfolded_header, STATE(unfolded_odata), (uint16_t)pgm_header_len));
+	STATE(unfolded_odata)			= tsdu_csum_copy (sock, tsdu, data, (uint16_t)tsdu_length);
+	tpdu_set_checksum (sock, STATE(skb)->pgm_header, (uint16_t)pgm_header_len, STATE(unfolded_odata));
 
 /* add to transmit window, skb::data set to payload */
 	pgm_spinlock_lock (&sock->txw_spinlock);
@@ -1489,9 +1731,9 @@ send_odatav (
 	}
 	pgm_return_val_if_fail (STATE(tsdu_length) <= sock->max_tsdu, PGM_IO_STATUS_ERROR);
 
-	STATE(skb) = pgm_alloc_skb (sock->max_tpdu);
+	STATE(skb) = pgm_txw_alloc_skb (sock->window, sock->max_tpdu);
 	STATE(skb)->sock = sock;
-	STATE(skb)->tstamp = pgm_time_update_now();
+	STATE(skb)->tstamp = pgm_time_cached_now();
 	const sa_family_t pgmcc_family = sock->use_pgmcc ? sock->family : 0;
 	pgm_skb_reserve (STATE(skb), (uint16_t)pgm_pkt_offset (FALSE, pgmcc_family));
 	pgm_skb_put (STATE(skb), (uint16_t)STATE(tsdu_length));
@@ -1511,20 +1753,19 @@ send_odatav (
 
 	STATE(skb)->pgm_header->pgm_checksum	= 0;
 	const size_t   pgm_header_len		= (char*)(STATE(skb)->pgm_data + 1) - (char*)STATE(skb)->pgm_header;
-	const uint32_t unfolded_header		= pgm_csum_partial (STATE(skb)->pgm_header, (uint16_t)pgm_header_len, 0);
 
 /* unroll first iteration to make friendly branch prediction */
 	dst			= (char*)(STATE(skb)->pgm_data + 1);
-	STATE(unfolded_odata)	= pgm_csum_partial_copy ((const char*)vector[0].iov_base, dst, (uint16_t)vector[0].iov_len, 0);
+	STATE(unfolded_odata)	= tsdu_csum_copy (sock, (const char*)vector[0].iov_base, dst, (uint16_t)vector[0].iov_len);
 
 /* iterate over one or more vector elements to perform scatter/gather checksum & copy */
 	for (unsigned i = 1; i < count; i++) {
 		dst += vector[i-1].iov_len;
-		const uint32_t unfolded_element = pgm_csum_partial_copy ((const char*)vector[i].iov_base, dst, (uint16_t)vector[i].iov_len, 0);
+		const uint32_t unfolded_element = tsdu_csum_copy (sock, (const char*)vector[i].iov_base, dst, (uint16_t)vector[i].iov_len);
 		STATE(unfolded_odata) = pgm_csum_block_add (STATE(unfolded_odata), unfolded_element, (uint16_t)vector[i-1].iov_len);
 	}
 
-	STATE(skb)->pgm_header->pgm_checksum	= pgm_csum_fold (pgm_csum_block_add (unfolded_header, STATE(unfolded_odata), (uint16_t)pgm_header_len));
+	tpdu_set_checksum (sock, STATE(skb)->pgm_header, (uint16_t)pgm_header_len, STATE(unfolded_odata));
 
 /* add to transmit window, skb::data set to payload */
 	pgm_spinlock_lock (&sock->txw_spinlock);
@@ -1614,13 +1855,14 @@ send_apdu (
 	pgm_sock_t* 	 const restrict	sock,
 	const void*	       restrict	apdu,
 	const size_t			apdu_length,
+	const bool			flush,		/* false to leave a partial batch queued */
 	size_t*		       restrict	bytes_written
 	)
 {
 	size_t		bytes_sent = 0;		/* counted at IP layer */
 	unsigned	packets_sent = 0;	/* IP packets */
 	size_t		data_bytes_sent = 0;
-	int		save_errno;
+	int		status;
 
 	pgm_assert (NULL != sock);
 	pgm_assert (NULL != apdu);
@@ -1635,7 +1877,7 @@ send_apdu (
 	STATE(is_rate_limited) = FALSE;
 	if (sock->is_nonblocking && sock->is_controlled_odata)
 	{
-		const size_t header_length = pgm_pkt_offset (TRUE, pgmcc_family);
+		const size_t header_length = pgm_pkt_offset (TRUE, pgmcc_family) + pgm_pkt_tstamp_offset (sock, TRUE);
 		size_t tpdu_length = 0;
 		size_t offset_	   = 0;
 
@@ -1660,18 +1902,17 @@ send_apdu (
 	STATE(first_sqn)		= pgm_txw_next_lead(sock->window);
 
 	do {
-		size_t			 tpdu_length, header_length;
+		size_t			 header_length;
 		struct pgm_opt_header	*opt_header;
 		struct pgm_opt_length	*opt_len;
-		ssize_t			 sent;
 
 /* retrieve packet storage from transmit window */
-		header_length = pgm_pkt_offset (TRUE, pgmcc_family);
+		header_length = pgm_pkt_offset (TRUE, pgmcc_family) + pgm_pkt_tstamp_offset (sock, TRUE);
 		STATE(tsdu_length) = MIN( source_max_tsdu (sock, TRUE), apdu_length - STATE(data_bytes_offset) );
 
-		STATE(skb) = pgm_alloc_skb (sock->max_tpdu);
+		STATE(skb) = pgm_txw_alloc_skb (sock->window, sock->max_tpdu);
 		STATE(skb)->sock = sock;
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = pgm_time_cached_now();
 		pgm_skb_reserve (STATE(skb), (uint16_t)header_length);
 		pgm_skb_put (STATE(skb), (uint16_t)STATE(tsdu_length));
 
@@ -1693,10 +1934,14 @@ send_apdu (
 		opt_len->opt_type			= PGM_OPT_LENGTH;
 		opt_len->opt_length			= sizeof(struct pgm_opt_length);
 		opt_len->opt_total_length		= pgm_htons ((uint16_t)(sizeof(struct pgm_opt_length) +
+									pgm_pkt_tstamp_offset (sock, TRUE) +
 									sizeof(struct pgm_opt_header) +
 									sizeof(struct pgm_opt_fragment)));
-/* OPT_FRAGMENT */
 		opt_header				= (struct pgm_opt_header*)(opt_len + 1);
+/* OPT_TSTAMP */
+		if (sock->use_tx_tstamp)
+			opt_header			= source_opt_tstamp (opt_header, FALSE);
+/* OPT_FRAGMENT */
 		opt_header->opt_type			= PGM_OPT_FRAGMENT | PGM_OPT_END;
 		opt_header->opt_length			= sizeof(struct pgm_opt_header) +
 						  	  sizeof(struct pgm_opt_fragment);
@@ -1709,55 +1954,28 @@ send_apdu (
 /* TODO: the assembly checksum & copy routine is faster than memcpy & pgm_cksum on >= opteron hardware */
 		STATE(skb)->pgm_header->pgm_checksum	= 0;
 		const size_t   pgm_header_len		= (char*)(STATE(skb)->pgm_opt_fragment + 1) - (char*)STATE(skb)->pgm_header;
-		const uint32_t unfolded_header		= pgm_csum_partial (STATE(skb)->pgm_header, (uint16_t)pgm_header_len, 0);
-		STATE(unfolded_odata)			= pgm_csum_partial_copy ((const char*)apdu + STATE(data_bytes_offset), STATE(skb)->pgm_opt_fragment + 1, (uint16_t)STATE(tsdu_length), 0);
-		STATE(skb)->pgm_header->pgm_checksum	= pgm_csum_fold (pgm_csum_block_add (unfolded_header, STATE(unfolded_odata), (uint16_t)pgm_header_len));
+		STATE(unfolded_odata)			= tsdu_csum_copy (sock, (const char*)apdu + STATE(data_bytes_offset), STATE(skb)->pgm_opt_fragment + 1, (uint16_t)STATE(tsdu_length));
+		tpdu_set_checksum (sock, STATE(skb)->pgm_header, (uint16_t)pgm_header_len, STATE(unfolded_odata));
 
 /* add to transmit window, skb::data set to payload */
 		pgm_spinlock_lock (&sock->txw_spinlock);
 		pgm_txw_add (sock->window, STATE(skb));
 		pgm_spinlock_unlock (&sock->txw_spinlock);
 
-retry_send:
-		pgm_assert ((char*)STATE(skb)->tail > (char*)STATE(skb)->head);
-		tpdu_length = (char*)STATE(skb)->tail - (char*)STATE(skb)->head;
-		sent = pgm_sendto (sock,
-				   !STATE(is_rate_limited),	/* rate limit on blocking */
-			   	   &sock->odata_rate_control,
-				   FALSE,			/* regular socket */
-				   STATE(skb)->head,
-				   tpdu_length,
-				   (struct sockaddr*)&sock->send_gsr.gsr_group,
-				   pgm_sockaddr_len((struct sockaddr*)&sock->send_gsr.gsr_group));
-		if (sent < 0) {
-			save_errno = pgm_get_last_sock_error();
-			if (PGM_LIKELY(PGM_SOCK_EAGAIN == save_errno || PGM_SOCK_ENOBUFS == save_errno))
-			{
-				sock->is_apdu_eagain = TRUE;
-				sock->blocklen = tpdu_length + sock->iphdr_len;
-				goto blocked;
-			}
-/* fall through silently on other errors */
-		}
-
 /* save unfolded odata for retransmissions */
 		pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
-
-		if (PGM_LIKELY((size_t)sent == tpdu_length)) {
-			bytes_sent += tpdu_length + sock->iphdr_len;	/* as counted at IP layer */
-			packets_sent++;					/* IP packets */
-			data_bytes_sent += STATE(tsdu_length);
-		}
-
 		STATE(data_bytes_offset) += STATE(tsdu_length);
 
-/* check for end of transmission group */
-		if (sock->use_proactive_parity) {
-			const uint32_t odata_sqn = pgm_ntohl (STATE(skb)->pgm_data->data_sqn);
-			const uint32_t tg_sqn_mask = 0xffffffff << sock->tg_sqn_shift;
-			if (!((odata_sqn + 1) & ~tg_sqn_mask))
-				pgm_schedule_proactive_nak (sock, odata_sqn & tg_sqn_mask);
-		}
+/* queue with an in-transit reference, flush when full or at end of APDU */
+		sock->send_batch[ STATE(batch_len)++ ] = pgm_skb_get (STATE(skb));
+		if (STATE(batch_len) < source_batch_size (sock) &&
+		    (STATE(data_bytes_offset) < apdu_length || !flush))
+			continue;
+
+retry_send:
+		status = send_odata_batch (sock, &bytes_sent, &packets_sent, &data_bytes_sent);
+		if (PGM_UNLIKELY(PGM_IO_STATUS_NORMAL != status))
+			goto blocked;
 
 	} while ( STATE(data_bytes_offset)  < apdu_length);
 	pgm_assert( STATE(data_bytes_offset) == apdu_length );
@@ -1781,11 +1999,9 @@ blocked:
 		sock->cumulative_stats[PGM_PC_SOURCE_DATA_MSGS_SENT]  += packets_sent;
 		sock->cumulative_stats[PGM_PC_SOURCE_DATA_BYTES_SENT] += data_bytes_sent;
 	}
-	if (PGM_SOCK_ENOBUFS == save_errno)
-		return PGM_IO_STATUS_RATE_LIMITED;
-	if (sock->use_pgmcc)
+	if (PGM_IO_STATUS_WOULD_BLOCK == status && sock->use_pgmcc)
 		pgm_notify_clear (&sock->ack_notify);
-	return PGM_IO_STATUS_WOULD_BLOCK;
+	return status;
 }
 
 /* Send one APDU, whether it fits within one TPDU or more.
@@ -1825,6 +2041,7 @@ pgm_send (
 
 /* source */
 	pgm_mutex_lock (&sock->source_mutex);
+	pgm_time_begin();
 
 /* pass on non-fragment calls */
 	if (apdu_length <= sock->max_tsdu)
@@ -1836,7 +2053,7 @@ pgm_send (
 	}
 	else
 	{
-		const int status = send_apdu (sock, apdu, (uint16_t)apdu_length, bytes_written);
+		const int status = send_apdu (sock, apdu, (uint16_t)apdu_length, TRUE, bytes_written);
 		pgm_mutex_unlock (&sock->source_mutex);
 		pgm_rwlock_reader_unlock (&sock->lock);
 		return status;
@@ -1875,7 +2092,7 @@ pgm_sendv (
 	unsigned	packets_sent = 0;
 	size_t		bytes_sent = 0;
 	size_t		data_bytes_sent = 0;
-	int		save_errno;
+	int		status;
 
 	pgm_debug ("pgm_sendv (sock:%p vector:%p count:%u is-one-apdu:%s bytes-written:%p)",
 		(const void*)sock,
@@ -1897,6 +2114,7 @@ pgm_sendv (
 	}
 
 	pgm_mutex_lock (&sock->source_mutex);
+	pgm_time_begin();
 
 /* pass on zero length as cannot count vector lengths */
 	if (PGM_UNLIKELY(0 == count))
@@ -1964,12 +2182,12 @@ pgm_sendv (
 	{
 		for (STATE(data_pkt_offset) = 0; STATE(data_pkt_offset) < count; STATE(data_pkt_offset)++)
 		{
-			int	status;
 			size_t	wrote_bytes;
 retry_send:
 			status = send_apdu (sock,
 					    vector[STATE(data_pkt_offset)].iov_base,
 					    vector[STATE(data_pkt_offset)].iov_len,
+					    STATE(data_pkt_offset) + 1 == count,	/* flush on last APDU */
 					    &wrote_bytes);
 			switch (status) {
 			case PGM_IO_STATUS_NORMAL:
@@ -2002,7 +2220,7 @@ retry_send:
 	STATE(is_rate_limited) = FALSE;
 	if (sock->is_nonblocking && sock->is_controlled_odata)
         {
-		const size_t header_length = pgm_pkt_offset (TRUE, pgmcc_family);
+		const size_t header_length = pgm_pkt_offset (TRUE, pgmcc_family) + pgm_pkt_tstamp_offset (sock, TRUE);
                 size_t tpdu_length = 0;
 		size_t offset_	   = 0;
 
@@ -2032,20 +2250,19 @@ retry_send:
 	STATE(first_sqn)		= pgm_txw_next_lead(sock->window);
 
 	do {
-		size_t			 tpdu_length, header_length;
+		size_t			 header_length;
 		struct pgm_opt_header	*opt_header;
 		struct pgm_opt_length	*opt_len;
 		const char		*src;
 		char			*dst;
 		size_t			 src_length, dst_length, copy_length;
-		ssize_t			 sent;
 
 /* retrieve packet storage from transmit window */
-		header_length = pgm_pkt_offset (TRUE, pgmcc_family);
+		header_length = pgm_pkt_offset (TRUE, pgmcc_family) + pgm_pkt_tstamp_offset (sock, TRUE);
 		STATE(tsdu_length) = MIN( source_max_tsdu (sock, TRUE), STATE(apdu_length) - STATE(data_bytes_offset) );
-		STATE(skb) = pgm_alloc_skb (sock->max_tpdu);
+		STATE(skb) = pgm_txw_alloc_skb (sock->window, sock->max_tpdu);
 		STATE(skb)->sock = sock;
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = pgm_time_cached_now();
 		pgm_skb_reserve (STATE(skb), (uint16_t)header_length);
 		pgm_skb_put (STATE(skb), (uint16_t)STATE(tsdu_length));
 
@@ -2067,10 +2284,14 @@ retry_send:
 		opt_len->opt_type			= PGM_OPT_LENGTH;
 		opt_len->opt_length			= sizeof(struct pgm_opt_length);
 		opt_len->opt_total_length		= pgm_htons ((uint16_t)(sizeof(struct pgm_opt_length) +
+									pgm_pkt_tstamp_offset (sock, TRUE) +
 									sizeof(struct pgm_opt_header) +
 									sizeof(struct pgm_opt_fragment)));
-/* OPT_FRAGMENT */
 		opt_header				= (struct pgm_opt_header*)(opt_len + 1);
+/* OPT_TSTAMP */
+		if (sock->use_tx_tstamp)
+			opt_header			= source_opt_tstamp (opt_header, FALSE);
+/* OPT_FRAGMENT */
 		opt_header->opt_type			= PGM_OPT_FRAGMENT | PGM_OPT_END;
 		opt_header->opt_length			= sizeof(struct pgm_opt_header) +
 							  sizeof(struct pgm_opt_fragment);
@@ -2083,7 +2304,6 @@ retry_send:
 /* checksum & copy */
 		STATE(skb)->pgm_header->pgm_checksum	= 0;
 		const size_t   pgm_header_len		= (char*)(STATE(skb)->pgm_opt_fragment + 1) - (char*)STATE(skb)->pgm_header;
-		const uint32_t unfolded_header		= pgm_csum_partial (STATE(skb)->pgm_header, (uint16_t)pgm_header_len, 0);
 
 /* iterate over one or more vector elements to perform scatter/gather checksum & copy
  *
@@ -2096,7 +2316,7 @@ retry_send:
 		src_length	= vector[STATE(vector_index)].iov_len - STATE(vector_offset);
 		dst_length	= 0;
 		copy_length	= MIN( STATE(tsdu_length), src_length );
-		STATE(unfolded_odata)	= pgm_csum_partial_copy (src, dst, (uint16_t)copy_length, 0);
+		STATE(unfolded_odata)	= tsdu_csum_copy (sock, src, dst, (uint16_t)copy_length);
 
 		for(;;)
 		{
@@ -2119,56 +2339,31 @@ retry_send:
 			dst	       += copy_length;
 			src_length	= vector[STATE(vector_index)].iov_len - STATE(vector_offset);
 			copy_length	= MIN( STATE(tsdu_length) - dst_length, src_length );
-			const uint32_t unfolded_element = pgm_csum_partial_copy (src, dst, (uint16_t)copy_length, 0);
+			const uint32_t unfolded_element = tsdu_csum_copy (sock, src, dst, (uint16_t)copy_length);
 			STATE(unfolded_odata) = pgm_csum_block_add (STATE(unfolded_odata), unfolded_element, (uint16_t)dst_length);
 		}
 
-		STATE(skb)->pgm_header->pgm_checksum = pgm_csum_fold (pgm_csum_block_add (unfolded_header, STATE(unfolded_odata), (uint16_t)pgm_header_len));
+		tpdu_set_checksum (sock, STATE(skb)->pgm_header, (uint16_t)pgm_header_len, STATE(unfolded_odata));
 
 /* add to transmit window, skb::data set to payload */
 		pgm_spinlock_lock (&sock->txw_spinlock);
 		pgm_txw_add (sock->window, STATE(skb));
 		pgm_spinlock_unlock (&sock->txw_spinlock);
 
-retry_one_apdu_send:
-		tpdu_length = (char*)STATE(skb)->tail - (char*)STATE(skb)->head;
-		sent = pgm_sendto (sock,
-				   !STATE(is_rate_limited),	/* rate limited on blocking */
-			   	   &sock->odata_rate_control,
-				   FALSE,			/* regular socket */
-				   STATE(skb)->head,
-				   tpdu_length,
-				   (struct sockaddr*)&sock->send_gsr.gsr_group,
-				   pgm_sockaddr_len((struct sockaddr*)&sock->send_gsr.gsr_group));
-		if (sent < 0) {
-			save_errno = pgm_get_last_sock_error();
-			if (PGM_LIKELY(PGM_SOCK_EAGAIN == save_errno || PGM_SOCK_ENOBUFS == save_errno))
-			{
-				sock->is_apdu_eagain = TRUE;
-				sock->blocklen = tpdu_length + sock->iphdr_len;
-				goto blocked;
-			}
-/* fall through silently on other errors */
-		}
-
 /* save unfolded odata for retransmissions */
 		pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
-
-		if (PGM_LIKELY((size_t)sent == tpdu_length)) {
-			bytes_sent += tpdu_length + sock->iphdr_len;	/* as counted at IP layer */
-			packets_sent++;					/* IP packets */
-			data_bytes_sent += STATE(tsdu_length);
-		}
-
 		STATE(data_bytes_offset) += STATE(tsdu_length);
 
-/* check for end of transmission group */
-		if (sock->use_proactive_parity) {
-			const uint32_t odata_sqn = pgm_ntohl (STATE(skb)->pgm_data->data_sqn);
-			const uint32_t tg_sqn_mask = 0xffffffff << sock->tg_sqn_shift;
-			if (!((odata_sqn + 1) & ~tg_sqn_mask))
-				pgm_schedule_proactive_nak (sock, odata_sqn & tg_sqn_mask);
-		}
+/* queue with an in-transit reference, flush when full or at end of APDU */
+		sock->send_batch[ STATE(batch_len)++ ] = pgm_skb_get (STATE(skb));
+		if (STATE(batch_len) < source_batch_size (sock) &&
+		    STATE(data_bytes_offset) < STATE(apdu_length))
+			continue;
+
+retry_one_apdu_send:
+		status = send_odata_batch (sock, &bytes_sent, &packets_sent, &data_bytes_sent);
+		if (PGM_UNLIKELY(PGM_IO_STATUS_NORMAL != status))
+			goto blocked;
 
 	} while ( STATE(data_bytes_offset)  < STATE(apdu_length) );
 	pgm_assert( STATE(data_bytes_offset) == STATE(apdu_length) );
@@ -2196,11 +2391,9 @@ blocked:
 	}
 	pgm_mutex_unlock (&sock->source_mutex);
 	pgm_rwlock_reader_unlock (&sock->lock);
-	if (PGM_SOCK_ENOBUFS == save_errno)
-		return PGM_IO_STATUS_RATE_LIMITED;
-	if (sock->use_pgmcc)
+	if (PGM_IO_STATUS_WOULD_BLOCK == status && sock->use_pgmcc)
 		pgm_notify_clear (&sock->ack_notify);
-	return PGM_IO_STATUS_WOULD_BLOCK;
+	return status;
 }
 
 /* send PGM original data, transmit window owned scatter/gather IO vector.
@@ -2226,7 +2419,7 @@ pgm_send_skbv (
 	unsigned	packets_sent = 0;
 	size_t		bytes_sent = 0;
 	size_t		data_bytes_sent = 0;
-	int		save_errno;
+	int		status;
 
 	pgm_debug ("pgm_send_skbv (sock:%p vector:%p count:%u is-one-apdu:%s bytes-written:%p)",
 		(const void*)sock,
@@ -2248,6 +2441,7 @@ pgm_send_skbv (
 	}
 
 	pgm_mutex_lock (&sock->source_mutex);
+	pgm_time_begin();
 
 /* pass on zero length as cannot count vector lengths */
 	if (PGM_UNLIKELY(0 == count))
@@ -2314,14 +2508,11 @@ pgm_send_skbv (
 
 	for (STATE(vector_index) = 0; STATE(vector_index) < count; STATE(vector_index)++)
 	{
-		size_t		tpdu_length;
-		ssize_t		sent;
-
 		STATE(tsdu_length) = vector[STATE(vector_index)]->len;
 		
 		STATE(skb) = pgm_skb_get(vector[STATE(vector_index)]);
 		STATE(skb)->sock = sock;
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = pgm_time_cached_now();
 
 		STATE(skb)->pgm_header = (struct pgm_header*)STATE(skb)->head;
 		STATE(skb)->pgm_data   = (struct pgm_data*)(STATE(skb)->pgm_header + 1);
@@ -2370,56 +2561,28 @@ pgm_send_skbv (
 		STATE(skb)->pgm_header->pgm_checksum	= 0;
 		pgm_assert ((char*)STATE(skb)->data > (char*)STATE(skb)->pgm_header);
 		const size_t header_length		= (char*)STATE(skb)->data - (char*)STATE(skb)->pgm_header;
-		const uint32_t unfolded_header		= pgm_csum_partial (STATE(skb)->pgm_header, (uint16_t)header_length, 0);
-		STATE(unfolded_odata)			= pgm_csum_partial ((char*)STATE(skb)->data, (uint16_t)STATE(tsdu_length), 0);
-		STATE(skb)->pgm_header->pgm_checksum	= pgm_csum_fold (pgm_csum_block_add (unfolded_header, STATE(unfolded_odata), (uint16_t)header_length));
+		STATE(unfolded_odata)			= tsdu_csum (sock, STATE(skb)->data, (uint16_t)STATE(tsdu_length));
+		tpdu_set_checksum (sock, STATE(skb)->pgm_header, (uint16_t)header_length, STATE(unfolded_odata));
 
 /* add to transmit window, skb::data set to payload */
 		pgm_spinlock_lock (&sock->txw_spinlock);
 		pgm_txw_add (sock->window, STATE(skb));
 		pgm_spinlock_unlock (&sock->txw_spinlock);
-retry_send:
-		pgm_assert ((char*)STATE(skb)->tail > (char*)STATE(skb)->head);
-		tpdu_length = (char*)STATE(skb)->tail - (char*)STATE(skb)->head;
-		sent = pgm_sendto (sock,
-				   !STATE(is_rate_limited),	/* rate limited on blocking */
-			   	   &sock->odata_rate_control,
-				   FALSE,			/* regular socket */
-				   STATE(skb)->head,
-				   tpdu_length,
-				   (struct sockaddr*)&sock->send_gsr.gsr_group,
-				   pgm_sockaddr_len((struct sockaddr*)&sock->send_gsr.gsr_group));
-		if (sent < 0) {
-			save_errno = pgm_get_last_sock_error();
-			if (PGM_LIKELY(PGM_SOCK_EAGAIN == save_errno || PGM_SOCK_ENOBUFS == save_errno))
-			{
-				sock->is_apdu_eagain = TRUE;
-				sock->blocklen = tpdu_length + sock->iphdr_len;
-				goto blocked;
-			}
-/* fall through silently on other errors */
-		}
 
 /* save unfolded odata for retransmissions */
 		pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
-
-		if (PGM_LIKELY((size_t)sent == tpdu_length)) {
-			bytes_sent += tpdu_length + sock->iphdr_len;	/* as counted at IP layer */
-			packets_sent++;					/* IP packets */
-			data_bytes_sent += STATE(tsdu_length);
-		}
-
-		pgm_free_skb (STATE(skb));
 		STATE(data_bytes_offset) += STATE(tsdu_length);
 
-/* check for end of transmission group */
-		if (sock->use_proactive_parity) {
-			const uint32_t odata_sqn   = pgm_ntohl (STATE(skb)->pgm_data->data_sqn);
-			const uint32_t tg_sqn_mask = 0xffffffff << sock->tg_sqn_shift;
-			if (!((odata_sqn + 1) & ~tg_sqn_mask))
-				pgm_schedule_proactive_nak (sock, odata_sqn & tg_sqn_mask);
-		}
+/* queue with the in-transit reference, flush when full or at end of vector */
+		sock->send_batch[ STATE(batch_len)++ ] = STATE(skb);
+		if (STATE(batch_len) < source_batch_size (sock) &&
+		    STATE(vector_index) + 1 < count)
+			continue;
 
+retry_send:
+		status = send_odata_batch (sock, &bytes_sent, &packets_sent, &data_bytes_sent);
+		if (PGM_UNLIKELY(PGM_IO_STATUS_NORMAL != status))
+			goto blocked;
 	}
 #ifdef TRANSPORT_DEBUG
 	if (is_one_apdu)
@@ -2451,11 +2614,9 @@ blocked:
 	}
 	pgm_mutex_unlock (&sock->source_mutex);
 	pgm_rwlock_reader_unlock (&sock->lock);
-	if (PGM_SOCK_ENOBUFS == save_errno)
-		return PGM_IO_STATUS_RATE_LIMITED;
-	if (sock->use_pgmcc)
+	if (PGM_IO_STATUS_WOULD_BLOCK == status && sock->use_pgmcc)
 		pgm_notify_clear (&sock->ack_notify);
-	return PGM_IO_STATUS_WOULD_BLOCK;
+	return status;
 }
 
 /* cleanup resuming send state helper 
@@ -2476,7 +2637,6 @@ send_rdata (
 {
 	size_t			 tpdu_length;
 	struct pgm_header	*header;
-	struct pgm_data		*rdata;
 	ssize_t			 sent;
 
 /* pre-conditions */
@@ -2497,18 +2657,8 @@ send_rdata (
 		return FALSE;
 	}
 
-/* update previous odata/rdata contents */
-	header				= skb->pgm_header;
-	rdata				= skb->pgm_data;
-	header->pgm_type		= PGM_RDATA;
-/* RDATA */
-        rdata->data_trail		= pgm_htonl (pgm_txw_trail(sock->window));
-
-        header->pgm_checksum		= 0;
-	const size_t header_length	= tpdu_length - pgm_ntohs(header->pgm_tsdu_length);
-	const uint32_t unfolded_header	= pgm_csum_partial (header, (uint16_t)header_length, 0);
-	const uint32_t unfolded_odata	= pgm_txw_get_unfolded_checksum (skb);
-	header->pgm_checksum		= pgm_csum_fold (pgm_csum_block_add (unfolded_header, unfolded_odata, (uint16_t)header_length));
+	rdata_prepare (sock, skb);
+	header = skb->pgm_header;
 
 /* congestion control */
 	if (sock->use_pgmcc &&
@@ -2537,7 +2687,7 @@ send_rdata (
 /* fall through silently on other errors */
 	}
 
-	const pgm_time_t now = pgm_time_update_now();
+	const pgm_time_t now = pgm_time_cached_now();
 
 	if (sock->use_pgmcc) {
 		sock->tokens -= pgm_fp8 (1);
@@ -2551,11 +2701,186 @@ send_rdata (
 	sock->next_heartbeat_spm = now + sock->spm_heartbeat_interval[sock->spm_heartbeat_state++];
 	pgm_mutex_unlock (&sock->timer_mutex);
 
+	rdata_sent (sock, skb);
+	return TRUE;
+}
+
+/* drain up to repair_burst_size requests from the retransmit queue with one
+ * batched send.  only the first repair may wait on the rate limit, following
+ * repairs are taken whilst budget and congestion tokens remain.  a parity
+ * repair is built in the shared parity buffer and so ends the burst.
+ *
+ * returns TRUE if any repair was sent, returns FALSE if operation would block
+ * before the first.  a partial burst re-arms rdata_notify for the remainder.
+ */
+
+static
+bool
+send_rdata_burst (
+	pgm_sock_t* const	sock
+	)
+{
+	struct pgm_sk_buff_t*	 skbs[ PGM_MAX_SEND_BATCH ];
+	struct pgm_iovec	 vector[ PGM_MAX_SEND_BATCH ];
+	unsigned		 count, len = 0;
+	int			 sent = 0;
+	bool			 is_blocked = FALSE;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (sock->repair_burst_size <= PGM_MAX_SEND_BATCH);
+
+	pgm_spinlock_lock (&sock->txw_spinlock);
+	count = pgm_txw_retransmit_try_peek_burst (sock->window, skbs, sock->repair_burst_size);
+	for (unsigned i = 0; i < count; i++)
+		skbs[i] = pgm_skb_get (skbs[i]);
+	pgm_spinlock_unlock (&sock->txw_spinlock);
+	if (0 == count)
+		return TRUE;
+
+/* charge each repair individually so that the burst stops where the budget does */
+	for (; len < count; len++)
+	{
+		const size_t tpdu_length = (char*)skbs[len]->tail - (char*)skbs[len]->head;
+		pgm_assert (tpdu_length > 0);
+		if ((sock->use_pgmcc &&
+		     sock->tokens < pgm_fp8 (len + 1)) ||
+		    (sock->is_controlled_rdata &&
+		     !pgm_rate_check2 (&sock->rate_control,
+				       &sock->rdata_rate_control,
+				       tpdu_length,
+				       len > 0 || sock->is_nonblocking)))
+		{
+			sock->blocklen = tpdu_length + sock->iphdr_len;
+			is_blocked = TRUE;
+			break;
+		}
+		rdata_prepare (sock, skbs[len]);
+		vector[len].iov_base = skbs[len]->head;
+		vector[len].iov_len  = tpdu_length;
+	}
+	if (0 == len)
+		goto out;
+
+	if (1 == len) {
+		const ssize_t bytes = pgm_sendto (sock,
+						  FALSE,			/* already rate limited */
+						  &sock->rdata_rate_control,
+						  TRUE,				/* with router alert */
+						  vector[0].iov_base,
+						  vector[0].iov_len,
+						  (struct sockaddr*)&sock->send_gsr.gsr_group,
+						  pgm_sockaddr_len((struct sockaddr*)&sock->send_gsr.gsr_group));
+		sent = (bytes < 0) ? -1 : 1;
+	} else {
+		sent = pgm_sendto_batch (sock,
+					 FALSE,				/* already rate limited */
+					 &sock->rdata_rate_control,
+					 TRUE,				/* with router alert */
+					 vector,
+					 len,
+					 (struct sockaddr*)&sock->send_gsr.gsr_group,
+					 pgm_sockaddr_len((struct sockaddr*)&sock->send_gsr.gsr_group));
+	}
+	if (sent < 0) {
+		const int save_errno = pgm_get_last_sock_error();
+		if (PGM_LIKELY(PGM_SOCK_EAGAIN == save_errno || PGM_SOCK_ENOBUFS == save_errno))
+			sent = 0;
+		else
+/* fall through silently on other errors */
+			sent = (int)len;
+	}
+	if ((unsigned)sent < len) {
+		sock->blocklen = vector[sent].iov_len + sock->iphdr_len;
+		is_blocked = TRUE;
+/* return the charge for repairs the socket did not take */
+		if (sock->is_controlled_rdata)
+			for (unsigned i = (unsigned)sent; i < len; i++)
+				pgm_rate_refund2 (&sock->rate_control, &sock->rdata_rate_control, vector[i].iov_len);
+	}
+	if (0 == sent)
+		goto out;
+
+	const pgm_time_t now = pgm_time_cached_now();
+
+	if (sock->use_pgmcc) {
+		sock->tokens -= pgm_fp8 (sent);
+		sock->ack_expiry = now + sock->ack_expiry_ivl;
+	}
+
+	pgm_mutex_lock (&sock->timer_mutex);
+	sock->spm_heartbeat_state = 1;
+	sock->next_heartbeat_spm = now + sock->spm_heartbeat_interval[sock->spm_heartbeat_state++];
+	pgm_mutex_unlock (&sock->timer_mutex);
+
+/* sent repairs are the oldest requests, remove in queue order */
+	for (int i = 0; i < sent; i++)
+		rdata_sent (sock, skbs[i]);
+	pgm_spinlock_lock (&sock->txw_spinlock);
+	for (int i = 0; i < sent; i++)
+		repair_queue_drained (sock, pgm_txw_retransmit_remove_head (sock->window), now);
+	sock->repair_info.bursts++;
+	pgm_spinlock_unlock (&sock->txw_spinlock);
+
+out:
+	for (unsigned i = 0; i < count; i++)
+		pgm_free_skb (skbs[i]);
+	if (is_blocked) {
+		pgm_notify_send (&sock->rdata_notify);
+		return (sent > 0);
+	}
+	return TRUE;
+}
+
+/* rewrite an ODATA or parity TPDU in place as RDATA.
+ */
+
+static
+void
+rdata_prepare (
+	pgm_sock_t*	      restrict sock,
+	struct pgm_sk_buff_t* restrict skb
+	)
+{
+	struct pgm_header	*header;
+	struct pgm_data		*rdata;
+
+	const size_t tpdu_length	= (char*)skb->tail - (char*)skb->head;
+
+/* update previous odata/rdata contents */
+	header				= skb->pgm_header;
+	rdata				= skb->pgm_data;
+	header->pgm_type		= PGM_RDATA;
+/* the shared parity buffer only carries the GSI */
+	if (header->pgm_options & PGM_OPT_PARITY) {
+		header->pgm_sport	= sock->tsi.sport;
+		header->pgm_dport	= sock->dport;
+	}
+/* RDATA */
+        rdata->data_trail		= pgm_htonl (pgm_txw_trail(sock->window));
+
+        header->pgm_checksum		= 0;
+	const size_t header_length	= tpdu_length - pgm_ntohs(header->pgm_tsdu_length);
+	const uint32_t unfolded_odata	= pgm_txw_get_unfolded_checksum (skb);
+	tpdu_set_checksum (sock, header, (uint16_t)header_length, unfolded_odata);
+}
+
+/* statistics for a sent repair.
+ */
+
+static
+void
+rdata_sent (
+	pgm_sock_t*	      restrict sock,
+	struct pgm_sk_buff_t* restrict skb
+	)
+{
+	const size_t tpdu_length = (char*)skb->tail - (char*)skb->head;
+
 	pgm_txw_inc_retransmit_count (skb);
-	sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_BYTES_RETRANSMITTED] += pgm_ntohs(header->pgm_tsdu_length);
+	sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_BYTES_RETRANSMITTED] += pgm_ntohs(skb->pgm_header->pgm_tsdu_length);
 	sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_MSGS_RETRANSMITTED]++;	/* impossible to determine APDU count */
 	pgm_atomic_add32 (&sock->cumulative_stats[PGM_PC_SOURCE_BYTES_SENT], (uint32_t)(tpdu_length + sock->iphdr_len));
-	return TRUE;
 }
 
 /* eof */
@@ -63,15 +63,19 @@ static gboolean mock_is_valid_spmr = TRUE;
 static gboolean mock_is_valid_ack = TRUE;
 static gboolean mock_is_valid_nak = TRUE;
 static gboolean mock_is_valid_nnak = TRUE;
+static guint8 mock_sent_tpdu[ TEST_MAX_TPDU ];
+static gsize mock_sent_len = 0;
 
 
 #define pgm_txw_get_unfolded_checksum	mock_pgm_txw_get_unfolded_checksum
 #define pgm_txw_set_unfolded_checksum	mock_pgm_txw_set_unfolded_checksum
 #define pgm_txw_inc_retransmit_count	mock_pgm_txw_inc_retransmit_count
 #define pgm_txw_add			mock_pgm_txw_add
+#define pgm_txw_alloc_skb		mock_pgm_txw_alloc_skb
 #define pgm_txw_peek			mock_pgm_txw_peek
 #define pgm_txw_retransmit_push		mock_pgm_txw_retransmit_push
 #define pgm_txw_retransmit_try_peek	mock_pgm_txw_retransmit_try_peek
+#define pgm_txw_retransmit_try_peek_burst	mock_pgm_txw_retransmit_try_peek_burst
 #define pgm_txw_retransmit_remove_head	mock_pgm_txw_retransmit_remove_head
 #define pgm_rs_encode			mock_pgm_rs_encode
 #define pgm_rate_check			mock_pgm_rate_check
@@ -84,6 +88,7 @@ static gboolean mock_is_valid_nnak = TRUE;
 #define pgm_csum_block_add		mock_pgm_csum_block_add
 #define pgm_csum_fold			mock_pgm_csum_fold
 #define pgm_sendto_hops			mock_pgm_sendto_hops
+#define pgm_sendto_batch		mock_pgm_sendto_batch
 #define pgm_time_update_now		mock_pgm_time_update_now
 #define pgm_setsockopt			mock_pgm_setsockopt
 
@@ -120,6 +125,7 @@ generate_sock (void)
 	sock->max_tsdu_fragment = TEST_MAX_TPDU - sizeof(struct pgm_ip) - pgm_pkt_offset (TRUE, FALSE);
 	sock->max_apdu = MIN(TEST_TXW_SQNS, PGM_MAX_FRAGMENTS) * sock->max_tsdu_fragment;
 	sock->iphdr_len = sizeof(struct pgm_ip);
+	sock->send_batch = g_new0 (struct pgm_sk_buff_t*, 1);
 	sock->spm_heartbeat_interval = g_malloc0 (sizeof(guint) * (2+2));
 	sock->spm_heartbeat_interval[0] = pgm_secs(1);
 	pgm_spinlock_init (&sock->txw_spinlock);
@@ -300,6 +306,17 @@ mock_pgm_txw_add (
 		(gpointer)window, (gpointer)skb);
 }
 
+struct pgm_sk_buff_t*
+mock_pgm_txw_alloc_skb (
+	pgm_txw_t* const		window,
+	const uint16_t			max_tpdu
+	)
+{
+	g_debug ("mock_pgm_txw_alloc_skb (window:%p max-tpdu:%" G_GUINT16_FORMAT ")",
+		(gpointer)window, max_tpdu);
+	return pgm_alloc_skb (max_tpdu);
+}
+
 struct pgm_sk_buff_t*
 mock_pgm_txw_peek (
 	const pgm_txw_t* const		window,
@@ -316,7 +333,8 @@ mock_pgm_txw_retransmit_push (
 	pgm_txw_t* const		window,
 	const uint32_t			sequence,
 	const bool			is_parity,
-	const uint8_t			tg_sqn_shift
+	const uint8_t			tg_sqn_shift,
+	const pgm_time_t		now
 	)
 {
 	g_debug ("mock_pgm_txw_retransmit_push (window:%p sequence:%" G_GUINT32_FORMAT " is-parity:%s tg-sqn-shift:%d)",
@@ -360,13 +378,28 @@ mock_pgm_txw_retransmit_try_peek (
 	return generate_odata (); 
 }
 
-void
+unsigned
+mock_pgm_txw_retransmit_try_peek_burst (
+	pgm_txw_t* const		window,
+	struct pgm_sk_buff_t**		skbs,
+	const unsigned			max_count
+	)
+{
+	g_debug ("mock_pgm_txw_retransmit_try_peek_burst (window:%p skbs:%p max-count:%u)",
+		(gpointer)window, (gpointer)skbs, max_count);
+	for (unsigned i = 0; i < max_count; i++)
+		skbs[i] = generate_odata ();
+	return max_count;
+}
+
+pgm_time_t
 mock_pgm_txw_retransmit_remove_head (
 	pgm_txw_t* const		window
 	)
 {
 	g_debug ("mock_pgm_txw_retransmit_remove_head (window:%p)",
 		(gpointer)window);
+	return 0;
 }
 
 void
@@ -492,9 +525,37 @@ mock_pgm_sendto_hops (
 		(unsigned)len,
 		saddr,
 		tolen);
+	mock_sent_len = MIN(len, sizeof(mock_sent_tpdu));
+	memcpy (mock_sent_tpdu, buf, mock_sent_len);
 	return len;
 }
 
+int
+mock_pgm_sendto_batch (
+	pgm_sock_t*			sock,
+	bool				use_rate_limit,
+	pgm_rate_t*			minor_rate_control,
+	bool				use_router_alert,
+	const struct pgm_iovec*		vector,
+	unsigned			count,
+	const struct sockaddr*		to,
+	socklen_t			tolen
+	)
+{
+	char saddr[INET6_ADDRSTRLEN];
+	pgm_sockaddr_ntop (to, saddr, sizeof(saddr));
+	g_debug ("mock_pgm_sendto_batch (sock:%p use-rate-limit:%s minor-rate-control:%p use-router-alert:%s vector:%p count:%u to:%s tolen:%d)",
+		(gpointer)sock,
+		use_rate_limit ? "YES" : "NO",
+		(gpointer)minor_rate_control,
+		use_router_alert ? "YES" : "NO",
+		(gconstpointer)vector,
+		count,
+		saddr,
+		tolen);
+	return (int)count;
+}
+
 /** time module */
 static pgm_time_t _mock_pgm_time_update_now (void);
 pgm_time_update_func mock_pgm_time_update_now = _mock_pgm_time_update_now;
@@ -583,6 +644,36 @@ START_TEST (test_send_pass_002)
 }
 END_TEST
 
+/* OPT_TSTAMP carries the wall clock transmit time */
+START_TEST (test_send_pass_003)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->is_bound = TRUE;
+	sock->use_tx_tstamp = TRUE;
+	sock->max_tsdu -= pgm_pkt_tstamp_offset (sock, FALSE);
+	const gsize apdu_length = 100;
+	guint8 buffer[ apdu_length ];
+	gsize bytes_written;
+	const guint64 before = pgm_time_epoch_nsecs();
+	fail_unless (PGM_IO_STATUS_NORMAL == pgm_send (sock, buffer, apdu_length, &bytes_written), "send not normal");
+	fail_unless ((gssize)apdu_length == bytes_written, "send underrun");
+	const gsize header_length = sizeof(struct pgm_header) + sizeof(struct pgm_data) +
+				    sizeof(struct pgm_opt_length) + sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_tstamp);
+	fail_unless (header_length + apdu_length == mock_sent_len, "tpdu length");
+	const struct pgm_header* header = (const struct pgm_header*)mock_sent_tpdu;
+	fail_unless (header->pgm_options & PGM_OPT_PRESENT, "options not present");
+	const struct pgm_opt_length* opt_len = (const struct pgm_opt_length*)((const struct pgm_data*)(header + 1) + 1);
+	fail_unless (PGM_OPT_LENGTH == opt_len->opt_type, "opt_length");
+	fail_unless (sizeof(struct pgm_opt_length) + sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_tstamp) == g_ntohs (opt_len->opt_total_length), "opt_total_length");
+	const struct pgm_opt_header* opt_header = (const struct pgm_opt_header*)(opt_len + 1);
+	fail_unless ((PGM_OPT_TSTAMP | PGM_OPT_END) == opt_header->opt_type, "opt_tstamp type");
+	const struct pgm_opt_tstamp* opt_tstamp = (const struct pgm_opt_tstamp*)(opt_header + 1);
+	const guint64 tstamp = (guint64)g_ntohl (opt_tstamp->opt_tstamp_sec) * UINT64_C(1000000000) + g_ntohl (opt_tstamp->opt_tstamp_nsec);
+	fail_unless (tstamp >= before && tstamp <= pgm_time_epoch_nsecs(), "transmit time");
+}
+END_TEST
+
 START_TEST (test_send_fail_001)
 {
 	guint8 buffer[ TEST_TXW_SQNS * TEST_MAX_TPDU ];
@@ -789,6 +880,18 @@ START_TEST (test_on_deferred_nak_pass_001)
 	pgm_on_deferred_nak (sock);
 }
 END_TEST
+
+/* burst of repairs in one batched send */
+START_TEST (test_on_deferred_nak_pass_002)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->repair_burst_size = 4;
+	fail_unless (TRUE == pgm_on_deferred_nak (sock), "on_deferred_nak failed");
+	fail_unless (4 == sock->repair_info.repairs, "repairs");
+	fail_unless (1 == sock->repair_info.bursts, "bursts");
+}
+END_TEST
 	
 START_TEST (test_on_deferred_nak_fail_001)
 {
@@ -1158,6 +1261,7 @@ make_test_suite (void)
 	tcase_add_checked_fixture (tc_send, mock_setup, NULL);
 	tcase_add_test (tc_send, test_send_pass_001);
 	tcase_add_test (tc_send, test_send_pass_002);
+	tcase_add_test (tc_send, test_send_pass_003);
 	tcase_add_test (tc_send, test_send_fail_001);
 
 	TCase* tc_sendv = tcase_create ("sendv");
@@ -1188,6 +1292,7 @@ make_test_suite (void)
 	suite_add_tcase (s, tc_on_deferred_nak);
 	tcase_add_checked_fixture (tc_on_deferred_nak, mock_setup, NULL);
 	tcase_add_test (tc_on_deferred_nak, test_on_deferred_nak_pass_001);
+	tcase_add_test (tc_on_deferred_nak, test_on_deferred_nak_pass_002);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_on_deferred_nak, test_on_deferred_nak_fail_001, SIGABRT);
 #endif
@@ -26,6 +26,7 @@
 #endif
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #ifdef _WIN32
 #	define WIN32_LEAN_AND_MEAN
 #	include <windows.h>
@@ -41,6 +42,10 @@
 
 pgm_time_update_func		pgm_time_update_now PGM_GNUC_READ_MOSTLY;
 pgm_time_since_epoch_func	pgm_time_since_epoch PGM_GNUC_READ_MOSTLY;
+bool				pgm_time_use_cache PGM_GNUC_READ_MOSTLY = FALSE;
+#ifdef PGM_TIME_TLS
+PGM_TIME_TLS pgm_time_t		pgm_time_cache = 0;
+#endif
 
 
 /* locals */
@@ -73,6 +78,9 @@ static void			pgm_time_conv_from_reset (const pgm_time_t*const restrict, time_t*
 #if defined(HAVE_CLOCK_GETTIME)
 #	include <time.h>
 static pgm_time_t		pgm_clock_update (void);
+#	ifdef CLOCK_MONOTONIC_COARSE
+static pgm_time_t		pgm_coarse_update (void);
+#	endif
 #endif
 #ifdef HAVE_FTIME
 #	include <sys/timeb.h>
@@ -170,6 +178,9 @@ static pgm_time_t		pgm_rtc_update (void);
 #	elif defined(_MSC_VER)
 #		include <intrin.h>
 #	endif
+#	ifndef _WIN32
+#		include <unistd.h>
+#	endif
 #	define TSC_NS_SCALE	10 /* 2^10, carefully chosen */
 #	define TSC_US_SCALE	20
 static uint_fast32_t		tsc_khz PGM_GNUC_READ_MOSTLY = 0;
@@ -241,7 +252,7 @@ pgm_time_init (
 	pgm_error_t**	error
 	)
 {
-	char	*pgm_timer;
+	char	*pgm_timer, *time_cache;
 	size_t	 envlen;
 	errno_t	 err;
 
@@ -272,6 +283,22 @@ pgm_time_init (
 #endif
 #ifdef HAVE_CLOCK_GETTIME
 	case 'C':
+#	ifdef CLOCK_MONOTONIC_COARSE
+/* e.g. export PGM_TIMER=COARSE
+ *
+ * resolution is the kernel tick, too coarse for rate limits beyond a few
+ * packets per tick.
+ */
+		if (0 == strncmp (pgm_timer, "COARSE", strlen ("COARSE"))) {
+			struct timespec res;
+			clock_getres (CLOCK_MONOTONIC_COARSE, &res);
+			pgm_minor (_("Using clock_gettime() coarse timer, resolution %ldus."),
+				   (long)(secs_to_usecs (res.tv_sec) + nsecs_to_usecs (res.tv_nsec)));
+			pgm_time_update_now	= pgm_coarse_update;
+			pgm_time_since_epoch	= pgm_time_conv_from_reset;
+			break;
+		}
+#	endif
 		pgm_minor (_("Using clock_gettime() timer."));
 		pgm_time_update_now	= pgm_clock_update;
 		break;
@@ -330,6 +357,22 @@ pgm_time_init (
 /* clean environment copy */
 	pgm_free (pgm_timer);
 
+/* e.g. export PGM_TIME_CACHE=1
+ *
+ * serve hot paths the time read at the start of each receive iteration, send
+ * call or receive batch instead of reading the clock at each use.
+ */
+	err = pgm_dupenv_s (&time_cache, &envlen, "PGM_TIME_CACHE");
+	if (0 == err && envlen > 0) {
+#ifdef PGM_TIME_TLS
+		pgm_minor (_("Using cached time stamps."));
+		pgm_time_use_cache = TRUE;
+#else
+		pgm_warn (_("Cached time stamps require thread-local storage, ignoring PGM_TIME_CACHE."));
+#endif
+		pgm_free (time_cache);
+	}
+
 #ifdef HAVE_DEV_RTC
 	if (pgm_time_update_now == pgm_rtc_update)
 	{
@@ -373,22 +416,9 @@ pgm_time_init (
 		char	*rdtsc_frequency;
 
 #ifdef HAVE_PROC_CPUINFO
-/* attempt to parse clock ticks from kernel
+/* "cpu MHz" of /proc/cpuinfo follows frequency scaling and is not the rate of
+ * an invariant TSC, leave the frequency to pgm_tsc_init().
  */
-		FILE	*fp = fopen ("/proc/cpuinfo", "r");
-		if (fp)
-		{
-			char buffer[1024];
-			while (!feof(fp) && fgets (buffer, sizeof(buffer), fp))
-			{
-				if (strstr (buffer, "cpu MHz")) {
-					const char *p = strchr (buffer, ':');
-					if (p) tsc_khz = atoi (p + 1) * 1000;
-					break;
-				}
-			}
-			fclose (fp);
-		}
 #elif defined(_WIN32)
 /* core frequency HKLM/Hardware/Description/System/CentralProcessor/0/~Mhz
  */
@@ -523,6 +553,9 @@ pgm_time_init (
 #	ifdef HAVE_DEV_HPET
 		|| pgm_time_update_now == pgm_hpet_update
 #	endif
+#	if defined( HAVE_CLOCK_GETTIME ) && defined( CLOCK_MONOTONIC_COARSE )
+		|| pgm_time_update_now == pgm_coarse_update
+#	endif
 #	ifdef _WIN32
 		|| pgm_time_update_now == pgm_mmtime_update
 		|| pgm_time_update_now == pgm_queryperformancecounter_update
@@ -576,6 +609,8 @@ pgm_time_shutdown (void)
 	if (pgm_atomic_exchange_and_add32 (&time_ref_count, (uint32_t)-1) != 1)
 		return retval;
 
+	pgm_time_use_cache = FALSE;
+
 #ifdef _WIN32
 	timeEndPeriod (wTimerRes);
 #endif
@@ -591,6 +626,35 @@ pgm_time_shutdown (void)
 	return retval;
 }
 
+/* wall clock in nanoseconds since the Unix epoch, comparable with the clocks
+ * of other hosts unlike pgm_time_update_now().
+ */
+
+PGM_GNUC_INTERNAL
+uint64_t
+pgm_time_epoch_nsecs (void)
+{
+#if defined( HAVE_CLOCK_GETTIME )
+	struct timespec	clock_now;
+	clock_gettime (CLOCK_REALTIME, &clock_now);
+	return secs_to_nsecs (clock_now.tv_sec) + clock_now.tv_nsec;
+#elif defined( HAVE_GETTIMEOFDAY )
+	struct timeval	gettimeofday_now;
+	gettimeofday (&gettimeofday_now, NULL);
+	return secs_to_nsecs (gettimeofday_now.tv_sec) + usecs_to_nsecs (gettimeofday_now.tv_usec);
+#elif defined( _WIN32 )
+/* FILETIME counts 100ns intervals since 1601-01-01 */
+	FILETIME	filetime_now;
+	ULARGE_INTEGER	intervals;
+	GetSystemTimeAsFileTime (&filetime_now);
+	intervals.LowPart  = filetime_now.dwLowDateTime;
+	intervals.HighPart = filetime_now.dwHighDateTime;
+	return (intervals.QuadPart - UINT64_C(116444736000000000)) * 100;
+#else
+	return usecs_to_nsecs (pgm_ftime_update());
+#endif
+}
+
 #ifdef HAVE_GETTIMEOFDAY
 static
 pgm_time_t
@@ -625,6 +689,27 @@ pgm_clock_update (void)
 	else
 		return last = now;
 }
+
+#	ifdef CLOCK_MONOTONIC_COARSE
+/* last kernel tick as maintained in the vDSO page, no counter is read.
+ */
+
+static
+pgm_time_t
+pgm_coarse_update (void)
+{
+	struct timespec		clock_now;
+	pgm_time_t		now;
+	static pgm_time_t	last = 0;
+
+	clock_gettime (CLOCK_MONOTONIC_COARSE, &clock_now);
+	now = secs_to_usecs (clock_now.tv_sec) + nsecs_to_usecs (clock_now.tv_nsec);
+	if (PGM_UNLIKELY(now < last))
+		return last;
+	else
+		return last = now;
+}
+#	endif
 #endif /* HAVE_CLOCK_GETTIME */
 
 #ifdef HAVE_FTIME
@@ -800,8 +885,145 @@ pgm_rdtsc (void)
 }
 
 #	ifndef _WIN32
-/* determine ratio of ticks to nano-seconds, use /dev/rtc for high accuracy
- * millisecond timer and convert.
+/* reference for calibration, unaffected by NTP slewing where available */
+#		if defined( CLOCK_MONOTONIC_RAW )
+#			define TSC_CALIBRATION_CLOCK	CLOCK_MONOTONIC_RAW
+#		else
+#			define TSC_CALIBRATION_CLOCK	CLOCK_MONOTONIC
+#		endif
+#		define TSC_CALIBRATION_MSECS	25
+#		define TSC_CALIBRATION_SAMPLES	5
+
+/* pair a TSC reading with the reference clock, the reference is read between
+ * two TSC reads and the narrowest of a few attempts bounds the pairing error.
+ *
+ * returns reference time in nanoseconds.
+ */
+
+static
+uint64_t
+pgm_tsc_sample (
+	uint64_t*	tsc
+	)
+{
+	uint64_t best = UINT64_MAX, ref_nsecs = 0;
+
+	for (unsigned i = 0; i < TSC_CALIBRATION_SAMPLES; i++)
+	{
+		const uint64_t before = pgm_rdtsc();
+#		ifdef HAVE_CLOCK_GETTIME
+		struct timespec clock_now;
+		clock_gettime (TSC_CALIBRATION_CLOCK, &clock_now);
+		const uint64_t nsecs = secs_to_nsecs (clock_now.tv_sec) + clock_now.tv_nsec;
+#		else
+		struct timeval gettimeofday_now;
+		gettimeofday (&gettimeofday_now, NULL);
+		const uint64_t nsecs = secs_to_nsecs (gettimeofday_now.tv_sec) + usecs_to_nsecs (gettimeofday_now.tv_usec);
+#		endif
+		const uint64_t after = pgm_rdtsc();
+		if (after - before < best) {
+			best      = after - before;
+			*tsc      = before + best / 2;
+			ref_nsecs = nsecs;
+		}
+	}
+	return ref_nsecs;
+}
+
+/* identity of the running kernel instance, a cached frequency is only trusted
+ * for the boot that measured it.
+ */
+
+static
+void
+pgm_tsc_boot_id (
+	char*		buf,
+	const size_t	len
+	)
+{
+	strcpy (buf, "-");
+#		ifdef __linux__
+	FILE* fp = fopen ("/proc/sys/kernel/random/boot_id", "r");
+	if (fp) {
+		if (fgets (buf, (int)len, fp))
+			buf[ strcspn (buf, "\r\n") ] = '\0';
+		else
+			strcpy (buf, "-");
+		fclose (fp);
+	}
+#		endif
+}
+
+/* PGM_TSC_CACHE names a file holding the frequency of a previous calibration,
+ * e.g. export PGM_TSC_CACHE=/var/tmp/pgm-tsc
+ *
+ * returns frequency in KHz, or 0 if unset, absent, or stale.
+ */
+
+static
+uint_fast32_t
+pgm_tsc_cache_read (
+	const char*	path
+	)
+{
+	char		buffer[128], cached_id[64], boot_id[64];
+	unsigned	khz = 0;
+	FILE*		fp = fopen (path, "r");
+
+	if (NULL == fp)
+		return 0;
+	if (NULL == fgets (buffer, sizeof (buffer), fp) ||
+	    2 != sscanf (buffer, "%u %63s", &khz, cached_id))
+	{
+		khz = 0;
+	}
+	fclose (fp);
+	if (0 == khz)
+		return 0;
+	pgm_tsc_boot_id (boot_id, sizeof (boot_id));
+	if (0 != strcmp (cached_id, boot_id)) {
+		pgm_minor (_("Ignoring TSC frequency cached by a previous boot in %s."), path);
+		return 0;
+	}
+	return khz;
+}
+
+/* replaced by rename so that concurrently starting processes never read a
+ * partial file.
+ */
+
+static
+void
+pgm_tsc_cache_write (
+	const char*		path,
+	const uint_fast32_t	khz
+	)
+{
+	char	tmp_path[1024], boot_id[64];
+	FILE*	fp;
+
+	pgm_tsc_boot_id (boot_id, sizeof (boot_id));
+	if (pgm_snprintf_s (tmp_path, sizeof (tmp_path), _TRUNCATE, "%s.%u", path, (unsigned)getpid()) < 0)
+		return;
+	fp = fopen (tmp_path, "w");
+	if (NULL == fp) {
+		char errbuf[1024];
+		pgm_warn (_("Cannot write TSC frequency cache %s: %s"),
+			  tmp_path, pgm_strerror_s (errbuf, sizeof (errbuf), errno));
+		return;
+	}
+	fprintf (fp, "%u %s\n", (unsigned)khz, boot_id);
+	if (0 != fclose (fp) || 0 != rename (tmp_path, path)) {
+		char errbuf[1024];
+		pgm_warn (_("Cannot write TSC frequency cache %s: %s"),
+			  path, pgm_strerror_s (errbuf, sizeof (errbuf), errno));
+		unlink (tmp_path);
+	}
+}
+
+/* determine ratio of ticks to nano-seconds, in order of preference from the
+ * processor, the kernel, a cache of a previous calibration, and finally a
+ * short calibration against the monotonic clock.
  *
  * WARNING: time is relative to start of timer.
  */
@@ -812,21 +1034,20 @@ pgm_tsc_init (
 	PGM_GNUC_UNUSED pgm_error_t**	error
 	)
 {
+	char*	cache_path = NULL;
+	size_t	envlen;
+	errno_t	err;
+
 #		ifdef HAVE_PROC_CPUINFO
 /* Test for constant TSC from kernel
  */
 	FILE	*fp = fopen ("/proc/cpuinfo", "r");
 	char	buffer[1024], *flags = NULL;
-	int	tmp_tsc_mhz = 0;
-	bool	ret = FALSE;
 	if (fp)
 	{
 		while (!feof(fp) && fgets (buffer, sizeof(buffer), fp))
 		{
-			if (strstr (buffer, "cpu MHz")) {
-				const char *p = strchr (buffer, ':');
-				if (p) tmp_tsc_mhz = atoi (p + 1) * 1000;
-			} else if (strstr (buffer, "flags")) {
+			if (strstr (buffer, "flags")) {
 				flags = strchr (buffer, ':');
 				break;
 			}
@@ -837,59 +1058,84 @@ pgm_tsc_init (
 		pgm_warn (_("Linux kernel reports no Time Stamp Counter (TSC)."));
 /* force both to stable clocks even though one might be OK */
 		pgm_time_update_now	= pgm_gettimeofday_update;
-		ret = TRUE;
+		return TRUE;
 	} else if (!strstr (flags, " constant_tsc")) {
 		pgm_warn (_("Linux kernel reports non-constant Time Stamp Counter (TSC)."));
 /* force both to stable clocks even though one might be OK */
 		pgm_time_update_now	= pgm_gettimeofday_update;
-		ret = TRUE;
+		return TRUE;
 	}
+#		endif /* HAVE_PROC_CPUINFO */
 
-/* Only return in case the kernel doesn't report 0 as cpu MHz */
-	if ((tmp_tsc_mhz != 0) && ret)
+	tsc_khz = pgm_cpuid_tsc_khz();
+	if (tsc_khz > 0) {
+		pgm_minor (_("CPUID reports TSC frequency %" PRIuFAST32 " KHz."), tsc_khz);
 		return TRUE;
+	}
 
-#		endif /* HAVE_PROC_CPUINFO */
+#		ifdef __linux__
+/* kernel calibration, only exported by some kernels */
+	FILE* sysfs_fp = fopen ("/sys/devices/system/cpu/cpu0/tsc_freq_khz", "r");
+	if (sysfs_fp) {
+		unsigned khz;
+		if (1 == fscanf (sysfs_fp, "%u", &khz))
+			tsc_khz = khz;
+		fclose (sysfs_fp);
+		if (tsc_khz > 0) {
+			pgm_minor (_("Kernel reports TSC frequency %" PRIuFAST32 " KHz."), tsc_khz);
+			return TRUE;
+		}
+	}
+#		endif
 
-	pgm_time_t		start, stop, elapsed;
-	const pgm_time_t	calibration_usec = secs_to_usecs (4);
-	struct timespec		req = {
-					.tv_sec  = 4,
-					.tv_nsec = 0
-				};
+	err = pgm_dupenv_s (&cache_path, &envlen, "PGM_TSC_CACHE");
+	if (0 != err || 0 == envlen) {
+		if (NULL != cache_path)
+			pgm_free (cache_path);
+		cache_path = NULL;
+	} else {
+		tsc_khz = pgm_tsc_cache_read (cache_path);
+		if (tsc_khz > 0) {
+			pgm_minor (_("Using TSC frequency %" PRIuFAST32 " KHz cached in %s."), tsc_khz, cache_path);
+			pgm_free (cache_path);
+			return TRUE;
+		}
+	}
 
-	pgm_info (_("Running a benchmark to measure system clock frequency..."));
+/* The counter is read either side of the reference clock at both ends of a
+ * short interval, so accuracy is limited by the clock resolution and read cost
+ * rather than by the interval length.
+ */
+	uint64_t		start_tsc = 0, stop_tsc = 0;
+	const struct timespec	req = {
+					.tv_sec  = 0,
+					.tv_nsec = msecs_to_nsecs (TSC_CALIBRATION_MSECS)
+				};
+	struct timespec		rem = req;
 
-	start = pgm_rdtsc();
-	while (-1 == nanosleep (&req, &req) && EINTR == errno);
-	stop = pgm_rdtsc();
+	const uint64_t start_nsecs = pgm_tsc_sample (&start_tsc);
+	while (-1 == nanosleep (&rem, &rem) && EINTR == errno);
+	const uint64_t stop_nsecs = pgm_tsc_sample (&stop_tsc);
 
-	if (stop < start)
+	if (stop_tsc <= start_tsc || stop_nsecs <= start_nsecs)
 	{
 		pgm_warn (_("Finished RDTSC test.  Unstable TSC detected.  The benchmark resulted in a "
 			   "non-monotonic time response rendering the TSC unsuitable for high resolution "
-			   "timing.  To prevent the start delay from this benchmark and use a stable clock "
-			   "source set the environment variable PGM_TIMER to GTOD."));
+			   "timing.  To use a stable clock source set the environment variable PGM_TIMER to GTOD."));
 /* force both to stable clocks even though one might be OK */
 		pgm_time_update_now = pgm_gettimeofday_update;
+		if (NULL != cache_path)
+			pgm_free (cache_path);
 		return TRUE;
 	}
 
-/* TODO: this math needs to be scaled to reduce rounding errors */
-	elapsed = stop - start;
-	if (elapsed > calibration_usec) {
-/* cpu > 1 Ghz */
-		tsc_khz = (elapsed * 1000) / calibration_usec;
-	} else {
-/* cpu < 1 Ghz */
-		tsc_khz = -( (calibration_usec * 1000) / elapsed );
-	}
+	tsc_khz = (uint_fast32_t)(((stop_tsc - start_tsc) * UINT64_C(1000000)) / (stop_nsecs - start_nsecs));
 
-	pgm_info (_("Finished RDTSC test. To prevent the startup delay from this benchmark, "
-		   "set the environment variable RDTSC_FREQUENCY to %" PRIuFAST32 " on this "
-		   "system. This value is dependent upon the CPU clock speed and "
-		   "architecture and should be determined separately for each server."),
-		   tsc_khz);
+	pgm_minor (_("Finished RDTSC test, measured TSC frequency %" PRIuFAST32 " KHz."), tsc_khz);
+	if (NULL != cache_path) {
+		pgm_tsc_cache_write (cache_path, tsc_khz);
+		pgm_free (cache_path);
+	}
 	return TRUE;
 }
 #	endif
@@ -51,7 +51,7 @@ pgm_timer_prepare (
 	pgm_assert (NULL != sock);
 	pgm_assert (sock->can_send_data || sock->can_recv_data);
 
-	now = pgm_time_update_now();
+	now = pgm_time_cached_now();
 
 	if (sock->can_send_data)
 		expiration = sock->next_ambient_spm;
@@ -78,7 +78,7 @@ pgm_timer_check (
 	pgm_sock_t* const	sock
 	)
 {
-	const pgm_time_t now = pgm_time_update_now();
+	const pgm_time_t now = pgm_time_cached_now();
 	bool expired;
 
 /* pre-conditions */
@@ -99,7 +99,7 @@ pgm_timer_expiration (
 	pgm_sock_t* const	sock
 	)
 {
-	const pgm_time_t now = pgm_time_update_now();
+	const pgm_time_t now = pgm_time_cached_now();
 	pgm_time_t expiration;
 
 /* pre-conditions */
@@ -108,6 +108,12 @@ pgm_timer_expiration (
 	pgm_timer_lock (sock);
 	expiration = pgm_time_after (sock->next_poll, now) ? pgm_to_usecs (sock->next_poll - now) : 0;
 	pgm_timer_unlock (sock);
+/* wake for delayed loopback packets as for a timer */
+	if (NULL != sock->loopback) {
+		pgm_time_t due;
+		if (pgm_loopback_next_due (sock->loopback, &due))
+			expiration = MIN(expiration, pgm_time_after (due, now) ? pgm_to_usecs (due - now) : 0);
+	}
 	return expiration;
 }
 
@@ -123,7 +129,7 @@ pgm_timer_dispatch (
 	pgm_sock_t* const	sock
 	)
 {
-	const pgm_time_t now = pgm_time_update_now();
+	const pgm_time_t now = pgm_time_cached_now();
 	pgm_time_t next_expiration = 0;
 
 /* pre-conditions */
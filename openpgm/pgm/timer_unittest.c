@@ -48,6 +48,7 @@
 #define pgm_min_receiver_expiry		mock_pgm_min_receiver_expiry
 #define pgm_check_peer_state		mock_pgm_check_peer_state
 #define pgm_send_spm			mock_pgm_send_spm
+#define pgm_loopback_next_due		mock_pgm_loopback_next_due
 
 
 #define TIMER_DEBUG
@@ -186,6 +187,18 @@ _mock_pgm_time_update_now (void)
 	return mock_pgm_time_now;
 }
 
+/** loopback module */
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_loopback_next_due (
+	pgm_loopback_t*		ep,
+	pgm_time_t*		due
+	)
+{
+	g_assert_not_reached();
+	return FALSE;
+}
+
 /** receiver module */
 PGM_GNUC_INTERNAL
 pgm_time_t
@@ -0,0 +1,225 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Open-addressing map from transport session identifier (TSI) to peer.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <impl/framework.h>
+
+
+//#define TSIMAP_DEBUG
+
+#define TSIMAP_MIN_SIZE		PGM_TSIMAP_GROUP
+#define TSIMAP_MAX_SIZE		(1U << 30)
+
+static void pgm_tsimap_alloc (pgm_tsimap_t*, const uint32_t);
+static void pgm_tsimap_resize (pgm_tsimap_t*, const uint32_t);
+static uint32_t pgm_tsimap_find_free (const pgm_tsimap_t*, const uint64_t);
+static void pgm_tsimap_set_ctrl (pgm_tsimap_t*, const uint32_t, const int8_t);
+
+PGM_GNUC_INTERNAL
+pgm_tsimap_t*
+pgm_tsimap_new (void)
+{
+	pgm_tsimap_t* map = pgm_new0 (pgm_tsimap_t, 1);
+	pgm_tsimap_alloc (map, TSIMAP_MIN_SIZE);
+	return map;
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_tsimap_destroy (
+	pgm_tsimap_t*	map
+	)
+{
+	pgm_return_if_fail (NULL != map);
+
+	pgm_free (map->ctrl);
+	pgm_free (map->slots);
+	pgm_free (map);
+}
+
+/* insert value for tsi, tsi must not already be present.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_tsimap_insert (
+	pgm_tsimap_t*	 restrict map,
+	const pgm_tsi_t* restrict tsi,
+	void*		 restrict value
+	)
+{
+	pgm_return_if_fail (NULL != map);
+	pgm_return_if_fail (NULL == pgm_tsimap_lookup (map, tsi));
+
+/* maximum load factor of 7/8 including tombstones */
+	const uint32_t capacity = map->mask + 1;
+	if (PGM_UNLIKELY((map->nnodes + map->ndeleted + 1) * 8 > capacity * 7)) {
+/* purge tombstones in place when they, not live entries, fill the table */
+		if ((map->nnodes + 1) * 16 > capacity * 7 && capacity < TSIMAP_MAX_SIZE)
+			pgm_tsimap_resize (map, capacity * 2);
+		else
+			pgm_tsimap_resize (map, capacity);
+	}
+
+	const uint64_t key = pgm_tsimap_key (tsi);
+	const uint64_t hash = pgm_tsimap_hash (key);
+	const uint32_t i = pgm_tsimap_find_free (map, hash);
+	if (PGM_TSIMAP_DELETED == map->ctrl[ i ])
+		map->ndeleted--;
+	pgm_tsimap_set_ctrl (map, i, (int8_t)(hash & 0x7f));
+	map->slots[ i ].key   = key;
+	map->slots[ i ].value = value;
+	map->nnodes++;
+}
+
+/* returns TRUE if tsi was present and has been removed.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_tsimap_remove (
+	pgm_tsimap_t*	 restrict map,
+	const pgm_tsi_t* restrict tsi
+	)
+{
+	pgm_return_val_if_fail (NULL != map, FALSE);
+
+	const uint64_t key = pgm_tsimap_key (tsi);
+	const uint64_t hash = pgm_tsimap_hash (key);
+	const int8_t tag = (int8_t)(hash & 0x7f);
+	uint32_t pos = (uint32_t)(hash >> 7) & map->mask;
+
+	for (uint32_t stride = 0;;)
+	{
+		for (unsigned match = pgm_tsimap_match (&map->ctrl[ pos ], tag); match; match &= match - 1)
+		{
+			const uint32_t i = (pos + pgm_tsimap_ctz (match)) & map->mask;
+			if (map->slots[ i ].key != key)
+				continue;
+/* a probe for another key may have passed over this slot, so an empty
+ * marker would cut that probe short.
+ */
+			pgm_tsimap_set_ctrl (map, i, PGM_TSIMAP_DELETED);
+			map->slots[ i ].value = NULL;
+			map->nnodes--;
+			map->ndeleted++;
+			return TRUE;
+		}
+		if (pgm_tsimap_match (&map->ctrl[ pos ], PGM_TSIMAP_EMPTY))
+			return FALSE;
+		stride += PGM_TSIMAP_GROUP;
+		pos = (pos + stride) & map->mask;
+	}
+}
+
+static
+void
+pgm_tsimap_alloc (
+	pgm_tsimap_t*	map,
+	const uint32_t	capacity
+	)
+{
+	pgm_assert (capacity >= PGM_TSIMAP_GROUP);
+	pgm_assert (0 == (capacity & (capacity - 1)));
+
+	map->ctrl  = pgm_malloc (capacity + PGM_TSIMAP_GROUP);
+	memset (map->ctrl, PGM_TSIMAP_EMPTY, capacity + PGM_TSIMAP_GROUP);
+	map->slots = pgm_new0 (struct pgm_tsimap_slot_t, capacity);
+	map->mask  = capacity - 1;
+	map->nnodes = map->ndeleted = 0;
+}
+
+/* rehash every live entry into a table of capacity slots, dropping all
+ * tombstones.
+ */
+
+static
+void
+pgm_tsimap_resize (
+	pgm_tsimap_t*	map,
+	const uint32_t	capacity
+	)
+{
+	int8_t* old_ctrl = map->ctrl;
+	struct pgm_tsimap_slot_t* old_slots = map->slots;
+	const uint32_t old_capacity = map->mask + 1;
+
+#ifdef TSIMAP_DEBUG
+	pgm_debug ("pgm_tsimap_resize (map:%p capacity:%" PRIu32 " nnodes:%u ndeleted:%u)",
+		(const void*)map, capacity, map->nnodes, map->ndeleted);
+#endif
+	pgm_tsimap_alloc (map, capacity);
+	for (uint32_t i = 0; i < old_capacity; i++)
+	{
+		if (old_ctrl[ i ] < 0)		/* empty or deleted */
+			continue;
+		const uint64_t hash = pgm_tsimap_hash (old_slots[ i ].key);
+		const uint32_t j = pgm_tsimap_find_free (map, hash);
+		pgm_tsimap_set_ctrl (map, j, (int8_t)(hash & 0x7f));
+		map->slots[ j ] = old_slots[ i ];
+		map->nnodes++;
+	}
+	pgm_free (old_ctrl);
+	pgm_free (old_slots);
+}
+
+/* first empty or deleted slot on the probe sequence for hash.
+ */
+
+static
+uint32_t
+pgm_tsimap_find_free (
+	const pgm_tsimap_t*	map,
+	const uint64_t		hash
+	)
+{
+	uint32_t pos = (uint32_t)(hash >> 7) & map->mask;
+
+	for (uint32_t stride = 0;;)
+	{
+		const unsigned match = pgm_tsimap_match (&map->ctrl[ pos ], PGM_TSIMAP_EMPTY) |
+				       pgm_tsimap_match (&map->ctrl[ pos ], PGM_TSIMAP_DELETED);
+		if (match)
+			return (pos + pgm_tsimap_ctz (match)) & map->mask;
+		stride += PGM_TSIMAP_GROUP;
+		pos = (pos + stride) & map->mask;
+	}
+}
+
+/* update control byte and its mirror past the end of the table.
+ */
+
+static
+void
+pgm_tsimap_set_ctrl (
+	pgm_tsimap_t*	map,
+	const uint32_t	i,
+	const int8_t	tag
+	)
+{
+	map->ctrl[ i ] = tag;
+	if (i < PGM_TSIMAP_GROUP)
+		map->ctrl[ map->mask + 1 + i ] = tag;
+}
+
+/* eof */
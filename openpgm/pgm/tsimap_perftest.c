@@ -0,0 +1,256 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * performance tests for TSI to peer lookup, chained hash table vs.
+ * open-addressing map with interleaved sources.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+
+/* mock state */
+
+#define TEST_LOOKUPS		(4 * 1000 * 1000)
+
+static unsigned perf_peers = 0;
+
+
+static
+void
+mock_setup_10 (void)
+{
+	perf_peers = 10;
+}
+
+static
+void
+mock_setup_1k (void)
+{
+	perf_peers = 1000;
+}
+
+static
+void
+mock_setup_100k (void)
+{
+	perf_peers = 100000;
+}
+
+#define TSIMAP_DEBUG
+#include "tsimap.c"
+
+static
+void
+mock_setup (void)
+{
+	g_assert (pgm_time_init (NULL));
+}
+
+static
+void
+mock_teardown (void)
+{
+	g_assert (pgm_time_shutdown ());
+}
+
+/* random session identifiers, the value of each is its own index plus one.
+ */
+
+static
+pgm_tsi_t*
+generate_tsis (
+	const unsigned	count
+	)
+{
+	pgm_tsi_t* tsis = g_new (pgm_tsi_t, count);
+	for (unsigned i = 0, j = 1; i < count; i++) {
+		for (unsigned x = 0; x < sizeof(pgm_tsi_t); x++) {
+			j = j * 1103515245 + 12345;
+			((guint8*)&tsis[ i ])[ x ] = j >> 16;
+		}
+	}
+	return tsis;
+}
+
+/* target:
+ *	void*
+ *	pgm_hashtable_lookup (
+ *		const pgm_hashtable_t*	hash_table,
+ *		const void*		key
+ *	)
+ *
+ *	void*
+ *	pgm_tsimap_lookup (
+ *		const pgm_tsimap_t*	map,
+ *		const pgm_tsi_t*	tsi
+ *	)
+ *
+ * each lookup selects a pseudo-random source, i.e. no locality between
+ * consecutive packets as with many interleaved senders.
+ */
+
+START_TEST (test_hashtable)
+{
+	pgm_tsi_t* tsis = generate_tsis (perf_peers);
+	pgm_hashtable_t* hash_table = pgm_hashtable_new (pgm_tsi_hash, pgm_tsi_equal);
+	for (unsigned i = 0; i < perf_peers; i++)
+		pgm_hashtable_insert (hash_table, &tsis[ i ], GUINT_TO_POINTER(i + 1));
+
+	guint64 sum = 0;
+	const pgm_time_t start = pgm_time_update_now();
+	for (unsigned i = TEST_LOOKUPS, j = 0; i; i--) {
+		j = j * 1103515245 + 12345;
+		sum += GPOINTER_TO_UINT(pgm_hashtable_lookup (hash_table, &tsis[ (j >> 8) % perf_peers ]));
+	}
+	const pgm_time_t elapsed = pgm_time_update_now() - start;
+	g_message ("hashtable/%u: elapsed time %" PGM_TIME_FORMAT " us, unit time %.1f ns",
+		perf_peers,
+		elapsed,
+		(1000.0 * (double)elapsed) / (double)TEST_LOOKUPS);
+	fail_if (0 == sum, "lookup failed");
+
+	pgm_hashtable_destroy (hash_table);
+	g_free (tsis);
+}
+END_TEST
+
+START_TEST (test_tsimap)
+{
+	pgm_tsi_t* tsis = generate_tsis (perf_peers);
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	for (unsigned i = 0; i < perf_peers; i++)
+		pgm_tsimap_insert (map, &tsis[ i ], GUINT_TO_POINTER(i + 1));
+
+	guint64 sum = 0;
+	const pgm_time_t start = pgm_time_update_now();
+	for (unsigned i = TEST_LOOKUPS, j = 0; i; i--) {
+		j = j * 1103515245 + 12345;
+		sum += GPOINTER_TO_UINT(pgm_tsimap_lookup (map, &tsis[ (j >> 8) % perf_peers ]));
+	}
+	const pgm_time_t elapsed = pgm_time_update_now() - start;
+	g_message ("tsimap/%u: elapsed time %" PGM_TIME_FORMAT " us, unit time %.1f ns, capacity %" PRIu32,
+		perf_peers,
+		elapsed,
+		(1000.0 * (double)elapsed) / (double)TEST_LOOKUPS,
+		map->mask + 1);
+	fail_if (0 == sum, "lookup failed");
+
+	pgm_tsimap_destroy (map);
+	g_free (tsis);
+}
+END_TEST
+
+/* peers expire and are replaced, every live entry must remain reachable
+ * through tombstones and in-place rehashes, absent entries must miss.
+ */
+
+START_TEST (test_tsimap_churn)
+{
+	const unsigned total = perf_peers * 4;
+	pgm_tsi_t* tsis = generate_tsis (total);
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	for (unsigned i = 0; i < perf_peers; i++)
+		pgm_tsimap_insert (map, &tsis[ i ], GUINT_TO_POINTER(i + 1));
+
+	const pgm_time_t start = pgm_time_update_now();
+	for (unsigned i = perf_peers; i < total; i++) {
+		fail_unless (pgm_tsimap_remove (map, &tsis[ i - perf_peers ]), "remove failed");
+		pgm_tsimap_insert (map, &tsis[ i ], GUINT_TO_POINTER(i + 1));
+	}
+	const pgm_time_t elapsed = pgm_time_update_now() - start;
+	g_message ("tsimap-churn/%u: elapsed time %" PGM_TIME_FORMAT " us, unit time %.1f ns, capacity %" PRIu32,
+		perf_peers,
+		elapsed,
+		(1000.0 * (double)elapsed) / (double)(total - perf_peers),
+		map->mask + 1);
+
+	fail_unless (perf_peers == map->nnodes, "size mismatch");
+	for (unsigned i = 0; i < total; i++) {
+		void* value = pgm_tsimap_lookup (map, &tsis[ i ]);
+		if (i < total - perf_peers)
+			fail_unless (NULL == value, "removed entry found");
+		else
+			fail_unless (GUINT_TO_POINTER(i + 1) == value, "entry lost");
+	}
+
+	pgm_tsimap_destroy (map);
+	g_free (tsis);
+}
+END_TEST
+
+
+static
+Suite*
+make_tsimap_performance_suite (void)
+{
+	Suite* s;
+
+	s = suite_create ("TSI lookup performance");
+
+	TCase* tc_10 = tcase_create ("10");
+	suite_add_tcase (s, tc_10);
+	tcase_add_checked_fixture (tc_10, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_10, mock_setup_10, NULL);
+	tcase_add_test (tc_10, test_hashtable);
+	tcase_add_test (tc_10, test_tsimap);
+	tcase_add_test (tc_10, test_tsimap_churn);
+
+	TCase* tc_1k = tcase_create ("1k");
+	suite_add_tcase (s, tc_1k);
+	tcase_add_checked_fixture (tc_1k, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_1k, mock_setup_1k, NULL);
+	tcase_add_test (tc_1k, test_hashtable);
+	tcase_add_test (tc_1k, test_tsimap);
+	tcase_add_test (tc_1k, test_tsimap_churn);
+
+	TCase* tc_100k = tcase_create ("100k");
+	suite_add_tcase (s, tc_100k);
+	tcase_add_checked_fixture (tc_100k, mock_setup, mock_teardown);
+	tcase_add_checked_fixture (tc_100k, mock_setup_100k, NULL);
+	tcase_add_test (tc_100k, test_hashtable);
+	tcase_add_test (tc_100k, test_tsimap);
+	tcase_add_test (tc_100k, test_tsimap_churn);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_tsimap_performance_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
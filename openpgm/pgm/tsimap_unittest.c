@@ -0,0 +1,311 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for the TSI to peer map.
+ *
+ * Copyright (c) 2010-2016 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+#define TEST_NODES		10000
+
+
+#define TSIMAP_DEBUG
+#include "tsimap.c"
+
+PGM_GNUC_INTERNAL
+int
+pgm_get_nprocs (void)
+{
+	return 1;
+}
+
+/* distinct TSI per index, varying both the GSI and the source port */
+static
+pgm_tsi_t
+generate_tsi (
+	const unsigned		i
+	)
+{
+	pgm_tsi_t tsi;
+	memset (&tsi, 0, sizeof(tsi));
+	tsi.gsi.identifier[0] = 1;
+	tsi.gsi.identifier[2] = (uint8_t)(i >> 16);
+	tsi.gsi.identifier[4] = (uint8_t)(i >> 8);
+	tsi.gsi.identifier[5] = (uint8_t)i;
+	tsi.sport = (uint16_t)(1000 + (i & 0xff));
+	return tsi;
+}
+
+/* any non-NULL value unique to the index */
+#define TEST_VALUE(i)		((void*)(uintptr_t)(0x1000 + (i)))
+
+/* target:
+ *	pgm_tsimap_t*
+ *	pgm_tsimap_new (void)
+ *
+ *	void
+ *	pgm_tsimap_destroy (
+ *		pgm_tsimap_t*		map
+ *	)
+ */
+
+START_TEST (test_new_pass_001)
+{
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	fail_if (NULL == map, "new failed");
+	fail_unless (0 == map->nnodes, "not empty");
+	fail_unless (0 == map->ndeleted, "tombstones");
+	fail_unless (TSIMAP_MIN_SIZE == map->mask + 1, "capacity");
+	pgm_tsimap_destroy (map);
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_tsimap_insert (
+ *		pgm_tsimap_t*		map,
+ *		const pgm_tsi_t*	tsi,
+ *		void*			value
+ *	)
+ *
+ *	void*
+ *	pgm_tsimap_lookup (
+ *		const pgm_tsimap_t*	map,
+ *		const pgm_tsi_t*	tsi
+ *	)
+ */
+
+START_TEST (test_insert_pass_001)
+{
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	fail_if (NULL == map, "new failed");
+	for (unsigned i = 0; i < 8; i++) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		fail_unless (NULL == pgm_tsimap_lookup (map, &tsi), "present before insert");
+		pgm_tsimap_insert (map, &tsi, TEST_VALUE(i));
+		fail_unless (TEST_VALUE(i) == pgm_tsimap_lookup (map, &tsi), "lookup failed");
+	}
+	fail_unless (8 == map->nnodes, "nnodes");
+	for (unsigned i = 0; i < 8; i++) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		fail_unless (TEST_VALUE(i) == pgm_tsimap_lookup (map, &tsi), "lookup failed");
+	}
+	const pgm_tsi_t absent = generate_tsi (8);
+	fail_unless (NULL == pgm_tsimap_lookup (map, &absent), "absent key found");
+	pgm_tsimap_destroy (map);
+}
+END_TEST
+
+/* TSIs differing only in the source port are distinct keys */
+START_TEST (test_insert_pass_002)
+{
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	fail_if (NULL == map, "new failed");
+	pgm_tsi_t tsi = generate_tsi (1);
+	pgm_tsimap_insert (map, &tsi, TEST_VALUE(1));
+	tsi.sport++;
+	fail_unless (NULL == pgm_tsimap_lookup (map, &tsi), "port ignored");
+	pgm_tsimap_insert (map, &tsi, TEST_VALUE(2));
+	fail_unless (TEST_VALUE(2) == pgm_tsimap_lookup (map, &tsi), "lookup failed");
+	tsi.sport--;
+	fail_unless (TEST_VALUE(1) == pgm_tsimap_lookup (map, &tsi), "lookup failed");
+	pgm_tsimap_destroy (map);
+}
+END_TEST
+
+/* a duplicate is refused and the original value kept */
+START_TEST (test_insert_pass_003)
+{
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	fail_if (NULL == map, "new failed");
+	const pgm_tsi_t tsi = generate_tsi (1);
+	pgm_tsimap_insert (map, &tsi, TEST_VALUE(1));
+	pgm_tsimap_insert (map, &tsi, TEST_VALUE(2));
+	fail_unless (1 == map->nnodes, "duplicate inserted");
+	fail_unless (TEST_VALUE(1) == pgm_tsimap_lookup (map, &tsi), "value replaced");
+	pgm_tsimap_destroy (map);
+}
+END_TEST
+
+/* growth keeps every entry reachable and the load factor bounded */
+START_TEST (test_insert_pass_004)
+{
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	fail_if (NULL == map, "new failed");
+	uint32_t capacity = map->mask + 1;
+	unsigned resizes = 0;
+	for (unsigned i = 0; i < TEST_NODES; i++) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		pgm_tsimap_insert (map, &tsi, TEST_VALUE(i));
+		if (map->mask + 1 != capacity) {
+			fail_unless (map->mask + 1 == capacity * 2, "capacity not doubled");
+			capacity = map->mask + 1;
+			resizes++;
+		}
+		fail_unless ((map->nnodes + map->ndeleted) * 8 <= capacity * 7, "load factor");
+	}
+	fail_unless (TEST_NODES == map->nnodes, "nnodes");
+	fail_unless (resizes > 0, "never grew");
+	for (unsigned i = 0; i < TEST_NODES; i++) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		fail_unless (TEST_VALUE(i) == pgm_tsimap_lookup (map, &tsi), "lookup after growth failed");
+	}
+	pgm_tsimap_destroy (map);
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_tsimap_remove (
+ *		pgm_tsimap_t*		map,
+ *		const pgm_tsi_t*	tsi
+ *	)
+ */
+
+START_TEST (test_remove_pass_001)
+{
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	fail_if (NULL == map, "new failed");
+	const pgm_tsi_t tsi = generate_tsi (1);
+	fail_unless (FALSE == pgm_tsimap_remove (map, &tsi), "removed absent key");
+	pgm_tsimap_insert (map, &tsi, TEST_VALUE(1));
+	fail_unless (TRUE == pgm_tsimap_remove (map, &tsi), "remove failed");
+	fail_unless (NULL == pgm_tsimap_lookup (map, &tsi), "found after remove");
+	fail_unless (FALSE == pgm_tsimap_remove (map, &tsi), "removed twice");
+	fail_unless (0 == map->nnodes, "nnodes");
+	fail_unless (1 == map->ndeleted, "no tombstone");
+	pgm_tsimap_destroy (map);
+}
+END_TEST
+
+/* keys sharing the one group of the minimum table probe past tombstones,
+ * and a later insert reuses a tombstone.
+ */
+START_TEST (test_remove_pass_002)
+{
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	fail_if (NULL == map, "new failed");
+	for (unsigned i = 0; i < 12; i++) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		pgm_tsimap_insert (map, &tsi, TEST_VALUE(i));
+	}
+	fail_unless (TSIMAP_MIN_SIZE == map->mask + 1, "grew early");
+	for (unsigned i = 0; i < 12; i += 2) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		fail_unless (TRUE == pgm_tsimap_remove (map, &tsi), "remove failed");
+	}
+	fail_unless (6 == map->nnodes, "nnodes");
+	fail_unless (6 == map->ndeleted, "ndeleted");
+	for (unsigned i = 0; i < 12; i++) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		fail_unless ((i & 1 ? TEST_VALUE(i) : NULL) == pgm_tsimap_lookup (map, &tsi), "lookup past tombstone failed");
+	}
+	const pgm_tsi_t tsi = generate_tsi (0);
+	pgm_tsimap_insert (map, &tsi, TEST_VALUE(100));
+	fail_unless (TEST_VALUE(100) == pgm_tsimap_lookup (map, &tsi), "reinsert failed");
+	fail_unless (7 == map->nnodes, "nnodes");
+	fail_unless (5 == map->ndeleted, "tombstone not reused");
+	pgm_tsimap_destroy (map);
+}
+END_TEST
+
+/* churn purges tombstones in place rather than growing the table */
+START_TEST (test_remove_pass_003)
+{
+	pgm_tsimap_t* map = pgm_tsimap_new ();
+	fail_if (NULL == map, "new failed");
+	for (unsigned i = 0; i < TEST_NODES; i++) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		pgm_tsimap_insert (map, &tsi, TEST_VALUE(i));
+		if (i >= 4) {
+			const pgm_tsi_t old = generate_tsi (i - 4);
+			fail_unless (TRUE == pgm_tsimap_remove (map, &old), "remove failed");
+		}
+		fail_unless ((map->nnodes + map->ndeleted) * 8 <= (map->mask + 1) * 7, "load factor");
+	}
+	fail_unless (4 == map->nnodes, "nnodes");
+	fail_unless (TSIMAP_MIN_SIZE == map->mask + 1, "grew under churn");
+	for (unsigned i = TEST_NODES - 4; i < TEST_NODES; i++) {
+		const pgm_tsi_t tsi = generate_tsi (i);
+		fail_unless (TEST_VALUE(i) == pgm_tsimap_lookup (map, &tsi), "lookup failed");
+	}
+	pgm_tsimap_destroy (map);
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_new = tcase_create ("new");
+	suite_add_tcase (s, tc_new);
+	tcase_add_test (tc_new, test_new_pass_001);
+
+	TCase* tc_insert = tcase_create ("insert");
+	suite_add_tcase (s, tc_insert);
+	tcase_add_test (tc_insert, test_insert_pass_001);
+	tcase_add_test (tc_insert, test_insert_pass_002);
+	tcase_add_test (tc_insert, test_insert_pass_003);
+	tcase_add_test (tc_insert, test_insert_pass_004);
+
+	TCase* tc_remove = tcase_create ("remove");
+	suite_add_tcase (s, tc_remove);
+	tcase_add_test (tc_remove, test_remove_pass_001);
+	tcase_add_test (tc_remove, test_remove_pass_002);
+	tcase_add_test (tc_remove, test_remove_pass_003);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
@@ -33,6 +33,9 @@
 #	define PGM_DISABLE_ASSERT
 #endif
 
+/* arena slots start on a cache line */
+#define PGM_TXW_SLOT_ALIGN		64
+
 
 /* testing function: is TSI null
  *
@@ -77,8 +80,7 @@ _pgm_txw_peek (
 
 	if (pgm_uint32_gte (sequence, window->trail) && pgm_uint32_lte (sequence, window->lead))
 	{
-		const uint_fast32_t index_ = sequence % pgm_txw_max_length (window);
-		skb = window->pdata[index_];
+		skb = window->pdata[ sequence & window->mask ];
 		pgm_assert (NULL != skb);
 		pgm_assert (pgm_skb_is_valid (skb));
 		pgm_assert (pgm_tsi_is_null (&skb->tsi));
@@ -152,8 +154,10 @@ pgm_txw_retransmit_is_empty (
 /* globals */
 
 static void pgm_txw_remove_tail (pgm_txw_t*const);
-static bool pgm_txw_retransmit_push_parity (pgm_txw_t*const, const uint32_t, const uint8_t);
-static bool pgm_txw_retransmit_push_selective (pgm_txw_t*const, const uint32_t);
+static void pgm_txw_proactive_add (pgm_txw_t*const restrict, const struct pgm_sk_buff_t*const restrict);
+static bool pgm_txw_retransmit_push_parity (pgm_txw_t*const, const uint32_t, const uint8_t, const pgm_time_t);
+static bool pgm_txw_retransmit_push_selective (pgm_txw_t*const, const uint32_t, const pgm_time_t);
+static struct pgm_sk_buff_t* pgm_txw_retransmit_peek (pgm_txw_t*const restrict, struct pgm_sk_buff_t*restrict);
 
 
 /* constructor for transmit window.  zero-length windows are not permitted.
@@ -203,7 +207,9 @@ pgm_txw_create (
 /* calculate transmit window parameters */
 	pgm_assert (sqns || (tpdu_size && secs && max_rte));
 	const unsigned alloc_sqns = sqns ? sqns : (unsigned)( (secs * max_rte) / tpdu_size );
-	window = pgm_malloc0 (sizeof(pgm_txw_t) + ( alloc_sqns * sizeof(struct pgm_sk_buff_t*) ));
+/* pointer array is rounded up to a power of two for mask indexing */
+	const uint32_t pdata_len = (uint32_t)pgm_nearest_power (1, alloc_sqns);
+	window = pgm_malloc0 (sizeof(pgm_txw_t) + ( pdata_len * sizeof(struct pgm_sk_buff_t*) ));
 	window->tsi = tsi;
 
 /* empty state for transmission group boundaries to align.
@@ -223,6 +229,7 @@ pgm_txw_create (
 
 /* pointer array */
 	window->alloc = alloc_sqns;
+	window->mask = pdata_len - 1;
 
 /* post-conditions */
 	pgm_assert_cmpuint (pgm_txw_max_length (window), ==, alloc_sqns);
@@ -235,6 +242,142 @@ pgm_txw_create (
 	return window;
 }
 
+/* enable incremental encoding of the first rs_h parity packets of each
+ * transmission group as original data is added, such that pro-active parity
+ * is available as soon as the group is complete without a further pass over
+ * the group payloads.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_txw_set_proactive_parity (
+	pgm_txw_t*const		window,
+	const uint8_t		rs_h,		/* pro-active parity packets per group */
+	const uint16_t		max_tsdu
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (window->is_fec_enabled);
+	pgm_assert_cmpuint (rs_h, >, 0);
+	pgm_assert_cmpuint (rs_h, <=, window->rs.n - window->rs.k);
+	pgm_assert_cmpuint (max_tsdu, >, 0);
+	pgm_assert_cmpuint (window->rs_proactive_h, ==, 0);
+
+	pgm_debug ("set_proactive_parity (window:%p rs(h):%u max-tsdu:%" PRIu16 ")",
+		(const void*)window, rs_h, max_tsdu);
+
+	window->rs_proactive_h = rs_h;
+	window->max_tsdu = max_tsdu;
+	window->parity_stride = max_tsdu + sizeof(uint16_t) + sizeof(struct pgm_opt_fragment) - sizeof(struct pgm_opt_header);
+	for (unsigned i = 0; i < PGM_N_ELEMENTS(window->proactive); i++)
+		window->proactive[i].rows = pgm_malloc0 (rs_h * window->parity_stride);
+}
+
+/* parity packets are sent without a PGM checksum, skip the partial sum.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_txw_set_zero_checksum (
+	pgm_txw_t*const		window
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	window->is_zero_checksum = 1;
+}
+
+/* pre-allocate contiguous storage for the skbuffs of original data, such
+ * that neighbouring sequences share pages and cache lines for repairs and
+ * parity encoding.  one slot more than the window length ensures the slot
+ * for the next sequence has already left the trailing edge.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_txw_set_arena (
+	pgm_txw_t*const		window,
+	const uint16_t		max_tpdu,
+	const int		node,		/* NUMA node, -1 for first touch */
+	const bool		use_hugepages
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert_cmpuint (max_tpdu, >, 0);
+	pgm_assert (NULL == window->arena.base);
+
+	pgm_debug ("set_arena (window:%p max-tpdu:%" PRIu16 " node:%d use-hugepages:%s)",
+		(const void*)window, max_tpdu, node, use_hugepages ? "YES" : "NO");
+
+/* a window sized in sequence numbers has no TPDU size at creation */
+	if (window->is_fec_enabled &&
+	    window->parity_buffer->truesize < sizeof(struct pgm_sk_buff_t) + max_tpdu)
+	{
+		pgm_free_skb (window->parity_buffer);
+		window->parity_buffer = pgm_alloc_skb (max_tpdu);
+	}
+
+	const size_t stride = (sizeof(struct pgm_sk_buff_t) + max_tpdu + (PGM_TXW_SLOT_ALIGN - 1)) & ~(size_t)(PGM_TXW_SLOT_ALIGN - 1);
+	const unsigned slots = window->alloc + 1;
+	if (PGM_UNLIKELY(slots > SIZE_MAX / stride)) {
+		pgm_warn (_("Transmit window of %u sequences too large for arena."), window->alloc);
+		return;
+	}
+	window->arena_stride = stride;
+	window->arena_slots  = slots;
+	window->arena_next   = 0;
+/* zero users marks every slot free */
+	pgm_mem_arena_init (&window->arena, slots * stride, node, use_hugepages);
+}
+
+/* allocate an skbuff for original data, from the next arena slot unless that
+ * slot is still referenced, e.g. by a send batch or a repair in transit, in
+ * which case from the heap.  called with the source mutex held.
+ *
+ * returns pointer to skbuff of max_tpdu bytes.
+ */
+
+PGM_GNUC_INTERNAL
+struct pgm_sk_buff_t*
+pgm_txw_alloc_skb (
+	pgm_txw_t*const		window,
+	const uint16_t		max_tpdu
+	)
+{
+	struct pgm_sk_buff_t* skb;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	if (NULL == window->arena.base)
+		return pgm_alloc_skb (max_tpdu);
+
+	pgm_assert_cmpuint (sizeof(struct pgm_sk_buff_t) + max_tpdu, <=, window->arena_stride);
+
+	skb = (struct pgm_sk_buff_t*)(window->arena.base + (window->arena_next * window->arena_stride));
+	if (++window->arena_next == window->arena_slots)
+		window->arena_next = 0;
+	if (PGM_UNLIKELY(0 != pgm_atomic_read32 (&skb->users)))
+		return pgm_alloc_skb (max_tpdu);
+
+	if (PGM_UNLIKELY(pgm_mem_gc_friendly)) {
+		memset (skb, 0, sizeof(struct pgm_sk_buff_t) + max_tpdu);
+		skb->zero_padded = 1;
+	} else {
+		memset (skb, 0, sizeof(struct pgm_sk_buff_t));
+	}
+	skb->is_txw_slot = 1;
+	skb->truesize = max_tpdu + sizeof(struct pgm_sk_buff_t);
+	pgm_atomic_write32 (&skb->users, 1);
+	skb->head = skb + 1;
+	skb->data = skb->tail = skb->head;
+	skb->end  = (char*)skb->data + max_tpdu;
+	return skb;
+}
+
 /* destructor for transmit window.  must not be called more than once for same window.
  */
 
@@ -266,10 +409,16 @@ pgm_txw_shutdown (
 
 /* free reed-solomon state */
 	if (window->is_fec_enabled) {
+		for (unsigned i = 0; i < PGM_N_ELEMENTS(window->proactive); i++)
+			if (window->proactive[i].rows)
+				pgm_free (window->proactive[i].rows);
 		pgm_free_skb (window->parity_buffer);
 		pgm_rs_destroy (&window->rs);
 	}
 
+/* skbuff arena, every slot was released with the window contents */
+	pgm_mem_arena_destroy (&window->arena);
+
 /* window */
 	pgm_free (window);
 }
@@ -320,17 +469,90 @@ pgm_txw_add (
 	skb->sequence = window->lead;
 
 /* add skb to window */
-	const uint_fast32_t index_ = skb->sequence % pgm_txw_max_length (window);
-	window->pdata[index_] = skb;
+	window->pdata[ skb->sequence & window->mask ] = skb;
 
 /* statistics */
 	window->size += skb->len;
 
+/* accumulate pro-active parity whilst the payload is hot */
+	if (window->rs_proactive_h)
+		pgm_txw_proactive_add (window, skb);
+
 /* post-conditions */
 	pgm_assert_cmpuint (pgm_txw_length (window), >, 0);
 	pgm_assert_cmpuint (pgm_txw_length (window), <=, pgm_txw_max_length (window));
 }
 
+/* add the contribution of an original data packet to each pro-active parity
+ * packet of its transmission group.  a group that was not observed from its
+ * first packet is left incomplete and falls back to encoding on demand.
+ */
+
+static
+void
+pgm_txw_proactive_add (
+	pgm_txw_t*		    const restrict window,
+	const struct pgm_sk_buff_t* const restrict skb
+	)
+{
+	const uint32_t tg_sqn_mask = 0xffffffff << window->tg_sqn_shift;
+	const uint32_t tg_sqn      = skb->sequence &  tg_sqn_mask;
+	const uint8_t  pkt_sqn     = skb->sequence & ~tg_sqn_mask;
+	const uint16_t tsdu_length = pgm_ntohs (skb->pgm_header->pgm_tsdu_length);
+	struct pgm_txw_parity_t* parity = &window->proactive[ (tg_sqn >> window->tg_sqn_shift) & 1 ];
+	struct pgm_opt_fragment null_opt_fragment;
+	const pgm_gf8_t* opt_src;
+
+	if (0 == pkt_sqn) {
+		parity->tg_sqn		= tg_sqn;
+		parity->pkt_cnt		= 0;
+		parity->tsdu_length	= tsdu_length;
+		parity->is_var_pktlen	= 0;
+		parity->is_op_encoded	= 0;
+		memset (parity->rows, 0, window->rs_proactive_h * window->parity_stride);
+	} else if (parity->tg_sqn != tg_sqn || parity->pkt_cnt != pkt_sqn) {
+		return;
+	}
+
+	if (PGM_UNLIKELY(tsdu_length > window->max_tsdu)) {
+		pgm_trace (PGM_LOG_ROLE_TX_WINDOW,_("Sequence #%" PRIu32 " exceeds pro-active parity buffer."), skb->sequence);
+		parity->pkt_cnt = 0;
+		return;
+	}
+
+	if (tsdu_length != parity->tsdu_length) {
+		parity->is_var_pktlen = 1;
+		if (tsdu_length > parity->tsdu_length)
+			parity->tsdu_length = tsdu_length;
+	}
+
+/* encode every option separately, per pgm_txw_retransmit_try_peek() */
+	if (skb->pgm_header->pgm_options & PGM_OPT_PRESENT)
+		parity->is_op_encoded = 1;
+	if (skb->pgm_opt_fragment) {
+		opt_src = (const pgm_gf8_t*)((const char*)skb->pgm_opt_fragment + sizeof (struct pgm_opt_header));
+	} else {
+		memset (&null_opt_fragment, 0, sizeof(null_opt_fragment));
+		*(uint8_t*)&null_opt_fragment |= PGM_OP_ENCODED_NULL;
+		opt_src = (const pgm_gf8_t*)&null_opt_fragment;
+	}
+
+/* zero padding is implicit, appended TSDU length is summed separately as its
+ * position depends upon the largest TSDU of the complete group.
+ */
+	for (uint_fast8_t i = 0; i < window->rs_proactive_h; i++)
+	{
+		pgm_gf8_t* row = parity->rows + (i * window->parity_stride);
+		pgm_rs_encode_accumulate (&window->rs, skb->data, pkt_sqn, window->rs.k + i, row, tsdu_length);
+		pgm_rs_encode_accumulate (&window->rs, (const pgm_gf8_t*)&tsdu_length, pkt_sqn, window->rs.k + i,
+					  row + window->max_tsdu, sizeof(uint16_t));
+		pgm_rs_encode_accumulate (&window->rs, opt_src, pkt_sqn, window->rs.k + i,
+					  row + window->max_tsdu + sizeof(uint16_t),
+					  sizeof(struct pgm_opt_fragment) - sizeof(struct pgm_opt_header));
+	}
+	parity->pkt_cnt++;
+}
+
 /* peek an entry from the window for retransmission.
  *
  * returns pointer to skbuff on success, returns NULL on invalid parameters.
@@ -388,8 +610,7 @@ pgm_txw_remove_tail (
 
 /* remove reference to skb */
 	if (PGM_UNLIKELY(pgm_mem_gc_friendly)) {
-		const uint_fast32_t index_ = skb->sequence % pgm_txw_max_length (window);
-		window->pdata[index_] = NULL;
+		window->pdata[ skb->sequence & window->mask ] = NULL;
 	}
 	pgm_free_skb (skb);
 
@@ -409,6 +630,8 @@ pgm_txw_remove_tail (
  * transmisison group.  Parity NAKs are ignored if the packet count is
  * less than or equal to the count already queued for retransmission.
  *
+ * New requests are stamped with now to measure repair latency.
+ *
  * returns FALSE if request was eliminated, returns TRUE if request was
  * added to queue.
  */
@@ -419,7 +642,8 @@ pgm_txw_retransmit_push (
 	pgm_txw_t* const	window,
 	const uint32_t		sequence,
 	const bool		is_parity,	/* parity NAK ⇒ sequence_number = transmission group | packet count */
-	const uint8_t		tg_sqn_shift
+	const uint8_t		tg_sqn_shift,
+	const pgm_time_t	now
 	)
 {
 /* pre-conditions */
@@ -435,11 +659,11 @@ pgm_txw_retransmit_push (
 
 	if (is_parity)
 	{
-		return pgm_txw_retransmit_push_parity (window, sequence, tg_sqn_shift);
+		return pgm_txw_retransmit_push_parity (window, sequence, tg_sqn_shift, now);
 	}
 	else
 	{
-		return pgm_txw_retransmit_push_selective (window, sequence);
+		return pgm_txw_retransmit_push_selective (window, sequence, now);
 	}
 }
 
@@ -448,7 +672,8 @@ bool
 pgm_txw_retransmit_push_parity (
 	pgm_txw_t* const	window,
 	const uint32_t		sequence,
-	const uint8_t		tg_sqn_shift
+	const uint8_t		tg_sqn_shift,
+	const pgm_time_t	now
 	)
 {
 	struct pgm_sk_buff_t	*skb;
@@ -475,8 +700,8 @@ pgm_txw_retransmit_push_parity (
 /* check if request can be eliminated */
 	if (state->waiting_retransmit)
 	{
-		pgm_assert (NULL != ((const pgm_list_t*)skb)->next);
-		pgm_assert (NULL != ((const pgm_list_t*)skb)->prev);
+/* the queue head and tail have no prev and next links respectively */
+		pgm_assert (!pgm_queue_is_empty (&window->retransmit_queue));
 		if (state->pkt_cnt_requested < nak_pkt_cnt) {
 /* more parity packets requested than currently scheduled, simply bump up the count */
 			state->pkt_cnt_requested = nak_pkt_cnt;
@@ -495,6 +720,7 @@ pgm_txw_retransmit_push_parity (
 	pgm_queue_push_head_link (&window->retransmit_queue, (pgm_list_t*)skb);
 	pgm_assert (!pgm_queue_is_empty (&window->retransmit_queue));
 	state->waiting_retransmit = 1;
+	state->retransmit_tstamp = now;
 	return TRUE;
 }
 
@@ -502,7 +728,8 @@ static
 bool
 pgm_txw_retransmit_push_selective (
 	pgm_txw_t* const	window,
-	const uint32_t		sequence
+	const uint32_t		sequence,
+	const pgm_time_t	now
 	)
 {
 	struct pgm_sk_buff_t	*skb;
@@ -535,6 +762,7 @@ pgm_txw_retransmit_push_selective (
 	pgm_queue_push_head_link (&window->retransmit_queue, (pgm_list_t*)skb);
 	pgm_assert (!pgm_queue_is_empty (&window->retransmit_queue));
 	state->waiting_retransmit = 1;
+	state->retransmit_tstamp = now;
 	return TRUE;
 }
 
@@ -549,19 +777,11 @@ pgm_txw_retransmit_try_peek (
 	pgm_txw_t* const	window
 	)
 {
-	struct pgm_sk_buff_t	 *skb;
-	pgm_txw_state_t		 *state;
-	bool			  is_var_pktlen = FALSE;
-	bool			  is_op_encoded = FALSE;
-	uint16_t		  parity_length = 0;
-	const pgm_gf8_t		**src;
-	void			 *data;
+	struct pgm_sk_buff_t	*skb;
 
 /* pre-conditions */
 	pgm_assert (NULL != window);
 
-	src = pgm_newa (const pgm_gf8_t*, window->rs.k);
-
 	pgm_debug ("retransmit_try_peek (window:%p)", (const void*)window);
 
 /* no lock required to detect presence of a request */
@@ -570,6 +790,72 @@ pgm_txw_retransmit_try_peek (
 		pgm_debug ("retransmit queue empty on peek.");
 		return NULL;
 	}
+	return pgm_txw_retransmit_peek (window, skb);
+}
+
+/* try to peek up to count requests in queue order.  only one parity packet
+ * can be built at a time in the shared parity buffer so the burst ends after
+ * a parity request.  sent requests are removed by calling
+ * pgm_txw_retransmit_remove_head() once for each in order.
+ *
+ * returns count of skbs stored, zero if the queue is empty or the first
+ * request is still in transit.
+ */
+
+PGM_GNUC_INTERNAL
+unsigned
+pgm_txw_retransmit_try_peek_burst (
+	pgm_txw_t*	      const restrict window,
+	struct pgm_sk_buff_t**	    restrict skbs,
+	const unsigned			     count
+	)
+{
+	const pgm_list_t	*link;
+	unsigned		 n = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (NULL != skbs);
+
+	pgm_debug ("retransmit_try_peek_burst (window:%p skbs:%p count:%u)",
+		(const void*)window, (const void*)skbs, count);
+
+/* queue is pushed at the head and served from the tail */
+	link = pgm_queue_peek_tail_link (&window->retransmit_queue);
+	while (n < count && NULL != link)
+	{
+		struct pgm_sk_buff_t* skb = pgm_txw_retransmit_peek (window, (struct pgm_sk_buff_t*)link);
+		if (NULL == skb)
+			break;
+		skbs[ n++ ] = skb;
+		if (skb == window->parity_buffer)
+			break;
+		link = link->prev;
+	}
+	return n;
+}
+
+/* prepare the repair for one queued request, the skb itself for a selective
+ * request or a parity packet in the parity buffer.
+ *
+ * returns NULL if the original data is still in transit.
+ */
+
+static
+struct pgm_sk_buff_t*
+pgm_txw_retransmit_peek (
+	pgm_txw_t*	      const restrict window,
+	struct pgm_sk_buff_t*	    restrict skb
+	)
+{
+	pgm_txw_state_t		 *state;
+	bool			  is_var_pktlen = FALSE;
+	bool			  is_op_encoded = FALSE;
+	uint16_t		  parity_length = 0;
+	const pgm_gf8_t		**src;
+	void			 *data;
+
+	src = pgm_newa (const pgm_gf8_t*, window->rs.k);
 
 	pgm_assert (pgm_skb_is_valid (skb));
 	state = (pgm_txw_state_t*)&skb->cb;
@@ -591,10 +877,25 @@ pgm_txw_retransmit_try_peek (
 	const uint8_t rs_h = state->pkt_cnt_sent % (window->rs.n - window->rs.k);
 	const uint32_t tg_sqn_mask = 0xffffffff << window->tg_sqn_shift;
 	const uint32_t tg_sqn = skb->sequence & tg_sqn_mask;
-	for (uint_fast8_t i = 0; i < window->rs.k; i++)
+
+/* pro-active parity accumulated with the original data */
+	const struct pgm_txw_parity_t* proactive = NULL;
+	if (rs_h < window->rs_proactive_h) {
+		const struct pgm_txw_parity_t* parity = &window->proactive[ (tg_sqn >> window->tg_sqn_shift) & 1 ];
+		if (parity->tg_sqn == tg_sqn && parity->pkt_cnt == window->rs.k) {
+			proactive	= parity;
+			parity_length	= parity->tsdu_length;
+			is_var_pktlen	= parity->is_var_pktlen;
+			is_op_encoded	= parity->is_op_encoded;
+		}
+	}
+
+	for (uint_fast8_t i = 0; NULL == proactive && i < window->rs.k; i++)
 	{
 		const struct pgm_sk_buff_t* odata_skb = pgm_txw_peek (window, tg_sqn + i);
 		const uint16_t odata_tsdu_length = pgm_ntohs (odata_skb->pgm_header->pgm_tsdu_length);
+		if (i + 1 < window->rs.k)
+			pgm_prefetch (window->pdata[ (tg_sqn + i + 1) & window->mask ]);
 		if (!parity_length)
 		{
 			parity_length = odata_tsdu_length;
@@ -630,7 +931,7 @@ pgm_txw_retransmit_try_peek (
 	{
 		skb->pgm_header->pgm_options |= PGM_OPT_VAR_PKTLEN;
 
-		for (uint_fast8_t i = 0; i < window->rs.k; i++)
+		for (uint_fast8_t i = 0; NULL == proactive && i < window->rs.k; i++)
 		{
 			struct pgm_sk_buff_t* odata_skb = pgm_txw_peek (window, tg_sqn + i);
 			const uint16_t odata_tsdu_length = pgm_ntohs (odata_skb->pgm_header->pgm_tsdu_length);
@@ -679,7 +980,7 @@ pgm_txw_retransmit_try_peek (
 		memset (&null_opt_fragment, 0, sizeof(null_opt_fragment));
 		*(uint8_t*)&null_opt_fragment |= PGM_OP_ENCODED_NULL;
 
-		for (uint_fast8_t i = 0; i < window->rs.k; i++)
+		for (uint_fast8_t i = 0; NULL == proactive && i < window->rs.k; i++)
 		{
 			const struct pgm_sk_buff_t* odata_skb = pgm_txw_peek (window, tg_sqn + i);
 
@@ -718,33 +1019,55 @@ pgm_txw_retransmit_try_peek (
  *
  *   "warning: dereferencing type-punned pointer will break strict-aliasing rules"
  */
-		pgm_rs_encode (&window->rs,
-				opt_src,
-				window->rs.k + rs_h,
-				(pgm_gf8_t*)((char*)opt_fragment + sizeof(struct pgm_opt_header)),
+		if (proactive)
+			memcpy ((char*)opt_fragment + sizeof(struct pgm_opt_header),
+				proactive->rows + (rs_h * window->parity_stride) + window->max_tsdu + sizeof(uint16_t),
 				sizeof(struct pgm_opt_fragment) - sizeof(struct pgm_opt_header));
+		else
+			pgm_rs_encode (&window->rs,
+					opt_src,
+					window->rs.k + rs_h,
+					(pgm_gf8_t*)((char*)opt_fragment + sizeof(struct pgm_opt_header)),
+					sizeof(struct pgm_opt_fragment) - sizeof(struct pgm_opt_header));
 
 		data = opt_fragment + 1;
 	}
 
 /* encode payload */
-	pgm_rs_encode (&window->rs,
-			src,
-			window->rs.k + rs_h,
-			data,
-			parity_length);
+	if (proactive)
+	{
+		const pgm_gf8_t* row = proactive->rows + (rs_h * window->parity_stride);
+		memcpy (data, row, proactive->tsdu_length);
+		if (is_var_pktlen)
+			memcpy ((char*)data + proactive->tsdu_length, row + window->max_tsdu, sizeof(uint16_t));
+	}
+	else
+	{
+		pgm_rs_encode (&window->rs,
+				src,
+				window->rs.k + rs_h,
+				data,
+				parity_length);
+	}
 
-/* calculate partial checksum */
-	const uint16_t tsdu_length = pgm_ntohs (skb->pgm_header->pgm_tsdu_length);
-	state->unfolded_checksum = pgm_csum_partial ((char*)skb->tail - tsdu_length, tsdu_length, 0);
+/* calculate partial checksum of the parity packet, not the group lead */
+	state = (pgm_txw_state_t*)&skb->cb;
+	if (window->is_zero_checksum) {
+		state->unfolded_checksum = 0;
+	} else {
+		const uint16_t tsdu_length = pgm_ntohs (skb->pgm_header->pgm_tsdu_length);
+		state->unfolded_checksum = pgm_csum_partial ((char*)skb->tail - tsdu_length, tsdu_length, 0);
+	}
 	return skb;
 }
 
 /* remove head entry from retransmit queue, will fail on assertion if queue is empty.
+ *
+ * returns the time the request was queued.
  */
 
 PGM_GNUC_INTERNAL
-void
+pgm_time_t
 pgm_txw_retransmit_remove_head (
 	pgm_txw_t* const	window
 	)
@@ -783,6 +1106,7 @@ pgm_txw_retransmit_remove_head (
 		pgm_queue_pop_tail_link (&window->retransmit_queue);
 		state->waiting_retransmit = 0;
 	}
+	return state->retransmit_tstamp;
 }
 
 /* eof */
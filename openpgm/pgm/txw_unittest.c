@@ -37,6 +37,7 @@
 #define pgm_rs_create			mock_pgm_rs_create
 #define pgm_rs_destroy			mock_pgm_rs_destroy
 #define pgm_rs_encode			mock_pgm_rs_encode
+#define pgm_rs_encode_accumulate	mock_pgm_rs_encode_accumulate
 #define pgm_compat_csum_partial		mock_pgm_compat_csum_partial
 #define pgm_histogram_init		mock_pgm_histogram_init
 
@@ -44,6 +45,9 @@
 #include "txw.c"
 
 
+static unsigned mock_rs_encode_calls = 0;
+static unsigned mock_rs_accumulate_calls = 0;
+
 /** reed-solomon module */
 void
 mock_pgm_rs_create (
@@ -52,6 +56,8 @@ mock_pgm_rs_create (
 	uint8_t			k
 	)
 {
+	rs->n = n;
+	rs->k = k;
 }
 
 void
@@ -70,6 +76,20 @@ mock_pgm_rs_encode(
 	const uint16_t		len
         )
 {
+	mock_rs_encode_calls++;
+}
+
+void
+mock_pgm_rs_encode_accumulate (
+	pgm_rs_t*		rs,
+	const pgm_gf8_t*	src,
+	const uint8_t		src_offset,
+	const uint8_t		offset,
+	pgm_gf8_t*		dst,
+	const uint16_t		len
+	)
+{
+	mock_rs_accumulate_calls++;
 }
 
 /** checksum module */
@@ -117,15 +137,16 @@ pgm_get_nprocs (void)
 	return 1;
 }
 
-/* generate valid skb, data pointer pointing to PGM payload
+/* fill skb as valid, data pointer pointing to PGM payload
  */
 static
 struct pgm_sk_buff_t*
-generate_valid_skb (void)
+format_valid_skb (
+	struct pgm_sk_buff_t*	skb
+	)
 {
 	const guint16 tsdu_length = 1000;
 	const guint16 header_length = sizeof(struct pgm_header) + sizeof(struct pgm_data);
-	struct pgm_sk_buff_t* skb = pgm_alloc_skb (1500);
 /* fake but valid transport and timestamp */
 	skb->sock = (pgm_sock_t*)0x1;
 	skb->tstamp = 1;
@@ -141,6 +162,13 @@ generate_valid_skb (void)
 	return skb;
 }
 
+static
+struct pgm_sk_buff_t*
+generate_valid_skb (void)
+{
+	return format_valid_skb (pgm_alloc_skb (1500));
+}
+
 /* target:
  *	pgm_txw_t*
  *	pgm_txw_create (
@@ -330,6 +358,26 @@ START_TEST (test_peek_fail_001)
 }
 END_TEST
 
+/* window length not a power of two, after wrapping several times */
+START_TEST (test_peek_pass_002)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	struct pgm_sk_buff_t* skbs[100];
+	pgm_txw_t* window = pgm_txw_create (&tsi, 0, 100, 0, 0, FALSE, 0, 0);
+	fail_if (NULL == window, "create failed");
+	for (guint i = 0; i < 350; i++) {
+		struct pgm_sk_buff_t* skb = generate_valid_skb ();
+		pgm_txw_add (window, skb);
+		skbs[ i % 100 ] = skb;
+	}
+	fail_unless (100 == pgm_txw_length (window), "length failed");
+	for (guint32 sqn = 250; sqn < 350; sqn++)
+		fail_unless (skbs[ sqn % 100 ] == pgm_txw_peek (window, sqn), "peek failed");
+	fail_unless (NULL == pgm_txw_peek (window, 249), "peek failed");
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
 /* empty window */
 START_TEST (test_peek_fail_002)
 {
@@ -341,6 +389,82 @@ START_TEST (test_peek_fail_002)
 }
 END_TEST
 
+/* target:
+ *	struct pgm_sk_buff_t*
+ *	pgm_txw_alloc_skb (
+ *		pgm_txw_t* const	window,
+ *		const guint16		max_tpdu
+ *		)
+ */
+
+/* arena slots are recycled once released by the trailing edge */
+START_TEST (test_alloc_skb_pass_001)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	struct pgm_sk_buff_t* first = NULL;
+	pgm_txw_t* window = pgm_txw_create (&tsi, 0, 100, 0, 0, FALSE, 0, 0);
+	fail_if (NULL == window, "create failed");
+	pgm_txw_set_arena (window, 1500, -1, FALSE);
+	for (guint i = 0; i < 350; i++) {
+		struct pgm_sk_buff_t* skb = pgm_txw_alloc_skb (window, 1500);
+		fail_unless (skb->is_txw_slot, "heap allocation");
+		fail_unless ((char*)skb->end - (char*)skb->head == 1500, "tpdu size");
+		if (0 == i)
+			first = skb;
+		else if (0 == i % 101)
+			fail_unless (first == skb, "slot not recycled");
+		pgm_txw_add (window, format_valid_skb (skb));
+	}
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
+/* referenced slot, e.g. a repair in transit, falls back to the heap */
+START_TEST (test_alloc_skb_pass_002)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	struct pgm_sk_buff_t* held = NULL;
+	pgm_txw_t* window = pgm_txw_create (&tsi, 0, 100, 0, 0, FALSE, 0, 0);
+	fail_if (NULL == window, "create failed");
+	pgm_txw_set_arena (window, 1500, -1, FALSE);
+	for (guint i = 0; i < 101; i++) {
+		struct pgm_sk_buff_t* skb = pgm_txw_alloc_skb (window, 1500);
+		if (0 == i)
+			held = pgm_skb_get (skb);
+		pgm_txw_add (window, format_valid_skb (skb));
+	}
+	struct pgm_sk_buff_t* skb = pgm_txw_alloc_skb (window, 1500);
+	fail_if (held == skb, "held slot reused");
+	fail_if (skb->is_txw_slot, "held slot reused");
+	pgm_txw_add (window, format_valid_skb (skb));
+	pgm_free_skb (held);
+	for (guint i = 0; i < 100; i++)
+		pgm_txw_add (window, format_valid_skb (pgm_txw_alloc_skb (window, 1500)));
+	skb = pgm_txw_alloc_skb (window, 1500);
+	fail_unless (held == skb, "released slot not recycled");
+	pgm_txw_add (window, format_valid_skb (skb));
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
+/* mapped arena on a NUMA node and hugepages, or the heap where unavailable */
+START_TEST (test_alloc_skb_pass_003)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	pgm_txw_t* window = pgm_txw_create (&tsi, 0, 100, 0, 0, FALSE, 0, 0);
+	fail_if (NULL == window, "create failed");
+	pgm_txw_set_arena (window, 1500, 0, TRUE);
+	fail_if (NULL == window->arena.base, "arena failed");
+	fail_unless (window->arena.len >= 101 * window->arena_stride, "arena length");
+	for (guint i = 0; i < 350; i++) {
+		struct pgm_sk_buff_t* skb = pgm_txw_alloc_skb (window, 1500);
+		fail_unless (skb->is_txw_slot, "heap allocation");
+		pgm_txw_add (window, format_valid_skb (skb));
+	}
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
 /** inline function tests **/
 /* pgm_txw_max_length () 
  */
@@ -536,7 +660,8 @@ END_TEST
  *		pgm_txw_t* const	window,
  *		const uint32_t		sequence,
  *		const bool		is_parity,
- *		const uint8_t		tg_sqn_shift
+ *		const uint8_t		tg_sqn_shift,
+ *		const pgm_time_t	now
  *		)
  */
 
@@ -546,21 +671,21 @@ START_TEST (test_retransmit_push_pass_001)
 	pgm_txw_t* window = pgm_txw_create (&tsi, 0, 100, 0, 0, FALSE, 0, 0);
 	fail_if (NULL == window, "create failed");
 /* empty window invalidates all requests */
-	fail_unless (FALSE == pgm_txw_retransmit_push (window, window->trail, FALSE, 0), "retransmit_push failed");
+	fail_unless (FALSE == pgm_txw_retransmit_push (window, window->trail, FALSE, 0, 0), "retransmit_push failed");
 	struct pgm_sk_buff_t* skb = generate_valid_skb ();
 	fail_if (NULL == skb, "generate_valid_skb failed");
 	pgm_txw_add (window, skb);
 /* first request */
-	fail_unless (TRUE == pgm_txw_retransmit_push (window, window->trail, FALSE, 0), "retransmit_push failed");
+	fail_unless (TRUE == pgm_txw_retransmit_push (window, window->trail, FALSE, 0, 0), "retransmit_push failed");
 /* second request eliminated */
-	fail_unless (FALSE == pgm_txw_retransmit_push (window, window->trail, FALSE, 0), "retransmit_push failed");
+	fail_unless (FALSE == pgm_txw_retransmit_push (window, window->trail, FALSE, 0, 0), "retransmit_push failed");
 	pgm_txw_shutdown (window);
 }
 END_TEST
 
 START_TEST (test_retransmit_push_fail_001)
 {
-	const bool answer = pgm_txw_retransmit_push (NULL, 0, FALSE, 0);
+	const bool answer = pgm_txw_retransmit_push (NULL, 0, FALSE, 0, 0);
 	fail ("reached");
 }
 END_TEST
@@ -580,12 +705,110 @@ START_TEST (test_retransmit_try_peek_pass_001)
 	struct pgm_sk_buff_t* skb = generate_valid_skb ();
 	fail_if (NULL == skb, "generate_valid_skb failed");
 	pgm_txw_add (window, skb);
-	fail_unless (1 == pgm_txw_retransmit_push (window, window->trail, FALSE, 0), "retransmit_push failed");
+	fail_unless (1 == pgm_txw_retransmit_push (window, window->trail, FALSE, 0, 0), "retransmit_push failed");
 	fail_unless (NULL != pgm_txw_retransmit_try_peek (window), "retransmit_try_peek failed");
 	pgm_txw_shutdown (window);
 }
 END_TEST
 
+/* pro-active parity of a complete transmission group is served from the
+ * incremental encoder without re-reading the original data.
+ */
+START_TEST (test_retransmit_try_peek_pass_002)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const guint8 rs_k = 4, rs_h = 2;
+	pgm_txw_t* window = pgm_txw_create (&tsi, 1500, 0, 60, 1500 * 100, TRUE, 255, rs_k);
+	fail_if (NULL == window, "create failed");
+	pgm_txw_set_proactive_parity (window, rs_h, 1500);
+	mock_rs_encode_calls = mock_rs_accumulate_calls = 0;
+	for (unsigned i = 0; i < rs_k; i++) {
+		struct pgm_sk_buff_t* skb = generate_valid_skb ();
+		fail_if (NULL == skb, "generate_valid_skb failed");
+		pgm_txw_add (window, skb);
+	}
+	fail_unless (rs_k * rs_h * 3 == mock_rs_accumulate_calls, "accumulate calls %u", mock_rs_accumulate_calls);
+	fail_unless (TRUE == pgm_txw_retransmit_push (window, window->trail | rs_h, TRUE, window->tg_sqn_shift, 0), "retransmit_push failed");
+/* raise pending request to h packets */
+	pgm_txw_state_t* state = (pgm_txw_state_t*)&pgm_txw_peek (window, window->trail)->cb;
+	state->pkt_cnt_requested = rs_h;
+	for (unsigned i = 0; i < rs_h; i++) {
+		const struct pgm_sk_buff_t* skb = pgm_txw_retransmit_try_peek (window);
+		fail_if (NULL == skb, "retransmit_try_peek failed");
+		fail_unless (skb->pgm_header->pgm_options & PGM_OPT_PARITY, "not parity");
+		fail_unless (1000 == g_ntohs (skb->pgm_header->pgm_tsdu_length), "tsdu length");
+		fail_unless (i == g_ntohl (skb->pgm_data->data_sqn), "parity sqn");
+		pgm_txw_retransmit_remove_head (window);
+	}
+	fail_unless (0 == mock_rs_encode_calls, "encode calls %u", mock_rs_encode_calls);
+/* on-demand parity beyond h is encoded from the window */
+	fail_unless (TRUE == pgm_txw_retransmit_push (window, window->trail | 1, TRUE, window->tg_sqn_shift, 0), "retransmit_push failed");
+	fail_if (NULL == pgm_txw_retransmit_try_peek (window), "retransmit_try_peek failed");
+	fail_unless (1 == mock_rs_encode_calls, "encode calls %u", mock_rs_encode_calls);
+	pgm_txw_retransmit_remove_head (window);
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
+/* target:
+ *	unsigned
+ *	pgm_txw_retransmit_try_peek_burst (
+ *		pgm_txw_t* const	window,
+ *		struct pgm_sk_buff_t**	skbs,
+ *		const unsigned		count
+ *		)
+ */
+
+START_TEST (test_retransmit_try_peek_burst_pass_001)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	struct pgm_sk_buff_t* skbs[ 4 ];
+	pgm_txw_t* window = pgm_txw_create (&tsi, 0, 100, 0, 0, FALSE, 0, 0);
+	fail_if (NULL == window, "create failed");
+	fail_unless (0 == pgm_txw_retransmit_try_peek_burst (window, skbs, 4), "retransmit_try_peek_burst failed");
+	for (unsigned i = 0; i < 3; i++) {
+		struct pgm_sk_buff_t* skb = generate_valid_skb ();
+		fail_if (NULL == skb, "generate_valid_skb failed");
+		pgm_txw_add (window, skb);
+		fail_unless (TRUE == pgm_txw_retransmit_push (window, window->lead, FALSE, 0, 100 + i), "retransmit_push failed");
+	}
+/* served oldest request first, bounded by count */
+	fail_unless (2 == pgm_txw_retransmit_try_peek_burst (window, skbs, 2), "retransmit_try_peek_burst failed");
+	fail_unless (window->trail == skbs[0]->sequence, "sequence");
+	fail_unless (window->trail + 1 == skbs[1]->sequence, "sequence");
+	fail_unless (3 == pgm_txw_retransmit_try_peek_burst (window, skbs, 4), "retransmit_try_peek_burst failed");
+	fail_unless (100 == pgm_txw_retransmit_remove_head (window), "queued time");
+	fail_unless (101 == pgm_txw_retransmit_remove_head (window), "queued time");
+	fail_unless (1 == pgm_txw_retransmit_try_peek_burst (window, skbs, 4), "retransmit_try_peek_burst failed");
+	fail_unless (window->lead == skbs[0]->sequence, "sequence");
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
+/* parity repairs share one buffer and end the burst */
+START_TEST (test_retransmit_try_peek_burst_pass_002)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const guint8 rs_k = 4;
+	struct pgm_sk_buff_t* skbs[ 4 ];
+	pgm_txw_t* window = pgm_txw_create (&tsi, 1500, 0, 60, 1500 * 100, TRUE, 255, rs_k);
+	fail_if (NULL == window, "create failed");
+	for (unsigned i = 0; i < rs_k * 2; i++) {
+		struct pgm_sk_buff_t* skb = generate_valid_skb ();
+		fail_if (NULL == skb, "generate_valid_skb failed");
+		pgm_txw_add (window, skb);
+	}
+	fail_unless (TRUE == pgm_txw_retransmit_push (window, window->trail | 1, TRUE, window->tg_sqn_shift, 0), "retransmit_push failed");
+	fail_unless (TRUE == pgm_txw_retransmit_push (window, window->lead, FALSE, 0, 0), "retransmit_push failed");
+	fail_unless (1 == pgm_txw_retransmit_try_peek_burst (window, skbs, 4), "retransmit_try_peek_burst failed");
+	fail_unless (skbs[0]->pgm_header->pgm_options & PGM_OPT_PARITY, "not parity");
+	pgm_txw_retransmit_remove_head (window);
+	fail_unless (1 == pgm_txw_retransmit_try_peek_burst (window, skbs, 4), "retransmit_try_peek_burst failed");
+	fail_unless (window->lead == skbs[0]->sequence, "sequence");
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
 /* null window */
 START_TEST (test_retransmit_try_peek_fail_001)
 {
@@ -595,7 +818,7 @@ START_TEST (test_retransmit_try_peek_fail_001)
 END_TEST
 
 /* target:
- *	void
+ *	pgm_time_t
  *	pgm_txw_retransmit_remove_head (
  *		pgm_txw_t* const	window
  *		)
@@ -609,7 +832,7 @@ START_TEST (test_retransmit_remove_head_pass_001)
 	struct pgm_sk_buff_t* skb = generate_valid_skb ();
 	fail_if (NULL == skb, "generate_valid_skb failed");
 	pgm_txw_add (window, skb);
-	fail_unless (1 == pgm_txw_retransmit_push (window, window->trail, FALSE, 0), "retransmit_push failed");
+	fail_unless (1 == pgm_txw_retransmit_push (window, window->trail, FALSE, 0, 0), "retransmit_push failed");
 	fail_unless (NULL != pgm_txw_retransmit_try_peek (window), "retransmit_try_peek failed");
 	pgm_txw_retransmit_remove_head (window);
 	pgm_txw_shutdown (window);
@@ -678,9 +901,16 @@ make_test_suite (void)
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_peek, test_peek_fail_001, SIGABRT);
 #endif
+	tcase_add_test (tc_peek, test_peek_pass_002);
 /* logical not fatal errors */
 	tcase_add_test (tc_peek, test_peek_fail_002);
 
+	TCase* tc_alloc_skb = tcase_create ("alloc-skb");
+	suite_add_tcase (s, tc_alloc_skb);
+	tcase_add_test (tc_alloc_skb, test_alloc_skb_pass_001);
+	tcase_add_test (tc_alloc_skb, test_alloc_skb_pass_002);
+	tcase_add_test (tc_alloc_skb, test_alloc_skb_pass_003);
+
 	TCase* tc_max_length = tcase_create ("max-length");
 	suite_add_tcase (s, tc_max_length);
 	tcase_add_test (tc_max_length, test_max_length_pass_001);
@@ -746,6 +976,9 @@ make_test_suite (void)
 	TCase* tc_retransmit_try_peek = tcase_create ("retransmit-try-peek");
 	suite_add_tcase (s, tc_retransmit_try_peek);
 	tcase_add_test (tc_retransmit_try_peek, test_retransmit_try_peek_pass_001);
+	tcase_add_test (tc_retransmit_try_peek, test_retransmit_try_peek_pass_002);
+	tcase_add_test (tc_retransmit_try_peek, test_retransmit_try_peek_burst_pass_001);
+	tcase_add_test (tc_retransmit_try_peek, test_retransmit_try_peek_burst_pass_002);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_retransmit_try_peek, test_retransmit_try_peek_fail_001, SIGABRT);
 #endif